@@ -4,6 +4,7 @@
 
 #include <boost/variant.hpp>
 
+#include <functional>
 #include <string>
 #include <memory>
 #include <vector>
@@ -36,6 +37,25 @@ namespace sqlite
 
 	const vnull_t vnull;
 
+	// SB: column data owned by statement, it's valid until the next step, reset or destruction of the statement
+	struct text_view
+	{
+		const wchar_t* data;
+		size_t size;
+
+	public:
+		std::wstring str() const
+		{
+			return std::wstring(data, size);
+		}
+	};
+
+	struct blob_span
+	{
+		const byte_t* data;
+		size_t size;
+	};
+
 	class statement : sb::noncopyable
 	{
 	public:
@@ -47,9 +67,11 @@ namespace sqlite
 
 	private:
 		 value_t get_value_impl(int column_index);
+		 void check_column_type(int column_index, int expected_type);
 
 	public:
 		void reset();
+		void clear_bindings();
 		bool step();
 
 		template<typename T>
@@ -63,8 +85,26 @@ namespace sqlite
 			return *res;
 		}
 
+		// SB: typed accessors don't build value_t, text and blob aren't copied. They throw if column has another type, like get_value does
+		__int64 get_int64(int column_index);
+		double get_double(int column_index);
+		text_view get_text_view(int column_index);
+		blob_span get_blob_span(int column_index);
+
 		void bind_value(const value_t& val, int index);
 
+		// SB: typed binders don't build value_t. Text and blob aren't copied by SQLITE,
+		// so data should stay alive until the statement is stepped for the last time with this binding
+		void bind_int(int val, int index);
+		void bind_int64(__int64 val, int index);
+		void bind_double(double val, int index);
+		void bind_text(const wchar_t* data, size_t size, int index);
+		void bind_text(const std::wstring& val, int index);
+		void bind_text(std::wstring&& val, int index) = delete;
+		void bind_blob(const byte_t* data, size_t size, int index);
+		void bind_blob(const binary_t& val, int index);
+		void bind_blob(binary_t&& val, int index) = delete;
+
 		__int64 last_insert_row_id() const;
 
 	public:
@@ -76,20 +116,97 @@ namespace sqlite
 	template<>
 	int statement::get_value(int column_index);
 
+	struct statement_cache_stats
+	{
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+
+		// SB: cached statement was still in use, so a new one was prepared and not cached
+		size_t busy = 0;
+		size_t size = 0;
+		size_t capacity = 0;
+	};
+
+	class statement_cache;
+
+	enum class synchronous_mode
+	{
+		off,
+		normal,
+		full
+	};
+
+	enum class journal_mode
+	{
+		rollback,
+		wal
+	};
+
+	enum class auto_vacuum_mode
+	{
+		none,
+		full,
+		incremental
+	};
+
 	class connection : sb::noncopyable
 	{
 	public:
 		using ptr = std::shared_ptr<connection>;
 
+		static const size_t default_statement_cache_capacity = 64;
+
 	private:
 		sqlite3* m_handle;
+		const std::unique_ptr<statement_cache> m_cache;
 
 	public:
 		statement::ptr create_statement(const std::wstring& query) const;
+
+		// SB: returns prepared statement for the query from LRU cache, statement is reset and its bindings are cleared.
+		// Statement returns to the cache when the last reference to it is released. Should be used for queries which are executed
+		// repeatedly, schema changes and other one time queries should be created by create_statement
+		statement::ptr cached_statement(const std::wstring& query) const;
+		void set_statement_cache_capacity(size_t capacity);
+		statement_cache_stats cache_stats() const;
+
 		void set_synchronous(bool flag);
+		void set_synchronous(synchronous_mode mode);
+
+		// SB: WAL mode is persistent, it's kept in DB file
+		void set_journal_mode(journal_mode mode);
+		bool in_transaction() const;
+
+		// SB: how long statement waits for lock held by another connection before it fails with SQLITE_BUSY
+		void set_busy_timeout(unsigned long milliseconds);
+
+		// SB: any change of DB made by query only connection fails with SQLITE_READONLY
+		void set_query_only(bool flag);
+
+		// SB: schema version is the schema cookie, it's changed by any DDL statement and by vacuum
 		void set_schema_version(int ver);
 		int schema_version() const;
 
+		// SB: user version isn't used by SQLite itself, so it keeps application defined version of DB schema
+		void set_user_version(int ver);
+		int user_version() const;
+
+		// SB: mode can be changed before the first table is created only, otherwise it takes effect after vacuum()
+		void set_auto_vacuum(auto_vacuum_mode mode);
+		auto_vacuum_mode auto_vacuum() const;
+
+		// SB: rebuilds the whole DB file, it holds write lock and needs free disk space of DB size for a while
+		void vacuum();
+
+		// SB: returns at most 'pages' free pages to file system, works in incremental auto vacuum mode only
+		void incremental_vacuum(size_t pages);
+		size_t page_count() const;
+		size_t freelist_count() const;
+
+		// SB: max amount of parameters of one statement
+		size_t max_variables() const;
+
 	public:
 		static ptr create(const std::wstring& db_path);
 
@@ -98,9 +215,87 @@ namespace sqlite
 		~connection();
 	};
 
+	struct connection_pool_stats
+	{
+		size_t checkouts = 0;
+
+		// SB: all readers were in use, so the read went to a temporary reader
+		size_t busy = 0;
+		size_t readers = 0;
+		size_t max_readers = 0;
+	};
+
+	class connection_pool_state;
+
+	//////////////////////////////////////////////////////////
+	// connection_pool
+	// SB: one writer connection and up to 'max_readers' query only connections to the same DB. In WAL mode readers don't wait for writer
+	// and each of them sees the last committed state of DB. Readers are opened on demand and reused. Reader returns to the pool
+	// when the last reference to it is released, so it shouldn't be kept longer than the read. If all readers are in use
+	// temporary reader is opened instead of waiting, so nested reads can't deadlock. Writer may have uncommitted changes,
+	// so it's returned as reader only if 'max_readers' is zero
+
+	class connection_pool : sb::noncopyable
+	{
+	public:
+		using ptr = std::shared_ptr<connection_pool>;
+		using open_function = std::function<connection::ptr()>;
+
+	private:
+		const connection::ptr m_writer;
+		const std::shared_ptr<connection_pool_state> m_state;
+
+	public:
+		const connection::ptr& writer() const;
+		connection::ptr reader() const;
+		connection_pool_stats stats() const;
+
+	public:
+		// SB: 'open' opens new connection to the DB of 'writer' with required settings, f.e. busy timeout
+		connection_pool(const connection::ptr& writer, const open_function& open, size_t max_readers);
+	};
+
+	//////////////////////////////////////////////////////////
+	// bulk_insert
+	// SB: inserts many rows by multi-row INSERT ... VALUES (...), (...) statements, so each row doesn't cost a separate step of statement.
+	// Statements have power of two amount of rows up to 'max_rows', so any amount of rows is inserted by a few cached statements.
+	// Amount of rows of one statement is limited by amount of parameters SQLITE allows as well
+
+	class bulk_insert : sb::noncopyable
+	{
+	public:
+		// SB: binds values of 'row' to parameters which start from 'first_index'. Text and blob should stay alive until insert returns
+		using bind_function = std::function<void(statement& st, size_t row, int first_index)>;
+
+		static const size_t default_max_rows = 128;
+
+	private:
+		const connection::ptr m_db;
+		const std::wstring m_query;
+		const int m_columns;
+		const size_t m_max_rows;
+
+	private:
+		statement::ptr batch_statement(size_t rows) const;
+
+	public:
+		// SB: it doesn't start a transaction, rows which were inserted before an error are rolled back by caller's transaction
+		void insert(size_t rows_count, const bind_function& bind_row) const;
+
+	public:
+		// SB: 'query' is INSERT statement without VALUES clause, f.e. INSERT OR REPLACE INTO T(A, B)
+		bulk_insert(const connection::ptr& db, const std::wstring& query, int columns, size_t max_rows = default_max_rows);
+	};
+
+	// SB: transaction which is started inside another one becomes a savepoint,
+	// so its changes are committed or rolled back together with the outer transaction.
+	// Transaction takes write lock at the start, so if another connection writes the same DB
+	// it waits for the lock instead of failing on the first write after a read
+
 	class transaction : sb::noncopyable
 	{
 		bool m_closed;
+		const bool m_nested;
 		const statement::ptr m_commit;
 		const statement::ptr m_rollback;
 
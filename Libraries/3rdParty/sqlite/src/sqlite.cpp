@@ -3,7 +3,12 @@
 
 #include <boost/numeric/conversion/cast.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 
 namespace sqlite
 {
@@ -29,8 +34,269 @@ namespace sqlite
 
 			return result;
 		}
+
+		// SB: max amount of rows of bulk insert statement is rounded down to power of two
+		size_t get_batch_rows(const connection::ptr& db, int columns, size_t max_rows)
+		{
+			if (nullptr == db)
+			{
+				throw std::invalid_argument("db argument is null!");
+			}
+
+			if (columns <= 0 || 0 == max_rows)
+			{
+				throw std::invalid_argument("columns or max_rows argument is zero!");
+			}
+
+			const auto limit = std::min(max_rows, db->max_variables() / static_cast<size_t>(columns));
+			if (0 == limit)
+			{
+				throw std::invalid_argument("columns argument exceeds max amount of statement parameters!");
+			}
+
+			size_t rows = 1;
+			while (rows * 2 <= limit)
+			{
+				rows *= 2;
+			}
+
+			return rows;
+		}
 	}
 
+	//////////////////////////////////////////////////////////
+	// statement_cache
+	// SB: statements are kept in LRU order, the most recently used one goes first.
+	// Entry is shared with the deleter of returned pointer, so evicted statement which is still in use is finalized when it's released
+
+	class statement_cache : sb::noncopyable
+	{
+		struct entry
+		{
+			const std::wstring query;
+			const std::unique_ptr<statement> st;
+			std::atomic<bool> in_use;
+
+		public:
+			entry(const std::wstring& q, std::unique_ptr<statement> s)
+				: query(q)
+				, st(std::move(s))
+				, in_use(false)
+			{
+			}
+		};
+
+		using entry_ptr = std::shared_ptr<entry>;
+		using lru_list = std::list<entry_ptr>;
+
+	private:
+		std::mutex m_mutex;
+		size_t m_capacity;
+		lru_list m_lru;
+		std::unordered_map<std::wstring, lru_list::iterator> m_index;
+		statement_cache_stats m_stats;
+
+	private:
+		static statement::ptr checkout(const entry_ptr& e)
+		{
+			// SB: statement is reset on release, so read transaction isn't kept opened by idle statement.
+			// Bindings are cleared as well, since bound text and blob aren't copied and may be already destroyed
+			auto release = [e](statement* st)
+			{
+				try
+				{
+					st->clear_bindings();
+					st->reset();
+				}
+				catch (...)
+				{
+					// SB: reset returns error of the last step, it's already reported to the caller
+				}
+
+				e->in_use.store(false);
+			};
+
+			return statement::ptr(e->st.get(), release);
+		}
+
+		void evict()
+		{
+			while (m_lru.size() > m_capacity)
+			{
+				m_index.erase(m_lru.back()->query);
+				m_lru.pop_back();
+				++m_stats.evictions;
+			}
+		}
+
+	public:
+		statement::ptr get(sqlite3* db_handle, const std::wstring& query)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (0 == m_capacity)
+			{
+				++m_stats.misses;
+				return std::make_shared<statement>(db_handle, query);
+			}
+
+			auto it = m_index.find(query);
+			if (m_index.end() != it)
+			{
+				const auto e = *it->second;
+				if (e->in_use.exchange(true))
+				{
+					// SB: f.e. the same query is executed inside a loop over results of this query
+					++m_stats.busy;
+					return std::make_shared<statement>(db_handle, query);
+				}
+
+				++m_stats.hits;
+				m_lru.splice(m_lru.begin(), m_lru, it->second);
+
+				return checkout(e);
+			}
+
+			++m_stats.misses;
+
+			auto e = std::make_shared<entry>(query, std::make_unique<statement>(db_handle, query));
+			e->in_use.store(true);
+			m_lru.push_front(e);
+			m_index[query] = m_lru.begin();
+			evict();
+
+			return checkout(e);
+		}
+
+		void set_capacity(size_t capacity)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_capacity = capacity;
+			evict();
+		}
+
+		statement_cache_stats stats()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			auto result = m_stats;
+			result.size = m_lru.size();
+			result.capacity = m_capacity;
+
+			return result;
+		}
+
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_index.clear();
+			m_lru.clear();
+		}
+
+	public:
+		statement_cache(size_t capacity)
+			: m_capacity(capacity)
+		{
+		}
+	};
+
+	//////////////////////////////////////////////////////////
+	// connection_pool_state
+	// SB: it's shared with deleters of checked out readers, so reader may outlive the pool
+
+	class connection_pool_state : sb::noncopyable
+	{
+		std::mutex m_mutex;
+		const connection_pool::open_function m_open;
+		std::vector<connection::ptr> m_idle;
+		connection_pool_stats m_stats;
+
+	private:
+		void release(const connection::ptr& reader)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			// SB: capacity is reserved for all readers, so it doesn't throw
+			m_idle.push_back(reader);
+		}
+
+	public:
+		// SB: returns nullptr if pool has no readers at all. If all readers are in use temporary reader is opened,
+		// it's closed when the last reference to it is released
+		static connection::ptr checkout(const std::shared_ptr<connection_pool_state>& state)
+		{
+			connection::ptr reader;
+			bool temporary = false;
+			{
+				std::lock_guard<std::mutex> lock(state->m_mutex);
+
+				++state->m_stats.checkouts;
+				if (0 == state->m_stats.max_readers)
+				{
+					return nullptr;
+				}
+
+				if (!state->m_idle.empty())
+				{
+					reader = state->m_idle.back();
+					state->m_idle.pop_back();
+				}
+				else if (state->m_stats.readers < state->m_stats.max_readers)
+				{
+					++state->m_stats.readers;
+				}
+				else
+				{
+					++state->m_stats.busy;
+					temporary = true;
+				}
+			}
+
+			if (temporary)
+			{
+				reader = state->m_open();
+				reader->set_query_only(true);
+
+				return reader;
+			}
+
+			if (nullptr == reader)
+			{
+				try
+				{
+					reader = state->m_open();
+					reader->set_query_only(true);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(state->m_mutex);
+					--state->m_stats.readers;
+
+					throw;
+				}
+			}
+
+			return connection::ptr(reader.get(), [state, reader](connection*) { state->release(reader); });
+		}
+
+		connection_pool_stats stats()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			return m_stats;
+		}
+
+	public:
+		connection_pool_state(const connection_pool::open_function& open, size_t max_readers)
+			: m_open(open)
+		{
+			m_idle.reserve(max_readers);
+			m_stats.max_readers = max_readers;
+		}
+	};
+
 	//////////////////////////////////////////////////////////
 	// exception impl
 
@@ -51,6 +317,11 @@ namespace sqlite
 		exception::check(m_db_handle, ::sqlite3_reset(m_handle));
 	}
 
+	void statement::clear_bindings()
+	{
+		exception::check(m_db_handle, ::sqlite3_clear_bindings(m_handle));
+	}
+
 	bool statement::step()
 	{
 		// execute
@@ -116,6 +387,48 @@ namespace sqlite
 		return res;
 	}
 
+	void statement::check_column_type(int column_index, int expected_type)
+	{
+		if (expected_type != ::sqlite3_column_type(m_handle, column_index))
+			throw std::runtime_error(__FUNCTION__ " Invalid value type!");
+	}
+
+	__int64 statement::get_int64(int column_index)
+	{
+		check_column_type(column_index, SQLITE_INTEGER);
+
+		return ::sqlite3_column_int64(m_handle, column_index);
+	}
+
+	double statement::get_double(int column_index)
+	{
+		check_column_type(column_index, SQLITE_FLOAT);
+
+		return ::sqlite3_column_double(m_handle, column_index);
+	}
+
+	text_view statement::get_text_view(int column_index)
+	{
+		check_column_type(column_index, SQLITE_TEXT);
+
+		// SB: size should be taken after the data, since the data can be converted to UTF-16 by the first call
+		auto data = static_cast<const wchar_t*>(::sqlite3_column_text16(m_handle, column_index));
+		auto size = ::sqlite3_column_bytes16(m_handle, column_index);
+
+		return{ data, static_cast<size_t>(size) / sizeof(wchar_t) };
+	}
+
+	blob_span statement::get_blob_span(int column_index)
+	{
+		check_column_type(column_index, SQLITE_BLOB);
+
+		// SB: data is nullptr for empty blob
+		auto data = static_cast<const byte_t*>(::sqlite3_column_blob(m_handle, column_index));
+		auto size = ::sqlite3_column_bytes(m_handle, column_index);
+
+		return{ data, static_cast<size_t>(size) };
+	}
+
 	template<>
 	int statement::get_value(int column_index)
 	{
@@ -180,6 +493,48 @@ namespace sqlite
 		val.apply_visitor(value_binder(m_db_handle, m_handle, index));
 	}
 
+	void statement::bind_int(int val, int index)
+	{
+		exception::check(m_db_handle, ::sqlite3_bind_int(m_handle, index, val));
+	}
+
+	void statement::bind_int64(__int64 val, int index)
+	{
+		exception::check(m_db_handle, ::sqlite3_bind_int64(m_handle, index, val));
+	}
+
+	void statement::bind_double(double val, int index)
+	{
+		exception::check(m_db_handle, ::sqlite3_bind_double(m_handle, index, val));
+	}
+
+	void statement::bind_text(const wchar_t* data, size_t size, int index)
+	{
+		exception::check(m_db_handle, ::sqlite3_bind_text16(m_handle, index, data, boost::numeric_cast<int>(size * sizeof(wchar_t)), SQLITE_STATIC));
+	}
+
+	void statement::bind_text(const std::wstring& val, int index)
+	{
+		bind_text(val.data(), val.size(), index);
+	}
+
+	void statement::bind_blob(const byte_t* data, size_t size, int index)
+	{
+		// SB: SQLITE binds NULL instead of empty blob for nullptr
+		if (nullptr == data)
+		{
+			exception::check(m_db_handle, ::sqlite3_bind_zeroblob(m_handle, index, 0));
+			return;
+		}
+
+		exception::check(m_db_handle, ::sqlite3_bind_blob(m_handle, index, data, boost::numeric_cast<int>(size), SQLITE_STATIC));
+	}
+
+	void statement::bind_blob(const binary_t& val, int index)
+	{
+		bind_blob(val.data(), val.size(), index);
+	}
+
 	__int64 statement::last_insert_row_id() const
 	{
 		return sqlite3_last_insert_rowid(m_db_handle);
@@ -210,15 +565,23 @@ namespace sqlite
 	void transaction::rollback()
 	{
 		m_rollback->step();
+
+		// SB: savepoint stays opened after rollback to it
+		if (m_nested)
+		{
+			m_commit->step();
+		}
+
 		m_closed = true;
 	}
 
 	transaction::transaction(const connection::ptr& db)
 		: m_closed(false)
-		, m_commit(db->create_statement(L"COMMIT TRANSACTION"))
-		, m_rollback(db->create_statement(L"ROLLBACK TRANSACTION"))
+		, m_nested(db->in_transaction())
+		, m_commit(db->cached_statement(m_nested ? L"RELEASE SAVEPOINT NESTED_TRANSACTION" : L"COMMIT TRANSACTION"))
+		, m_rollback(db->cached_statement(m_nested ? L"ROLLBACK TRANSACTION TO SAVEPOINT NESTED_TRANSACTION" : L"ROLLBACK TRANSACTION"))
 	{
-		auto begin = db->create_statement(L"BEGIN TRANSACTION");
+		auto begin = db->cached_statement(m_nested ? L"SAVEPOINT NESTED_TRANSACTION" : L"BEGIN IMMEDIATE TRANSACTION");
 		begin->step();
 	}
 
@@ -238,12 +601,56 @@ namespace sqlite
 		return std::make_shared<statement>(m_handle, query);
 	}
 
+	statement::ptr connection::cached_statement(const std::wstring& query) const
+	{
+		return m_cache->get(m_handle, query);
+	}
+
+	void connection::set_statement_cache_capacity(size_t capacity)
+	{
+		m_cache->set_capacity(capacity);
+	}
+
+	statement_cache_stats connection::cache_stats() const
+	{
+		return m_cache->stats();
+	}
+
 	void connection::set_synchronous(bool flag)
 	{
 		auto st = create_statement(std::wstring(L"PRAGMA SYNCHRONOUS =") + (flag ? L"FULL" : L"OFF"));
 		st->step();
 	}
 
+	void connection::set_synchronous(synchronous_mode mode)
+	{
+		const wchar_t* const values[] = { L"OFF", L"NORMAL", L"FULL" };
+		auto st = create_statement(std::wstring(L"PRAGMA SYNCHRONOUS =") + values[static_cast<int>(mode)]);
+		st->step();
+	}
+
+	void connection::set_journal_mode(journal_mode mode)
+	{
+		auto st = create_statement(std::wstring(L"PRAGMA JOURNAL_MODE =") + (journal_mode::wal == mode ? L"WAL" : L"DELETE"));
+		st->step();
+	}
+
+	bool connection::in_transaction() const
+	{
+		return 0 == ::sqlite3_get_autocommit(m_handle);
+	}
+
+	void connection::set_busy_timeout(unsigned long milliseconds)
+	{
+		exception::check(m_handle, ::sqlite3_busy_timeout(m_handle, static_cast<int>(milliseconds)));
+	}
+
+	void connection::set_query_only(bool flag)
+	{
+		auto st = create_statement(std::wstring(L"PRAGMA QUERY_ONLY =") + (flag ? L"ON" : L"OFF"));
+		st->step();
+	}
+
 	void connection::set_schema_version(int ver)
 	{
 		std::wstringstream ss;
@@ -259,6 +666,74 @@ namespace sqlite
 		return st->get_value<int>(0);
 	}
 
+	void connection::set_user_version(int ver)
+	{
+		std::wstringstream ss;
+		ss << L"PRAGMA user_version = " << ver;
+		auto st = create_statement(ss.str());
+		st->step();
+	}
+
+	int connection::user_version() const
+	{
+		auto st = create_statement(L"PRAGMA user_version");
+		st->step();
+		return st->get_value<int>(0);
+	}
+
+	void connection::set_auto_vacuum(auto_vacuum_mode mode)
+	{
+		const wchar_t* const values[] = { L"NONE", L"FULL", L"INCREMENTAL" };
+		auto st = create_statement(std::wstring(L"PRAGMA AUTO_VACUUM =") + values[static_cast<int>(mode)]);
+		st->step();
+	}
+
+	auto_vacuum_mode connection::auto_vacuum() const
+	{
+		auto st = create_statement(L"PRAGMA AUTO_VACUUM");
+		st->step();
+		return static_cast<auto_vacuum_mode>(st->get_value<int>(0));
+	}
+
+	void connection::vacuum()
+	{
+		auto st = create_statement(L"VACUUM");
+		st->step();
+	}
+
+	void connection::incremental_vacuum(size_t pages)
+	{
+		std::wstringstream ss;
+		ss << L"PRAGMA INCREMENTAL_VACUUM(" << pages << L")";
+		auto st = create_statement(ss.str());
+
+		// SB: each step releases one page
+		while (st->step())
+		{
+		}
+	}
+
+	size_t connection::page_count() const
+	{
+		auto st = create_statement(L"PRAGMA PAGE_COUNT");
+		st->step();
+		return static_cast<size_t>(st->get_value<__int64>(0));
+	}
+
+	size_t connection::freelist_count() const
+	{
+		auto st = create_statement(L"PRAGMA FREELIST_COUNT");
+		st->step();
+		return static_cast<size_t>(st->get_value<__int64>(0));
+	}
+
+	size_t connection::max_variables() const
+	{
+		return static_cast<size_t>(::sqlite3_limit(m_handle, SQLITE_LIMIT_VARIABLE_NUMBER, -1));
+	}
+
+	const size_t connection::default_statement_cache_capacity;
+
 	connection::ptr connection::create(const std::wstring& db_path)
 	{
 		return std::make_shared<connection>(db_path);
@@ -266,13 +741,113 @@ namespace sqlite
 
 	connection::connection(const std::wstring& db_path)
 		: m_handle(open_db(db_path))
+		, m_cache(std::make_unique<statement_cache>(default_statement_cache_capacity))
 	{
 	}
 
 	connection::~connection()
 	{
+		// SB: cached statements should be finalized before DB is closed
+		m_cache->clear();
+
 		// TODO: add result validation logic
 		::sqlite3_close(m_handle);
 		m_handle = nullptr;
 	}
+
+	//////////////////////////////////////////////////////////
+	// connection_pool impl
+
+	const connection::ptr& connection_pool::writer() const
+	{
+		return m_writer;
+	}
+
+	connection::ptr connection_pool::reader() const
+	{
+		// SB: writer may be inside of a transaction, so it's used only by pool without readers, f.e. for DB in memory
+		auto result = connection_pool_state::checkout(m_state);
+
+		return nullptr != result ? result : m_writer;
+	}
+
+	connection_pool_stats connection_pool::stats() const
+	{
+		return m_state->stats();
+	}
+
+	connection_pool::connection_pool(const connection::ptr& writer, const open_function& open, size_t max_readers)
+		: m_writer(writer)
+		, m_state(std::make_shared<connection_pool_state>(open, max_readers))
+	{
+		if (nullptr == writer)
+		{
+			throw std::invalid_argument("writer argument is null!");
+		}
+	}
+
+	//////////////////////////////////////////////////////////
+	// bulk_insert impl
+
+	statement::ptr bulk_insert::batch_statement(size_t rows) const
+	{
+		std::wstring row(L"(");
+		for (int i = 0; i < m_columns; ++i)
+		{
+			row += 0 == i ? L"?" : L", ?";
+		}
+		row += L")";
+
+		std::wstring query = m_query + L" VALUES ";
+		query.reserve(query.size() + rows * (row.size() + 2));
+		for (size_t i = 0; i < rows; ++i)
+		{
+			if (0 != i)
+			{
+				query += L", ";
+			}
+
+			query += row;
+		}
+
+		return m_db->cached_statement(query);
+	}
+
+	void bulk_insert::insert(size_t rows_count, const bind_function& bind_row) const
+	{
+		size_t row = 0;
+		for (size_t rows = m_max_rows; 0 != rows; rows /= 2)
+		{
+			if (rows_count - row < rows)
+			{
+				continue;
+			}
+
+			auto st = batch_statement(rows);
+
+			// SB: only the largest statement is executed repeatedly, the rest rows are inserted by at most one statement of each size
+			do
+			{
+				st->reset();
+				for (size_t i = 0; i < rows; ++i)
+				{
+					bind_row(*st, row + i, static_cast<int>(i) * m_columns + 1);
+				}
+
+				st->step();
+				row += rows;
+			}
+			while (rows_count - row >= rows);
+		}
+	}
+
+	const size_t bulk_insert::default_max_rows;
+
+	bulk_insert::bulk_insert(const connection::ptr& db, const std::wstring& query, int columns, size_t max_rows)
+		: m_db(db)
+		, m_query(query)
+		, m_columns(columns)
+		, m_max_rows(get_batch_rows(db, columns, max_rows))
+	{
+	}
 }
\ No newline at end of file
@@ -226,6 +226,55 @@ BOOST_FIXTURE_TEST_CASE(transactional, test_helpers::temp_dir_fixture)
 	}
 }
 
+BOOST_FIXTURE_TEST_CASE(nested_transaction, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+
+	auto st = db->create_statement(L"CREATE TABLE T1(column1 INTEGER, PRIMARY KEY(column1))");
+	st->step();
+
+	auto insert = [&](int value)
+	{
+		auto insert_st = db->create_statement(L"INSERT INTO T1 VALUES(?1)");
+		insert_st->bind_value(value, 1);
+		insert_st->step();
+	};
+
+	// ACT
+	{
+		sqlite::transaction outer(db);
+		insert(1);
+
+		{
+			sqlite::transaction inner(db);
+			insert(2);
+			inner.rollback();
+		}
+
+		{
+			sqlite::transaction inner(db);
+			insert(3);
+			inner.commit();
+		}
+
+		// ASSERT
+		BOOST_TEST(db->in_transaction());
+
+		outer.commit();
+	}
+
+	// ASSERT
+	BOOST_TEST(!db->in_transaction());
+
+	st = db->create_statement(L"SELECT SUM(column1), COUNT(*) FROM T1");
+	BOOST_TEST(st->step());
+	BOOST_TEST(st->get_value<int>(0) == 4);
+	BOOST_TEST(st->get_value<int>(1) == 2);
+}
+
 BOOST_FIXTURE_TEST_CASE(synchronous, test_helpers::temp_dir_fixture)
 {
 	// INIT
@@ -239,6 +288,15 @@ BOOST_FIXTURE_TEST_CASE(synchronous, test_helpers::temp_dir_fixture)
 	// ACT
 	db->set_synchronous(false);
 	db->set_synchronous(true);
+	db->set_synchronous(sqlite::synchronous_mode::normal);
+	db->set_journal_mode(sqlite::journal_mode::wal);
+
+	// ASSERT
+	auto st = db->create_statement(L"PRAGMA JOURNAL_MODE");
+	BOOST_TEST(st->step());
+
+	const auto mode = st->get_value<std::wstring>(0);
+	BOOST_TEST(0 == _wcsicmp(mode.c_str(), L"wal"));
 }
 
 BOOST_FIXTURE_TEST_CASE(schema_version, test_helpers::temp_dir_fixture)
@@ -262,4 +320,449 @@ BOOST_FIXTURE_TEST_CASE(schema_version, test_helpers::temp_dir_fixture)
 
 	// ASSERT
 	BOOST_TEST(db->schema_version() == 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(user_version, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+
+	// ACT
+	db->set_user_version(3);
+
+	auto st = db->create_statement(L"CREATE TABLE [TEST]([ID] INTEGER PRIMARY KEY NOT NULL)");
+	st->step();
+
+	st = db->create_statement(L"DROP TABLE [TEST]");
+	st->step();
+
+	db->vacuum();
+
+	// ASSERT
+	BOOST_TEST(db->user_version() == 3);
+	BOOST_TEST(db->schema_version() != 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(statement_cache_hits, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+
+	auto st = db->create_statement(L"CREATE TABLE T1(column1 INTEGER, PRIMARY KEY(column1))");
+	st->step();
+
+	// ACT
+	for (int i = 0; i < 3; ++i)
+	{
+		auto insert_st = db->cached_statement(L"INSERT INTO T1 VALUES(?1)");
+		insert_st->bind_value(i, 1);
+		insert_st->step();
+	}
+
+	// ASSERT
+	const auto stats = db->cache_stats();
+	BOOST_TEST(stats.misses == 1);
+	BOOST_TEST(stats.hits == 2);
+	BOOST_TEST(stats.busy == 0);
+	BOOST_TEST(stats.size == 1);
+	BOOST_TEST(stats.capacity == sqlite::connection::default_statement_cache_capacity);
+
+	st = db->create_statement(L"SELECT COUNT(*) FROM T1");
+	st->step();
+	BOOST_TEST(st->get_value<int>(0) == 3);
+}
+
+BOOST_FIXTURE_TEST_CASE(statement_cache_resets_statement, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+
+	auto st = db->create_statement(L"CREATE TABLE T1(column1 INTEGER, column2 INTEGER, PRIMARY KEY(column1))");
+	st->step();
+
+	st = db->create_statement(L"INSERT INTO T1 VALUES(1, 10), (2, 20)");
+	st->step();
+
+	{
+		auto select_st = db->cached_statement(L"SELECT column2 FROM T1 WHERE column1 >= ?1 ORDER BY column1");
+		select_st->bind_value(1, 1);
+		BOOST_TEST(select_st->step());
+	}
+
+	// ACT
+	auto select_st = db->cached_statement(L"SELECT column2 FROM T1 WHERE column1 >= ?1 ORDER BY column1");
+
+	// ASSERT
+	// SB: parameter is NULL after bindings are cleared, so nothing is selected
+	BOOST_TEST(!select_st->step());
+
+	// ACT
+	select_st->reset();
+	select_st->bind_value(2, 1);
+
+	// ASSERT
+	BOOST_TEST(select_st->step());
+	BOOST_TEST(select_st->get_value<int>(0) == 20);
+	BOOST_TEST(db->cache_stats().hits == 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(statement_cache_busy_statement, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+
+	auto st = db->create_statement(L"CREATE TABLE T1(column1 INTEGER, PRIMARY KEY(column1))");
+	st->step();
+
+	st = db->create_statement(L"INSERT INTO T1 VALUES(1), (2)");
+	st->step();
+
+	const std::wstring query = L"SELECT column1 FROM T1 WHERE column1 = ?1";
+
+	// ACT
+	auto outer_st = db->cached_statement(query);
+	outer_st->bind_value(1, 1);
+	BOOST_TEST(outer_st->step());
+
+	auto inner_st = db->cached_statement(query);
+	inner_st->bind_value(2, 1);
+
+	// ASSERT
+	BOOST_TEST(inner_st->step());
+	BOOST_TEST(inner_st->get_value<int>(0) == 2);
+	BOOST_TEST(outer_st->get_value<int>(0) == 1);
+	BOOST_TEST(outer_st.get() != inner_st.get());
+
+	const auto stats = db->cache_stats();
+	BOOST_TEST(stats.busy == 1);
+	BOOST_TEST(stats.size == 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(statement_cache_eviction, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	db->set_statement_cache_capacity(2);
+
+	// ACT
+	db->cached_statement(L"SELECT 1");
+	db->cached_statement(L"SELECT 2");
+	db->cached_statement(L"SELECT 1");
+	db->cached_statement(L"SELECT 3");
+
+	// SB: "SELECT 2" is the least recently used one, so it has been evicted
+	db->cached_statement(L"SELECT 1");
+	db->cached_statement(L"SELECT 2");
+
+	// ASSERT
+	auto stats = db->cache_stats();
+	BOOST_TEST(stats.misses == 4);
+	BOOST_TEST(stats.hits == 2);
+	BOOST_TEST(stats.evictions == 2);
+	BOOST_TEST(stats.size == 2);
+
+	// ACT
+	db->set_statement_cache_capacity(0);
+	auto st = db->cached_statement(L"SELECT 1");
+	st->step();
+
+	// ASSERT
+	stats = db->cache_stats();
+	BOOST_TEST(stats.size == 0);
+	BOOST_TEST(stats.misses == 5);
+	BOOST_TEST(st->get_value<int>(0) == 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(connection_pool_readers, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_path = tmp_folder.path + L"\\" + unique_string();
+	auto open_db = [db_path]()
+	{
+		auto db = sqlite::connection::create(db_path);
+		db->set_journal_mode(sqlite::journal_mode::wal);
+
+		return db;
+	};
+
+	sqlite::connection_pool pool(open_db(), open_db, 2);
+
+	auto st = pool.writer()->create_statement(L"CREATE TABLE T1(column1 INTEGER, PRIMARY KEY(column1))");
+	st->step();
+
+	st = pool.writer()->create_statement(L"INSERT INTO T1 VALUES(1), (2)");
+	st->step();
+
+	// ACT
+	auto reader1 = pool.reader();
+	auto reader2 = pool.reader();
+
+	// SB: all readers are in use
+	auto reader3 = pool.reader();
+
+	// ASSERT
+	BOOST_TEST(reader1.get() != pool.writer().get());
+	BOOST_TEST(reader2.get() != pool.writer().get());
+	BOOST_TEST(reader1.get() != reader2.get());
+	BOOST_TEST(reader3.get() != pool.writer().get());
+	BOOST_TEST(reader3.get() != reader1.get());
+	BOOST_TEST(reader3.get() != reader2.get());
+
+	st = reader1->create_statement(L"SELECT COUNT(*) FROM T1");
+	BOOST_TEST(st->step());
+	BOOST_TEST(st->get_value<int>(0) == 2);
+
+	bool thrown = false;
+	try
+	{
+		st = reader2->create_statement(L"INSERT INTO T1 VALUES(3)");
+		st->step();
+	}
+	catch (const sqlite::exception&)
+	{
+		thrown = true;
+	}
+
+	BOOST_TEST(thrown);
+
+	// ACT
+	// SB: released reader is reused
+	st.reset();
+	auto reader = reader1.get();
+	reader1.reset();
+	reader1 = pool.reader();
+
+	// SB: temporary reader isn't returned to the pool
+	reader3.reset();
+	auto reader4 = pool.reader();
+
+	// ASSERT
+	BOOST_TEST(reader1.get() == reader);
+	BOOST_TEST(reader4.get() != pool.writer().get());
+
+	const auto stats = pool.stats();
+	BOOST_TEST(stats.checkouts == 5);
+	BOOST_TEST(stats.busy == 2);
+	BOOST_TEST(stats.readers == 2);
+	BOOST_TEST(stats.max_readers == 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(connection_pool_reader_doesnt_wait_for_writer, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_path = tmp_folder.path + L"\\" + unique_string();
+	auto open_db = [db_path]()
+	{
+		auto db = sqlite::connection::create(db_path);
+		db->set_journal_mode(sqlite::journal_mode::wal);
+
+		return db;
+	};
+
+	sqlite::connection_pool pool(open_db(), open_db, 1);
+
+	auto st = pool.writer()->create_statement(L"CREATE TABLE T1(column1 INTEGER, PRIMARY KEY(column1))");
+	st->step();
+
+	st = pool.writer()->create_statement(L"INSERT INTO T1 VALUES(1)");
+	st->step();
+
+	// ACT
+	// SB: reader sees the last committed state while write transaction is opened
+	sqlite::transaction t(pool.writer());
+	st = pool.writer()->create_statement(L"INSERT INTO T1 VALUES(2)");
+	st->step();
+
+	auto reader = pool.reader();
+	auto select_st = reader->create_statement(L"SELECT COUNT(*) FROM T1");
+	BOOST_TEST(select_st->step());
+	const auto count = select_st->get_value<int>(0);
+
+	t.commit();
+	select_st->reset();
+	BOOST_TEST(select_st->step());
+
+	// ASSERT
+	BOOST_TEST(count == 1);
+	BOOST_TEST(select_st->get_value<int>(0) == 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(connection_pool_without_readers, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	sqlite::connection_pool pool(sqlite::connection::create(tmp_folder.path + L"\\" + unique_string()), sqlite::connection_pool::open_function(), 0);
+
+	// ACT
+	auto reader = pool.reader();
+
+	// ASSERT
+	BOOST_TEST(reader.get() == pool.writer().get());
+	BOOST_TEST(pool.stats().busy == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(incremental_vacuum, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	db->set_auto_vacuum(sqlite::auto_vacuum_mode::incremental);
+
+	db->create_statement(L"CREATE TABLE [DATA]([VALUE] BLOB)")->step();
+	auto insert_st = db->create_statement(L"INSERT INTO DATA(VALUE) VALUES (ZEROBLOB(10000))");
+	for (int i = 0; i < 100; ++i)
+	{
+		insert_st->reset();
+		insert_st->step();
+	}
+
+	db->create_statement(L"DELETE FROM DATA")->step();
+	const auto page_count = db->page_count();
+	const auto free_pages = db->freelist_count();
+
+	// ACT
+	db->incremental_vacuum(10);
+
+	// ASSERT
+	BOOST_TEST((sqlite::auto_vacuum_mode::incremental == db->auto_vacuum()));
+	BOOST_TEST(free_pages > 10);
+	BOOST_TEST(db->freelist_count() == free_pages - 10);
+	BOOST_TEST(db->page_count() == page_count - 10);
+
+	// ACT
+	db->incremental_vacuum(0);
+
+	// ASSERT
+	// SB: zero means all free pages
+	BOOST_TEST(db->freelist_count() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(typed_accessors, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+
+	const std::wstring expected_text = L"some text";
+	const sqlite::binary_t expected_blob(20, 0xff);
+	const __int64 expected_int64 = 0x100000000;
+	const double expected_double = 45345.0342;
+	const sqlite::binary_t empty_blob;
+	db->create_statement(L"CREATE TABLE T1(column1 INTEGER, column2 TEXT, column3 FLOAT, column4 BLOB, column5 BLOB)")->step();
+
+	// ACT
+	auto st = db->create_statement(L"INSERT INTO T1 VALUES(?1, ?2, ?3, ?4, ?5)");
+	st->bind_int64(expected_int64, 1);
+	st->bind_text(expected_text, 2);
+	st->bind_double(expected_double, 3);
+	st->bind_blob(expected_blob, 4);
+	st->bind_blob(empty_blob, 5);
+	st->step();
+
+	st = db->create_statement(L"SELECT column1, column2, column3, column4, column5 FROM T1");
+
+	// ACT / ASSERT
+	BOOST_TEST(st->step());
+
+	// ASSERT
+	BOOST_TEST(st->get_int64(0) == expected_int64);
+	BOOST_TEST(st->get_double(2) == expected_double);
+
+	const auto text = st->get_text_view(1);
+	BOOST_TEST((text.str() == expected_text));
+
+	const auto blob = st->get_blob_span(3);
+	BOOST_TEST((sqlite::binary_t(blob.data, blob.data + blob.size) == expected_blob));
+
+	// SB: empty blob isn't NULL
+	BOOST_TEST(st->get_blob_span(4).size == 0);
+
+	// SB: typed accessors don't convert values
+	BOOST_CHECK_THROW(st->get_double(0), std::runtime_error);
+	BOOST_CHECK_THROW(st->get_int64(1), std::runtime_error);
+	BOOST_CHECK_THROW(st->get_text_view(3), std::runtime_error);
+
+	// SB: variant API reads values bound by typed binders
+	BOOST_TEST(st->get_value<__int64>(0) == expected_int64);
+	BOOST_TEST((st->get_value<std::wstring>(1) == expected_text));
+}
+
+BOOST_FIXTURE_TEST_CASE(bulk_insert_rows, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	db->create_statement(L"CREATE TABLE T1(column1 INTEGER, column2 FLOAT, PRIMARY KEY(column1))")->step();
+
+	// SB: 3 full statements of 16 rows and statements of 4, 2 and 1 rows
+	const size_t rows_count = 55;
+	sqlite::bulk_insert insert(db, L"INSERT INTO T1(column1, column2)", 2, 16);
+
+	// ACT
+	insert.insert(rows_count, [](sqlite::statement& st, size_t row, int first_index)
+	{
+		st.bind_int64(static_cast<__int64>(row), first_index);
+		st.bind_double(row / 2.0, first_index + 1);
+	});
+
+	// ASSERT
+	auto st = db->create_statement(L"SELECT column1, column2 FROM T1 ORDER BY column1");
+	size_t row = 0;
+	while (st->step())
+	{
+		BOOST_TEST(st->get_int64(0) == static_cast<__int64>(row));
+		BOOST_TEST(st->get_double(1) == row / 2.0);
+		++row;
+	}
+
+	BOOST_TEST(row == rows_count);
+	BOOST_TEST(db->cache_stats().size == 4);
+
+	// ACT
+	// SB: statements are taken from the cache, error of the row isn't hidden
+	BOOST_CHECK_THROW(insert.insert(2, [](sqlite::statement& st, size_t row, int first_index)
+	{
+		st.bind_int64(static_cast<__int64>(row), first_index);
+		st.bind_double(0.0, first_index + 1);
+	}), sqlite::exception);
+
+	// ASSERT
+	BOOST_TEST(db->cache_stats().size == 4);
+}
+
+BOOST_FIXTURE_TEST_CASE(bulk_insert_parameters_limit, test_helpers::temp_dir_fixture)
+{
+	// INIT
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	db->create_statement(L"CREATE TABLE T1(column1 INTEGER)")->step();
+
+	// ACT
+	// SB: rows of the largest statement are limited by parameters limit instead of 'max_rows'
+	const auto rows_count = db->max_variables() * 3;
+	sqlite::bulk_insert insert(db, L"INSERT INTO T1(column1)", 1, rows_count);
+	insert.insert(rows_count, [](sqlite::statement& st, size_t row, int first_index) { st.bind_int64(static_cast<__int64>(row), first_index); });
+
+	// ASSERT
+	auto st = db->create_statement(L"SELECT COUNT(*), SUM(column1) FROM T1");
+	BOOST_TEST(st->step());
+	BOOST_TEST(st->get_int64(0) == static_cast<__int64>(rows_count));
+	BOOST_TEST(st->get_int64(1) == static_cast<__int64>(rows_count * (rows_count - 1) / 2));
+	BOOST_CHECK_THROW(sqlite::bulk_insert(db, L"INSERT INTO T1(column1)", static_cast<int>(db->max_variables()) + 1), std::invalid_argument);
 }
\ No newline at end of file
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <core/primitives.h>
+
 #include <boost/numeric/conversion/cast.hpp>
 
+#include <vector>
+
 namespace tbp
 {
 	namespace analysis
@@ -63,5 +67,135 @@ namespace tbp
 				}
 			}
 		}
+
+		/////////////////////////////////////////////////////////////////////
+		// sma_state
+		// SB: streaming simple moving average. Each update costs O(1), window values
+		// are kept in the ring buffer so the oldest value can be subtracted from the sum
+
+		class sma_state
+		{
+			unsigned long m_length;
+			std::vector<double> m_window;
+			size_t m_position;
+			size_t m_count;
+			double m_sum;
+
+		public:
+			double update(double value);
+			void reset();
+
+			bool ready() const;
+			double value() const;
+			unsigned long length() const;
+
+			template<typename iterator_t>
+			void seed(iterator_t first, iterator_t last)
+			{
+				reset();
+				for (; first != last; ++first)
+				{
+					update(*first);
+				}
+			}
+
+			template<typename values_container_t>
+			void seed(const values_container_t& values)
+			{
+				seed(std::begin(values), std::end(values));
+			}
+
+			data_t save() const;
+			static sma_state load(const data_t& state);
+
+		public:
+			explicit sma_state(unsigned long length);
+		};
+
+		/////////////////////////////////////////////////////////////////////
+		// ema_state
+		// SB: streaming exponential moving average. Produces the same values as calculate_ema:
+		// first 'length' values are used to calculate SMA which becomes the first EMA value
+
+		class ema_state
+		{
+			unsigned long m_length;
+			double m_alpha;
+			size_t m_count;
+			double m_value;
+
+		public:
+			double update(double value);
+			void reset();
+
+			bool ready() const;
+			double value() const;
+			unsigned long length() const;
+
+			template<typename iterator_t>
+			void seed(iterator_t first, iterator_t last)
+			{
+				reset();
+				for (; first != last; ++first)
+				{
+					update(*first);
+				}
+			}
+
+			template<typename values_container_t>
+			void seed(const values_container_t& values)
+			{
+				seed(std::begin(values), std::end(values));
+			}
+
+			data_t save() const;
+			static ema_state load(const data_t& state);
+
+		public:
+			explicit ema_state(unsigned long length);
+		};
+
+		/////////////////////////////////////////////////////////////////////
+		// macd_state
+		// SB: MACD line is difference between fast and slow EMA, signal line is EMA of MACD line.
+		// Signal EMA starts accumulating values only when slow EMA is ready
+
+		class macd_state
+		{
+			ema_state m_fast;
+			ema_state m_slow;
+			ema_state m_signal;
+
+		public:
+			double update(double value);
+			void reset();
+
+			bool ready() const;
+			double value() const;
+			double signal() const;
+			double histogram() const;
+
+			template<typename iterator_t>
+			void seed(iterator_t first, iterator_t last)
+			{
+				reset();
+				for (; first != last; ++first)
+				{
+					update(*first);
+				}
+			}
+
+			template<typename values_container_t>
+			void seed(const values_container_t& values)
+			{
+				seed(std::begin(values), std::end(values));
+			}
+
+			data_t save() const;
+			static macd_state load(const data_t& state);
+
+		public:
+			macd_state(unsigned long fast_length = 12, unsigned long slow_length = 26, unsigned long signal_length = 9);
+		};
 	}
 }
\ No newline at end of file
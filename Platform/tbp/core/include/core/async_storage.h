@@ -0,0 +1,72 @@
+#pragma once
+
+#include <core/data_storage.h>
+
+#include <win/thread.h>
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+namespace tbp
+{
+	/////////////////////////////////////////////////////////////////////
+	// async_storage
+	// SB: saves are queued and written to the wrapped storage by dedicated writer thread, so collectors don't wait for disk.
+	// Writer takes all queued saves at once (up to max batch size) and writes them by one save_batch call, i.e. one group commit.
+	// Reads flush the queue first, so caller always sees its own writes. Failed save is dropped, its error is logged and rethrown by the
+	// next flush of the thread which queued it. Other saves of the failed group commit are written once more one by one
+
+	class async_storage : public data_storage
+	{
+		struct item
+		{
+			std::function<void(data_storage&)> write;
+
+			// SB: flush request, it's set when all previously queued saves are written
+			win::event* barrier;
+
+			// SB: thread which queued the item, error of the write is reported to it
+			std::thread::id owner;
+		};
+
+	private:
+		const data_storage::ptr m_storage;
+		const size_t m_max_batch_size;
+		mutable win::critical_section m_queue_cs;
+		mutable win::event m_queue_evt;
+		mutable std::deque<item> m_queue;
+		mutable std::unordered_map<std::thread::id, std::exception_ptr> m_errors;
+		bool m_stop;
+		std::thread m_writer;
+
+	private:
+		void writer_thread();
+		void write(std::vector<item>& batch);
+		void enqueue(item&& i) const;
+
+	public:
+		// SB: waits until all saves queued before the call are written, rethrows error of saves queued by the calling thread if any
+		void flush() const;
+
+	public:
+		virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override;
+		virtual std::vector<data_t::ptr> get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const override;
+		virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override;
+		virtual fixed_candle_series get_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, time_t* start_datetime, time_t* end_datetime) const override;
+		virtual data_chunks scan(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, size_t chunk_size = default_scan_chunk_size) const override;
+		virtual bool get_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, std::vector<time_range>* result) const override;
+
+		virtual void save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<data_t::ptr>& data) override;
+		virtual void save_instant_data(const std::wstring& instrument_id, const std::vector<data_t::ptr>& data) override;
+		virtual void save_candles(const std::wstring& instrument_id, unsigned long granularity, const candle_series& candles) override;
+		virtual void save_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, const fixed_candle_series& candles) override;
+		virtual void add_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime) override;
+
+	public:
+		async_storage(const data_storage::ptr& storage, size_t max_batch_size = 1000);
+		~async_storage();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <core/strategy.h>
+#include <core/data_storage.h>
+#include <core/connector.h>
+#include <core/trader.h>
+
+#include <functional>
+#include <vector>
+#include <string>
+
+namespace tbp
+{
+	namespace backtest
+	{
+		// SB: backtest replays stored candles through a strategy as fast as possible.
+		// Strategy gets simulated data provider, connector and trader: each candle is sent by on_historical_candles signal
+		// the same way data_collector does it live, market orders are filled immediately at close price of the current candle
+		// (ask for buy, bid for sell). Profit is calculated in quote currency of the instrument
+
+		/////////////////////////////////////////////////////////////////////
+		// parameters
+
+		struct parameters
+		{
+			std::wstring instrument;
+			unsigned long granularity = 60;
+			double initial_balance = 10000.0;
+			double margin_rate = 0.02;
+
+			// SB: amount of candles requested from data provider at once, limits memory used by backtest over data storage
+			size_t chunk_size = 64 * 1024;
+
+			// SB: equity curve takes two values per candle, optimizer needs only the summary
+			bool record_equity = true;
+		};
+
+		/////////////////////////////////////////////////////////////////////
+		// fill
+
+		struct fill
+		{
+			time_t timestamp;
+			std::wstring trade_id;
+
+			// SB: negative amount means sell. Closing fill has amount opposite to the trade amount
+			double amount = 0.0;
+			double price = 0.0;
+
+			// SB: realized profit, it is 0 for fills which open trades
+			double profit = 0.0;
+		};
+
+		/////////////////////////////////////////////////////////////////////
+		// result
+
+		struct result
+		{
+			std::vector<fill> fills;
+
+			// SB: equity curve, one point per processed candle. Equity includes unrealized profit of opened trades.
+			// Max drawdown is calculated even if the curve isn't recorded
+			std::vector<time_t> timestamp;
+			std::vector<double> equity;
+
+			double final_balance = 0.0;
+			double realized_profit = 0.0;
+			double max_drawdown = 0.0;
+			size_t candles_count = 0;
+			size_t rejected_orders = 0;
+		};
+
+		using strategy_factory = std::function<strategy::ptr(const data_provider::ptr& dp, const connector::ptr& c, const trader::ptr& t)>;
+
+		// SB: trades which are still opened after the last candle are closed at its close price
+		result run(const candle_series& candles, const parameters& params, const strategy_factory& create_strategy);
+		result run(const data_provider::ptr& source, time_t start_datetime, time_t end_datetime, const parameters& params, const strategy_factory& create_strategy);
+	}
+}
\ No newline at end of file
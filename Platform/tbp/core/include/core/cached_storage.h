@@ -0,0 +1,92 @@
+#pragma once
+
+#include <core/data_storage.h>
+
+#include <win/thread.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
+
+namespace tbp
+{
+	struct data_cache_stats
+	{
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+
+		// SB: estimated memory taken by cached blocks, in bytes
+		size_t size = 0;
+		size_t capacity = 0;
+	};
+
+	/////////////////////////////////////////////////////////////////////
+	// cached_storage
+	// SB: read-through cache of candles and candle records in front of the wrapped storage. They are cached by blocks of fixed time span per instrument and granularity,
+	// so overlapping requests share blocks. The least recently used blocks are evicted when estimated size exceeds the capacity.
+	// Saves go to the wrapped storage and invalidate the blocks they touch. Cached records are shared between readers, they shouldn't be modified
+
+	class cached_storage : public data_storage
+	{
+	public:
+		// SB: amount of candles in one block
+		static const size_t block_candles = 1024;
+
+	private:
+		enum class block_kind
+		{
+			data,
+			candles
+		};
+
+		struct block
+		{
+			std::vector<data_t::ptr> data;
+			candle_series candles;
+			size_t size = 0;
+		};
+
+		using block_key = std::tuple<block_kind, std::wstring, unsigned long, __int64>;
+		using lru_list = std::list<std::pair<block_key, std::shared_ptr<const block>>>;
+
+	private:
+		const data_storage::ptr m_storage;
+		const field_id m_timestamp_field;
+		mutable win::critical_section m_cache_cs;
+		mutable lru_list m_lru;
+		mutable std::map<block_key, lru_list::iterator> m_blocks;
+		mutable data_cache_stats m_stats;
+
+		// SB: it's incremented by each invalidation, so block which was read before invalidation isn't cached
+		mutable unsigned __int64 m_generation;
+
+	private:
+		std::shared_ptr<const block> get_block(block_kind kind, const std::wstring& instrument_id, unsigned long granularity, __int64 index) const;
+		std::shared_ptr<block> load_block(block_kind kind, const std::wstring& instrument_id, unsigned long granularity, __int64 index) const;
+		void invalidate(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime);
+		time_t get_timestamp(const data_t& record) const;
+
+	public:
+		data_cache_stats stats() const;
+
+	public:
+		virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override;
+		virtual std::vector<data_t::ptr> get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const override;
+		virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override;
+		virtual data_chunks scan(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, size_t chunk_size = default_scan_chunk_size) const override;
+		virtual bool get_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, std::vector<time_range>* result) const override;
+
+		virtual void save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<data_t::ptr>& data) override;
+		virtual void save_instant_data(const std::wstring& instrument_id, const std::vector<data_t::ptr>& data) override;
+		virtual void save_candles(const std::wstring& instrument_id, unsigned long granularity, const candle_series& candles) override;
+		virtual void save_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, const fixed_candle_series& candles) override;
+		virtual void save_batch(const std::function<void()>& save) override;
+		virtual void add_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime) override;
+
+	public:
+		// SB: 'timestamp_field' is the field of records which keeps candle timestamp, 'capacity' is the memory budget in bytes
+		cached_storage(const data_storage::ptr& storage, const field_id& timestamp_field, size_t capacity);
+	};
+}
\ No newline at end of file
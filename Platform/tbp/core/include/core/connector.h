@@ -108,9 +108,16 @@ namespace tbp
 		virtual double available_balance() const = 0;
 		virtual double margin_rate() const = 0;
 		virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const = 0;
+		virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const = 0;
 		virtual data_t::ptr get_instant_data(const std::wstring& instrument_id) = 0;
 		virtual order::ptr create_order(const data_t& params) = 0;
 		virtual order::ptr find_order(const std::wstring& id) const = 0;
 		virtual trade::ptr find_trade(const std::wstring& id) const = 0;
+
+		// SB: default implementation converts double prices, connectors which get prices as strings should parse them directly
+		virtual fixed_candle_series get_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, time_t* start_datetime, time_t* end_datetime) const
+		{
+			return to_fixed(get_candles(instrument_id, granularity, start_datetime, end_datetime), precision);
+		}
 	};
 }
\ No newline at end of file
@@ -34,10 +34,23 @@ namespace tbp
 		void collect_historical_data_thread();
 		void flush_cache();
 
+		// SB: if covered_source_only is set, only source candles which are marked as covered in storage are resampled
+		bool resample_stored_candles(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, bool covered_source_only, candle_series* result) const;
+
+		// SB: returns false if storage doesn't keep coverage index, otherwise ranges of [start_datetime, end_datetime] which are missing in storage
+		bool find_missing_ranges(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, std::vector<time_range>* result) const;
+
+		// SB: builds candles of missing ranges from finer stored candles or downloads them concurrently, then saves them and marks as covered
+		void fill_missing_ranges(const std::wstring& instrument_id, unsigned long granularity, const std::vector<time_range>& ranges) const;
+		void add_coverage(const std::wstring& instrument_id, unsigned long granularity, const time_range& range) const;
+
 	public:
-		// SB: if data not present id data storage gets it from connector and updates data in storage 
+		// SB: if data not present id data storage gets it from connector and updates data in storage.
+		// Before request to connector it tries to build candles from finer candles which are already in data storage.
+		// If storage keeps coverage index only missing ranges are requested, otherwise the whole range is requested when stored range differs
 		virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override;
 		virtual std::vector<data_t::ptr> get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const override;
+		virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override;
 
 	public:
 		void start();
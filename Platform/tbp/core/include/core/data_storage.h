@@ -1,28 +1,149 @@
 #pragma once
 
 #include <core/primitives.h>
+#include <core/fixed_price.h>
 
 #include <common/constrains.h>
 
 #include <boost/signals2.hpp>
 
+#include <functional>
 #include <vector>
 #include <memory>
 
 namespace tbp
 {
+	/////////////////////////////////////////////////////////////////////
+	// time_range
+	// SB: closed range [start, end] of timestamps
+
+	struct time_range
+	{
+		time_t start;
+		time_t end;
+	};
+
+	// SB: returns parts of [start_datetime, end_datetime] range which are not covered by 'covered' ranges. Covered ranges should be sorted by start
+	std::vector<time_range> find_gaps(const std::vector<time_range>& covered, time_t start_datetime, time_t end_datetime);
+
+	/////////////////////////////////////////////////////////////////////
+	// data_cursor
+	// SB: reads data range by chunks, so range of any length is read with bounded memory. Empty chunk means the end of range
+
+	struct data_cursor : sb::dynamic
+	{
+	public:
+		using ptr = std::shared_ptr<data_cursor>;
+
+	public:
+		virtual std::vector<data_t::ptr> next() = 0;
+	};
+
+	/////////////////////////////////////////////////////////////////////
+	// data_chunks
+	// SB: makes cursor usable in range-based for. It's single pass range, chunks are read by iterator increment
+
+	class data_chunks
+	{
+		data_cursor::ptr m_cursor;
+
+	public:
+		class iterator
+		{
+			data_cursor* m_cursor;
+			std::vector<data_t::ptr> m_chunk;
+
+		private:
+			void fetch()
+			{
+				m_chunk = m_cursor->next();
+				if (m_chunk.empty())
+				{
+					m_cursor = nullptr;
+				}
+			}
+
+		public:
+			std::vector<data_t::ptr>& operator*()
+			{
+				return m_chunk;
+			}
+
+			iterator& operator++()
+			{
+				fetch();
+				return *this;
+			}
+
+			bool operator==(const iterator& other) const
+			{
+				return m_cursor == other.m_cursor;
+			}
+
+			bool operator!=(const iterator& other) const
+			{
+				return m_cursor != other.m_cursor;
+			}
+
+		public:
+			iterator()
+				: m_cursor(nullptr)
+			{
+			}
+
+			explicit iterator(data_cursor* cursor)
+				: m_cursor(cursor)
+			{
+				fetch();
+			}
+		};
+
+	public:
+		iterator begin()
+		{
+			return iterator(m_cursor.get());
+		}
+
+		iterator end()
+		{
+			return iterator();
+		}
+
+	public:
+		explicit data_chunks(const data_cursor::ptr& cursor)
+			: m_cursor(cursor)
+		{
+		}
+	};
+
 	struct data_provider : sb::dynamic
 	{
 	public:
 		using ptr = std::shared_ptr<data_provider>;
 
+		// SB: max amount of records in one chunk returned by scan
+		static const size_t default_scan_chunk_size = 10000;
+
 	public:
 		boost::signals2::signal<void(const std::wstring& instrument_id, const std::vector<data_t::ptr>&)> on_instant_data;
-		boost::signals2::signal<void(const std::wstring& instrument_id, const std::vector<data_t::ptr>&)> on_historical_data;
+		boost::signals2::signal<void(const std::wstring& instrument_id, const candle_series&)> on_historical_candles;
 
 	public:
 		virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const = 0;
 		virtual std::vector<data_t::ptr> get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const = 0;
+
+		// SB: same as get_data but returns candles in columnar form without intermediate data_t objects
+		virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const = 0;
+
+		// SB: candles with fixed point prices, default implementation converts double prices
+		virtual fixed_candle_series get_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, time_t* start_datetime, time_t* end_datetime) const
+		{
+			return to_fixed(get_candles(instrument_id, granularity, start_datetime, end_datetime), precision);
+		}
+
+		// SB: same records as get_data returns for [start_datetime, end_datetime] range, but read by chunks of at most 'chunk_size' records.
+		// Default implementation calls get_data for consecutive time windows of 'chunk_size' candles, so chunks shouldn't outlive provider
+		virtual data_chunks scan(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, size_t chunk_size = default_scan_chunk_size) const;
 	};
 
 	struct data_storage : data_provider
@@ -33,5 +154,29 @@ namespace tbp
 	public:
 		virtual void save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<data_t::ptr>& data) = 0;
 		virtual void save_instant_data(const std::wstring& instrument_id, const std::vector<data_t::ptr>& data) = 0;
+		virtual void save_candles(const std::wstring& instrument_id, unsigned long granularity, const candle_series& candles) = 0;
+
+		virtual void save_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, const fixed_candle_series& candles)
+		{
+			save_candles(instrument_id, granularity, to_double(candles, precision));
+		}
+
+		// SB: saves made by 'save' function are committed at once if storage supports it, f.e. in one DB transaction
+		virtual void save_batch(const std::function<void()>& save)
+		{
+			save();
+		}
+
+		// SB: coverage index keeps ranges of candles which are known to be complete in storage, so missing ranges can be found without reading candles.
+		// Returns false if storage doesn't keep the index, otherwise appends covered ranges which intersect [start_datetime, end_datetime] in ascending order
+		virtual bool get_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, std::vector<time_range>* result) const
+		{
+			return false;
+		}
+
+		// SB: marks [start_datetime, end_datetime] range as complete, overlapping and adjacent ranges are merged
+		virtual void add_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime)
+		{
+		}
 	};
 }
\ No newline at end of file
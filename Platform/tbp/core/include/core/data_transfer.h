@@ -0,0 +1,34 @@
+#pragma once
+
+#include <core/data_storage.h>
+
+#include <istream>
+#include <ostream>
+
+namespace tbp
+{
+	/////////////////////////////////////////////////////////////////////
+	// data transfer
+	// SB: bulk import / export of historical candles. CSV has one candle per line:
+	// timestamp (Unix seconds), volume, bid open, high, low, close, ask open, high, low, close[, complete], lines which don't start with a number are skipped.
+	// Binary format is "TBPC" signature and format version followed by blocks, each block is amount of candles and then columns of candle_series
+	// in their declaration order, all values are little endian
+
+	enum class transfer_format
+	{
+		csv,
+		binary
+	};
+
+	// SB: amount of candles which are parsed and saved at once, each chunk is saved by one save_batch call
+	const size_t default_transfer_chunk_size = 100000;
+
+	// SB: chunks are parsed by worker threads and sorted by timestamp, the caller thread saves them in order meanwhile.
+	// Range of each chunk is added to coverage index of storage. Returns amount of imported candles
+	size_t import_candles(std::istream& input, transfer_format format, data_storage& storage, const std::wstring& instrument_id, unsigned long granularity, size_t chunk_size = default_transfer_chunk_size);
+
+	// SB: candles of [start_datetime, end_datetime] range are read by get_candles for consecutive windows of 'chunk_size' candles and written as they are read.
+	// Returns amount of exported candles
+	size_t export_candles(const data_provider& provider, const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime,
+		transfer_format format, std::ostream& output, size_t chunk_size = default_transfer_chunk_size);
+}
\ No newline at end of file
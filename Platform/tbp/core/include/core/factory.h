@@ -20,5 +20,11 @@ namespace tbp
 		virtual connector::ptr create_connector(const authentication::ptr& auth) = 0;
 		virtual data_storage::ptr create_storage() = 0;
 		virtual trader::ptr create_trader(const tbp::connector::ptr& c) = 0;
+
+		// SB: storage for bulk loads, saves go to the storage directly, so each of them is written by the time it returns
+		virtual data_storage::ptr create_bulk_storage()
+		{
+			return create_storage();
+		}
 	};
 }
\ No newline at end of file
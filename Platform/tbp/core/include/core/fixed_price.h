@@ -0,0 +1,53 @@
+#pragma once
+
+#include <core/primitives.h>
+
+#include <cmath>
+#include <string>
+#include <stdexcept>
+
+namespace tbp
+{
+	// SB: fixed point price is integer number of price units, unit is 10^-precision.
+	// Precision is the number of decimal digits quoted for the instrument, f.e. 1.10234 EUR_USD with precision 5 is 110234.
+	// Fixed point prices are compared exactly, conversion to double should be done only where floating point calculations
+	// are required. Storages keep prices as doubles and convert them on save / read
+
+	using fixed_price_t = __int64;
+
+	const unsigned long c_max_price_precision = 15;
+
+	inline __int64 get_price_scale(unsigned long precision)
+	{
+		static const __int64 scales[c_max_price_precision + 1] =
+		{
+			1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL, 1000000000LL,
+			10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL, 100000000000000LL, 1000000000000000LL
+		};
+
+		if (precision > c_max_price_precision)
+		{
+			throw std::out_of_range("Price precision is too large!");
+		}
+
+		return scales[precision];
+	}
+
+	// SB: rounds to the nearest price unit
+	inline fixed_price_t to_fixed(double price, unsigned long precision)
+	{
+		return std::llround(price * get_price_scale(precision));
+	}
+
+	// SB: both values are exact in double, so the result is the nearest double to the decimal price
+	inline double to_double(fixed_price_t price, unsigned long precision)
+	{
+		return static_cast<double>(price) / get_price_scale(precision);
+	}
+
+	// SB: parses decimal string without intermediate double, digits after precision are rounded half away from zero
+	fixed_price_t parse_fixed(const std::wstring& str, unsigned long precision);
+
+	fixed_candle_series to_fixed(const candle_series& candles, unsigned long precision);
+	candle_series to_double(const fixed_candle_series& candles, unsigned long precision);
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+
+namespace tbp
+{
+	namespace kernels
+	{
+		// SB: batch indicator kernels which work on contiguous spans of values.
+		// All kernels write 'count' values to the output, values which can't be calculated yet
+		// (warm-up period) are set to 0 the same way as analysis::calculate_ema does.
+		// SIMD implementation is selected at runtime, the scalar one is the reference implementation
+
+		enum class isa
+		{
+			scalar,
+			sse2,
+			avx2
+		};
+
+		// SB: the best instruction set supported by CPU and OS
+		isa supported_isa();
+		isa current_isa();
+
+		// SB: throws if requested instruction set is not supported. Mostly for tests and benchmarks
+		void set_isa(isa value);
+		const wchar_t* isa_name(isa value);
+
+		void sma(const double* values, size_t count, unsigned long length, double* result);
+		void sma(const float* values, size_t count, unsigned long length, float* result);
+
+		void ema(const double* values, size_t count, unsigned long length, double* result);
+		void ema(const float* values, size_t count, unsigned long length, float* result);
+
+		// SB: linearly weighted moving average, the newest value has weight 'length'
+		void wma(const double* values, size_t count, unsigned long length, double* result);
+		void wma(const float* values, size_t count, unsigned long length, float* result);
+
+		// SB: population standard deviation over the window
+		void rolling_stddev(const double* values, size_t count, unsigned long length, double* result);
+		void rolling_stddev(const float* values, size_t count, unsigned long length, float* result);
+
+		void bollinger(const double* values, size_t count, unsigned long length, double width, double* middle, double* upper, double* lower);
+		void bollinger(const float* values, size_t count, unsigned long length, float width, float* middle, float* upper, float* lower);
+
+		// SB: Wilder's RSI, the first value is available at index 'length'
+		void rsi(const double* values, size_t count, unsigned long length, double* result);
+		void rsi(const float* values, size_t count, unsigned long length, float* result);
+
+		// SB: Wilder's average true range, the first value is available at index 'length - 1'
+		void atr(const double* high, const double* low, const double* close, size_t count, unsigned long length, double* result);
+		void atr(const float* high, const float* low, const float* close, size_t count, unsigned long length, float* result);
+
+		// SB: signal line is EMA of MACD line, it starts when the slow EMA is available
+		void macd(const double* values, size_t count, unsigned long fast_length, unsigned long slow_length, unsigned long signal_length, double* macd_line, double* signal_line, double* histogram);
+		void macd(const float* values, size_t count, unsigned long fast_length, unsigned long slow_length, unsigned long signal_length, float* macd_line, float* signal_line, float* histogram);
+
+		void rolling_min(const double* values, size_t count, unsigned long length, double* result);
+		void rolling_min(const float* values, size_t count, unsigned long length, float* result);
+
+		void rolling_max(const double* values, size_t count, unsigned long length, double* result);
+		void rolling_max(const float* values, size_t count, unsigned long length, float* result);
+
+		// SB: EMA for each of 'lengths_count' lengths in one pass over values, lengths are calculated in SIMD lanes.
+		// Result is column-major: EMA for lengths[j] is stored to result[j * count] ... result[j * count + count - 1],
+		// each column is the same as ema() gives
+		void ema_sweep(const double* values, size_t count, const unsigned long* lengths, size_t lengths_count, double* result);
+		void ema_sweep(const float* values, size_t count, const unsigned long* lengths, size_t lengths_count, float* result);
+
+		// SB: extremum of each segment [offsets[i], offsets[i + 1]) of values, 'offsets' has segments_count + 1 items.
+		// Segments should not be empty. Used to aggregate candles into coarser granularity
+		void segment_min(const double* values, const size_t* offsets, size_t segments_count, double* result);
+		void segment_min(const float* values, const size_t* offsets, size_t segments_count, float* result);
+
+		void segment_max(const double* values, const size_t* offsets, size_t segments_count, double* result);
+		void segment_max(const float* values, const size_t* offsets, size_t segments_count, float* result);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <core/backtest.h>
+#include <core/settings.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tbp
+{
+	namespace optimizer
+	{
+		// SB: optimizer runs backtest for combinations of strategy settings in parallel and ranks them.
+		// Each trial gets base settings with optimized values put on top of them. All trials read the same candles
+
+		/////////////////////////////////////////////////////////////////////
+		// parameter
+
+		struct parameter
+		{
+			std::wstring name;
+			std::vector<setting_value> values;
+		};
+
+		// SB: values from first to last inclusive
+		parameter make_range(const std::wstring& name, int first, int last, int step);
+		parameter make_range(const std::wstring& name, double first, double last, double step);
+
+		/////////////////////////////////////////////////////////////////////
+		// options
+
+		enum class search_mode
+		{
+			grid,
+			random
+		};
+
+		enum class objective
+		{
+			profit,
+			profit_to_drawdown
+		};
+
+		struct options
+		{
+			search_mode mode = search_mode::grid;
+			objective target = objective::profit;
+
+			// SB: random search only. If grid is smaller than trials count the whole grid is evaluated
+			size_t random_trials = 100;
+			unsigned int random_seed = 0;
+
+			// SB: 0 means number of hardware threads
+			size_t threads_count = 0;
+		};
+
+		/////////////////////////////////////////////////////////////////////
+		// trial_result
+
+		struct trial_result
+		{
+			std::vector<std::pair<std::wstring, setting_value>> parameters;
+
+			double score = 0.0;
+			double profit = 0.0;
+			double max_drawdown = 0.0;
+			size_t fills_count = 0;
+			size_t rejected_orders = 0;
+
+			// SB: not empty if strategy failed with these settings, failed trials are ranked last
+			std::string error;
+		};
+
+		using strategy_factory = std::function<strategy::ptr(const data_provider::ptr& dp, const connector::ptr& c, const trader::ptr& t, const settings::ptr& s)>;
+
+		// SB: results are sorted by score, the best one goes first
+		std::vector<trial_result> run(const std::shared_ptr<const candle_series>& candles, const backtest::parameters& params, const settings::ptr& base_settings,
+			const std::vector<parameter>& parameters, const options& opts, const strategy_factory& create_strategy);
+
+		std::wstring format_results(const std::vector<trial_result>& results, size_t max_rows);
+	}
+}
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <boost/variant.hpp>
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
 #include <vector>
-#include <map>
 #include <chrono>
+#include <string>
+#include <stdexcept>
 
 namespace tbp
 {
@@ -14,13 +18,396 @@ namespace tbp
 	using binary_t = std::vector<byte_t>;
 	using value_t = boost::variant<__int64, std::wstring, time_t, bool, double, binary_t, data_t>;
 
-	struct data_t : public std::map<std::wstring, value_t>
+	/////////////////////////////////////////////////////////////////////
+	// field_id
+	// SB: interned field name. Each distinct name gets its own integer id once per process,
+	// so field lookups are integer compares. Implicitly constructible from string to keep
+	// string keyed code (JSON, order params) working. Interning takes a lock,
+	// hot paths should use predefined field_id constants
+
+	class field_id
+	{
+		unsigned long m_id;
+
+	private:
+		static unsigned long intern(const std::wstring& name);
+
+	public:
+		unsigned long id() const
+		{
+			return m_id;
+		}
+
+		const std::wstring& name() const;
+
+	public:
+		field_id(const std::wstring& name)
+			: m_id(intern(name))
+		{
+		}
+
+		field_id(const wchar_t* name)
+			: m_id(intern(name))
+		{
+		}
+	};
+
+	inline bool operator==(const field_id& lhs, const field_id& rhs)
+	{
+		return lhs.id() == rhs.id();
+	}
+
+	inline bool operator!=(const field_id& lhs, const field_id& rhs)
+	{
+		return lhs.id() != rhs.id();
+	}
+
+	inline bool operator<(const field_id& lhs, const field_id& rhs)
+	{
+		return lhs.id() < rhs.id();
+	}
+
+	/////////////////////////////////////////////////////////////////////
+	// data_t
+	// SB: record with map-like interface. Fields are stored in one flat vector sorted by field id,
+	// so the record needs a single allocation instead of a tree node per field.
+	// Iteration order is the order of field ids, not alphabetical
+
+	struct data_t
 	{
 		using ptr = std::shared_ptr<data_t>;
+		using key_type = field_id;
+		using mapped_type = value_t;
+		using value_type = std::pair<field_id, value_t>;
+		using container_type = std::vector<value_type>;
+		using iterator = container_type::iterator;
+		using const_iterator = container_type::const_iterator;
+
+	private:
+		container_type m_fields;
+
+	private:
+		iterator lower_bound(const field_id& key)
+		{
+			return std::lower_bound(m_fields.begin(), m_fields.end(), key, [](const value_type& field, const field_id& key) { return field.first < key; });
+		}
+
+		const_iterator lower_bound(const field_id& key) const
+		{
+			return std::lower_bound(m_fields.begin(), m_fields.end(), key, [](const value_type& field, const field_id& key) { return field.first < key; });
+		}
+
+	public:
+		iterator begin()
+		{
+			return m_fields.begin();
+		}
+
+		iterator end()
+		{
+			return m_fields.end();
+		}
+
+		const_iterator begin() const
+		{
+			return m_fields.begin();
+		}
+
+		const_iterator end() const
+		{
+			return m_fields.end();
+		}
+
+		size_t size() const
+		{
+			return m_fields.size();
+		}
+
+		bool empty() const
+		{
+			return m_fields.empty();
+		}
+
+		void clear()
+		{
+			m_fields.clear();
+		}
+
+		void reserve(size_t count)
+		{
+			m_fields.reserve(count);
+		}
+
+		iterator find(const field_id& key)
+		{
+			auto it = lower_bound(key);
+			return (m_fields.end() != it && it->first == key) ? it : m_fields.end();
+		}
+
+		const_iterator find(const field_id& key) const
+		{
+			auto it = lower_bound(key);
+			return (m_fields.end() != it && it->first == key) ? it : m_fields.end();
+		}
+
+		size_t count(const field_id& key) const
+		{
+			return end() != find(key) ? 1 : 0;
+		}
+
+		value_t& at(const field_id& key)
+		{
+			auto it = find(key);
+			if (end() == it)
+			{
+				throw std::out_of_range("Field is not found!");
+			}
+
+			return it->second;
+		}
+
+		const value_t& at(const field_id& key) const
+		{
+			auto it = find(key);
+			if (end() == it)
+			{
+				throw std::out_of_range("Field is not found!");
+			}
+
+			return it->second;
+		}
+
+		value_t& operator[](const field_id& key)
+		{
+			auto it = lower_bound(key);
+			if (m_fields.end() == it || it->first != key)
+			{
+				it = m_fields.emplace(it, key, value_t());
+			}
+
+			return it->second;
+		}
+
+		// SB: same as std::map, existing field is not overwritten
+		template <typename V>
+		std::pair<iterator, bool> emplace(const field_id& key, V&& value)
+		{
+			auto it = lower_bound(key);
+			if (m_fields.end() != it && it->first == key)
+			{
+				return{ it, false };
+			}
+
+			return{ m_fields.emplace(it, key, std::forward<V>(value)), true };
+		}
+
+		std::pair<iterator, bool> insert(value_type field)
+		{
+			return emplace(field.first, std::move(field.second));
+		}
+
+		size_t erase(const field_id& key)
+		{
+			auto it = find(key);
+			if (end() == it)
+			{
+				return 0;
+			}
+
+			m_fields.erase(it);
+			return 1;
+		}
 
 	public:
-		using std::map<std::wstring, value_t>::map;
+		data_t() = default;
+
+		data_t(std::initializer_list<value_type> fields)
+		{
+			m_fields.reserve(fields.size());
+			for (const auto& field : fields)
+			{
+				insert(field);
+			}
+		}
 	};
 
+	inline bool operator==(const data_t& lhs, const data_t& rhs)
+	{
+		return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+	}
+
+	inline bool operator!=(const data_t& lhs, const data_t& rhs)
+	{
+		return !(lhs == rhs);
+	}
+
 	using boost::get;
+
+	/////////////////////////////////////////////////////////////////////
+	// candlestick_data
+
+	struct candle_info
+	{
+		double high = 0.0;
+		double open = 0.0;
+		double close = 0.0;
+		double low = 0.0;
+	};
+
+	struct candlestick_data
+	{
+		candle_info bid;
+		candle_info ask;
+		int volume = 0;
+		time_t timestamp = time_t();
+		bool complete = true;
+
+		static double get_middle(const candle_info& ci)
+		{
+			return (ci.high + ci.low) / 2;
+		}
+	};
+
+	/////////////////////////////////////////////////////////////////////
+	// basic_candle_series
+	// SB: columnar (structure of arrays) representation of candles sequence.
+	// All columns always have the same size. Prices are either double or fixed point (see core/fixed_price.h),
+	// conversion from / to candlestick_data is available for double prices only
+
+	template <typename price_t>
+	struct basic_candle_series
+	{
+		using price_type = price_t;
+
+		struct prices
+		{
+			std::vector<price_t> open;
+			std::vector<price_t> high;
+			std::vector<price_t> low;
+			std::vector<price_t> close;
+
+		public:
+			void reserve(size_t count)
+			{
+				open.reserve(count);
+				high.reserve(count);
+				low.reserve(count);
+				close.reserve(count);
+			}
+
+			void clear()
+			{
+				open.clear();
+				high.clear();
+				low.clear();
+				close.clear();
+			}
+
+			void push_back(const candle_info& ci)
+			{
+				open.push_back(ci.open);
+				high.push_back(ci.high);
+				low.push_back(ci.low);
+				close.push_back(ci.close);
+			}
+
+			void append(const prices& rhs, size_t first, size_t count)
+			{
+				open.insert(open.end(), rhs.open.begin() + first, rhs.open.begin() + first + count);
+				high.insert(high.end(), rhs.high.begin() + first, rhs.high.begin() + first + count);
+				low.insert(low.end(), rhs.low.begin() + first, rhs.low.begin() + first + count);
+				close.insert(close.end(), rhs.close.begin() + first, rhs.close.begin() + first + count);
+			}
+
+			candle_info at(size_t index) const
+			{
+				candle_info result;
+				result.open = open.at(index);
+				result.high = high.at(index);
+				result.low = low.at(index);
+				result.close = close.at(index);
+
+				return result;
+			}
+		};
+
+	public:
+		std::vector<time_t> timestamp;
+		std::vector<__int64> volume;
+		prices bid;
+		prices ask;
+		std::vector<byte_t> complete;
+
+	public:
+		size_t size() const
+		{
+			return timestamp.size();
+		}
+
+		bool empty() const
+		{
+			return timestamp.empty();
+		}
+
+		void reserve(size_t count)
+		{
+			timestamp.reserve(count);
+			volume.reserve(count);
+			bid.reserve(count);
+			ask.reserve(count);
+			complete.reserve(count);
+		}
+
+		void clear()
+		{
+			timestamp.clear();
+			volume.clear();
+			bid.clear();
+			ask.clear();
+			complete.clear();
+		}
+
+		void push_back(const candlestick_data& candle)
+		{
+			timestamp.push_back(candle.timestamp);
+			volume.push_back(candle.volume);
+			bid.push_back(candle.bid);
+			ask.push_back(candle.ask);
+			complete.push_back(candle.complete ? 1 : 0);
+		}
+
+		void append(const basic_candle_series& rhs, size_t first, size_t count)
+		{
+			if (first + count > rhs.size())
+			{
+				throw std::out_of_range("Candle series range is out of bounds!");
+			}
+
+			timestamp.insert(timestamp.end(), rhs.timestamp.begin() + first, rhs.timestamp.begin() + first + count);
+			volume.insert(volume.end(), rhs.volume.begin() + first, rhs.volume.begin() + first + count);
+			bid.append(rhs.bid, first, count);
+			ask.append(rhs.ask, first, count);
+			complete.insert(complete.end(), rhs.complete.begin() + first, rhs.complete.begin() + first + count);
+		}
+
+		void append(const basic_candle_series& rhs)
+		{
+			append(rhs, 0, rhs.size());
+		}
+
+		candlestick_data at(size_t index) const
+		{
+			candlestick_data result;
+			result.timestamp = timestamp.at(index);
+			result.volume = static_cast<int>(volume.at(index));
+			result.bid = bid.at(index);
+			result.ask = ask.at(index);
+			result.complete = 0 != complete.at(index);
+
+			return result;
+		}
+	};
+
+	using candle_series = basic_candle_series<double>;
+	using fixed_candle_series = basic_candle_series<__int64>;
 }
\ No newline at end of file
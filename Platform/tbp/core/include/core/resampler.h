@@ -0,0 +1,22 @@
+#pragma once
+
+#include <core/primitives.h>
+
+namespace tbp
+{
+	namespace resampler
+	{
+		// SB: resampler builds candles of coarser granularity from stored finer candles (f.e. H1 from M1) without requests to server.
+		// Target candle starts at the timestamp aligned to target granularity. For both bid and ask: open is the open of the first
+		// source candle, close is the close of the last one, high / low are extremums over the source candles. Volume is summed.
+		// Source candles are expected to be sorted by timestamp, periods without ticks have no candles the same way as server returns them
+
+		// SB: target should be a multiple of source granularity. Only intraday granularities are supported: daily and longer candles
+		// are aligned by server to trading day, not to the epoch
+		bool can_resample(unsigned long source_granularity, unsigned long target_granularity);
+
+		// SB: target candle is complete if all its source candles are complete and its period is over, i.e. there are later
+		// source candles or the last source candle ends at the end of the target period
+		candle_series resample(const candle_series& candles, unsigned long source_granularity, unsigned long target_granularity);
+	}
+}
\ No newline at end of file
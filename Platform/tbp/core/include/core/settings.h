@@ -32,6 +32,20 @@ namespace tbp
 		return boost::get<T>(s->get(name));
 	}
 
+	// SB: json doesn't distinguish integral and floating point numbers, so integral value is also accepted as double
+	template<>
+	inline double get_value<double>(const settings::ptr& s, const std::wstring& name)
+	{
+		auto setting_val = s->get(name);
+		auto val = boost::get<int>(&setting_val);
+		if (nullptr != val)
+		{
+			return *val;
+		}
+
+		return boost::get<double>(setting_val);
+	}
+
 	template<typename T>
 	T get_value(const settings::ptr& s, const std::wstring& name, T default_val)
 	{
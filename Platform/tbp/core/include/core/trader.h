@@ -10,28 +10,6 @@
 
 namespace tbp
 {
-	struct candle_info
-	{
-		double high = 0.0;
-		double open = 0.0;
-		double close = 0.0;
-		double low = 0.0;
-	};
-
-	struct candlestick_data
-	{
-		candle_info bid;
-		candle_info ask;
-		int volume = 0;
-		time_t timestamp = time_t();
-		bool complete = true;
-
-		static double get_middle(const candle_info& ci)
-		{
-			return (ci.high + ci.low) / 2;
-		}
-	};
-
 	struct trader : public sb::dynamic
 	{
 	public:
@@ -48,6 +26,7 @@ namespace tbp
 		virtual void close_pending_trades() = 0;
 
 		// SB: connector get_data and get_instant_data should return vector of candlestick_data instead of vector of data_t::ptr
+		// use get_candles methods of connector / data_provider to get columnar candles data directly
 		virtual std::vector<candlestick_data> get_candles_from_data(const std::vector<data_t::ptr>& candles_data) const = 0;
 	};
 }
\ No newline at end of file
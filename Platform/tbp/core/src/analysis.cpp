@@ -1,8 +1,320 @@
 #include <core/analysis.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace tbp
 {
 	namespace analysis
 	{
+		namespace
+		{
+			namespace state_fields
+			{
+				const field_id c_length = L"length";
+				const field_id c_count = L"count";
+				const field_id c_position = L"position";
+				const field_id c_value = L"value";
+				const field_id c_sum = L"sum";
+				const field_id c_window = L"window";
+				const field_id c_fast = L"fast";
+				const field_id c_slow = L"slow";
+				const field_id c_signal = L"signal";
+			}
+
+			unsigned long get_length(const data_t& state)
+			{
+				const auto length = get<__int64>(state.at(state_fields::c_length));
+				if (length <= 0)
+				{
+					throw std::runtime_error("Invalid indicator state length!");
+				}
+
+				return boost::numeric_cast<unsigned long>(length);
+			}
+
+			size_t get_count(const data_t& state)
+			{
+				return boost::numeric_cast<size_t>(get<__int64>(state.at(state_fields::c_count)));
+			}
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// sma_state
+
+		double sma_state::update(double value)
+		{
+			if (m_count >= m_length)
+			{
+				m_sum -= m_window[m_position];
+			}
+
+			m_window[m_position] = value;
+			m_sum += value;
+			++m_count;
+
+			if (++m_position == m_length)
+			{
+				m_position = 0;
+
+				// SB: recalculate sum once per window to avoid accumulation of floating point error
+				m_sum = 0.0;
+				for (const auto& val : m_window)
+				{
+					m_sum += val;
+				}
+			}
+
+			return this->value();
+		}
+
+		void sma_state::reset()
+		{
+			std::fill(m_window.begin(), m_window.end(), 0.0);
+			m_position = 0;
+			m_count = 0;
+			m_sum = 0.0;
+		}
+
+		bool sma_state::ready() const
+		{
+			return m_count >= m_length;
+		}
+
+		double sma_state::value() const
+		{
+			if (!ready())
+			{
+				return 0.0;
+			}
+
+			return m_sum / m_length;
+		}
+
+		unsigned long sma_state::length() const
+		{
+			return m_length;
+		}
+
+		data_t sma_state::save() const
+		{
+			binary_t window(m_window.size() * sizeof(double));
+			if (!window.empty())
+			{
+				std::memcpy(window.data(), m_window.data(), window.size());
+			}
+
+			data_t result;
+			result[state_fields::c_length] = static_cast<__int64>(m_length);
+			result[state_fields::c_count] = boost::numeric_cast<__int64>(m_count);
+			result[state_fields::c_position] = boost::numeric_cast<__int64>(m_position);
+			result[state_fields::c_sum] = m_sum;
+			result[state_fields::c_window] = window;
+
+			return result;
+		}
+
+		sma_state sma_state::load(const data_t& state)
+		{
+			sma_state result(get_length(state));
+
+			const auto& window = get<binary_t>(state.at(state_fields::c_window));
+			if (window.size() != result.m_window.size() * sizeof(double))
+			{
+				throw std::runtime_error("Invalid SMA state window size!");
+			}
+
+			const auto position = boost::numeric_cast<size_t>(get<__int64>(state.at(state_fields::c_position)));
+			if (position >= result.m_length)
+			{
+				throw std::runtime_error("Invalid SMA state window position!");
+			}
+
+			std::memcpy(result.m_window.data(), window.data(), window.size());
+			result.m_position = position;
+			result.m_count = get_count(state);
+			result.m_sum = get<double>(state.at(state_fields::c_sum));
+
+			return result;
+		}
+
+		sma_state::sma_state(unsigned long length)
+			: m_length(length)
+			, m_position(0)
+			, m_count(0)
+			, m_sum(0.0)
+		{
+			if (0 == m_length)
+			{
+				throw std::runtime_error("SMA length should be greater than zero!");
+			}
+
+			m_window.resize(m_length, 0.0);
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// ema_state
+
+		double ema_state::update(double value)
+		{
+			if (m_count < m_length)
+			{
+				// SB: accumulate sum of first values, it becomes the first EMA value
+				m_value += value;
+				if (m_length - 1 == m_count)
+				{
+					m_value /= m_length;
+				}
+			}
+			else
+			{
+				m_value = value * m_alpha + (1.0 - m_alpha) * m_value;
+			}
+
+			++m_count;
+
+			return this->value();
+		}
+
+		void ema_state::reset()
+		{
+			m_count = 0;
+			m_value = 0.0;
+		}
+
+		bool ema_state::ready() const
+		{
+			return m_count >= m_length;
+		}
+
+		double ema_state::value() const
+		{
+			if (!ready())
+			{
+				return 0.0;
+			}
+
+			return m_value;
+		}
+
+		unsigned long ema_state::length() const
+		{
+			return m_length;
+		}
+
+		data_t ema_state::save() const
+		{
+			data_t result;
+			result[state_fields::c_length] = static_cast<__int64>(m_length);
+			result[state_fields::c_count] = boost::numeric_cast<__int64>(m_count);
+			result[state_fields::c_value] = m_value;
+
+			return result;
+		}
+
+		ema_state ema_state::load(const data_t& state)
+		{
+			ema_state result(get_length(state));
+			result.m_count = get_count(state);
+			result.m_value = get<double>(state.at(state_fields::c_value));
+
+			return result;
+		}
+
+		ema_state::ema_state(unsigned long length)
+			: m_length(length)
+			, m_alpha(2.0 / (length + 1))
+			, m_count(0)
+			, m_value(0.0)
+		{
+			if (0 == m_length)
+			{
+				throw std::runtime_error("EMA length should be greater than zero!");
+			}
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// macd_state
+
+		double macd_state::update(double value)
+		{
+			m_fast.update(value);
+			m_slow.update(value);
+
+			if (m_slow.ready())
+			{
+				m_signal.update(this->value());
+			}
+
+			return this->value();
+		}
+
+		void macd_state::reset()
+		{
+			m_fast.reset();
+			m_slow.reset();
+			m_signal.reset();
+		}
+
+		bool macd_state::ready() const
+		{
+			return m_slow.ready() && m_signal.ready();
+		}
+
+		double macd_state::value() const
+		{
+			if (!m_slow.ready())
+			{
+				return 0.0;
+			}
+
+			return m_fast.value() - m_slow.value();
+		}
+
+		double macd_state::signal() const
+		{
+			return m_signal.value();
+		}
+
+		double macd_state::histogram() const
+		{
+			if (!ready())
+			{
+				return 0.0;
+			}
+
+			return value() - signal();
+		}
+
+		data_t macd_state::save() const
+		{
+			data_t result;
+			result[state_fields::c_fast] = m_fast.save();
+			result[state_fields::c_slow] = m_slow.save();
+			result[state_fields::c_signal] = m_signal.save();
+
+			return result;
+		}
+
+		macd_state macd_state::load(const data_t& state)
+		{
+			macd_state result;
+			result.m_fast = ema_state::load(get<data_t>(state.at(state_fields::c_fast)));
+			result.m_slow = ema_state::load(get<data_t>(state.at(state_fields::c_slow)));
+			result.m_signal = ema_state::load(get<data_t>(state.at(state_fields::c_signal)));
+
+			return result;
+		}
+
+		macd_state::macd_state(unsigned long fast_length, unsigned long slow_length, unsigned long signal_length)
+			: m_fast(fast_length)
+			, m_slow(slow_length)
+			, m_signal(signal_length)
+		{
+			if (fast_length >= slow_length)
+			{
+				throw std::runtime_error("MACD fast length should be less than slow length!");
+			}
+		}
 	}
 }
\ No newline at end of file
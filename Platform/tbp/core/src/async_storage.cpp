@@ -0,0 +1,261 @@
+#include <core/async_storage.h>
+#include <logging/log.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace tbp
+{
+	namespace
+	{
+		// SB: records are shared with caller which can change them before they are written
+		std::vector<data_t::ptr> copy_data(const std::vector<data_t::ptr>& data)
+		{
+			std::vector<data_t::ptr> result;
+			result.reserve(data.size());
+			for (const auto& d : data)
+			{
+				result.emplace_back(std::make_shared<data_t>(*d));
+			}
+
+			return result;
+		}
+
+		// SB: returns error of the batch, batch is rolled back completely by the storage
+		std::exception_ptr try_save_batch(data_storage& storage, const std::function<void()>& save, size_t batch_size)
+		{
+			try
+			{
+				storage.save_batch(save);
+			}
+			catch (const std::exception& ex)
+			{
+				LOG_ERR << L"Exception was thrown during writing data to storage. Batch size: " << batch_size << L" Info: " << ex.what();
+				return std::current_exception();
+			}
+			catch (...)
+			{
+				LOG_ERR << L"Unknown error! Exception was thrown during writing data to storage. Batch size: " << batch_size;
+				return std::current_exception();
+			}
+
+			return nullptr;
+		}
+	}
+
+	void async_storage::writer_thread()
+	{
+		for (;;)
+		{
+			m_queue_evt.wait(INFINITE);
+
+			for (;;)
+			{
+				std::vector<item> batch;
+				bool stop = false;
+				{
+					win::scoped_lock lock(m_queue_cs);
+
+					const auto count = std::min(m_queue.size(), m_max_batch_size);
+					batch.assign(std::make_move_iterator(m_queue.begin()), std::make_move_iterator(m_queue.begin() + count));
+					m_queue.erase(m_queue.begin(), m_queue.begin() + count);
+					stop = m_stop;
+				}
+
+				if (batch.empty())
+				{
+					// SB: queue is written completely before writer stops
+					if (stop)
+					{
+						return;
+					}
+
+					break;
+				}
+
+				write(batch);
+			}
+		}
+	}
+
+	void async_storage::write(std::vector<item>& batch)
+	{
+		// SB: batch can contain flush requests only
+		std::vector<const item*> writes;
+		for (const auto& i : batch)
+		{
+			if (i.write)
+			{
+				writes.push_back(&i);
+			}
+		}
+
+		std::vector<std::pair<std::thread::id, std::exception_ptr>> errors;
+		if (!writes.empty())
+		{
+			auto error = try_save_batch(*m_storage, [&]() { for (const auto i : writes) { i->write(*m_storage); } }, writes.size());
+			if (error && writes.size() > 1)
+			{
+				// SB: one failed save shouldn't drop the whole group, so its saves are written once more one by one
+				LOG_INFO << L"Group commit has failed. Writing its saves one by one. Saves count: " << writes.size();
+
+				for (const auto i : writes)
+				{
+					if (auto item_error = try_save_batch(*m_storage, [&]() { i->write(*m_storage); }, 1))
+					{
+						errors.emplace_back(i->owner, item_error);
+					}
+				}
+			}
+			else if (error)
+			{
+				errors.emplace_back(writes.front()->owner, error);
+			}
+		}
+
+		if (!errors.empty())
+		{
+			win::scoped_lock lock(m_queue_cs);
+
+			// SB: the first error of the thread is kept until its flush
+			for (const auto& e : errors)
+			{
+				m_errors.emplace(e.first, e.second);
+			}
+		}
+
+		for (const auto& i : batch)
+		{
+			if (nullptr != i.barrier)
+			{
+				i.barrier->set();
+			}
+		}
+	}
+
+	void async_storage::enqueue(item&& i) const
+	{
+		i.owner = std::this_thread::get_id();
+		{
+			win::scoped_lock lock(m_queue_cs);
+			m_queue.push_back(std::move(i));
+		}
+
+		m_queue_evt.set();
+	}
+
+	void async_storage::flush() const
+	{
+		win::event written(false, false);
+		enqueue({ nullptr, &written });
+		written.wait(INFINITE);
+
+		std::exception_ptr error;
+		{
+			win::scoped_lock lock(m_queue_cs);
+
+			const auto it = m_errors.find(std::this_thread::get_id());
+			if (m_errors.end() != it)
+			{
+				error = it->second;
+				m_errors.erase(it);
+			}
+		}
+
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	std::vector<data_t::ptr> async_storage::get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const
+	{
+		flush();
+
+		return m_storage->get_data(instrument_id, granularity, start_datetime, end_datetime);
+	}
+
+	std::vector<data_t::ptr> async_storage::get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const
+	{
+		flush();
+
+		return m_storage->get_instant_data(instrument_id, start_datetime, end_datetime);
+	}
+
+	candle_series async_storage::get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const
+	{
+		flush();
+
+		return m_storage->get_candles(instrument_id, granularity, start_datetime, end_datetime);
+	}
+
+	fixed_candle_series async_storage::get_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, time_t* start_datetime, time_t* end_datetime) const
+	{
+		flush();
+
+		return m_storage->get_fixed_candles(instrument_id, granularity, precision, start_datetime, end_datetime);
+	}
+
+	data_chunks async_storage::scan(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, size_t chunk_size) const
+	{
+		// SB: saves which are queued after the scan is started may be seen by its next chunks or not
+		flush();
+
+		return m_storage->scan(instrument_id, granularity, start_datetime, end_datetime, chunk_size);
+	}
+
+	bool async_storage::get_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, std::vector<time_range>* result) const
+	{
+		flush();
+
+		return m_storage->get_coverage(instrument_id, granularity, start_datetime, end_datetime, result);
+	}
+
+	void async_storage::save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<data_t::ptr>& data)
+	{
+		auto data_copy = copy_data(data);
+		enqueue({ [instrument_id, granularity, data_copy](data_storage& s) { s.save_data(instrument_id, granularity, data_copy); }, nullptr });
+	}
+
+	void async_storage::save_instant_data(const std::wstring& instrument_id, const std::vector<data_t::ptr>& data)
+	{
+		auto data_copy = copy_data(data);
+		enqueue({ [instrument_id, data_copy](data_storage& s) { s.save_instant_data(instrument_id, data_copy); }, nullptr });
+	}
+
+	void async_storage::save_candles(const std::wstring& instrument_id, unsigned long granularity, const candle_series& candles)
+	{
+		enqueue({ [instrument_id, granularity, candles](data_storage& s) { s.save_candles(instrument_id, granularity, candles); }, nullptr });
+	}
+
+	void async_storage::save_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, const fixed_candle_series& candles)
+	{
+		enqueue({ [instrument_id, granularity, precision, candles](data_storage& s) { s.save_fixed_candles(instrument_id, granularity, precision, candles); }, nullptr });
+	}
+
+	void async_storage::add_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime)
+	{
+		// SB: coverage is queued after the saves of its candles, so it's never committed before them
+		enqueue({ [instrument_id, granularity, start_datetime, end_datetime](data_storage& s) { s.add_coverage(instrument_id, granularity, start_datetime, end_datetime); }, nullptr });
+	}
+
+	async_storage::async_storage(const data_storage::ptr& storage, size_t max_batch_size)
+		: m_storage(storage)
+		, m_max_batch_size(std::max<size_t>(1, max_batch_size))
+		, m_queue_evt(false, false)
+		, m_stop(false)
+		, m_writer(std::bind(&async_storage::writer_thread, this))
+	{
+	}
+
+	async_storage::~async_storage()
+	{
+		{
+			win::scoped_lock lock(m_queue_cs);
+			m_stop = true;
+		}
+
+		m_queue_evt.set();
+		m_writer.join();
+	}
+}
\ No newline at end of file
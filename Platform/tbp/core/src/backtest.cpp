@@ -0,0 +1,425 @@
+#include <core/backtest.h>
+#include <logging/log.h>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace tbp
+{
+	namespace backtest
+	{
+		namespace
+		{
+			/////////////////////////////////////////////////////////////////////
+			// account
+			// SB: state shared by simulated connector and trader
+
+			class account
+			{
+				struct position
+				{
+					std::wstring id;
+					double amount;
+					double price;
+				};
+
+			private:
+				const parameters m_params;
+				result& m_result;
+				std::vector<position> m_positions;
+				double m_balance;
+				unsigned long m_last_id;
+				time_t m_timestamp;
+				double m_bid;
+				double m_ask;
+
+			private:
+				double close_price(double amount) const
+				{
+					return amount > 0.0 ? m_bid : m_ask;
+				}
+
+				void add_fill(const std::wstring& trade_id, double amount, double price, double profit)
+				{
+					fill f;
+					f.timestamp = m_timestamp;
+					f.trade_id = trade_id;
+					f.amount = amount;
+					f.price = price;
+					f.profit = profit;
+
+					m_result.fills.push_back(std::move(f));
+				}
+
+				// SB: amount_to_close has the same sign as position amount
+				void close(std::vector<position>::iterator it, double amount_to_close)
+				{
+					const auto price = close_price(it->amount);
+					const auto profit = amount_to_close * (price - it->price);
+
+					m_balance += profit;
+					m_result.realized_profit += profit;
+					add_fill(it->id, -amount_to_close, price, profit);
+
+					it->amount -= amount_to_close;
+					if (0.0 == it->amount)
+					{
+						m_positions.erase(it);
+					}
+				}
+
+			public:
+				void set_market(const time_t& timestamp, double bid, double ask)
+				{
+					m_timestamp = timestamp;
+					m_bid = bid;
+					m_ask = ask;
+				}
+
+				double margin_rate() const
+				{
+					return m_params.margin_rate;
+				}
+
+				double balance() const
+				{
+					return m_balance;
+				}
+
+				double equity() const
+				{
+					double result = m_balance;
+					for (const auto& p : m_positions)
+					{
+						result += p.amount * (close_price(p.amount) - p.price);
+					}
+
+					return result;
+				}
+
+				double available_balance() const
+				{
+					double used_margin = 0.0;
+					for (const auto& p : m_positions)
+					{
+						used_margin += std::abs(p.amount) * p.price * m_params.margin_rate;
+					}
+
+					return equity() - used_margin;
+				}
+
+				std::wstring open(double amount)
+				{
+					const auto price = amount > 0.0 ? m_ask : m_bid;
+					if (0.0 == amount || std::abs(amount) * price * m_params.margin_rate > available_balance())
+					{
+						++m_result.rejected_orders;
+
+						throw trader::trade_canceled("Order was canceled by backtest. Amount is zero or margin is insufficient!");
+					}
+
+					auto id = std::to_wstring(++m_last_id);
+					m_positions.push_back({ id, amount, price });
+					add_fill(id, amount, price, 0.0);
+
+					return id;
+				}
+
+				void close(const std::wstring& id, double amount)
+				{
+					auto it = std::find_if(m_positions.begin(), m_positions.end(), [&](const position& p) { return p.id == id; });
+					if (m_positions.end() == it)
+					{
+						LOG_ERR << L"Can't find opened backtest trade to close. Trade ID: " << id;
+
+						return;
+					}
+
+					// SB: 0.0 means close the whole trade, the same as for live trader
+					auto amount_to_close = std::min(std::abs(amount), std::abs(it->amount));
+					if (0.0 == amount)
+					{
+						amount_to_close = std::abs(it->amount);
+					}
+
+					close(it, it->amount > 0.0 ? amount_to_close : -amount_to_close);
+				}
+
+				void close_all()
+				{
+					while (!m_positions.empty())
+					{
+						close(m_positions.begin(), m_positions.front().amount);
+					}
+				}
+
+			public:
+				account(const parameters& params, result& r)
+					: m_params(params)
+					, m_result(r)
+					, m_balance(params.initial_balance)
+					, m_last_id(0)
+					, m_bid(0.0)
+					, m_ask(0.0)
+				{
+				}
+			};
+
+			/////////////////////////////////////////////////////////////////////
+			// simulated_provider
+			// SB: there is no history before the first replayed candle, strategy warms up on replayed candles
+
+			class simulated_provider : public data_provider
+			{
+			public:
+				virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override
+				{
+					return std::vector<data_t::ptr>();
+				}
+
+				virtual std::vector<data_t::ptr> get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const override
+				{
+					return std::vector<data_t::ptr>();
+				}
+
+				virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override
+				{
+					return candle_series();
+				}
+			};
+
+			/////////////////////////////////////////////////////////////////////
+			// simulated_connector
+
+			class simulated_connector : public connector
+			{
+				const std::wstring m_instrument;
+				const std::shared_ptr<account> m_account;
+
+			public:
+				virtual std::vector<std::wstring> get_instruments() const override
+				{
+					return{ m_instrument };
+				}
+
+				virtual double available_balance() const override
+				{
+					return m_account->available_balance();
+				}
+
+				virtual double margin_rate() const override
+				{
+					return m_account->margin_rate();
+				}
+
+				virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override
+				{
+					return std::vector<data_t::ptr>();
+				}
+
+				virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override
+				{
+					return candle_series();
+				}
+
+				virtual data_t::ptr get_instant_data(const std::wstring& instrument_id) override
+				{
+					throw std::runtime_error("Not implemented!");
+				}
+
+				virtual order::ptr create_order(const data_t& params) override
+				{
+					throw std::runtime_error("Not implemented!");
+				}
+
+				virtual order::ptr find_order(const std::wstring& id) const override
+				{
+					throw std::runtime_error("Not implemented!");
+				}
+
+				virtual trade::ptr find_trade(const std::wstring& id) const override
+				{
+					throw std::runtime_error("Not implemented!");
+				}
+
+			public:
+				simulated_connector(const std::wstring& instrument, const std::shared_ptr<account>& a)
+					: m_instrument(instrument)
+					, m_account(a)
+				{
+				}
+			};
+
+			/////////////////////////////////////////////////////////////////////
+			// simulated_trader
+
+			class simulated_trader : public trader
+			{
+				const std::wstring m_instrument;
+				const std::shared_ptr<account> m_account;
+
+			public:
+				virtual std::wstring open_trade(const std::wstring& instrument_id, double amount) override
+				{
+					if (instrument_id != m_instrument)
+					{
+						throw std::invalid_argument("Backtest trades only one instrument!");
+					}
+
+					return m_account->open(amount);
+				}
+
+				virtual void close_trade(const std::wstring& internal_id, double amount) override
+				{
+					m_account->close(internal_id, amount);
+				}
+
+				virtual void close_pending_trades() override
+				{
+					m_account->close_all();
+				}
+
+				virtual std::vector<candlestick_data> get_candles_from_data(const std::vector<data_t::ptr>& candles_data) const override
+				{
+					throw std::runtime_error("Not implemented!");
+				}
+
+			public:
+				simulated_trader(const std::wstring& instrument, const std::shared_ptr<account>& a)
+					: m_instrument(instrument)
+					, m_account(a)
+				{
+				}
+			};
+
+			/////////////////////////////////////////////////////////////////////
+			// runner
+
+			class runner
+			{
+				const parameters m_params;
+				result m_result;
+				const std::shared_ptr<account> m_account;
+				const std::shared_ptr<simulated_provider> m_provider;
+				const std::shared_ptr<simulated_trader> m_trader;
+				const strategy::ptr m_strategy;
+
+				// SB: single candle sent to strategy, it's reused to avoid allocations per candle
+				candle_series m_candle;
+				double m_peak_equity;
+
+			private:
+				void set_candle(const candle_series& candles, size_t index)
+				{
+					m_candle.timestamp[0] = candles.timestamp[index];
+					m_candle.volume[0] = candles.volume[index];
+					m_candle.bid.open[0] = candles.bid.open[index];
+					m_candle.bid.high[0] = candles.bid.high[index];
+					m_candle.bid.low[0] = candles.bid.low[index];
+					m_candle.bid.close[0] = candles.bid.close[index];
+					m_candle.ask.open[0] = candles.ask.open[index];
+					m_candle.ask.high[0] = candles.ask.high[index];
+					m_candle.ask.low[0] = candles.ask.low[index];
+					m_candle.ask.close[0] = candles.ask.close[index];
+					m_candle.complete[0] = candles.complete[index];
+				}
+
+			public:
+				void process(const candle_series& candles)
+				{
+					for (size_t i = 0; i < candles.size(); ++i)
+					{
+						m_account->set_market(candles.timestamp[i], candles.bid.close[i], candles.ask.close[i]);
+						set_candle(candles, i);
+
+						try
+						{
+							m_provider->on_historical_candles(m_params.instrument, m_candle);
+						}
+						catch (const trader::trade_canceled&)
+						{
+							// SB: rejected order is counted by account, backtest goes on the same way as live trading does
+						}
+
+						const auto equity = m_account->equity();
+						m_peak_equity = std::max(m_peak_equity, equity);
+						m_result.max_drawdown = std::max(m_result.max_drawdown, m_peak_equity - equity);
+
+						if (m_params.record_equity)
+						{
+							m_result.timestamp.push_back(candles.timestamp[i]);
+							m_result.equity.push_back(equity);
+						}
+					}
+
+					m_result.candles_count += candles.size();
+				}
+
+				result finish()
+				{
+					m_trader->close_pending_trades();
+					m_result.final_balance = m_account->balance();
+
+					return std::move(m_result);
+				}
+
+				void reserve(size_t count)
+				{
+					if (!m_params.record_equity)
+					{
+						return;
+					}
+
+					m_result.timestamp.reserve(count);
+					m_result.equity.reserve(count);
+				}
+
+			public:
+				runner(const parameters& params, const strategy_factory& create_strategy)
+					: m_params(params)
+					, m_account(std::make_shared<account>(params, m_result))
+					, m_provider(std::make_shared<simulated_provider>())
+					, m_trader(std::make_shared<simulated_trader>(params.instrument, m_account))
+					, m_strategy(create_strategy(m_provider, std::make_shared<simulated_connector>(params.instrument, m_account), m_trader))
+					, m_peak_equity(params.initial_balance)
+				{
+					candlestick_data empty_candle;
+					m_candle.push_back(empty_candle);
+				}
+			};
+		}
+
+		result run(const candle_series& candles, const parameters& params, const strategy_factory& create_strategy)
+		{
+			runner r(params, create_strategy);
+			r.reserve(candles.size());
+			r.process(candles);
+
+			return r.finish();
+		}
+
+		result run(const data_provider::ptr& source, time_t start_datetime, time_t end_datetime, const parameters& params, const strategy_factory& create_strategy)
+		{
+			if (0 == params.chunk_size || 0 == params.granularity)
+			{
+				throw std::invalid_argument("Backtest chunk size and granularity should be positive!");
+			}
+
+			runner r(params, create_strategy);
+
+			// SB: data provider returns candles including both range ends
+			const auto chunk_duration = std::chrono::duration_cast<time_t::duration>(std::chrono::seconds(boost::numeric_cast<__int64>(params.granularity * params.chunk_size)));
+			for (auto chunk_start = start_datetime; chunk_start <= end_datetime; chunk_start += chunk_duration)
+			{
+				auto first = chunk_start;
+				auto last = std::min(chunk_start + chunk_duration - time_t::duration(1), end_datetime);
+
+				r.process(source->get_candles(params.instrument, params.granularity, &first, &last));
+			}
+
+			return r.finish();
+		}
+	}
+}
\ No newline at end of file
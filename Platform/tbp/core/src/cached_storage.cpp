@@ -0,0 +1,345 @@
+#include <core/cached_storage.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tbp
+{
+	namespace
+	{
+		// SB: shared_ptr control block and allocator overhead per record
+		const size_t c_record_overhead = 32;
+
+		time_t::duration get_block_span(unsigned long granularity)
+		{
+			return std::chrono::duration_cast<time_t::duration>(std::chrono::seconds(granularity)) * static_cast<__int64>(cached_storage::block_candles);
+		}
+
+		// SB: floor division, blocks before the epoch have negative index
+		__int64 block_index(time_t timestamp, time_t::duration block_span)
+		{
+			const auto count = timestamp.time_since_epoch().count();
+			const auto span = block_span.count();
+
+			return count >= 0 ? count / span : -((-count + span - 1) / span);
+		}
+
+		size_t estimate_size(const data_t& record)
+		{
+			size_t result = sizeof(data_t) + record.size() * sizeof(data_t::value_type);
+			for (const auto& field : record)
+			{
+				if (auto nested = boost::get<data_t>(&field.second))
+				{
+					result += estimate_size(*nested);
+				}
+				else if (auto str = boost::get<std::wstring>(&field.second))
+				{
+					result += str->capacity() * sizeof(wchar_t);
+				}
+				else if (auto bin = boost::get<binary_t>(&field.second))
+				{
+					result += bin->capacity();
+				}
+			}
+
+			return result;
+		}
+
+		size_t estimate_size(const candle_series& candles)
+		{
+			return candles.size() * (sizeof(time_t) + sizeof(__int64) + 8 * sizeof(double) + sizeof(byte_t));
+		}
+
+		void append_range(const candle_series& candles, time_t start_datetime, time_t end_datetime, candle_series* result)
+		{
+			const auto first = std::lower_bound(candles.timestamp.begin(), candles.timestamp.end(), start_datetime);
+			const auto last = std::upper_bound(first, candles.timestamp.end(), end_datetime);
+			result->append(candles, first - candles.timestamp.begin(), last - first);
+		}
+
+		// SB: range of the result is reported the same way as storages do
+		void set_result_range(time_t first, time_t last, size_t count, time_t* start_datetime, time_t* end_datetime)
+		{
+			if (count <= 1)
+			{
+				*end_datetime = *start_datetime;
+
+				return;
+			}
+
+			*start_datetime = first;
+			*end_datetime = last;
+		}
+	}
+
+	const size_t cached_storage::block_candles;
+
+	time_t cached_storage::get_timestamp(const data_t& record) const
+	{
+		auto it = record.find(m_timestamp_field);
+		if (record.end() == it)
+		{
+			throw std::runtime_error("Timestamp value isn't provided by instrument data!");
+		}
+
+		return boost::get<time_t>(it->second);
+	}
+
+	std::shared_ptr<cached_storage::block> cached_storage::load_block(block_kind kind, const std::wstring& instrument_id, unsigned long granularity, __int64 index) const
+	{
+		const auto block_span = get_block_span(granularity);
+		time_t start(block_span * index);
+		time_t end = start + block_span - time_t::duration(1);
+
+		auto result = std::make_shared<block>();
+		if (block_kind::data == kind)
+		{
+			result->data = m_storage->get_data(instrument_id, granularity, &start, &end);
+			for (const auto& record : result->data)
+			{
+				result->size += estimate_size(*record) + c_record_overhead;
+			}
+		}
+		else
+		{
+			result->candles = m_storage->get_candles(instrument_id, granularity, &start, &end);
+			result->size = estimate_size(result->candles);
+		}
+
+		result->size += sizeof(block) + instrument_id.capacity() * sizeof(wchar_t);
+
+		return result;
+	}
+
+	std::shared_ptr<const cached_storage::block> cached_storage::get_block(block_kind kind, const std::wstring& instrument_id, unsigned long granularity, __int64 index) const
+	{
+		const auto key = std::make_tuple(kind, instrument_id, granularity, index);
+
+		unsigned __int64 generation = 0;
+		{
+			win::scoped_lock lock(m_cache_cs);
+
+			auto it = m_blocks.find(key);
+			if (m_blocks.end() != it)
+			{
+				++m_stats.hits;
+				m_lru.splice(m_lru.begin(), m_lru, it->second);
+
+				return it->second->second;
+			}
+
+			++m_stats.misses;
+			generation = m_generation;
+		}
+
+		// SB: storage is read without lock, so the same block can be loaded by several readers at once
+		const std::shared_ptr<const block> result = load_block(kind, instrument_id, granularity, index);
+
+		win::scoped_lock lock(m_cache_cs);
+
+		if (generation != m_generation || result->size > m_stats.capacity || m_blocks.end() != m_blocks.find(key))
+		{
+			return result;
+		}
+
+		m_lru.emplace_front(key, result);
+		m_blocks.emplace(key, m_lru.begin());
+		m_stats.size += result->size;
+
+		while (m_stats.size > m_stats.capacity)
+		{
+			m_stats.size -= m_lru.back().second->size;
+			m_blocks.erase(m_lru.back().first);
+			m_lru.pop_back();
+			++m_stats.evictions;
+		}
+
+		return result;
+	}
+
+	void cached_storage::invalidate(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime)
+	{
+		const auto block_span = get_block_span(granularity);
+		const auto first = block_index(start_datetime, block_span);
+		const auto last = block_index(end_datetime, block_span);
+
+		win::scoped_lock lock(m_cache_cs);
+
+		++m_generation;
+		for (const auto kind : { block_kind::data, block_kind::candles })
+		{
+			auto it = m_blocks.lower_bound(std::make_tuple(kind, instrument_id, granularity, first));
+			while (m_blocks.end() != it && it->first <= std::make_tuple(kind, instrument_id, granularity, last))
+			{
+				m_stats.size -= it->second->second->size;
+				m_lru.erase(it->second);
+				it = m_blocks.erase(it);
+			}
+		}
+	}
+
+	data_cache_stats cached_storage::stats() const
+	{
+		win::scoped_lock lock(m_cache_cs);
+
+		return m_stats;
+	}
+
+	std::vector<data_t::ptr> cached_storage::get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const
+	{
+		if (nullptr == start_datetime || nullptr == end_datetime)
+		{
+			throw std::invalid_argument("start_datetime or end_datetime argument is null!");
+		}
+
+		const auto block_span = get_block_span(granularity);
+		const auto first = block_index(*start_datetime, block_span);
+		const auto last = block_index(*end_datetime, block_span);
+
+		std::vector<data_t::ptr> result;
+		for (auto index = first; index <= last && *start_datetime <= *end_datetime; ++index)
+		{
+			const auto b = get_block(block_kind::data, instrument_id, granularity, index);
+			for (const auto& record : b->data)
+			{
+				const auto timestamp = get_timestamp(*record);
+				if (timestamp >= *start_datetime && timestamp <= *end_datetime)
+				{
+					result.push_back(record);
+				}
+			}
+		}
+
+		if (!result.empty())
+		{
+			set_result_range(get_timestamp(*result.front()), get_timestamp(*result.back()), result.size(), start_datetime, end_datetime);
+		}
+		else
+		{
+			*end_datetime = *start_datetime;
+		}
+
+		return result;
+	}
+
+	candle_series cached_storage::get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const
+	{
+		if (nullptr == start_datetime || nullptr == end_datetime)
+		{
+			throw std::invalid_argument("start_datetime or end_datetime argument is null!");
+		}
+
+		const auto block_span = get_block_span(granularity);
+		const auto first = block_index(*start_datetime, block_span);
+		const auto last = block_index(*end_datetime, block_span);
+
+		candle_series result;
+		for (auto index = first; index <= last && *start_datetime <= *end_datetime; ++index)
+		{
+			const auto b = get_block(block_kind::candles, instrument_id, granularity, index);
+			append_range(b->candles, *start_datetime, *end_datetime, &result);
+		}
+
+		if (!result.empty())
+		{
+			set_result_range(result.timestamp.front(), result.timestamp.back(), result.size(), start_datetime, end_datetime);
+		}
+		else
+		{
+			*end_datetime = *start_datetime;
+		}
+
+		return result;
+	}
+
+	std::vector<data_t::ptr> cached_storage::get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const
+	{
+		return m_storage->get_instant_data(instrument_id, start_datetime, end_datetime);
+	}
+
+	data_chunks cached_storage::scan(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, size_t chunk_size) const
+	{
+		// SB: scans are long sequential reads, they would evict the whole cache
+		return m_storage->scan(instrument_id, granularity, start_datetime, end_datetime, chunk_size);
+	}
+
+	bool cached_storage::get_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, std::vector<time_range>* result) const
+	{
+		return m_storage->get_coverage(instrument_id, granularity, start_datetime, end_datetime, result);
+	}
+
+	void cached_storage::save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<data_t::ptr>& data)
+	{
+		m_storage->save_data(instrument_id, granularity, data);
+
+		if (data.empty())
+		{
+			return;
+		}
+
+		auto start = get_timestamp(*data.front());
+		auto end = start;
+		for (const auto& record : data)
+		{
+			const auto timestamp = get_timestamp(*record);
+			start = std::min(start, timestamp);
+			end = std::max(end, timestamp);
+		}
+
+		invalidate(instrument_id, granularity, start, end);
+	}
+
+	void cached_storage::save_instant_data(const std::wstring& instrument_id, const std::vector<data_t::ptr>& data)
+	{
+		m_storage->save_instant_data(instrument_id, data);
+	}
+
+	void cached_storage::save_candles(const std::wstring& instrument_id, unsigned long granularity, const candle_series& candles)
+	{
+		m_storage->save_candles(instrument_id, granularity, candles);
+
+		if (!candles.empty())
+		{
+			const auto range = std::minmax_element(candles.timestamp.begin(), candles.timestamp.end());
+			invalidate(instrument_id, granularity, *range.first, *range.second);
+		}
+	}
+
+	void cached_storage::save_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, const fixed_candle_series& candles)
+	{
+		m_storage->save_fixed_candles(instrument_id, granularity, precision, candles);
+
+		if (!candles.empty())
+		{
+			const auto range = std::minmax_element(candles.timestamp.begin(), candles.timestamp.end());
+			invalidate(instrument_id, granularity, *range.first, *range.second);
+		}
+	}
+
+	void cached_storage::save_batch(const std::function<void()>& save)
+	{
+		m_storage->save_batch(save);
+
+		// SB: saves of the batch are invalidated before the batch is committed, so blocks read meanwhile could keep old data
+		win::scoped_lock lock(m_cache_cs);
+
+		++m_generation;
+		m_blocks.clear();
+		m_lru.clear();
+		m_stats.size = 0;
+	}
+
+	void cached_storage::add_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime)
+	{
+		m_storage->add_coverage(instrument_id, granularity, start_datetime, end_datetime);
+	}
+
+	cached_storage::cached_storage(const data_storage::ptr& storage, const field_id& timestamp_field, size_t capacity)
+		: m_storage(storage)
+		, m_timestamp_field(timestamp_field)
+		, m_generation(0)
+	{
+		m_stats.capacity = capacity;
+	}
+}
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include <core/data_collector.h>
 #include <core/utilities.h>
+#include <core/resampler.h>
 
 #include <logging/log.h>
 
 #include <boost/numeric/conversion/cast.hpp>
 
+#include <algorithm>
 #include <future>
 #include <sstream>
 
@@ -12,6 +14,12 @@ namespace tbp
 {
 	namespace
 	{
+		// SB: granularities which are tried as resampling source, the coarsest one goes first since it requires less candles to read
+		const unsigned long c_resample_source_granularities[] = { 60 /*M1*/, 5 /*S5*/ };
+
+		// SB: max amount of missing ranges which are downloaded at once
+		const size_t c_max_concurrent_downloads = 4;
+
 		// SB: this code is taken from oanda connector implementation for testing purposes
 		std::wstring to_str(time_t time)
 		{
@@ -124,11 +132,18 @@ namespace tbp
 				auto curr_time = tbp::time_t::clock::now();
 				curr_time = tbp::time_t(align_to_granularity<tbp::time_t::duration>(curr_time, granularity_secs));
 				auto start_time = curr_time - granularity_secs;
-				auto data = m_connector->get_data(m_instrument_id, m_historcial_data_granularity, &start_time, nullptr);
-				if (!data.empty())
+				auto candles = m_connector->get_candles(m_instrument_id, m_historcial_data_granularity, &start_time, nullptr);
+				if (!candles.empty())
 				{
-					m_data_storage->save_data(m_instrument_id, m_historcial_data_granularity, data);
-					on_historical_data(m_instrument_id, data);
+					m_data_storage->save_candles(m_instrument_id, m_historcial_data_granularity, candles);
+
+					// SB: polled candles are contiguous, so coverage of consecutive polls is merged to one range
+					if (start_time == candles.timestamp.front() && 0 != candles.complete.front())
+					{
+						m_data_storage->add_coverage(m_instrument_id, m_historcial_data_granularity, start_time, curr_time - time_t::duration(1));
+					}
+
+					on_historical_candles(m_instrument_id, candles);
 				}
 				else
 				{
@@ -172,6 +187,127 @@ namespace tbp
 		m_cache.clear();
 	}
 
+	bool data_collector::resample_stored_candles(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, bool covered_source_only, candle_series* result) const
+	{
+		for (const auto source_granularity : c_resample_source_granularities)
+		{
+			if (!resampler::can_resample(source_granularity, granularity))
+			{
+				continue;
+			}
+
+			// SB: the last target candle ends one source candle before the start of the next target candle
+			auto source_start = start_datetime;
+			auto source_end = end_datetime + std::chrono::seconds(granularity - source_granularity);
+
+			// SB: stored candles may have gaps inside of the range (f.e. collection was stopped for a while),
+			// such gap gives complete but wrong target candle, so range is marked as covered only if source candles are covered
+			std::vector<time_range> source_missing_ranges;
+			if (covered_source_only && (!find_missing_ranges(instrument_id, source_granularity, source_start, source_end, &source_missing_ranges) || !source_missing_ranges.empty()))
+			{
+				continue;
+			}
+
+			const auto candles = m_data_storage->get_candles(instrument_id, source_granularity, &source_start, &source_end);
+
+			// SB: stored candles which start inside of the first target period (f.e. collection was started in the middle of the hour)
+			// would give the first target candle with wrong open, high / low and volume, resampler can't see that
+			if (candles.empty() || candles.timestamp.front() != start_datetime)
+			{
+				continue;
+			}
+
+			auto resampled = resampler::resample(candles, source_granularity, granularity);
+
+			// SB: the same check as for data in storage: both range ends should be present, partial candles are not stored
+			const bool all_complete = std::all_of(resampled.complete.begin(), resampled.complete.end(), [](byte_t complete) { return 0 != complete; });
+			if (!all_complete || resampled.timestamp.front() != start_datetime || resampled.timestamp.back() != end_datetime)
+			{
+				continue;
+			}
+
+			LOG_DBG << L"Candles have been resampled from stored data. Granularity: " << source_granularity << L" -> " << granularity << L". Count: " << resampled.size();
+
+			m_data_storage->save_candles(instrument_id, granularity, resampled);
+			*result = std::move(resampled);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool data_collector::find_missing_ranges(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, std::vector<time_range>* result) const
+	{
+		std::vector<time_range> covered;
+		if (!m_data_storage->get_coverage(instrument_id, granularity, start_datetime, end_datetime, &covered))
+		{
+			return false;
+		}
+
+		*result = find_gaps(covered, start_datetime, end_datetime);
+
+		return true;
+	}
+
+	void data_collector::fill_missing_ranges(const std::wstring& instrument_id, unsigned long granularity, const std::vector<time_range>& ranges) const
+	{
+		std::vector<time_range> download_ranges;
+		for (const auto& range : ranges)
+		{
+			candle_series resampled;
+			if (resample_stored_candles(instrument_id, granularity, range.start, range.end, true, &resampled))
+			{
+				add_coverage(instrument_id, granularity, range);
+			}
+			else
+			{
+				download_ranges.push_back(range);
+			}
+		}
+
+		for (size_t first = 0; first < download_ranges.size(); first += c_max_concurrent_downloads)
+		{
+			const auto last = std::min(first + c_max_concurrent_downloads, download_ranges.size());
+
+			std::vector<std::future<candle_series>> downloads;
+			for (size_t i = first; i < last; ++i)
+			{
+				downloads.emplace_back(std::async(std::launch::async, [this, &instrument_id, granularity](time_range range)
+				{
+					return m_connector->get_candles(instrument_id, granularity, &range.start, &range.end);
+				}, download_ranges[i]));
+			}
+
+			// SB: storage is written by this thread only, range is marked as covered after its candles are saved
+			for (size_t i = first; i < last; ++i)
+			{
+				const auto candles = downloads[i - first].get();
+				if (!candles.empty())
+				{
+					m_data_storage->save_candles(instrument_id, granularity, candles);
+				}
+
+				add_coverage(instrument_id, granularity, download_ranges[i]);
+			}
+		}
+
+		if (!download_ranges.empty())
+		{
+			LOG_DBG << L"Missing ranges have been downloaded. Granularity: " << granularity << L". Count: " << download_ranges.size();
+		}
+	}
+
+	void data_collector::add_coverage(const std::wstring& instrument_id, unsigned long granularity, const time_range& range) const
+	{
+		// SB: candles which haven't been completed yet are requested again next time
+		const auto complete_end = std::min(range.end, time_t(time_t::clock::now() - std::chrono::seconds(granularity)));
+		if (complete_end >= range.start)
+		{
+			m_data_storage->add_coverage(instrument_id, granularity, range.start, complete_end);
+		}
+	}
+
 	std::vector<data_t::ptr> data_collector::get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const
 	{
 		if (nullptr == start_datetime || nullptr == end_datetime)
@@ -179,12 +315,33 @@ namespace tbp
 			throw std::invalid_argument("start_datetime or end_datetime argument is null!");
 		}
 
+		std::vector<time_range> missing_ranges;
+		if (find_missing_ranges(instrument_id, granularity, *start_datetime, *end_datetime, &missing_ranges))
+		{
+			fill_missing_ranges(instrument_id, granularity, missing_ranges);
+
+			auto actual_start = *start_datetime;
+			auto actual_end = *end_datetime;
+
+			return m_data_storage->get_data(instrument_id, granularity, &actual_start, &actual_end);
+		}
+
 		auto actual_start = *start_datetime;
 		auto actual_end = *end_datetime;
 		auto result = m_data_storage->get_data(instrument_id, granularity, &actual_start, &actual_end);
 
 		if (actual_start != *start_datetime || actual_end != *end_datetime)
 		{
+			candle_series resampled;
+			if (resample_stored_candles(instrument_id, granularity, *start_datetime, *end_datetime, false, &resampled))
+			{
+				// SB: resampled candles are saved to storage, so they are read back in storage format
+				actual_start = *start_datetime;
+				actual_end = *end_datetime;
+
+				return m_data_storage->get_data(instrument_id, granularity, &actual_start, &actual_end);
+			}
+
 			// SB: should we make connector call from worker thread? Is it some reason for this? Anyway we will wait untill data arrives...
 			result = m_connector->get_data(instrument_id, granularity, start_datetime, end_datetime);
 			m_data_storage->save_data(instrument_id, granularity, result);
@@ -193,6 +350,42 @@ namespace tbp
 		return result;
 	}
 
+	candle_series data_collector::get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const
+	{
+		if (nullptr == start_datetime || nullptr == end_datetime)
+		{
+			throw std::invalid_argument("start_datetime or end_datetime argument is null!");
+		}
+
+		std::vector<time_range> missing_ranges;
+		if (find_missing_ranges(instrument_id, granularity, *start_datetime, *end_datetime, &missing_ranges))
+		{
+			fill_missing_ranges(instrument_id, granularity, missing_ranges);
+
+			auto actual_start = *start_datetime;
+			auto actual_end = *end_datetime;
+
+			return m_data_storage->get_candles(instrument_id, granularity, &actual_start, &actual_end);
+		}
+
+		auto actual_start = *start_datetime;
+		auto actual_end = *end_datetime;
+		auto result = m_data_storage->get_candles(instrument_id, granularity, &actual_start, &actual_end);
+
+		if (actual_start != *start_datetime || actual_end != *end_datetime)
+		{
+			if (resample_stored_candles(instrument_id, granularity, *start_datetime, *end_datetime, false, &result))
+			{
+				return result;
+			}
+
+			result = m_connector->get_candles(instrument_id, granularity, start_datetime, end_datetime);
+			m_data_storage->save_candles(instrument_id, granularity, result);
+		}
+
+		return result;
+	}
+
 	std::vector<data_t::ptr> data_collector::get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const
 	{
 		if (nullptr == start_datetime || nullptr == end_datetime)
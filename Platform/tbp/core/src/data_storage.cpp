@@ -0,0 +1,109 @@
+#include <core/data_storage.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace tbp
+{
+	namespace
+	{
+		/////////////////////////////////////////////////////////////////////
+		// window_cursor
+		// SB: provider doesn't tell where its records are, so cursor reads consecutive time windows which are shorter than 'chunk_size' candles.
+		// Records are not closer than granularity, so window can't contain more than 'chunk_size' of them. Windows without records are skipped
+
+		class window_cursor : public data_cursor
+		{
+			const data_provider& m_provider;
+			const std::wstring m_instrument_id;
+			const unsigned long m_granularity;
+			const time_t::duration m_window;
+			const time_t m_end_datetime;
+			time_t m_window_start;
+
+		public:
+			virtual std::vector<data_t::ptr> next() override
+			{
+				while (m_window_start <= m_end_datetime)
+				{
+					const auto window_end = std::min(m_window_start + m_window - time_t::duration(1), m_end_datetime);
+					auto start = m_window_start;
+					auto end = window_end;
+					m_window_start = window_end + time_t::duration(1);
+
+					auto chunk = m_provider.get_data(m_instrument_id, m_granularity, &start, &end);
+					if (!chunk.empty())
+					{
+						return chunk;
+					}
+				}
+
+				return std::vector<data_t::ptr>();
+			}
+
+		public:
+			window_cursor(const data_provider& provider, const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, size_t chunk_size)
+				: m_provider(provider)
+				, m_instrument_id(instrument_id)
+				, m_granularity(granularity)
+				, m_window(std::chrono::duration_cast<time_t::duration>(std::chrono::seconds(granularity) * static_cast<__int64>(chunk_size)))
+				, m_end_datetime(end_datetime)
+				, m_window_start(start_datetime)
+			{
+			}
+		};
+	}
+
+	std::vector<time_range> find_gaps(const std::vector<time_range>& covered, time_t start_datetime, time_t end_datetime)
+	{
+		std::vector<time_range> result;
+
+		// SB: timestamps are discrete, so range which ends right before the next one starts is contiguous with it
+		const time_t::duration tick(1);
+		auto gap_start = start_datetime;
+		for (const auto& range : covered)
+		{
+			if (gap_start > end_datetime)
+			{
+				break;
+			}
+
+			if (range.end < gap_start)
+			{
+				continue;
+			}
+
+			if (range.start > gap_start)
+			{
+				result.push_back({ gap_start, std::min(range.start - tick, end_datetime) });
+			}
+
+			if (range.end >= end_datetime)
+			{
+				return result;
+			}
+
+			gap_start = std::max(gap_start, range.end + tick);
+		}
+
+		if (gap_start <= end_datetime)
+		{
+			result.push_back({ gap_start, end_datetime });
+		}
+
+		return result;
+	}
+
+	const size_t data_provider::default_scan_chunk_size;
+
+	data_chunks data_provider::scan(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, size_t chunk_size) const
+	{
+		if (0 == granularity || 0 == chunk_size)
+		{
+			throw std::invalid_argument("granularity or chunk_size argument is zero!");
+		}
+
+		return data_chunks(std::make_shared<window_cursor>(*this, instrument_id, granularity, start_datetime, end_datetime, chunk_size));
+	}
+}
\ No newline at end of file
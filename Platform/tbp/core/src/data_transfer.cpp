@@ -0,0 +1,422 @@
+#include <core/data_transfer.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace tbp
+{
+	namespace
+	{
+		const char c_binary_signature[4] = { 'T', 'B', 'P', 'C' };
+		const unsigned int c_binary_version = 1;
+
+		// SB: timestamp, volume, 8 prices and complete flag
+		const size_t c_binary_candle_size = sizeof(__int64) * 2 + sizeof(double) * 8 + sizeof(byte_t);
+
+		const char* const c_csv_header = "timestamp,volume,bid_open,bid_high,bid_low,bid_close,ask_open,ask_high,ask_low,ask_close,complete\n";
+
+		/////////////////////////////////////////////////////////////////////
+		// reading
+
+		// SB: reads lines of at most 'chunk_size' candles, empty string means the end of input
+		std::string read_csv_chunk(std::istream& input, size_t chunk_size)
+		{
+			std::string result;
+			std::string line;
+			for (size_t i = 0; i < chunk_size && std::getline(input, line); ++i)
+			{
+				result.append(line).push_back('\n');
+			}
+
+			return result;
+		}
+
+		// SB: reads one block, empty string means the end of input
+		std::string read_binary_chunk(std::istream& input)
+		{
+			unsigned int count = 0;
+			if (!input.read(reinterpret_cast<char*>(&count), sizeof(count)))
+			{
+				if (0 != input.gcount())
+				{
+					throw std::runtime_error("Binary candles block is truncated!");
+				}
+
+				return std::string();
+			}
+
+			std::string result(sizeof(count) + count * c_binary_candle_size, '\0');
+			std::memcpy(&result[0], &count, sizeof(count));
+			if (!input.read(&result[sizeof(count)], result.size() - sizeof(count)))
+			{
+				throw std::runtime_error("Binary candles block is truncated!");
+			}
+
+			return result;
+		}
+
+		void read_binary_header(std::istream& input)
+		{
+			char signature[sizeof(c_binary_signature)] = {};
+			unsigned int version = 0;
+			if (!input.read(signature, sizeof(signature)) || 0 != std::memcmp(signature, c_binary_signature, sizeof(signature)))
+			{
+				throw std::runtime_error("Input isn't binary candles data!");
+			}
+
+			if (!input.read(reinterpret_cast<char*>(&version), sizeof(version)) || c_binary_version != version)
+			{
+				throw std::runtime_error("Unsupported version of binary candles data!");
+			}
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// parsing
+
+		void parse_csv_line(const char* line, candle_series* result)
+		{
+			const char* pos = line;
+			char* end = nullptr;
+
+			// SB: each field except the first one should follow comma, field is invalid if nothing is parsed
+			auto next_field = [&]()
+			{
+				if (',' != *end)
+				{
+					return false;
+				}
+
+				pos = end + 1;
+				return true;
+			};
+
+			const auto timestamp = std::strtoll(pos, &end, 10);
+			bool valid = end != pos && next_field();
+
+			const auto volume = valid ? std::strtoll(pos, &end, 10) : 0;
+			valid = valid && end != pos;
+
+			double prices[8] = {};
+			for (auto& price : prices)
+			{
+				valid = valid && next_field();
+				price = valid ? std::strtod(pos, &end) : 0.0;
+				valid = valid && end != pos;
+			}
+
+			// SB: candles without complete flag are historical ones
+			bool complete = true;
+			if (valid && next_field())
+			{
+				complete = 0 != std::strtol(pos, &end, 10);
+				valid = end != pos;
+			}
+
+			if (!valid || ('\n' != *end && '\r' != *end && '\0' != *end))
+			{
+				throw std::runtime_error("Invalid candle line: " + std::string(line, std::strcspn(line, "\n")));
+			}
+
+			result->timestamp.push_back(time_t(std::chrono::seconds(timestamp)));
+			result->volume.push_back(volume);
+			result->bid.open.push_back(prices[0]);
+			result->bid.high.push_back(prices[1]);
+			result->bid.low.push_back(prices[2]);
+			result->bid.close.push_back(prices[3]);
+			result->ask.open.push_back(prices[4]);
+			result->ask.high.push_back(prices[5]);
+			result->ask.low.push_back(prices[6]);
+			result->ask.close.push_back(prices[7]);
+			result->complete.push_back(complete ? 1 : 0);
+		}
+
+		candle_series parse_csv_chunk(const std::string& chunk)
+		{
+			candle_series result;
+			result.reserve(static_cast<size_t>(std::count(chunk.begin(), chunk.end(), '\n')));
+
+			for (size_t pos = 0; pos < chunk.size(); pos = chunk.find('\n', pos) + 1)
+			{
+				// SB: header and empty lines
+				const auto first = chunk[pos];
+				if ('-' != first && (first < '0' || first > '9'))
+				{
+					continue;
+				}
+
+				parse_csv_line(chunk.c_str() + pos, &result);
+			}
+
+			return result;
+		}
+
+		template <typename T>
+		void read_column(const char** data, size_t count, std::vector<T>* result)
+		{
+			result->resize(count);
+			std::memcpy(result->data(), *data, count * sizeof(T));
+			*data += count * sizeof(T);
+		}
+
+		candle_series parse_binary_chunk(const std::string& chunk)
+		{
+			unsigned int count = 0;
+			std::memcpy(&count, chunk.data(), sizeof(count));
+
+			std::vector<__int64> timestamp;
+			candle_series result;
+			const char* data = chunk.data() + sizeof(count);
+			read_column(&data, count, &timestamp);
+			read_column(&data, count, &result.volume);
+			read_column(&data, count, &result.bid.open);
+			read_column(&data, count, &result.bid.high);
+			read_column(&data, count, &result.bid.low);
+			read_column(&data, count, &result.bid.close);
+			read_column(&data, count, &result.ask.open);
+			read_column(&data, count, &result.ask.high);
+			read_column(&data, count, &result.ask.low);
+			read_column(&data, count, &result.ask.close);
+			read_column(&data, count, &result.complete);
+
+			result.timestamp.reserve(count);
+			for (const auto t : timestamp)
+			{
+				result.timestamp.push_back(time_t(time_t::duration(t)));
+			}
+
+			return result;
+		}
+
+		// SB: storage inserts sorted rows into the end of primary key index instead of random pages
+		void sort_candles(candle_series* candles)
+		{
+			if (std::is_sorted(candles->timestamp.begin(), candles->timestamp.end()))
+			{
+				return;
+			}
+
+			std::vector<size_t> order(candles->size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [candles](size_t lhs, size_t rhs) { return candles->timestamp[lhs] < candles->timestamp[rhs]; });
+
+			candle_series result;
+			result.reserve(order.size());
+			for (const auto i : order)
+			{
+				result.append(*candles, i, 1);
+			}
+
+			*candles = std::move(result);
+		}
+
+		candle_series parse_chunk(const std::string& chunk, transfer_format format)
+		{
+			auto result = transfer_format::csv == format ? parse_csv_chunk(chunk) : parse_binary_chunk(chunk);
+			sort_candles(&result);
+
+			return result;
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// writing
+
+		// SB: the shortest of two representations which reads back to the same value
+		void append_price(double price, std::string* result)
+		{
+			char buffer[32];
+			std::snprintf(buffer, sizeof(buffer), "%.15g", price);
+			if (std::strtod(buffer, nullptr) != price)
+			{
+				std::snprintf(buffer, sizeof(buffer), "%.17g", price);
+			}
+
+			result->append(buffer);
+		}
+
+		void append_prices(const candle_series::prices& prices, size_t index, std::string* result)
+		{
+			for (const auto column : { &prices.open, &prices.high, &prices.low, &prices.close })
+			{
+				result->push_back(',');
+				append_price((*column)[index], result);
+			}
+		}
+
+		void write_csv_chunk(const candle_series& candles, std::ostream& output)
+		{
+			std::string chunk;
+			chunk.reserve(candles.size() * 128);
+
+			for (size_t i = 0; i < candles.size(); ++i)
+			{
+				char buffer[64];
+				std::snprintf(buffer, sizeof(buffer), "%lld,%lld", static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(candles.timestamp[i].time_since_epoch()).count()),
+					static_cast<long long>(candles.volume[i]));
+
+				chunk.append(buffer);
+				append_prices(candles.bid, i, &chunk);
+				append_prices(candles.ask, i, &chunk);
+				chunk.append(0 != candles.complete[i] ? ",1\n" : ",0\n");
+			}
+
+			output.write(chunk.data(), chunk.size());
+		}
+
+		template <typename T>
+		void write_column(const std::vector<T>& column, std::ostream& output)
+		{
+			output.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+		}
+
+		void write_binary_chunk(const candle_series& candles, std::ostream& output)
+		{
+			const auto count = static_cast<unsigned int>(candles.size());
+			output.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+			std::vector<__int64> timestamp;
+			timestamp.reserve(candles.size());
+			for (const auto& t : candles.timestamp)
+			{
+				timestamp.push_back(t.time_since_epoch().count());
+			}
+
+			write_column(timestamp, output);
+			write_column(candles.volume, output);
+			write_column(candles.bid.open, output);
+			write_column(candles.bid.high, output);
+			write_column(candles.bid.low, output);
+			write_column(candles.bid.close, output);
+			write_column(candles.ask.open, output);
+			write_column(candles.ask.high, output);
+			write_column(candles.ask.low, output);
+			write_column(candles.ask.close, output);
+			write_column(candles.complete, output);
+		}
+	}
+
+	size_t import_candles(std::istream& input, transfer_format format, data_storage& storage, const std::wstring& instrument_id, unsigned long granularity, size_t chunk_size)
+	{
+		if (0 == granularity || 0 == chunk_size)
+		{
+			throw std::invalid_argument("granularity or chunk_size argument is zero!");
+		}
+
+		if (transfer_format::binary == format)
+		{
+			read_binary_header(input);
+		}
+
+		// SB: reading and saving are sequential, so parsing is the only stage which is worth to parallelize
+		const size_t max_parsed_chunks = std::max(1u, std::thread::hardware_concurrency());
+
+		size_t result = 0;
+		std::deque<std::future<candle_series>> parsed_chunks;
+		auto save_chunk = [&]()
+		{
+			const auto candles = parsed_chunks.front().get();
+			parsed_chunks.pop_front();
+
+			// SB: chunk is the whole history of its range, so the range is marked as covered by the same batch.
+			// Incomplete candles at the end of the chunk are requested again the same way as by data collector
+			const auto last_complete = std::find_if(candles.complete.rbegin(), candles.complete.rend(), [](byte_t complete) { return 0 != complete; });
+			storage.save_batch([&]()
+			{
+				storage.save_candles(instrument_id, granularity, candles);
+
+				if (candles.complete.rend() != last_complete)
+				{
+					const auto covered_end = candles.timestamp.at(candles.complete.rend() - last_complete - 1);
+					storage.add_coverage(instrument_id, granularity, candles.timestamp.front(), covered_end);
+				}
+			});
+
+			result += candles.size();
+		};
+
+		for (;;)
+		{
+			auto chunk = transfer_format::csv == format ? read_csv_chunk(input, chunk_size) : read_binary_chunk(input);
+			if (chunk.empty())
+			{
+				break;
+			}
+
+			parsed_chunks.emplace_back(std::async(std::launch::async, [format](const std::string& chunk) { return parse_chunk(chunk, format); }, std::move(chunk)));
+			if (parsed_chunks.size() > max_parsed_chunks)
+			{
+				save_chunk();
+			}
+		}
+
+		while (!parsed_chunks.empty())
+		{
+			save_chunk();
+		}
+
+		return result;
+	}
+
+	size_t export_candles(const data_provider& provider, const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime,
+		transfer_format format, std::ostream& output, size_t chunk_size)
+	{
+		// SB: window of zero granularity is empty, so export would never reach the end of the range
+		if (0 == granularity || 0 == chunk_size)
+		{
+			throw std::invalid_argument("granularity or chunk_size argument is zero!");
+		}
+
+		if (transfer_format::csv == format)
+		{
+			output << c_csv_header;
+		}
+		else
+		{
+			output.write(c_binary_signature, sizeof(c_binary_signature));
+			output.write(reinterpret_cast<const char*>(&c_binary_version), sizeof(c_binary_version));
+		}
+
+		// SB: candles are not closer than granularity, so window can't contain more than 'chunk_size' of them
+		const auto window = std::chrono::duration_cast<time_t::duration>(std::chrono::seconds(granularity) * static_cast<__int64>(chunk_size));
+
+		size_t result = 0;
+		for (auto window_start = start_datetime; window_start <= end_datetime; )
+		{
+			const auto window_end = std::min(window_start + window - time_t::duration(1), end_datetime);
+			auto start = window_start;
+			auto end = window_end;
+			window_start = window_end + time_t::duration(1);
+
+			const auto candles = provider.get_candles(instrument_id, granularity, &start, &end);
+			if (candles.empty())
+			{
+				continue;
+			}
+
+			if (transfer_format::csv == format)
+			{
+				write_csv_chunk(candles, output);
+			}
+			else
+			{
+				write_binary_chunk(candles, output);
+			}
+
+			if (!output)
+			{
+				throw std::runtime_error("Failed to write exported candles!");
+			}
+
+			result += candles.size();
+		}
+
+		return result;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include <core/fixed_price.h>
+
+#include <cwctype>
+#include <limits>
+
+namespace tbp
+{
+	namespace
+	{
+		template <typename src_t, typename dst_t, typename convert_t>
+		void convert_prices(const src_t& src, dst_t* dst, const convert_t& convert)
+		{
+			auto convert_column = [&](const auto& from, auto* to)
+			{
+				to->resize(from.size());
+				for (size_t i = 0; i < from.size(); ++i)
+				{
+					(*to)[i] = convert(from[i]);
+				}
+			};
+
+			convert_column(src.open, &dst->open);
+			convert_column(src.high, &dst->high);
+			convert_column(src.low, &dst->low);
+			convert_column(src.close, &dst->close);
+		}
+
+		template <typename dst_series_t, typename src_series_t, typename convert_t>
+		dst_series_t convert_series(const src_series_t& candles, const convert_t& convert)
+		{
+			dst_series_t result;
+			result.timestamp = candles.timestamp;
+			result.volume = candles.volume;
+			result.complete = candles.complete;
+			convert_prices(candles.bid, &result.bid, convert);
+			convert_prices(candles.ask, &result.ask, convert);
+
+			return result;
+		}
+	}
+
+	fixed_price_t parse_fixed(const std::wstring& str, unsigned long precision)
+	{
+		const auto scale = get_price_scale(precision);
+
+		size_t pos = 0;
+		bool negative = false;
+		if (pos < str.size() && (L'-' == str[pos] || L'+' == str[pos]))
+		{
+			negative = L'-' == str[pos];
+			++pos;
+		}
+
+		__int64 integral = 0;
+		size_t digits = 0;
+		for (; pos < str.size() && iswdigit(str[pos]); ++pos, ++digits)
+		{
+			const int digit = str[pos] - L'0';
+			if (integral > (std::numeric_limits<__int64>::max() - digit) / 10)
+			{
+				throw std::out_of_range("Price value is too large!");
+			}
+
+			integral = integral * 10 + digit;
+		}
+
+		__int64 fractional = 0;
+		unsigned long fractional_digits = 0;
+		bool round_up = false;
+		if (pos < str.size() && L'.' == str[pos])
+		{
+			++pos;
+			for (; pos < str.size() && iswdigit(str[pos]); ++pos, ++digits)
+			{
+				const int digit = str[pos] - L'0';
+				if (fractional_digits < precision)
+				{
+					fractional = fractional * 10 + digit;
+					++fractional_digits;
+				}
+				else if (fractional_digits == precision)
+				{
+					// SB: only the first extra digit matters for rounding half away from zero
+					round_up = digit >= 5;
+					++fractional_digits;
+				}
+			}
+		}
+
+		if (0 == digits || pos != str.size())
+		{
+			throw std::invalid_argument("Invalid price value!");
+		}
+
+		for (; fractional_digits < precision; ++fractional_digits)
+		{
+			fractional *= 10;
+		}
+
+		fractional += round_up ? 1 : 0;
+		if (integral > (std::numeric_limits<__int64>::max() - fractional) / scale)
+		{
+			throw std::out_of_range("Price value is too large!");
+		}
+
+		const auto result = integral * scale + fractional;
+		return negative ? -result : result;
+	}
+
+	fixed_candle_series to_fixed(const candle_series& candles, unsigned long precision)
+	{
+		const double scale = static_cast<double>(get_price_scale(precision));
+		return convert_series<fixed_candle_series>(candles, [scale](double price) { return std::llround(price * scale); });
+	}
+
+	candle_series to_double(const fixed_candle_series& candles, unsigned long precision)
+	{
+		const double scale = static_cast<double>(get_price_scale(precision));
+		return convert_series<candle_series>(candles, [scale](fixed_price_t price) { return static_cast<double>(price) / scale; });
+	}
+}
\ No newline at end of file
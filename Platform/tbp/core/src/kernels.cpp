@@ -0,0 +1,649 @@
+#include <core/kernels.h>
+
+#include "kernels_impl.h"
+
+#include <intrin.h>
+#include <immintrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+namespace tbp
+{
+	namespace kernels
+	{
+		namespace
+		{
+			/////////////////////////////////////////////////////////////////////
+			// scalar reference implementation
+			// SB: straightforward running sums, accumulated in double for all value types
+
+			template<typename T>
+			void sma_scalar(const T* values, size_t count, unsigned long length, T* result, T* /*scratch*/)
+			{
+				double sum = 0.0;
+				for (size_t i = 0; i < count; ++i)
+				{
+					sum += values[i];
+					if (i >= length)
+					{
+						sum -= values[i - length];
+					}
+
+					result[i] = i + 1 >= length ? static_cast<T>(sum / length) : T(0);
+				}
+			}
+
+			template<typename T>
+			void ema_scalar(const T* values, size_t count, unsigned long length, T* result, T* /*scratch*/)
+			{
+				detail::ema_recurrence(values, count, length, result);
+			}
+
+			template<typename T>
+			void wma_scalar(const T* values, size_t count, unsigned long length, T* result, T* /*scratch*/)
+			{
+				const double norm = length * (length + 1) / 2.0;
+				double sum = 0.0;
+				double numerator = 0.0;
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (i < length)
+					{
+						numerator += (i + 1) * static_cast<double>(values[i]);
+						sum += values[i];
+					}
+					else
+					{
+						numerator += length * static_cast<double>(values[i]) - sum;
+						sum += values[i] - static_cast<double>(values[i - length]);
+					}
+
+					result[i] = i + 1 >= length ? static_cast<T>(numerator / norm) : T(0);
+				}
+			}
+
+			// SB: running sums of squares suffer from cancellation, so values are shifted by the first value of the window
+			// and sums are recalculated from scratch periodically to keep the error bounded
+			// SB: 'mean' is optional
+			template<typename T>
+			void moments_scalar(const T* values, size_t count, unsigned long length, T* mean, T* stddev)
+			{
+				const size_t reseed_interval = 1024;
+				double shift = 0.0;
+				double sum = 0.0;
+				double sum_sq = 0.0;
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (i + 1 < length)
+					{
+						if (nullptr != mean)
+						{
+							mean[i] = T(0);
+						}
+
+						stddev[i] = T(0);
+						continue;
+					}
+
+					const size_t position = i + 1 - length;
+					if (0 == position % reseed_interval)
+					{
+						shift = values[i];
+						sum = 0.0;
+						sum_sq = 0.0;
+						for (size_t j = position; j <= i; ++j)
+						{
+							const double y = values[j] - shift;
+							sum += y;
+							sum_sq += y * y;
+						}
+					}
+					else
+					{
+						const double y_new = values[i] - shift;
+						const double y_old = values[position - 1] - shift;
+						sum += y_new - y_old;
+						sum_sq += y_new * y_new - y_old * y_old;
+					}
+
+					const double m = sum / length;
+					const double variance = sum_sq / length - m * m;
+					if (nullptr != mean)
+					{
+						mean[i] = static_cast<T>(m + shift);
+					}
+
+					stddev[i] = static_cast<T>(std::sqrt(std::max(variance, 0.0)));
+				}
+			}
+
+			template<typename T>
+			void rolling_stddev_scalar(const T* values, size_t count, unsigned long length, T* result, T* /*scratch*/)
+			{
+				moments_scalar(values, count, length, static_cast<T*>(nullptr), result);
+			}
+
+			template<typename T>
+			void bollinger_scalar(const T* values, size_t count, unsigned long length, T width, T* middle, T* upper, T* lower, T* /*scratch*/)
+			{
+				moments_scalar(values, count, length, middle, upper);
+				for (size_t i = 0; i < count; ++i)
+				{
+					const T deviation = upper[i];
+					upper[i] = i + 1 >= length ? middle[i] + width * deviation : T(0);
+					lower[i] = i + 1 >= length ? middle[i] - width * deviation : T(0);
+				}
+			}
+
+			template<typename T>
+			void rsi_scalar(const T* values, size_t count, unsigned long length, T* result, T* /*scratch*/)
+			{
+				detail::rsi_recurrence(values, count, length, result);
+			}
+
+			template<typename T>
+			void atr_scalar(const T* high, const T* low, const T* close, size_t count, unsigned long length, T* result, T* /*scratch*/)
+			{
+				detail::atr_recurrence(high, low, close, count, length, result);
+			}
+
+			template<typename T>
+			void macd_scalar(const T* values, size_t count, unsigned long fast_length, unsigned long slow_length, unsigned long signal_length, T* macd_line, T* signal_line, T* histogram, T* /*scratch*/)
+			{
+				const size_t start = slow_length - 1;
+				const size_t signal_start = start + signal_length - 1;
+
+				// SB: histogram is used as temporary storage for the slow EMA
+				detail::ema_recurrence(values, count, fast_length, macd_line);
+				detail::ema_recurrence(values, count, slow_length, histogram);
+				for (size_t i = 0; i < count; ++i)
+				{
+					macd_line[i] = i >= start ? macd_line[i] - histogram[i] : T(0);
+					signal_line[i] = T(0);
+				}
+
+				if (count > start)
+				{
+					detail::ema_recurrence(macd_line + start, count - start, signal_length, signal_line + start);
+				}
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					histogram[i] = i >= signal_start ? macd_line[i] - signal_line[i] : T(0);
+				}
+			}
+
+			// SB: monotonic queue of indexes, front is the extremum of the current window
+			template<typename T, typename compare_t>
+			void rolling_extremum_scalar(const T* values, size_t count, unsigned long length, T* result, compare_t compare)
+			{
+				std::deque<size_t> window;
+				for (size_t i = 0; i < count; ++i)
+				{
+					while (!window.empty() && !compare(values[window.back()], values[i]))
+					{
+						window.pop_back();
+					}
+
+					window.push_back(i);
+					if (window.front() + length <= i)
+					{
+						window.pop_front();
+					}
+
+					result[i] = i + 1 >= length ? values[window.front()] : T(0);
+				}
+			}
+
+			template<typename T>
+			void rolling_min_scalar(const T* values, size_t count, unsigned long length, T* result, T* /*scratch*/)
+			{
+				rolling_extremum_scalar(values, count, length, result, [](T lhs, T rhs) { return lhs < rhs; });
+			}
+
+			template<typename T>
+			void rolling_max_scalar(const T* values, size_t count, unsigned long length, T* result, T* /*scratch*/)
+			{
+				rolling_extremum_scalar(values, count, length, result, [](T lhs, T rhs) { return lhs > rhs; });
+			}
+
+			template<typename T, typename compare_t>
+			void segment_extremum_scalar(const T* values, const size_t* offsets, size_t segments_count, T* result, compare_t compare)
+			{
+				for (size_t s = 0; s < segments_count; ++s)
+				{
+					T extremum = values[offsets[s]];
+					for (size_t i = offsets[s] + 1; i < offsets[s + 1]; ++i)
+					{
+						if (compare(values[i], extremum))
+						{
+							extremum = values[i];
+						}
+					}
+
+					result[s] = extremum;
+				}
+			}
+
+			template<typename T>
+			void segment_min_scalar(const T* values, const size_t* offsets, size_t segments_count, T* result)
+			{
+				segment_extremum_scalar(values, offsets, segments_count, result, [](T lhs, T rhs) { return lhs < rhs; });
+			}
+
+			template<typename T>
+			void segment_max_scalar(const T* values, const size_t* offsets, size_t segments_count, T* result)
+			{
+				segment_extremum_scalar(values, offsets, segments_count, result, [](T lhs, T rhs) { return lhs > rhs; });
+			}
+
+			template<typename T>
+			void ema_sweep_scalar(const T* values, size_t count, const unsigned long* lengths, size_t lengths_count, T* result, double* /*state*/)
+			{
+				for (size_t j = 0; j < lengths_count; ++j)
+				{
+					detail::ema_recurrence(values, count, lengths[j], result + j * count);
+				}
+			}
+
+			template<typename T>
+			void make_scalar_kernels(detail::kernel_table<T>* table)
+			{
+				table->sma = &sma_scalar<T>;
+				table->ema = &ema_scalar<T>;
+				table->wma = &wma_scalar<T>;
+				table->rolling_stddev = &rolling_stddev_scalar<T>;
+				table->bollinger = &bollinger_scalar<T>;
+				table->rsi = &rsi_scalar<T>;
+				table->atr = &atr_scalar<T>;
+				table->macd = &macd_scalar<T>;
+				table->rolling_min = &rolling_min_scalar<T>;
+				table->rolling_max = &rolling_max_scalar<T>;
+				table->ema_sweep = &ema_sweep_scalar<T>;
+				table->segment_min = &segment_min_scalar<T>;
+				table->segment_max = &segment_max_scalar<T>;
+			}
+
+			/////////////////////////////////////////////////////////////////////
+			// dispatching
+
+			isa detect_isa()
+			{
+				int info[4] = {};
+				__cpuid(info, 0);
+				const int max_leaf = info[0];
+
+				__cpuid(info, 1);
+				const bool sse2 = 0 != (info[3] & (1 << 26));
+				const bool osxsave = 0 != (info[2] & (1 << 27));
+				const bool avx = 0 != (info[2] & (1 << 28));
+
+				// SB: AVX registers should be saved by OS on context switch
+				if (osxsave && avx && max_leaf >= 7 && 6 == (_xgetbv(0) & 6))
+				{
+					__cpuidex(info, 7, 0);
+					if (0 != (info[1] & (1 << 5)))
+					{
+						return isa::avx2;
+					}
+				}
+
+				return sse2 ? isa::sse2 : isa::scalar;
+			}
+
+			std::atomic<isa>& active_isa()
+			{
+				static std::atomic<isa> value(supported_isa());
+				return value;
+			}
+
+			template<typename T>
+			class kernel_registry
+			{
+				detail::kernel_table<T> m_tables[3];
+
+			public:
+				const detail::kernel_table<T>& get(isa value) const
+				{
+					return m_tables[static_cast<size_t>(value)];
+				}
+
+				static const kernel_registry& instance()
+				{
+					static const kernel_registry registry;
+					return registry;
+				}
+
+			private:
+				kernel_registry()
+				{
+					make_scalar_kernels(&m_tables[static_cast<size_t>(isa::scalar)]);
+					detail::make_sse2_kernels(&m_tables[static_cast<size_t>(isa::sse2)]);
+
+					// SB: AVX2 translation unit is compiled with /arch:AVX2, so even its table filling code may use AVX instructions.
+					// AVX2 table stays empty on other CPUs, set_isa() doesn't allow to select it there
+					if (isa::avx2 == supported_isa())
+					{
+						detail::make_avx2_kernels(&m_tables[static_cast<size_t>(isa::avx2)]);
+					}
+				}
+			};
+
+			template<typename T>
+			const detail::kernel_table<T>& current_kernels()
+			{
+				return kernel_registry<T>::instance().get(active_isa().load());
+			}
+
+			void check_length(unsigned long length)
+			{
+				if (0 == length)
+				{
+					throw std::runtime_error("Indicator length should be greater than zero!");
+				}
+			}
+
+			// SB: scratch memory is reused between calls on the same thread to avoid allocation and page faults on each call
+			template<typename T>
+			T* get_scratch(size_t size)
+			{
+				thread_local std::vector<T> scratch;
+				if (scratch.size() < size)
+				{
+					scratch.resize(size);
+				}
+
+				return scratch.data();
+			}
+
+			template<typename T>
+			void sma_impl(const T* values, size_t count, unsigned long length, T* result)
+			{
+				check_length(length);
+				current_kernels<T>().sma(values, count, length, result, nullptr);
+			}
+
+			template<typename T>
+			void ema_impl(const T* values, size_t count, unsigned long length, T* result)
+			{
+				check_length(length);
+				current_kernels<T>().ema(values, count, length, result, nullptr);
+			}
+
+			template<typename T>
+			void wma_impl(const T* values, size_t count, unsigned long length, T* result)
+			{
+				check_length(length);
+				current_kernels<T>().wma(values, count, length, result, get_scratch<T>(detail::min_size(count, detail::block_size(length))));
+			}
+
+			template<typename T>
+			void rolling_stddev_impl(const T* values, size_t count, unsigned long length, T* result)
+			{
+				check_length(length);
+				current_kernels<T>().rolling_stddev(values, count, length, result, get_scratch<T>(detail::min_size(count, detail::block_size(length))));
+			}
+
+			template<typename T>
+			void bollinger_impl(const T* values, size_t count, unsigned long length, T width, T* middle, T* upper, T* lower)
+			{
+				check_length(length);
+				current_kernels<T>().bollinger(values, count, length, width, middle, upper, lower, nullptr);
+			}
+
+			template<typename T>
+			void rsi_impl(const T* values, size_t count, unsigned long length, T* result)
+			{
+				check_length(length);
+				current_kernels<T>().rsi(values, count, length, result, nullptr);
+			}
+
+			template<typename T>
+			void atr_impl(const T* high, const T* low, const T* close, size_t count, unsigned long length, T* result)
+			{
+				check_length(length);
+				current_kernels<T>().atr(high, low, close, count, length, result, nullptr);
+			}
+
+			template<typename T>
+			void macd_impl(const T* values, size_t count, unsigned long fast_length, unsigned long slow_length, unsigned long signal_length, T* macd_line, T* signal_line, T* histogram)
+			{
+				check_length(fast_length);
+				check_length(slow_length);
+				check_length(signal_length);
+				if (fast_length >= slow_length)
+				{
+					throw std::runtime_error("MACD fast length should be less than slow length!");
+				}
+
+				current_kernels<T>().macd(values, count, fast_length, slow_length, signal_length, macd_line, signal_line, histogram, nullptr);
+			}
+
+			template<typename T>
+			void rolling_min_impl(const T* values, size_t count, unsigned long length, T* result)
+			{
+				check_length(length);
+				current_kernels<T>().rolling_min(values, count, length, result, get_scratch<T>(count));
+			}
+
+			template<typename T>
+			void rolling_max_impl(const T* values, size_t count, unsigned long length, T* result)
+			{
+				check_length(length);
+				current_kernels<T>().rolling_max(values, count, length, result, get_scratch<T>(count));
+			}
+
+			template<typename T>
+			void ema_sweep_impl(const T* values, size_t count, const unsigned long* lengths, size_t lengths_count, T* result)
+			{
+				for (size_t j = 0; j < lengths_count; ++j)
+				{
+					check_length(lengths[j]);
+				}
+
+				if (0 == lengths_count)
+				{
+					return;
+				}
+
+				current_kernels<T>().ema_sweep(values, count, lengths, lengths_count, result, get_scratch<double>(lengths_count + 8));
+			}
+
+			void check_segments(const size_t* offsets, size_t segments_count)
+			{
+				for (size_t s = 0; s < segments_count; ++s)
+				{
+					if (offsets[s] >= offsets[s + 1])
+					{
+						throw std::runtime_error("Segment should not be empty!");
+					}
+				}
+			}
+
+			template<typename T>
+			void segment_min_impl(const T* values, const size_t* offsets, size_t segments_count, T* result)
+			{
+				check_segments(offsets, segments_count);
+				current_kernels<T>().segment_min(values, offsets, segments_count, result);
+			}
+
+			template<typename T>
+			void segment_max_impl(const T* values, const size_t* offsets, size_t segments_count, T* result)
+			{
+				check_segments(offsets, segments_count);
+				current_kernels<T>().segment_max(values, offsets, segments_count, result);
+			}
+		}
+
+		isa supported_isa()
+		{
+			static const isa value = detect_isa();
+			return value;
+		}
+
+		isa current_isa()
+		{
+			return active_isa().load();
+		}
+
+		void set_isa(isa value)
+		{
+			if (static_cast<int>(value) > static_cast<int>(supported_isa()))
+			{
+				throw std::runtime_error("Instruction set is not supported!");
+			}
+
+			active_isa().store(value);
+		}
+
+		const wchar_t* isa_name(isa value)
+		{
+			switch (value)
+			{
+			case isa::scalar:
+				return L"scalar";
+			case isa::sse2:
+				return L"sse2";
+			case isa::avx2:
+				return L"avx2";
+			}
+
+			return L"unknown";
+		}
+
+		void sma(const double* values, size_t count, unsigned long length, double* result)
+		{
+			sma_impl(values, count, length, result);
+		}
+
+		void sma(const float* values, size_t count, unsigned long length, float* result)
+		{
+			sma_impl(values, count, length, result);
+		}
+
+		void ema(const double* values, size_t count, unsigned long length, double* result)
+		{
+			ema_impl(values, count, length, result);
+		}
+
+		void ema(const float* values, size_t count, unsigned long length, float* result)
+		{
+			ema_impl(values, count, length, result);
+		}
+
+		void wma(const double* values, size_t count, unsigned long length, double* result)
+		{
+			wma_impl(values, count, length, result);
+		}
+
+		void wma(const float* values, size_t count, unsigned long length, float* result)
+		{
+			wma_impl(values, count, length, result);
+		}
+
+		void rolling_stddev(const double* values, size_t count, unsigned long length, double* result)
+		{
+			rolling_stddev_impl(values, count, length, result);
+		}
+
+		void rolling_stddev(const float* values, size_t count, unsigned long length, float* result)
+		{
+			rolling_stddev_impl(values, count, length, result);
+		}
+
+		void bollinger(const double* values, size_t count, unsigned long length, double width, double* middle, double* upper, double* lower)
+		{
+			bollinger_impl(values, count, length, width, middle, upper, lower);
+		}
+
+		void bollinger(const float* values, size_t count, unsigned long length, float width, float* middle, float* upper, float* lower)
+		{
+			bollinger_impl(values, count, length, width, middle, upper, lower);
+		}
+
+		void rsi(const double* values, size_t count, unsigned long length, double* result)
+		{
+			rsi_impl(values, count, length, result);
+		}
+
+		void rsi(const float* values, size_t count, unsigned long length, float* result)
+		{
+			rsi_impl(values, count, length, result);
+		}
+
+		void atr(const double* high, const double* low, const double* close, size_t count, unsigned long length, double* result)
+		{
+			atr_impl(high, low, close, count, length, result);
+		}
+
+		void atr(const float* high, const float* low, const float* close, size_t count, unsigned long length, float* result)
+		{
+			atr_impl(high, low, close, count, length, result);
+		}
+
+		void macd(const double* values, size_t count, unsigned long fast_length, unsigned long slow_length, unsigned long signal_length, double* macd_line, double* signal_line, double* histogram)
+		{
+			macd_impl(values, count, fast_length, slow_length, signal_length, macd_line, signal_line, histogram);
+		}
+
+		void macd(const float* values, size_t count, unsigned long fast_length, unsigned long slow_length, unsigned long signal_length, float* macd_line, float* signal_line, float* histogram)
+		{
+			macd_impl(values, count, fast_length, slow_length, signal_length, macd_line, signal_line, histogram);
+		}
+
+		void rolling_min(const double* values, size_t count, unsigned long length, double* result)
+		{
+			rolling_min_impl(values, count, length, result);
+		}
+
+		void rolling_min(const float* values, size_t count, unsigned long length, float* result)
+		{
+			rolling_min_impl(values, count, length, result);
+		}
+
+		void rolling_max(const double* values, size_t count, unsigned long length, double* result)
+		{
+			rolling_max_impl(values, count, length, result);
+		}
+
+		void rolling_max(const float* values, size_t count, unsigned long length, float* result)
+		{
+			rolling_max_impl(values, count, length, result);
+		}
+
+		void ema_sweep(const double* values, size_t count, const unsigned long* lengths, size_t lengths_count, double* result)
+		{
+			ema_sweep_impl(values, count, lengths, lengths_count, result);
+		}
+
+		void ema_sweep(const float* values, size_t count, const unsigned long* lengths, size_t lengths_count, float* result)
+		{
+			ema_sweep_impl(values, count, lengths, lengths_count, result);
+		}
+
+		void segment_min(const double* values, const size_t* offsets, size_t segments_count, double* result)
+		{
+			segment_min_impl(values, offsets, segments_count, result);
+		}
+
+		void segment_min(const float* values, const size_t* offsets, size_t segments_count, float* result)
+		{
+			segment_min_impl(values, offsets, segments_count, result);
+		}
+
+		void segment_max(const double* values, const size_t* offsets, size_t segments_count, double* result)
+		{
+			segment_max_impl(values, offsets, segments_count, result);
+		}
+
+		void segment_max(const float* values, const size_t* offsets, size_t segments_count, float* result)
+		{
+			segment_max_impl(values, offsets, segments_count, result);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "kernels_impl.h"
+
+#include <immintrin.h>
+
+// SB: this file is compiled with /arch:AVX2, functions from here are called only if CPU supports AVX2
+
+namespace tbp
+{
+	namespace kernels
+	{
+		namespace detail
+		{
+			namespace
+			{
+				struct avx2_double
+				{
+					using value_type = double;
+					using reg = __m256d;
+					static const size_t width = 4;
+
+					static reg load(const double* p) { return _mm256_loadu_pd(p); }
+					static void store(double* p, reg v) { _mm256_storeu_pd(p, v); }
+					static reg set1(double v) { return _mm256_set1_pd(v); }
+					static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+					static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+					static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+					static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+					static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+					static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+
+					static reg prefix_sum(reg a)
+					{
+						// SB: shift by one lane, then by two lanes (zeros are shifted in)
+						a = _mm256_add_pd(a, _mm256_blend_pd(_mm256_permute4x64_pd(a, _MM_SHUFFLE(2, 1, 0, 3)), _mm256_setzero_pd(), 0x1));
+						return _mm256_add_pd(a, _mm256_permute2f128_pd(a, a, 0x08));
+					}
+
+					static reg broadcast_last(reg a)
+					{
+						return _mm256_permute4x64_pd(a, _MM_SHUFFLE(3, 3, 3, 3));
+					}
+
+					static void transpose(reg* rows)
+					{
+						const auto t0 = _mm256_unpacklo_pd(rows[0], rows[1]);
+						const auto t1 = _mm256_unpackhi_pd(rows[0], rows[1]);
+						const auto t2 = _mm256_unpacklo_pd(rows[2], rows[3]);
+						const auto t3 = _mm256_unpackhi_pd(rows[2], rows[3]);
+						rows[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+						rows[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+						rows[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+						rows[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+					}
+
+					static void store_values(double* p, reg v) { _mm256_storeu_pd(p, v); }
+					static void store_values(float* p, reg v) { _mm_storeu_ps(p, _mm256_cvtpd_ps(v)); }
+				};
+
+				struct avx2_float
+				{
+					using value_type = float;
+					using reg = __m256;
+					static const size_t width = 8;
+
+					static reg load(const float* p) { return _mm256_loadu_ps(p); }
+					static void store(float* p, reg v) { _mm256_storeu_ps(p, v); }
+					static reg set1(float v) { return _mm256_set1_ps(v); }
+					static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+					static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+					static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+					static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+					static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+					static reg sqrt(reg a) { return _mm256_sqrt_ps(a); }
+
+					static reg prefix_sum(reg a)
+					{
+						// SB: shift by one, two and four lanes (zeros are shifted in)
+						a = _mm256_add_ps(a, _mm256_blend_ps(_mm256_permutevar8x32_ps(a, _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6)), _mm256_setzero_ps(), 0x01));
+						a = _mm256_add_ps(a, _mm256_blend_ps(_mm256_permutevar8x32_ps(a, _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5)), _mm256_setzero_ps(), 0x03));
+						return _mm256_add_ps(a, _mm256_permute2f128_ps(a, a, 0x08));
+					}
+
+					static reg broadcast_last(reg a)
+					{
+						return _mm256_permutevar8x32_ps(a, _mm256_set1_epi32(7));
+					}
+				};
+			}
+
+			void make_avx2_kernels(kernel_table<double>* table)
+			{
+				simd_kernels<avx2_double>::fill(table);
+				table->ema_sweep = &ema_sweep_kernel<avx2_double, double>::run;
+			}
+
+			void make_avx2_kernels(kernel_table<float>* table)
+			{
+				simd_kernels<avx2_float>::fill(table);
+				table->ema_sweep = &ema_sweep_kernel<avx2_double, float>::run;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,810 @@
+#pragma once
+
+#include <cstddef>
+#include <math.h>
+
+// SB: private header, shared by kernels.cpp and ISA specific translation units (kernels_sse2.cpp, kernels_avx2.cpp).
+// ISA specific translation units are compiled with /arch flags, so everything they instantiate should have internal
+// linkage. Otherwise linker can pick AVX2 encoded copy of inline function for the code which runs on any CPU.
+// That's why helpers below live in the unnamed namespace and standard library templates are not used here.
+
+namespace tbp
+{
+	namespace kernels
+	{
+		namespace detail
+		{
+			// SB: kernels don't allocate memory, 'scratch' should have space for:
+			// - wma, rolling_stddev: min(count, block_size(length)) values;
+			// - rolling_min, rolling_max: count values;
+			// - others don't use it.
+			// ema_sweep uses 'state' with space for lengths_count rounded up to 8 values
+
+			template<typename T>
+			struct kernel_table
+			{
+				void(*sma)(const T* values, size_t count, unsigned long length, T* result, T* scratch);
+				void(*ema)(const T* values, size_t count, unsigned long length, T* result, T* scratch);
+				void(*wma)(const T* values, size_t count, unsigned long length, T* result, T* scratch);
+				void(*rolling_stddev)(const T* values, size_t count, unsigned long length, T* result, T* scratch);
+				void(*bollinger)(const T* values, size_t count, unsigned long length, T width, T* middle, T* upper, T* lower, T* scratch);
+				void(*rsi)(const T* values, size_t count, unsigned long length, T* result, T* scratch);
+				void(*atr)(const T* high, const T* low, const T* close, size_t count, unsigned long length, T* result, T* scratch);
+				void(*macd)(const T* values, size_t count, unsigned long fast_length, unsigned long slow_length, unsigned long signal_length, T* macd_line, T* signal_line, T* histogram, T* scratch);
+				void(*rolling_min)(const T* values, size_t count, unsigned long length, T* result, T* scratch);
+				void(*rolling_max)(const T* values, size_t count, unsigned long length, T* result, T* scratch);
+				void(*ema_sweep)(const T* values, size_t count, const unsigned long* lengths, size_t lengths_count, T* result, double* state);
+				void(*segment_min)(const T* values, const size_t* offsets, size_t segments_count, T* result);
+				void(*segment_max)(const T* values, const size_t* offsets, size_t segments_count, T* result);
+			};
+
+			void make_sse2_kernels(kernel_table<double>* table);
+			void make_sse2_kernels(kernel_table<float>* table);
+			void make_avx2_kernels(kernel_table<double>* table);
+			void make_avx2_kernels(kernel_table<float>* table);
+
+			namespace
+			{
+				template<typename T>
+				void fill_zero(T* first, T* last)
+				{
+					for (; first != last; ++first)
+					{
+						*first = T(0);
+					}
+				}
+
+				inline size_t min_size(size_t lhs, size_t rhs)
+				{
+					return lhs < rhs ? lhs : rhs;
+				}
+
+				// SB: number of outputs between recalculations of rolling sums
+				inline size_t block_size(unsigned long length)
+				{
+					const size_t min_block = 1024;
+					const size_t block = 8 * static_cast<size_t>(length);
+
+					return block < min_block ? min_block : block;
+				}
+
+				// SB: EMA is a recurrence, so it stays scalar for all ISAs. Calculation is done in double for all value types
+				// to produce the same values as analysis::calculate_ema
+				template<typename T>
+				void ema_recurrence(const T* values, size_t count, unsigned long length, T* result)
+				{
+					const double alpha = 2.0 / (length + 1);
+					double value = 0.0;
+					for (size_t i = 0; i < count; ++i)
+					{
+						if (i < length)
+						{
+							value += values[i];
+							if (length - 1 == i)
+							{
+								value /= length;
+								result[i] = static_cast<T>(value);
+							}
+							else
+							{
+								result[i] = T(0);
+							}
+						}
+						else
+						{
+							value = values[i] * alpha + (1.0 - alpha) * value;
+							result[i] = static_cast<T>(value);
+						}
+					}
+				}
+
+				// SB: RSI and ATR use Wilder's smoothing: the first value is SMA of 'length' values,
+				// each next one is previous * (length - 1) / length + value / length. It's a recurrence as well,
+				// so these kernels are scalar for all ISAs
+
+				template<typename T>
+				void rsi_recurrence(const T* values, size_t count, unsigned long length, T* result)
+				{
+					const double previous_weight = static_cast<double>(length - 1) / length;
+					const double value_weight = 1.0 / length;
+					double gain = 0.0;
+					double loss = 0.0;
+					for (size_t i = 0; i < count; ++i)
+					{
+						result[i] = T(0);
+						if (0 == i)
+						{
+							continue;
+						}
+
+						const double d = static_cast<double>(values[i]) - values[i - 1];
+						const double current_gain = d > 0.0 ? d : 0.0;
+						const double current_loss = d < 0.0 ? -d : 0.0;
+						if (i <= length)
+						{
+							gain += current_gain;
+							loss += current_loss;
+							if (i < length)
+							{
+								continue;
+							}
+
+							gain /= length;
+							loss /= length;
+						}
+						else
+						{
+							gain = gain * previous_weight + current_gain * value_weight;
+							loss = loss * previous_weight + current_loss * value_weight;
+						}
+
+						result[i] = 0.0 == gain + loss ? T(50) : static_cast<T>(100.0 * gain / (gain + loss));
+					}
+				}
+
+				template<typename T>
+				void atr_recurrence(const T* high, const T* low, const T* close, size_t count, unsigned long length, T* result)
+				{
+					const double previous_weight = static_cast<double>(length - 1) / length;
+					const double value_weight = 1.0 / length;
+					double average = 0.0;
+					for (size_t i = 0; i < count; ++i)
+					{
+						double range = static_cast<double>(high[i]) - low[i];
+						if (0 != i)
+						{
+							const double high_close = static_cast<double>(high[i]) - close[i - 1];
+							const double low_close = static_cast<double>(low[i]) - close[i - 1];
+							const double high_close_abs = high_close < 0.0 ? -high_close : high_close;
+							const double low_close_abs = low_close < 0.0 ? -low_close : low_close;
+							range = range < high_close_abs ? high_close_abs : range;
+							range = range < low_close_abs ? low_close_abs : range;
+						}
+
+						result[i] = T(0);
+						if (i < length)
+						{
+							average += range;
+							if (length - 1 == i)
+							{
+								average /= length;
+								result[i] = static_cast<T>(average);
+							}
+						}
+						else
+						{
+							average = average * previous_weight + range * value_weight;
+							result[i] = static_cast<T>(average);
+						}
+					}
+				}
+
+				/////////////////////////////////////////////////////////////////////
+				// simd_kernels
+				// SB: simd_t provides: value_type, reg, width, load, store, set1, add, sub, mul, min, max, sqrt,
+				// prefix_sum (inclusive scan inside register) and broadcast_last.
+				// Rolling sums are calculated as prefix scan of (x[i] - x[i - length]) with the carry between registers.
+				// To keep floating point error bounded sums are recalculated directly at the start of each block,
+				// values inside the block are shifted by the block's first value to avoid cancellation in variance.
+
+				template<typename simd_t>
+				struct simd_kernels
+				{
+					using value_t = typename simd_t::value_type;
+					using reg_t = typename simd_t::reg;
+
+					// SB: out[i] = carry + d[0] + ... + d[i], 'out' can be the same as 'd'. Returns the last sum.
+					// Prefix sums of two registers are calculated independently, so the only dependency between iterations
+					// is the carry update
+					static value_t scan_add(const value_t* d, size_t count, value_t carry, value_t* out)
+					{
+						const size_t step = 2 * simd_t::width;
+						size_t i = 0;
+						auto c = simd_t::set1(carry);
+						for (; i + step <= count; i += step)
+						{
+							const auto p0 = simd_t::prefix_sum(simd_t::load(d + i));
+							const auto p1 = simd_t::prefix_sum(simd_t::load(d + i + simd_t::width));
+							const auto t0 = simd_t::broadcast_last(p0);
+							const auto t1 = simd_t::broadcast_last(p1);
+							simd_t::store(out + i, simd_t::add(p0, c));
+							simd_t::store(out + i + simd_t::width, simd_t::add(p1, simd_t::add(c, t0)));
+							c = simd_t::add(c, simd_t::add(t0, t1));
+						}
+
+						if (0 != i)
+						{
+							carry = out[i - 1];
+						}
+
+						for (; i < count; ++i)
+						{
+							carry += d[i];
+							out[i] = carry;
+						}
+
+						return carry;
+					}
+
+					// SB: window sums of (x - shift) and (x - shift)^2 for outputs [first, last). sum[0] corresponds to 'first'.
+					// 'sum_sq' is optional
+					static void centered_sums(const value_t* values, size_t first, size_t last, unsigned long length, value_t shift, value_t* sum, value_t* sum_sq)
+					{
+						value_t s = 0;
+						value_t s2 = 0;
+						for (size_t j = first + 1 - length; j <= first; ++j)
+						{
+							const value_t y = values[j] - shift;
+							s += y;
+							s2 += y * y;
+						}
+
+						sum[0] = s;
+						if (nullptr != sum_sq)
+						{
+							sum_sq[0] = s2;
+						}
+
+						const size_t count = last - first;
+						const value_t* new_values = values + first;
+						const value_t* old_values = values + first - length;
+						const auto vshift = simd_t::set1(shift);
+
+						size_t k = 1;
+						for (; k + simd_t::width <= count; k += simd_t::width)
+						{
+							const auto x_new = simd_t::load(new_values + k);
+							const auto x_old = simd_t::load(old_values + k);
+							simd_t::store(sum + k, simd_t::sub(x_new, x_old));
+
+							if (nullptr != sum_sq)
+							{
+								const auto y_new = simd_t::sub(x_new, vshift);
+								const auto y_old = simd_t::sub(x_old, vshift);
+								simd_t::store(sum_sq + k, simd_t::sub(simd_t::mul(y_new, y_new), simd_t::mul(y_old, y_old)));
+							}
+						}
+
+						for (; k < count; ++k)
+						{
+							sum[k] = new_values[k] - old_values[k];
+							if (nullptr != sum_sq)
+							{
+								const value_t y_new = new_values[k] - shift;
+								const value_t y_old = old_values[k] - shift;
+								sum_sq[k] = y_new * y_new - y_old * y_old;
+							}
+						}
+
+						if (count > 1)
+						{
+							scan_add(sum + 1, count - 1, s, sum + 1);
+							if (nullptr != sum_sq)
+							{
+								scan_add(sum_sq + 1, count - 1, s2, sum_sq + 1);
+							}
+						}
+					}
+
+					static void sma(const value_t* values, size_t count, unsigned long length, value_t* result, value_t* /*scratch*/)
+					{
+						fill_zero(result, result + min_size(count, length - 1));
+
+						const size_t block = block_size(length);
+						const value_t inv_length = value_t(1) / length;
+						const auto vinv_length = simd_t::set1(inv_length);
+						for (size_t first = length - 1; first < count; first += block)
+						{
+							const size_t last = min_size(count, first + block);
+							const value_t shift = values[first];
+							value_t* sum = result + first;
+							centered_sums(values, first, last, length, shift, sum, nullptr);
+
+							const auto vshift = simd_t::set1(shift);
+							size_t k = 0;
+							for (; k + simd_t::width <= last - first; k += simd_t::width)
+							{
+								simd_t::store(sum + k, simd_t::add(simd_t::mul(simd_t::load(sum + k), vinv_length), vshift));
+							}
+
+							for (; k < last - first; ++k)
+							{
+								sum[k] = sum[k] * inv_length + shift;
+							}
+						}
+					}
+
+					static void ema(const value_t* values, size_t count, unsigned long length, value_t* result, value_t* /*scratch*/)
+					{
+						ema_recurrence(values, count, length, result);
+					}
+
+					// SB: numerator of WMA is updated as N[i] = N[i - 1] + length * x[i] - S[i - 1], where S is the window sum,
+					// so it's a prefix scan as well
+					static void wma(const value_t* values, size_t count, unsigned long length, value_t* result, value_t* scratch)
+					{
+						fill_zero(result, result + min_size(count, length - 1));
+
+						const size_t block = block_size(length);
+						const value_t vlength = static_cast<value_t>(length);
+						const value_t inv_norm = value_t(2) / (value_t(length) * (length + 1));
+						const auto vlength_reg = simd_t::set1(vlength);
+						const auto vinv_norm = simd_t::set1(inv_norm);
+						for (size_t first = length - 1; first < count; first += block)
+						{
+							const size_t last = min_size(count, first + block);
+							const size_t block_count = last - first;
+							const value_t shift = values[first];
+							const auto vshift = simd_t::set1(shift);
+							value_t* window_sum = scratch;
+							value_t* numerator = result + first;
+							centered_sums(values, first, last, length, shift, window_sum, nullptr);
+
+							value_t n = 0;
+							for (unsigned long j = 1; j <= length; ++j)
+							{
+								n += j * (values[first + j - length] - shift);
+							}
+
+							numerator[0] = n;
+
+							const value_t* new_values = values + first;
+							size_t k = 1;
+							for (; k + simd_t::width <= block_count; k += simd_t::width)
+							{
+								const auto y = simd_t::sub(simd_t::load(new_values + k), vshift);
+								simd_t::store(numerator + k, simd_t::sub(simd_t::mul(y, vlength_reg), simd_t::load(window_sum + k - 1)));
+							}
+
+							for (; k < block_count; ++k)
+							{
+								numerator[k] = (new_values[k] - shift) * vlength - window_sum[k - 1];
+							}
+
+							if (block_count > 1)
+							{
+								scan_add(numerator + 1, block_count - 1, n, numerator + 1);
+							}
+
+							k = 0;
+							for (; k + simd_t::width <= block_count; k += simd_t::width)
+							{
+								simd_t::store(numerator + k, simd_t::add(simd_t::mul(simd_t::load(numerator + k), vinv_norm), vshift));
+							}
+
+							for (; k < block_count; ++k)
+							{
+								numerator[k] = numerator[k] * inv_norm + shift;
+							}
+						}
+					}
+
+					// SB: calculates mean (optional) and standard deviation over the window
+					static void moments(const value_t* values, size_t count, unsigned long length, value_t* mean, value_t* stddev, value_t* scratch)
+					{
+						if (nullptr != mean)
+						{
+							fill_zero(mean, mean + min_size(count, length - 1));
+						}
+
+						fill_zero(stddev, stddev + min_size(count, length - 1));
+
+						const size_t block = block_size(length);
+						const value_t inv_length = value_t(1) / length;
+						const auto vinv_length = simd_t::set1(inv_length);
+						const auto vzero = simd_t::set1(value_t(0));
+						for (size_t first = length - 1; first < count; first += block)
+						{
+							const size_t last = min_size(count, first + block);
+							const size_t block_count = last - first;
+							const value_t shift = values[first];
+							const auto vshift = simd_t::set1(shift);
+							value_t* sum = nullptr != mean ? mean + first : scratch;
+							value_t* sum_sq = stddev + first;
+							centered_sums(values, first, last, length, shift, sum, sum_sq);
+
+							size_t k = 0;
+							for (; k + simd_t::width <= block_count; k += simd_t::width)
+							{
+								const auto m = simd_t::mul(simd_t::load(sum + k), vinv_length);
+								const auto variance = simd_t::mul(simd_t::sub(simd_t::load(sum_sq + k), simd_t::mul(simd_t::load(sum + k), m)), vinv_length);
+								simd_t::store(sum_sq + k, simd_t::sqrt(simd_t::max(variance, vzero)));
+								if (nullptr != mean)
+								{
+									simd_t::store(sum + k, simd_t::add(m, vshift));
+								}
+							}
+
+							for (; k < block_count; ++k)
+							{
+								const value_t m = sum[k] * inv_length;
+								const value_t variance = (sum_sq[k] - sum[k] * m) * inv_length;
+								sum_sq[k] = static_cast<value_t>(::sqrt(variance > value_t(0) ? static_cast<double>(variance) : 0.0));
+								if (nullptr != mean)
+								{
+									sum[k] = m + shift;
+								}
+							}
+						}
+					}
+
+					static void rolling_stddev(const value_t* values, size_t count, unsigned long length, value_t* result, value_t* scratch)
+					{
+						moments(values, count, length, nullptr, result, scratch);
+					}
+
+					static void bollinger(const value_t* values, size_t count, unsigned long length, value_t width, value_t* middle, value_t* upper, value_t* lower, value_t* scratch)
+					{
+						moments(values, count, length, middle, upper, scratch);
+
+						const auto vwidth = simd_t::set1(width);
+						size_t i = 0;
+						for (; i + simd_t::width <= count; i += simd_t::width)
+						{
+							const auto m = simd_t::load(middle + i);
+							const auto d = simd_t::mul(simd_t::load(upper + i), vwidth);
+							simd_t::store(upper + i, simd_t::add(m, d));
+							simd_t::store(lower + i, simd_t::sub(m, d));
+						}
+
+						for (; i < count; ++i)
+						{
+							const value_t d = upper[i] * width;
+							upper[i] = middle[i] + d;
+							lower[i] = middle[i] - d;
+						}
+
+						// SB: warm-up values should stay zero
+						fill_zero(upper, upper + min_size(count, length - 1));
+						fill_zero(lower, lower + min_size(count, length - 1));
+					}
+
+					static void rsi(const value_t* values, size_t count, unsigned long length, value_t* result, value_t* /*scratch*/)
+					{
+						rsi_recurrence(values, count, length, result);
+					}
+
+					static void atr(const value_t* high, const value_t* low, const value_t* close, size_t count, unsigned long length, value_t* result, value_t* /*scratch*/)
+					{
+						atr_recurrence(high, low, close, count, length, result);
+					}
+
+					static void subtract(const value_t* lhs, const value_t* rhs, size_t count, value_t* result)
+					{
+						size_t i = 0;
+						for (; i + simd_t::width <= count; i += simd_t::width)
+						{
+							simd_t::store(result + i, simd_t::sub(simd_t::load(lhs + i), simd_t::load(rhs + i)));
+						}
+
+						for (; i < count; ++i)
+						{
+							result[i] = lhs[i] - rhs[i];
+						}
+					}
+
+					// SB: histogram is used as temporary storage for the slow EMA
+					static void macd(const value_t* values, size_t count, unsigned long fast_length, unsigned long slow_length, unsigned long signal_length, value_t* macd_line, value_t* signal_line, value_t* histogram, value_t* /*scratch*/)
+					{
+						const size_t start = slow_length - 1;
+						const size_t signal_start = start + signal_length - 1;
+
+						if (count <= start)
+						{
+							fill_zero(macd_line, macd_line + count);
+							fill_zero(signal_line, signal_line + count);
+							fill_zero(histogram, histogram + count);
+							return;
+						}
+
+						ema_recurrence(values, count, fast_length, macd_line);
+						ema_recurrence(values, count, slow_length, histogram);
+						fill_zero(macd_line, macd_line + start);
+						subtract(macd_line + start, histogram + start, count - start, macd_line + start);
+
+						fill_zero(signal_line, signal_line + start);
+						ema_recurrence(macd_line + start, count - start, signal_length, signal_line + start);
+
+						fill_zero(histogram, histogram + min_size(count, signal_start));
+						if (count > signal_start)
+						{
+							subtract(macd_line + signal_start, signal_line + signal_start, count - signal_start, histogram + signal_start);
+						}
+					}
+
+					// SB: van Herk/Gil-Werman algorithm: prefix and suffix extremums inside blocks of 'length' values,
+					// result for the window is the extremum of suffix at the window start and prefix at the window end
+					template<typename op_t>
+					static void rolling_extremum(const value_t* values, size_t count, unsigned long length, value_t* result, value_t* scratch)
+					{
+						if (count < length)
+						{
+							fill_zero(result, result + count);
+							return;
+						}
+
+						// SB: prefix extremums are stored directly to the result, each of them is read before it's overwritten
+						value_t* prefix = result;
+						value_t* suffix = scratch;
+						for (size_t first = 0; first < count; first += length)
+						{
+							const size_t last = min_size(count, first + length);
+
+							prefix[first] = values[first];
+							for (size_t i = first + 1; i < last; ++i)
+							{
+								prefix[i] = op_t::apply(prefix[i - 1], values[i]);
+							}
+
+							suffix[last - 1] = values[last - 1];
+							for (size_t i = last - 1; i > first; --i)
+							{
+								suffix[i - 1] = op_t::apply(suffix[i], values[i - 1]);
+							}
+						}
+
+						const size_t offset = length - 1;
+						size_t i = offset;
+						for (; i + simd_t::width <= count; i += simd_t::width)
+						{
+							simd_t::store(result + i, op_t::apply(simd_t::load(suffix + i - offset), simd_t::load(prefix + i)));
+						}
+
+						for (; i < count; ++i)
+						{
+							result[i] = op_t::apply(suffix[i - offset], prefix[i]);
+						}
+
+						fill_zero(result, result + offset);
+					}
+
+					struct min_op
+					{
+						static value_t apply(value_t lhs, value_t rhs)
+						{
+							return rhs < lhs ? rhs : lhs;
+						}
+
+						static reg_t apply(reg_t lhs, reg_t rhs)
+						{
+							return simd_t::min(lhs, rhs);
+						}
+					};
+
+					struct max_op
+					{
+						static value_t apply(value_t lhs, value_t rhs)
+						{
+							return lhs < rhs ? rhs : lhs;
+						}
+
+						static reg_t apply(reg_t lhs, reg_t rhs)
+						{
+							return simd_t::max(lhs, rhs);
+						}
+					};
+
+					static void rolling_min(const value_t* values, size_t count, unsigned long length, value_t* result, value_t* scratch)
+					{
+						rolling_extremum<min_op>(values, count, length, result, scratch);
+					}
+
+					static void rolling_max(const value_t* values, size_t count, unsigned long length, value_t* result, value_t* scratch)
+					{
+						rolling_extremum<max_op>(values, count, length, result, scratch);
+					}
+
+					// SB: segment is reduced in a register, lanes are combined once per segment
+					template<typename op_t>
+					static void segment_extremum(const value_t* values, const size_t* offsets, size_t segments_count, value_t* result)
+					{
+						for (size_t s = 0; s < segments_count; ++s)
+						{
+							const size_t first = offsets[s];
+							const size_t last = offsets[s + 1];
+
+							size_t i = first;
+							value_t extremum = values[first];
+							if (last - first >= simd_t::width)
+							{
+								auto acc = simd_t::load(values + first);
+								for (i += simd_t::width; i + simd_t::width <= last; i += simd_t::width)
+								{
+									acc = op_t::apply(acc, simd_t::load(values + i));
+								}
+
+								value_t lanes[simd_t::width];
+								simd_t::store(lanes, acc);
+								for (size_t j = 1; j < simd_t::width; ++j)
+								{
+									lanes[0] = op_t::apply(lanes[0], lanes[j]);
+								}
+
+								extremum = lanes[0];
+							}
+
+							for (; i < last; ++i)
+							{
+								extremum = op_t::apply(extremum, values[i]);
+							}
+
+							result[s] = extremum;
+						}
+					}
+
+					static void segment_min(const value_t* values, const size_t* offsets, size_t segments_count, value_t* result)
+					{
+						segment_extremum<min_op>(values, offsets, segments_count, result);
+					}
+
+					static void segment_max(const value_t* values, const size_t* offsets, size_t segments_count, value_t* result)
+					{
+						segment_extremum<max_op>(values, offsets, segments_count, result);
+					}
+
+					static void fill(kernel_table<value_t>* table)
+					{
+						table->sma = &sma;
+						table->ema = &ema;
+						table->wma = &wma;
+						table->rolling_stddev = &rolling_stddev;
+						table->bollinger = &bollinger;
+						table->rsi = &rsi;
+						table->atr = &atr;
+						table->macd = &macd;
+						table->rolling_min = &rolling_min;
+						table->rolling_max = &rolling_max;
+						table->segment_min = &segment_min;
+						table->segment_max = &segment_max;
+					}
+				};
+
+				/////////////////////////////////////////////////////////////////////
+				// ema_sweep_kernel
+				// SB: EMA for many lengths in one pass: lengths are processed in SIMD lanes (one group of lengths per register),
+				// values are processed by chunks which stay in L1 cache while all groups go over them.
+				// EMA state is kept in double for all value types, so results are the same as ema_recurrence gives.
+				// double_simd_t should also provide transpose (width x width registers in place) and store_values (converts to T).
+				// Warm-up (SMA seed) is different for each length, so it's calculated per length up to the moment
+				// when all lanes of the group are in steady state
+
+				template<typename double_simd_t, typename T>
+				struct ema_sweep_kernel
+				{
+					using reg_t = typename double_simd_t::reg;
+					static const size_t width = double_simd_t::width;
+					static const size_t chunk_size = 256;
+
+					// SB: padding lanes of the last group repeat the last length
+					static unsigned long lane_length(const unsigned long* lengths, size_t lengths_count, size_t index)
+					{
+						return lengths[index < lengths_count ? index : lengths_count - 1];
+					}
+
+					// SB: the last index of warm-up for the group
+					static size_t steady_start(const unsigned long* lengths, size_t lengths_count, size_t first)
+					{
+						unsigned long result = 1;
+						for (size_t j = first; j < first + width; ++j)
+						{
+							const auto length = lane_length(lengths, lengths_count, j);
+							result = result < length ? length : result;
+						}
+
+						return result - 1;
+					}
+
+					// SB: calculates EMA up to 'last' index inclusive, returns the last EMA state
+					static double warm_up(const T* values, size_t count, unsigned long length, size_t last, T* column)
+					{
+						const double alpha = 2.0 / (length + 1);
+						double value = 0.0;
+						for (size_t i = 0; i <= last && i < count; ++i)
+						{
+							T result = T(0);
+							if (i < length)
+							{
+								value += values[i];
+								if (length - 1 == i)
+								{
+									value /= length;
+									result = static_cast<T>(value);
+								}
+							}
+							else
+							{
+								value = values[i] * alpha + (1.0 - alpha) * value;
+								result = static_cast<T>(value);
+							}
+
+							if (nullptr != column)
+							{
+								column[i] = result;
+							}
+						}
+
+						return value;
+					}
+
+					static void process(const T* values, size_t count, size_t begin, size_t end, const unsigned long* lengths, size_t lengths_count, size_t first, double* state, T* result)
+					{
+						double alpha[width];
+						double beta[width];
+						for (size_t lane = 0; lane < width; ++lane)
+						{
+							alpha[lane] = 2.0 / (lane_length(lengths, lengths_count, first + lane) + 1);
+							beta[lane] = 1.0 - alpha[lane];
+						}
+
+						const size_t active = min_size(lengths_count - first, width);
+						const auto valpha = double_simd_t::load(alpha);
+						const auto vbeta = double_simd_t::load(beta);
+						auto s = double_simd_t::load(state + first);
+
+						size_t i = begin;
+						for (; i + width <= end; i += width)
+						{
+							reg_t rows[width];
+							for (size_t t = 0; t < width; ++t)
+							{
+								s = double_simd_t::add(double_simd_t::mul(double_simd_t::set1(static_cast<double>(values[i + t])), valpha), double_simd_t::mul(vbeta, s));
+								rows[t] = s;
+							}
+
+							// SB: after transposition each register contains consecutive values of one length
+							double_simd_t::transpose(rows);
+							for (size_t lane = 0; lane < active; ++lane)
+							{
+								double_simd_t::store_values(result + (first + lane) * count + i, rows[lane]);
+							}
+						}
+
+						for (; i < end; ++i)
+						{
+							s = double_simd_t::add(double_simd_t::mul(double_simd_t::set1(static_cast<double>(values[i])), valpha), double_simd_t::mul(vbeta, s));
+
+							double lanes[width];
+							double_simd_t::store(lanes, s);
+							for (size_t lane = 0; lane < active; ++lane)
+							{
+								result[(first + lane) * count + i] = static_cast<T>(lanes[lane]);
+							}
+						}
+
+						double_simd_t::store(state + first, s);
+					}
+
+					static void run(const T* values, size_t count, const unsigned long* lengths, size_t lengths_count, T* result, double* state)
+					{
+						const size_t groups = (lengths_count + width - 1) / width;
+						for (size_t g = 0; g < groups; ++g)
+						{
+							const size_t first = g * width;
+							const size_t steady = steady_start(lengths, lengths_count, first);
+							for (size_t j = first; j < first + width; ++j)
+							{
+								T* column = j < lengths_count ? result + j * count : nullptr;
+								state[j] = warm_up(values, count, lane_length(lengths, lengths_count, j), steady, column);
+							}
+						}
+
+						for (size_t chunk_first = 0; chunk_first < count; chunk_first += chunk_size)
+						{
+							const size_t chunk_last = min_size(count, chunk_first + chunk_size);
+							for (size_t g = 0; g < groups; ++g)
+							{
+								const size_t first = g * width;
+								const size_t steady = steady_start(lengths, lengths_count, first);
+								const size_t begin = chunk_first > steady ? chunk_first : steady + 1;
+								if (begin < chunk_last)
+								{
+									process(values, count, begin, chunk_last, lengths, lengths_count, first, state, result);
+								}
+							}
+						}
+					}
+				};
+			}
+		}
+	}
+}
\ No newline at end of file
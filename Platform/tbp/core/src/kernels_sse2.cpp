@@ -0,0 +1,92 @@
+#include "kernels_impl.h"
+
+#include <emmintrin.h>
+
+namespace tbp
+{
+	namespace kernels
+	{
+		namespace detail
+		{
+			namespace
+			{
+				struct sse2_double
+				{
+					using value_type = double;
+					using reg = __m128d;
+					static const size_t width = 2;
+
+					static reg load(const double* p) { return _mm_loadu_pd(p); }
+					static void store(double* p, reg v) { _mm_storeu_pd(p, v); }
+					static reg set1(double v) { return _mm_set1_pd(v); }
+					static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+					static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+					static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+					static reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+					static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+					static reg sqrt(reg a) { return _mm_sqrt_pd(a); }
+
+					static reg prefix_sum(reg a)
+					{
+						return _mm_add_pd(a, _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(a), 8)));
+					}
+
+					static reg broadcast_last(reg a)
+					{
+						return _mm_unpackhi_pd(a, a);
+					}
+
+					static void transpose(reg* rows)
+					{
+						const auto r0 = rows[0];
+						rows[0] = _mm_unpacklo_pd(r0, rows[1]);
+						rows[1] = _mm_unpackhi_pd(r0, rows[1]);
+					}
+
+					static void store_values(double* p, reg v) { _mm_storeu_pd(p, v); }
+					static void store_values(float* p, reg v) { _mm_storel_pi(reinterpret_cast<__m64*>(p), _mm_cvtpd_ps(v)); }
+				};
+
+				struct sse2_float
+				{
+					using value_type = float;
+					using reg = __m128;
+					static const size_t width = 4;
+
+					static reg load(const float* p) { return _mm_loadu_ps(p); }
+					static void store(float* p, reg v) { _mm_storeu_ps(p, v); }
+					static reg set1(float v) { return _mm_set1_ps(v); }
+					static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+					static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+					static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+					static reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+					static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+					static reg sqrt(reg a) { return _mm_sqrt_ps(a); }
+
+					static reg prefix_sum(reg a)
+					{
+						a = _mm_add_ps(a, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(a), 4)));
+						return _mm_add_ps(a, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(a), 8)));
+					}
+
+					static reg broadcast_last(reg a)
+					{
+						return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3));
+					}
+				};
+			}
+
+			void make_sse2_kernels(kernel_table<double>* table)
+			{
+				simd_kernels<sse2_double>::fill(table);
+				table->ema_sweep = &ema_sweep_kernel<sse2_double, double>::run;
+			}
+
+			void make_sse2_kernels(kernel_table<float>* table)
+			{
+				simd_kernels<sse2_float>::fill(table);
+				table->ema_sweep = &ema_sweep_kernel<sse2_double, float>::run;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,430 @@
+#include <core/optimizer.h>
+
+#include <win/thread.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+namespace tbp
+{
+	namespace optimizer
+	{
+		namespace
+		{
+			/////////////////////////////////////////////////////////////////////
+			// trial_settings
+			// SB: optimized values on top of base settings. Base settings are only read,
+			// strategy reads settings once when it's created
+
+			class trial_settings : public settings
+			{
+				const settings::ptr m_base;
+				std::map<std::wstring, setting_value> m_values;
+
+			public:
+				virtual setting_value get(const std::wstring& name) override
+				{
+					auto it = m_values.find(name);
+					if (m_values.end() != it)
+					{
+						return it->second;
+					}
+
+					return nullptr != m_base ? m_base->get(name) : setting_value(empty_value());
+				}
+
+				virtual void set(const std::wstring& name, const setting_value& value) override
+				{
+					m_values[name] = value;
+				}
+
+			public:
+				trial_settings(const settings::ptr& base)
+					: m_base(base)
+				{
+				}
+			};
+
+			/////////////////////////////////////////////////////////////////////
+			// work_stealing_queue
+			// SB: owner takes tasks from the back, other workers steal from the front
+
+			class work_stealing_queue
+			{
+				win::critical_section m_cs;
+				std::deque<size_t> m_tasks;
+
+			public:
+				void push(size_t task)
+				{
+					win::scoped_lock lock(m_cs);
+					m_tasks.push_back(task);
+				}
+
+				bool pop(size_t* task)
+				{
+					win::scoped_lock lock(m_cs);
+					if (m_tasks.empty())
+					{
+						return false;
+					}
+
+					*task = m_tasks.back();
+					m_tasks.pop_back();
+
+					return true;
+				}
+
+				bool steal(size_t* task)
+				{
+					win::scoped_lock lock(m_cs);
+					if (m_tasks.empty())
+					{
+						return false;
+					}
+
+					*task = m_tasks.front();
+					m_tasks.pop_front();
+
+					return true;
+				}
+			};
+
+			// SB: runs task for each index in [0, count). Each worker starts with its own contiguous block of indices
+			// and steals from other workers when its block is done, so long trials don't leave cores idle.
+			// Tasks are never added after start, so when all queues are empty the work is done
+			void parallel_for(size_t count, size_t threads_count, const std::function<void(size_t)>& task)
+			{
+				threads_count = std::max<size_t>(1, std::min(threads_count, count));
+
+				std::vector<std::unique_ptr<work_stealing_queue>> queues;
+				for (size_t i = 0; i < threads_count; ++i)
+				{
+					queues.emplace_back(new work_stealing_queue());
+				}
+
+				// SB: owner pops from the back, so the block is pushed in reverse order to process it in index order
+				for (size_t i = count; i > 0; --i)
+				{
+					queues[(i - 1) * threads_count / count]->push(i - 1);
+				}
+
+				win::critical_section error_cs;
+				std::exception_ptr error;
+
+				auto worker = [&](size_t worker_index)
+				{
+					try
+					{
+						size_t index = 0;
+						for (;;)
+						{
+							bool found = queues[worker_index]->pop(&index);
+							for (size_t i = 1; i < threads_count && !found; ++i)
+							{
+								found = queues[(worker_index + i) % threads_count]->steal(&index);
+							}
+
+							if (!found)
+							{
+								break;
+							}
+
+							task(index);
+						}
+					}
+					catch (...)
+					{
+						win::scoped_lock lock(error_cs);
+						if (nullptr == error)
+						{
+							error = std::current_exception();
+						}
+					}
+				};
+
+				std::vector<std::thread> threads;
+				for (size_t i = 1; i < threads_count; ++i)
+				{
+					threads.emplace_back(worker, i);
+				}
+
+				worker(0);
+
+				for (auto& t : threads)
+				{
+					t.join();
+				}
+
+				if (nullptr != error)
+				{
+					std::rethrow_exception(error);
+				}
+			}
+
+			/////////////////////////////////////////////////////////////////////
+			// helpers
+
+			size_t get_grid_size(const std::vector<parameter>& parameters)
+			{
+				size_t result = 1;
+				for (const auto& p : parameters)
+				{
+					if (p.values.empty())
+					{
+						throw std::invalid_argument("Optimized parameter should have at least one value!");
+					}
+
+					if (result > std::numeric_limits<size_t>::max() / p.values.size())
+					{
+						throw std::invalid_argument("Parameters grid is too large!");
+					}
+
+					result *= p.values.size();
+				}
+
+				return result;
+			}
+
+			// SB: grid index is a mixed radix number, the last parameter changes first
+			std::vector<std::pair<std::wstring, setting_value>> get_grid_point(const std::vector<parameter>& parameters, size_t index)
+			{
+				std::vector<std::pair<std::wstring, setting_value>> result(parameters.size());
+				for (size_t i = parameters.size(); i > 0; --i)
+				{
+					const auto& p = parameters[i - 1];
+					result[i - 1] = std::make_pair(p.name, p.values[index % p.values.size()]);
+					index /= p.values.size();
+				}
+
+				return result;
+			}
+
+			std::vector<size_t> select_trials(size_t grid_size, const options& opts)
+			{
+				std::vector<size_t> result;
+				if (search_mode::grid == opts.mode || opts.random_trials >= grid_size)
+				{
+					result.resize(grid_size);
+					for (size_t i = 0; i < grid_size; ++i)
+					{
+						result[i] = i;
+					}
+
+					return result;
+				}
+
+				std::mt19937_64 generator(opts.random_seed);
+				std::uniform_int_distribution<unsigned long long> distribution(0, grid_size - 1);
+				std::unordered_set<size_t> selected;
+				while (result.size() < opts.random_trials)
+				{
+					const auto index = static_cast<size_t>(distribution(generator));
+					if (selected.insert(index).second)
+					{
+						result.push_back(index);
+					}
+				}
+
+				return result;
+			}
+
+			double get_score(objective target, double profit, double max_drawdown)
+			{
+				switch (target)
+				{
+				case objective::profit:
+					return profit;
+
+				case objective::profit_to_drawdown:
+					if (0.0 == max_drawdown)
+					{
+						return profit > 0.0 ? std::numeric_limits<double>::infinity() : 0.0;
+					}
+
+					return profit / max_drawdown;
+				}
+
+				throw std::invalid_argument("Unknown optimization objective!");
+			}
+
+			struct value_formatter : boost::static_visitor<std::wstring>
+			{
+				std::wstring operator()(const empty_value&) const
+				{
+					return std::wstring();
+				}
+
+				std::wstring operator()(int val) const
+				{
+					return std::to_wstring(val);
+				}
+
+				std::wstring operator()(double val) const
+				{
+					std::wostringstream stream;
+					stream << val;
+
+					return stream.str();
+				}
+
+				std::wstring operator()(bool val) const
+				{
+					return val ? L"true" : L"false";
+				}
+
+				std::wstring operator()(const std::wstring& val) const
+				{
+					return val;
+				}
+			};
+		}
+
+		parameter make_range(const std::wstring& name, int first, int last, int step)
+		{
+			if (step <= 0 || first > last)
+			{
+				throw std::invalid_argument("Invalid parameter range!");
+			}
+
+			parameter result;
+			result.name = name;
+			for (__int64 val = first; val <= last; val += step)
+			{
+				result.values.push_back(static_cast<int>(val));
+			}
+
+			return result;
+		}
+
+		parameter make_range(const std::wstring& name, double first, double last, double step)
+		{
+			if (!(step > 0.0) || first > last)
+			{
+				throw std::invalid_argument("Invalid parameter range!");
+			}
+
+			// SB: values are calculated from the first one to avoid accumulation of floating point error
+			const auto count = static_cast<size_t>(std::floor((last - first) / step + 1e-9)) + 1;
+
+			parameter result;
+			result.name = name;
+			for (size_t i = 0; i < count; ++i)
+			{
+				result.values.push_back(first + i * step);
+			}
+
+			return result;
+		}
+
+		std::vector<trial_result> run(const std::shared_ptr<const candle_series>& candles, const backtest::parameters& params, const settings::ptr& base_settings,
+			const std::vector<parameter>& parameters, const options& opts, const strategy_factory& create_strategy)
+		{
+			if (nullptr == candles)
+			{
+				throw std::invalid_argument("Candles are not specified!");
+			}
+
+			const auto trials = select_trials(get_grid_size(parameters), opts);
+
+			auto trial_params = params;
+			trial_params.record_equity = false;
+
+			// SB: each trial writes only its own slot, order of trials doesn't depend on scheduling
+			std::vector<trial_result> results(trials.size());
+			auto evaluate = [&](size_t index)
+			{
+				auto& result = results[index];
+				result.parameters = get_grid_point(parameters, trials[index]);
+
+				auto s = std::make_shared<trial_settings>(base_settings);
+				for (const auto& p : result.parameters)
+				{
+					s->set(p.first, p.second);
+				}
+
+				try
+				{
+					const auto backtest_result = backtest::run(*candles, trial_params, [&](const data_provider::ptr& dp, const connector::ptr& c, const trader::ptr& t)
+					{
+						return create_strategy(dp, c, t, s);
+					});
+
+					result.profit = backtest_result.final_balance - params.initial_balance;
+					result.max_drawdown = backtest_result.max_drawdown;
+					result.fills_count = backtest_result.fills.size();
+					result.rejected_orders = backtest_result.rejected_orders;
+					result.score = get_score(opts.target, result.profit, result.max_drawdown);
+				}
+				catch (const std::exception& e)
+				{
+					result.error = e.what();
+					result.score = -std::numeric_limits<double>::infinity();
+				}
+			};
+
+			const size_t threads_count = 0 != opts.threads_count ? opts.threads_count : std::max<size_t>(1, std::thread::hardware_concurrency());
+			parallel_for(trials.size(), threads_count, evaluate);
+
+			std::stable_sort(results.begin(), results.end(), [](const trial_result& lhs, const trial_result& rhs)
+			{
+				if (lhs.error.empty() != rhs.error.empty())
+				{
+					return lhs.error.empty();
+				}
+
+				return lhs.score > rhs.score;
+			});
+
+			return results;
+		}
+
+		std::wstring format_results(const std::vector<trial_result>& results, size_t max_rows)
+		{
+			const int width = 14;
+
+			std::wostringstream table;
+			table << std::left << std::setw(6) << L"#";
+			if (!results.empty())
+			{
+				for (const auto& p : results.front().parameters)
+				{
+					table << std::setw(width) << p.first;
+				}
+			}
+
+			table << std::setw(width) << L"Score" << std::setw(width) << L"Profit" << std::setw(width) << L"Drawdown" << std::setw(width) << L"Fills" << L"Rejected" << std::endl;
+
+			const auto rows = std::min(max_rows, results.size());
+			for (size_t i = 0; i < rows; ++i)
+			{
+				const auto& r = results[i];
+
+				table << std::setw(6) << i + 1;
+				for (const auto& p : r.parameters)
+				{
+					table << std::setw(width) << boost::apply_visitor(value_formatter(), p.second);
+				}
+
+				if (!r.error.empty())
+				{
+					table << L"failed: " << std::wstring(r.error.begin(), r.error.end()) << std::endl;
+					continue;
+				}
+
+				table << std::setw(width) << r.score << std::setw(width) << r.profit << std::setw(width) << r.max_drawdown << std::setw(width) << r.fills_count << r.rejected_orders << std::endl;
+			}
+
+			return table.str();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <core/primitives.h>
+
+#include <win/thread.h>
+
+#include <unordered_map>
+#include <deque>
+
+namespace tbp
+{
+	namespace
+	{
+		// SB: names are never removed, so ids and references to names stay valid for the process lifetime
+		class field_registry
+		{
+			win::critical_section m_cs;
+			std::unordered_map<std::wstring, unsigned long> m_ids;
+			std::deque<std::wstring> m_names;
+
+		public:
+			unsigned long intern(const std::wstring& name)
+			{
+				win::scoped_lock lock(m_cs);
+
+				auto it = m_ids.find(name);
+				if (m_ids.end() != it)
+				{
+					return it->second;
+				}
+
+				const auto id = static_cast<unsigned long>(m_names.size());
+				m_names.push_back(name);
+				m_ids.emplace(name, id);
+
+				return id;
+			}
+
+			const std::wstring& name(unsigned long id)
+			{
+				win::scoped_lock lock(m_cs);
+
+				return m_names.at(id);
+			}
+
+		public:
+			// SB: function local static, field_id constants are created during static initialization of other modules
+			static field_registry& instance()
+			{
+				static field_registry registry;
+				return registry;
+			}
+		};
+	}
+
+	/////////////////////////////////////////////////////////////////////
+	// field_id
+
+	unsigned long field_id::intern(const std::wstring& name)
+	{
+		return field_registry::instance().intern(name);
+	}
+
+	const std::wstring& field_id::name() const
+	{
+		return field_registry::instance().name(m_id);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <core/resampler.h>
+#include <core/kernels.h>
+
+#include <chrono>
+#include <stdexcept>
+
+namespace tbp
+{
+	namespace resampler
+	{
+		namespace
+		{
+			const unsigned long c_day_granularity = 24 * 60 * 60;
+
+			void resample_prices(const candle_series::prices& src, const std::vector<size_t>& offsets, candle_series::prices* dst)
+			{
+				const size_t count = offsets.size() - 1;
+				dst->open.resize(count);
+				dst->close.resize(count);
+				dst->high.resize(count);
+				dst->low.resize(count);
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					dst->open[i] = src.open[offsets[i]];
+					dst->close[i] = src.close[offsets[i + 1] - 1];
+				}
+
+				kernels::segment_max(src.high.data(), offsets.data(), count, dst->high.data());
+				kernels::segment_min(src.low.data(), offsets.data(), count, dst->low.data());
+			}
+		}
+
+		bool can_resample(unsigned long source_granularity, unsigned long target_granularity)
+		{
+			return 0 != source_granularity && source_granularity < target_granularity && 0 == target_granularity % source_granularity && target_granularity < c_day_granularity && 0 == c_day_granularity % target_granularity;
+		}
+
+		candle_series resample(const candle_series& candles, unsigned long source_granularity, unsigned long target_granularity)
+		{
+			if (!can_resample(source_granularity, target_granularity))
+			{
+				throw std::invalid_argument("Candles can't be resampled to requested granularity!");
+			}
+
+			candle_series result;
+			if (candles.empty())
+			{
+				return result;
+			}
+
+			// SB: offsets of the first source candle of each target candle, the last offset is the end of source candles
+			const auto target_duration = std::chrono::duration_cast<time_t::duration>(std::chrono::seconds(target_granularity));
+			std::vector<size_t> offsets;
+			offsets.reserve(candles.size() / (target_granularity / source_granularity) + 2);
+			for (size_t i = 0; i < candles.size(); ++i)
+			{
+				if (0 != i && candles.timestamp[i] <= candles.timestamp[i - 1])
+				{
+					throw std::invalid_argument("Candles should be sorted by timestamp!");
+				}
+
+				const auto bucket = candles.timestamp[i].time_since_epoch() / target_duration;
+				if (0 == i || bucket != candles.timestamp[i - 1].time_since_epoch() / target_duration)
+				{
+					offsets.push_back(i);
+					result.timestamp.push_back(time_t(bucket * target_duration));
+				}
+			}
+
+			offsets.push_back(candles.size());
+
+			const size_t count = offsets.size() - 1;
+			result.volume.resize(count);
+			result.complete.resize(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				__int64 volume = 0;
+				byte_t complete = 1;
+				for (size_t j = offsets[i]; j < offsets[i + 1]; ++j)
+				{
+					volume += candles.volume[j];
+					if (0 == candles.complete[j])
+					{
+						complete = 0;
+					}
+				}
+
+				result.volume[i] = volume;
+				result.complete[i] = complete;
+			}
+
+			const auto source_end = candles.timestamp.back() + std::chrono::duration_cast<time_t::duration>(std::chrono::seconds(source_granularity));
+			if (source_end < result.timestamp.back() + target_duration)
+			{
+				result.complete.back() = 0;
+			}
+
+			resample_prices(candles.bid, offsets, &result.bid);
+			resample_prices(candles.ask, offsets, &result.ask);
+
+			return result;
+		}
+	}
+}
\ No newline at end of file
@@ -20,6 +20,12 @@ namespace tbp
 		public:
 			virtual setting_value get(const std::wstring& name) override
 			{
+				// SB: missing setting is empty value, so get_value with default value can be used for optional settings
+				if (!m_settings.has_field(name))
+				{
+					return empty_value();
+				}
+
 				auto value = m_settings.at(name);
 				switch (value.type())
 				{
@@ -5,9 +5,6 @@
 
 #include <boost/numeric/conversion/cast.hpp>
 
-#include <queue>
-#include <deque>
-
 namespace tbp
 {
 	namespace
@@ -20,10 +17,11 @@ namespace tbp
 			const data_provider::ptr m_data_provider;
 			const connector::ptr m_connector;
 			const trader::ptr m_trader;
+			const double m_risk_divisor;
+			const double m_threshold_factor;
 			double m_margin_rate;
-			std::deque<candlestick_data> m_trade_frame;
-			std::deque<double> m_fast_ema_frame;
-			std::deque<double> m_slow_ema_frame;
+			analysis::ema_state m_fast_ema;
+			analysis::ema_state m_slow_ema;
 			std::wstring m_opened_trade_id;
 			boost::signals2::connection m_historical_data_connection;
 
@@ -31,16 +29,6 @@ namespace tbp
 			bool m_waiting_for_threshold;
 
 		private:
-			void calculate_fast_ema(const std::vector<double>& values)
-			{
-				analysis::calculate_ema(values, &m_fast_ema_frame, 9);
-			}
-
-			void calculate_slow_ema(const std::vector<double>& values)
-			{
-				analysis::calculate_ema(values, &m_slow_ema_frame, 26);
-			}
-
 			double margin_rate()
 			{
 				if (0.0 != m_margin_rate)
@@ -57,89 +45,41 @@ namespace tbp
 			{
 				tbp::time_t end_time(align_to_granularity<tbp::time_t::duration>(tbp::time_t::clock::now(), m_data_granularity));
 				auto start_time = end_time - m_trend_interval;
-				auto historical_data = m_data_provider->get_data(m_working_instrument, boost::numeric_cast<unsigned long>(m_data_granularity.count()), &start_time, &end_time);
-				auto candles = m_trader->get_candles_from_data(historical_data);
-				m_trade_frame.assign(candles.begin(), candles.end());
-
-				std::vector<double> ask_values;
-				ask_values.reserve(m_trade_frame.size());
-				for (const auto& candle : m_trade_frame)
-				{
-					ask_values.push_back(candle.ask.close);
-				}
+				auto candles = m_data_provider->get_candles(m_working_instrument, boost::numeric_cast<unsigned long>(m_data_granularity.count()), &start_time, &end_time);
 
-				calculate_fast_ema(ask_values);
-				calculate_slow_ema(ask_values);
+				// SB: EMA states keep only the running values, so there is no need to keep the whole trade frame in memory
+				m_fast_ema.seed(candles.ask.close);
+				m_slow_ema.seed(candles.ask.close);
 			}
 
-			void on_historical_data(const std::wstring& instrument_id, const std::vector<data_t::ptr>& data)
+			void on_historical_candles(const std::wstring& instrument_id, const candle_series& candles)
 			{
-				auto candles = m_trader->get_candles_from_data(data);
 				if (candles.size() >= 2)
 				{
 					LOG_INFO << __FUNCTIONW__ << L" Arrived candles count is: " << candles.size();
-
-					// SB: can happen f.e. if request failed several times
-					while(candles.size() >= 2)
-					{
-						auto candle = candles.back();
-						if (candle.complete)
-						{
-							candles.assign(1, candle);
-						}
-
-						candles.pop_back();
-					}
 				}
 
-				m_trade_frame.pop_front();
-				m_trade_frame.insert(m_trade_frame.end(), candles.begin(), candles.end());
-
-				std::vector<double> ask_values;
-				ask_values.reserve(m_trade_frame.size());
-				for (const auto& candle : m_trade_frame)
+				// SB: can happen f.e. if request failed several times. Each complete candle updates EMA in O(1)
+				size_t last_candle = candles.size();
+				for (size_t i = 0; i < candles.size(); ++i)
 				{
-					ask_values.push_back(candle.ask.close);
-				}
-
-				// SB: remove the oldest EMA values
-				m_fast_ema_frame.pop_front();
-				m_slow_ema_frame.pop_front();
+					if (0 == candles.complete[i])
+					{
+						continue;
+					}
 
-				calculate_fast_ema(ask_values);
-				calculate_slow_ema(ask_values);
+					const auto fast_prev_val = m_fast_ema.value();
+					const auto slow_prev_val = m_slow_ema.value();
+					const bool was_ready = m_slow_ema.ready();
 
-				// SB: try to find latest crossing
-				//for (auto i = m_fast_ema_frame.size() - 1; i >= m_fast_ema_frame.size() - candles.size() - 1; --i)
-				{
-					auto i = m_fast_ema_frame.size() - 1;
-					auto fast_val = m_fast_ema_frame[i];
-					auto fast_prev_val = m_fast_ema_frame[i - 1];
+					const auto fast_val = m_fast_ema.update(candles.ask.close[i]);
+					const auto slow_val = m_slow_ema.update(candles.ask.close[i]);
+					last_candle = i;
 
-					auto slow_val = m_slow_ema_frame[i];
-					auto slow_prev_val = m_slow_ema_frame[i - 1];
-
-					auto open_trade = [&](bool sell) 
+					if (!was_ready)
 					{
-						if (!m_opened_trade_id.empty())
-						{
-							m_trader->close_trade(m_opened_trade_id, 0.0);
-							m_opened_trade_id.clear();
-						}
-
-						auto available_money = m_connector->available_balance();
-						auto margin = margin_rate();
-						double trade_amount = long(available_money / margin / 2.0); // SB: <- 2.0 should be replaced with value from settings, which specifies risk level
-						
-						if (sell)
-						{
-							trade_amount *= -1.0;
-						}
-
-						LOG_DBG << L"EMA strategy" << (sell ? L" Sell " : L" Buy ") << trade_amount << L" " + m_working_instrument;
-
-						m_opened_trade_id = m_trader->open_trade(m_working_instrument, trade_amount);
-					};
+						continue;
+					}
 
 					if (fast_prev_val <= slow_prev_val && fast_val > slow_val)
 					{
@@ -155,18 +95,45 @@ namespace tbp
 
 						LOG_DBG << L"EMA crossing detected. Falling. Cross value: " << m_cross_value;
 					}
+				}
 
-					const double threshold_value = abs(candles.back().ask.close - candles.back().bid.close) / 2.0;
-					const double curr_diff = fast_val - m_cross_value;
-					if (m_waiting_for_threshold && abs(curr_diff) >= threshold_value)
-					{
-						m_waiting_for_threshold = false;
+				if (candles.size() == last_candle || !m_slow_ema.ready())
+				{
+					return;
+				}
 
-						LOG_DBG << L"Threshold reached. Threshold value is: " << threshold_value;
+				auto open_trade = [&](bool sell) 
+				{
+					if (!m_opened_trade_id.empty())
+					{
+						m_trader->close_trade(m_opened_trade_id, 0.0);
+						m_opened_trade_id.clear();
+					}
 
-						// SB: open trade
-						open_trade(curr_diff < 0.0);
+					auto available_money = m_connector->available_balance();
+					auto margin = margin_rate();
+					double trade_amount = long(available_money / margin / m_risk_divisor);
+					
+					if (sell)
+					{
+						trade_amount *= -1.0;
 					}
+
+					LOG_DBG << L"EMA strategy" << (sell ? L" Sell " : L" Buy ") << trade_amount << L" " + m_working_instrument;
+
+					m_opened_trade_id = m_trader->open_trade(m_working_instrument, trade_amount);
+				};
+
+				const double threshold_value = abs(candles.ask.close[last_candle] - candles.bid.close[last_candle]) * m_threshold_factor;
+				const double curr_diff = m_fast_ema.value() - m_cross_value;
+				if (m_waiting_for_threshold && abs(curr_diff) >= threshold_value)
+				{
+					m_waiting_for_threshold = false;
+
+					LOG_DBG << L"Threshold reached. Threshold value is: " << threshold_value;
+
+					// SB: open trade
+					open_trade(curr_diff < 0.0);
 				}
 			}
 
@@ -178,11 +145,20 @@ namespace tbp
 				, m_data_provider(dp)
 				, m_connector(c)
 				, m_trader(t)
+				, m_risk_divisor(tbp::get_value<double>(s, L"RiskDivisor", 2.0))
+				, m_threshold_factor(tbp::get_value<double>(s, L"ThresholdFactor", 0.5))
 				, m_margin_rate(0.0)
-				, m_historical_data_connection(m_data_provider->on_historical_data.connect(std::bind(&ema_strategy_impl::on_historical_data, this, std::placeholders::_1, std::placeholders::_2)))
+				, m_fast_ema(boost::numeric_cast<unsigned long>(tbp::get_value<int>(s, L"FastEMA", 9)))
+				, m_slow_ema(boost::numeric_cast<unsigned long>(tbp::get_value<int>(s, L"SlowEMA", 26)))
+				, m_historical_data_connection(m_data_provider->on_historical_candles.connect(std::bind(&ema_strategy_impl::on_historical_candles, this, std::placeholders::_1, std::placeholders::_2)))
 				, m_cross_value(0.0)
 				, m_waiting_for_threshold(false)
 			{
+				if (m_risk_divisor <= 0.0)
+				{
+					throw std::invalid_argument("RiskDivisor should be positive!");
+				}
+
 				init_historical_data();
 			}
 
@@ -1,8 +1,13 @@
 #pragma once
 
 #include <core/data_storage.h>
+#include <oanda/storage_vacuum.h>
+#include <oanda/tick_archive.h>
 #include <sqlite/sqlite.h>
 
+#include <chrono>
+#include <memory>
+
 namespace tbp
 {
 	namespace oanda
@@ -11,34 +16,41 @@ namespace tbp
 		{
 			namespace instrument_data
 			{
-				extern const std::wstring c_timestamp;
-				extern const std::wstring c_volume;
-				extern const std::wstring c_bid_candlestick;
-				extern const std::wstring c_ask_candlestick;
-				extern const std::wstring c_complete;
+				extern const tbp::field_id c_timestamp;
+				extern const tbp::field_id c_volume;
+				extern const tbp::field_id c_bid_candlestick;
+				extern const tbp::field_id c_ask_candlestick;
+				extern const tbp::field_id c_complete;
 			}
 
 			namespace instant_data
 			{
-				extern const std::wstring c_bid_price;
-				extern const std::wstring c_ask_price;
+				extern const tbp::field_id c_bid_price;
+				extern const tbp::field_id c_ask_price;
 			}
 
 			namespace candlestick_data
 			{
-				extern const std::wstring c_open_price;
-				extern const std::wstring c_high_price;
-				extern const std::wstring c_low_price;
-				extern const std::wstring c_close_price;
+				extern const tbp::field_id c_open_price;
+				extern const tbp::field_id c_high_price;
+				extern const tbp::field_id c_low_price;
+				extern const tbp::field_id c_close_price;
 			}
 		}
 
 		class data_storage : public tbp::data_storage
 		{
 			const sqlite::connection::ptr m_db;
+			const sqlite::connection_pool::ptr m_pool;
+			std::unique_ptr<tick_compactor> m_compactor;
+			std::unique_ptr<storage_vacuum> m_vacuum;
 
 		private:
 			void create_db_schema();
+			void migrate_db_schema_v1();
+			void migrate_db_schema_v2();
+			void migrate_db_schema_v3();
+			void migrate_db_schema_v4();
 			void verify_db_schema();
 
 			__int64 get_instrument_row_id(const std::wstring& instrument_id);
@@ -48,9 +60,35 @@ namespace tbp
 			virtual std::vector<data_t::ptr> get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const override;
 			virtual void save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<data_t::ptr>& data) override;
 			virtual void save_instant_data(const std::wstring& instrument_id, const std::vector<data_t::ptr>& data) override;
+			virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override;
+			virtual fixed_candle_series get_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, time_t* start_datetime, time_t* end_datetime) const override;
+			virtual void save_candles(const std::wstring& instrument_id, unsigned long granularity, const candle_series& candles) override;
+
+			// SB: chunks read the DB by themselves, so they may outlive the storage
+			virtual data_chunks scan(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, size_t chunk_size = default_scan_chunk_size) const override;
+
+			// SB: saves are committed by one transaction, their own transactions become savepoints
+			virtual void save_batch(const std::function<void()>& save) override;
+
+			virtual bool get_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime, std::vector<time_range>* result) const override;
+			virtual void add_coverage(const std::wstring& instrument_id, unsigned long granularity, time_t start_datetime, time_t end_datetime) override;
 
 		public:
+			// SB: instant data older than 'age' is moved to compressed archive in background, reads return archived data as well.
+			// Days of instant data older than 'retention' are removed, zero 'age' or 'retention' disables the corresponding step.
+			// Archiving uses its own connection 'db' to the same DB file
+			void start_archiving(const sqlite::connection::ptr& db, std::chrono::seconds age, std::chrono::seconds retention, std::chrono::milliseconds interval);
+
+			// SB: free pages of DB file are released in background by its own connection 'db'. DB which was created before incremental
+			// vacuum was supported is rebuilt once by the background thread before the first run
+			void start_vacuum(const sqlite::connection::ptr& db, std::chrono::milliseconds interval);
+
+		public:
+			// SB: all reads and writes use 'db' connection
 			data_storage(const sqlite::connection::ptr& db);
+
+			// SB: writes use writer connection of the pool, reads use pooled readers
+			data_storage(const sqlite::connection_pool::ptr& pool);
 		};
 	}
 }
\ No newline at end of file
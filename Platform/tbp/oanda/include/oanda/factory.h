@@ -15,10 +15,15 @@ namespace tbp
 			const std::wstring m_working_dir;
 			const settings::ptr m_connector_settings;
 
+		private:
+			// SB: storage without async writer and cache layers
+			tbp::data_storage::ptr open_storage(bool archiving);
+
 		public:
 			virtual tbp::authentication::ptr create_auth() override;
 			virtual tbp::connector::ptr create_connector(const authentication::ptr& auth) override;
 			virtual tbp::data_storage::ptr create_storage() override;
+			virtual tbp::data_storage::ptr create_bulk_storage() override;
 			virtual tbp::trader::ptr create_trader(const tbp::connector::ptr& c) override;
 
 		public:
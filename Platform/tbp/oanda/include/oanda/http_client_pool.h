@@ -0,0 +1,65 @@
+#pragma once
+
+#include <common/constrains.h>
+
+#include <cpprest/http_client.h>
+
+#include <chrono>
+#include <memory>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		struct http_client_pool_stats
+		{
+			size_t checkouts = 0;
+
+			// SB: new client was created, so its request paid connection setup and TLS handshake
+			size_t connects = 0;
+
+			// SB: idle client was reused together with its keep-alive connection
+			size_t reuses = 0;
+
+			// SB: idle clients which were closed by idle timeout
+			size_t expirations = 0;
+
+			// SB: all clients of the host were in use, so checkout waited for one of them
+			size_t waits = 0;
+			size_t clients = 0;
+			size_t idle_clients = 0;
+			size_t max_connections = 0;
+		};
+
+		class http_client_pool_state;
+
+		/////////////////////////////////////////////////////////////////////
+		// http_client_pool
+		// SB: keeps up to 'max_connections' http clients per host (scheme, host and port of URI). Each client keeps its connection alive
+		// between requests, so only the first request of the client pays connection setup and TLS handshake. Client returns to the pool
+		// when the last reference to it is released, it shouldn't be kept longer than the request. Clients which were idle longer than
+		// 'idle_timeout' are closed on the next checkout, since server drops such connections anyway
+
+		class http_client_pool : sb::noncopyable
+		{
+		public:
+			using ptr = std::shared_ptr<http_client_pool>;
+			using client_ptr = std::shared_ptr<web::http::client::http_client>;
+
+			static const size_t default_max_connections = 4;
+			static const std::chrono::seconds default_idle_timeout;
+
+		private:
+			const std::shared_ptr<http_client_pool_state> m_state;
+
+		public:
+			// SB: client's base URI is authority of 'uri', so request should use resource of 'uri'. Waits if all clients of the host are in use
+			client_ptr checkout(const web::uri& uri) const;
+			http_client_pool_stats stats() const;
+
+		public:
+			http_client_pool(size_t max_connections = default_max_connections, std::chrono::milliseconds idle_timeout = default_idle_timeout,
+				const web::http::client::http_client_config& config = web::http::client::http_client_config());
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <core/data_storage.h>
+#include <win/thread.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		namespace mapped
+		{
+			// SB: records are written to files as is, so layout of these structures is a part of file format.
+			// Timestamp is time_t::duration count, the same value as SQLite storage keeps
+
+			struct candle_record
+			{
+				__int64 timestamp;
+				__int64 volume;
+				double bid_open;
+				double bid_high;
+				double bid_low;
+				double bid_close;
+				double ask_open;
+				double ask_high;
+				double ask_low;
+				double ask_close;
+			};
+
+			struct tick_record
+			{
+				__int64 timestamp;
+				double bid;
+				double ask;
+			};
+
+			/////////////////////////////////////////////////////////////////////
+			// view
+			// SB: records of mapped file without copying. View keeps the file region mapped,
+			// so it stays valid after storage is destroyed or new records are appended to the file
+
+			template <typename record_t>
+			class view
+			{
+				std::shared_ptr<const void> m_region;
+				const record_t* m_first;
+				size_t m_size;
+
+			public:
+				const record_t* begin() const
+				{
+					return m_first;
+				}
+
+				const record_t* end() const
+				{
+					return m_first + m_size;
+				}
+
+				const record_t& operator[](size_t index) const
+				{
+					return m_first[index];
+				}
+
+				size_t size() const
+				{
+					return m_size;
+				}
+
+				bool empty() const
+				{
+					return 0 == m_size;
+				}
+
+			public:
+				view()
+					: m_first(nullptr)
+					, m_size(0)
+				{
+				}
+
+				view(const std::shared_ptr<const void>& region, const record_t* first, size_t size)
+					: m_region(region)
+					, m_first(first)
+					, m_size(size)
+				{
+				}
+			};
+
+			using candle_view = view<candle_record>;
+			using tick_view = view<tick_record>;
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// mapped_storage
+		// SB: alternative to SQLite storage for research workloads which read the same history over and over.
+		// Each instrument / granularity is kept in its own append-only file of fixed size records sorted by timestamp,
+		// readers map the file and find range ends by binary search. Records which are older than the last stored one
+		// can't be inserted or updated, they are skipped. Incomplete candles are not stored
+
+		class mapped_storage : public tbp::data_storage
+		{
+			class file;
+			using file_ptr = std::shared_ptr<file>;
+
+		private:
+			const std::wstring m_path;
+			mutable win::critical_section m_files_cs;
+			mutable std::map<std::wstring, file_ptr> m_files;
+
+		private:
+			// SB: returns nullptr if file doesn't exist and it shouldn't be created
+			file_ptr get_file(const std::wstring& file_name, unsigned long record_type, unsigned long granularity, bool create) const;
+
+		public:
+			mapped::candle_view get_candle_view(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const;
+			mapped::tick_view get_tick_view(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const;
+
+		public:
+			virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override;
+			virtual std::vector<data_t::ptr> get_instant_data(const std::wstring& instrument_id, time_t* start_datetime, time_t* end_datetime) const override;
+			virtual void save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<data_t::ptr>& data) override;
+			virtual void save_instant_data(const std::wstring& instrument_id, const std::vector<data_t::ptr>& data) override;
+			virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start_datetime, time_t* end_datetime) const override;
+			virtual fixed_candle_series get_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, time_t* start_datetime, time_t* end_datetime) const override;
+			virtual void save_candles(const std::wstring& instrument_id, unsigned long granularity, const candle_series& candles) override;
+
+		public:
+			mapped_storage(const std::wstring& path);
+		};
+	}
+}
\ No newline at end of file
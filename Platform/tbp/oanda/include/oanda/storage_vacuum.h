@@ -0,0 +1,44 @@
+#pragma once
+
+#include <sqlite/sqlite.h>
+#include <win/thread.h>
+
+#include <chrono>
+#include <thread>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		namespace vacuum
+		{
+			// SB: switches DB to incremental auto vacuum mode. DB which was created in another mode is rebuilt once, it takes a while for big DB
+			void enable(const sqlite::connection::ptr& db);
+
+			// SB: returns at most 'pages' free pages to file system by one transaction, returns amount of released pages
+			size_t step(const sqlite::connection::ptr& db, size_t pages);
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// storage_vacuum
+		// SB: deleted rows and dropped tables leave free pages in DB file, f.e. after migration of version 1 tables or compaction of ticks.
+		// Inserts reuse them, but the file never shrinks by itself. Vacuum releases free pages periodically by short steps, so writes
+		// of data storage don't wait for the whole run. It should use its own connection to DB file.
+		// DB which isn't in incremental auto vacuum mode is rebuilt by the first run
+
+		class storage_vacuum
+		{
+			const sqlite::connection::ptr m_db;
+			const unsigned long m_interval;
+			win::event m_stop_evt;
+			std::thread m_worker;
+
+		private:
+			void vacuum_thread();
+
+		public:
+			storage_vacuum(const sqlite::connection::ptr& db, std::chrono::milliseconds interval);
+			~storage_vacuum();
+		};
+	}
+}
\ No newline at end of file
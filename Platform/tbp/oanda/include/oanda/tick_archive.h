@@ -0,0 +1,86 @@
+#pragma once
+
+#include <core/primitives.h>
+#include <sqlite/sqlite.h>
+#include <win/thread.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		namespace archive
+		{
+			struct tick
+			{
+				__int64 timestamp;
+				double bid;
+				double ask;
+			};
+
+			// SB: block is a sorted sequence of ticks compressed by zlib after delta encoding. Timestamps are stored as delta-of-delta.
+			// Prices which are decimal quotes are stored as deltas of integer quotes (ask as delta of spread), other prices as XOR of bits.
+			// Encoding is lossless, decoded doubles are bit exact
+			binary_t encode_block(const std::vector<tick>& ticks);
+
+			// SB: decoded ticks are appended to 'result'
+			void decode_block(const byte_t* data, size_t size, std::vector<tick>* result);
+			void decode_block(const binary_t& block, std::vector<tick>* result);
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// tick_archive
+		// SB: cold storage for instant data. Ticks of one instrument and one hour are kept in one compressed block of INSTANT_DATA_ARCHIVE table,
+		// blocks are decoded on demand. Compaction moves aged rows from day partitions to blocks, each hour in its own transaction.
+		// Ticks which arrive for already archived hour are merged into its block by the next compaction
+
+		class tick_archive
+		{
+			const sqlite::connection::ptr m_db;
+
+		public:
+			// SB: the table is a part of data storage DB schema, it's created by schema creation / migration
+			static void create_table(const sqlite::connection::ptr& db);
+
+		public:
+			// SB: appends ticks from [start_datetime, end_datetime] range
+			void read(const std::wstring& instrument_id, time_t start_datetime, time_t end_datetime, std::vector<archive::tick>* result) const;
+
+			// SB: archives complete hours older than 'cutoff', returns amount of moved ticks. Partitions of days which are archived completely are dropped
+			size_t compact(time_t cutoff);
+
+			// SB: removes partitions and blocks of days which end before 'cutoff', returns amount of removed partitions
+			size_t expire(time_t cutoff);
+
+		public:
+			tick_archive(const sqlite::connection::ptr& db);
+		};
+
+		/////////////////////////////////////////////////////////////////////
+		// tick_compactor
+		// SB: runs compaction of ticks which are older than 'age' and removal of ticks which are older than 'retention' periodically,
+		// zero value disables the corresponding step. It should use its own connection to DB file, so its transactions don't interleave
+		// with transactions of data storage
+
+		class tick_compactor
+		{
+			tick_archive m_archive;
+			const std::chrono::seconds m_age;
+			const std::chrono::seconds m_retention;
+			const unsigned long m_interval;
+			win::event m_stop_evt;
+			std::thread m_worker;
+
+		private:
+			void compactor_thread();
+
+		public:
+			tick_compactor(const sqlite::connection::ptr& db, std::chrono::seconds age, std::chrono::seconds retention, std::chrono::milliseconds interval);
+			~tick_compactor();
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <core/primitives.h>
+#include <sqlite/sqlite.h>
+
+#include <string>
+#include <vector>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		/////////////////////////////////////////////////////////////////////
+		// tick_partitions
+		// SB: instant data of each UTC day is kept in its own INSTANT_INSTRUMENT_DATA_<day> table, where day is the number of days since epoch.
+		// INSTANT_DATA_PARTITIONS table lists days of existing tables. Index of each table is never bigger than one day of ticks,
+		// so insert doesn't slow down while data is collected, and old days are removed by dropping their tables instead of deleting rows
+
+		class tick_partitions
+		{
+			const sqlite::connection::ptr m_db;
+
+		public:
+			// SB: the table is a part of data storage DB schema, it's created by schema creation / migration
+			static void create_table(const sqlite::connection::ptr& db);
+
+			static __int64 get_day(__int64 timestamp);
+			static __int64 get_day_start(__int64 day);
+			static std::wstring get_table_name(__int64 day);
+
+		public:
+			// SB: days of partitions which overlap [start_timestamp, end_timestamp] range in ascending order
+			std::vector<__int64> find(__int64 start_timestamp, __int64 end_timestamp) const;
+			bool exists(__int64 day) const;
+
+			// SB: creates partition of the day if it doesn't exist yet, returns its table name
+			std::wstring create(__int64 day);
+
+			// SB: if 'only_empty' is set partition which still has ticks isn't dropped. Returns true if partition has been dropped
+			bool drop(__int64 day, bool only_empty);
+
+		public:
+			tick_partitions(const sqlite::connection::ptr& db);
+		};
+	}
+}
\ No newline at end of file
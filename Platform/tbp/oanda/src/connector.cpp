@@ -1,5 +1,6 @@
 #include <oanda/connector.h>
 #include <oanda/data_storage.h>
+#include <oanda/http_client_pool.h>
 
 #include <win/exception.h>
 
@@ -177,7 +178,7 @@ namespace tbp
 					{
 						for (const auto& it : val)
 						{
-							result[it.first] = it.second.apply_visitor(value_visitor());
+							result[it.first.name()] = it.second.apply_visitor(value_visitor());
 						}
 
 						return result;
@@ -417,6 +418,25 @@ namespace tbp
 				}
 			};
 
+			http_client_pool::ptr create_http_client_pool(const settings::ptr& settings)
+			{
+				// SB: requests to one host which are executed at the same time, each of them keeps its own connection
+				const auto max_connections = get_value<int>(settings, L"HttpMaxConnections", static_cast<int>(http_client_pool::default_max_connections));
+				if (max_connections <= 0)
+				{
+					throw std::invalid_argument("HttpMaxConnections should be positive!");
+				}
+
+				// SB: seconds after which idle connection isn't reused anymore
+				const auto idle_timeout = get_value<int>(settings, L"HttpIdleTimeout", static_cast<int>(http_client_pool::default_idle_timeout.count()));
+				if (idle_timeout < 0)
+				{
+					throw std::invalid_argument("HttpIdleTimeout shouldn't be negative!");
+				}
+
+				return std::make_shared<http_client_pool>(static_cast<size_t>(max_connections), std::chrono::seconds(idle_timeout));
+			}
+
 			/////////////////////////////////////////////////////////////////////
 			// service_client
 
@@ -428,6 +448,7 @@ namespace tbp
 				const std::wstring token;
 				const std::wstring account_id;
 				const std::shared_ptr<service_schema> schema;
+				const http_client_pool::ptr clients;
 
 			public:
 				web::http::http_request create_request(web::http::method m, const web::json::value& body)
@@ -450,15 +471,17 @@ namespace tbp
 				{
 					try
 					{
-						// Create http_client to send the request.
-						web::http::client::http_client client(url);
+						// SB: client of the host keeps its connection alive, so the request doesn't pay connection setup and TLS handshake again
+						const web::uri uri(url);
+						const auto client = clients->checkout(uri);
 						auto request = create_request(method, body);
+						request.set_request_uri(uri.resource());
 
 						web::json::value json_response;
 						std::exception_ptr exception;
 
 						// Handle response headers arriving.
-						auto requestTask = client.request(request).then([&](web::http::http_response response)
+						auto requestTask = client->request(request).then([&](web::http::http_response response)
 						{
 							if (HTTP_STATUS_BAD_REQUEST <= response.status_code())
 							{
@@ -494,10 +517,11 @@ namespace tbp
 				}
 
 			public:
-				service_client(const std::wstring& token, const std::wstring& account_id, const std::shared_ptr<service_schema>& schema)
+				service_client(const std::wstring& token, const std::wstring& account_id, const std::shared_ptr<service_schema>& schema, const http_client_pool::ptr& clients)
 					: token(token)
 					, account_id(account_id)
 					, schema(schema)
+					, clients(clients)
 				{
 				}
 			};
@@ -669,6 +693,7 @@ namespace tbp
 				static tbp::data_t parse_candle_object(const web::json::object& candle_data)
 				{
 					tbp::data_t result;
+					result.reserve(4);
 
 					result.insert({ values::candlestick_data::c_close_price, tbp::value_t(to_double(candle_data.at(L"c").as_string())) });
 					result.insert({ values::candlestick_data::c_high_price, tbp::value_t(to_double(candle_data.at(L"h").as_string())) });
@@ -684,12 +709,46 @@ namespace tbp
 					return to_time(time_str);
 				}
 
-			public:
-				virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start, time_t* end) const override
+				template <typename prices_t, typename parse_price_t>
+				static void parse_candle_object(const web::json::object& candle_data, prices_t* prices, const parse_price_t& parse_price)
+				{
+					prices->open.push_back(parse_price(candle_data.at(L"o").as_string()));
+					prices->high.push_back(parse_price(candle_data.at(L"h").as_string()));
+					prices->low.push_back(parse_price(candle_data.at(L"l").as_string()));
+					prices->close.push_back(parse_price(candle_data.at(L"c").as_string()));
+				}
+
+				template <typename series_t, typename parse_price_t>
+				static series_t parse_candles(const web::json::value& json_responce, const parse_price_t& parse_price)
+				{
+					series_t result;
+					const auto& candles_arr = json_responce.as_object().at(L"candles").as_array();
+					result.reserve(candles_arr.size());
+					for (const auto& candle_data : candles_arr)
+					{
+						const auto& candle_obj = candle_data.as_object();
+						result.timestamp.push_back(parse_time(candle_obj.at(L"time")));
+						result.volume.push_back(static_cast<__int64>(candle_obj.at(L"volume").as_integer()));
+						parse_candle_object(candle_obj.at(L"bid").as_object(), &result.bid, parse_price);
+						parse_candle_object(candle_obj.at(L"ask").as_object(), &result.ask, parse_price);
+						result.complete.push_back(candle_obj.at(L"complete").as_bool() ? 1 : 0);
+					}
+
+					return result;
+				}
+
+				web::json::value request_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start, time_t* end) const
 				{
 					auto url = nullptr != end ? m_service->schema->get_historical_prices_url(instrument_id, granularity_to_str(granularity), *start, *end) :
 						m_service->schema->get_historical_prices_url(instrument_id, granularity_to_str(granularity), *start);
-					auto json_responce = execute_request(web::http::methods::GET, url);
+
+					return execute_request(web::http::methods::GET, url);
+				}
+
+			public:
+				virtual std::vector<data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, time_t* start, time_t* end) const override
+				{
+					auto json_responce = request_candles(instrument_id, granularity, start, end);
 
 					std::vector<data_t::ptr> result;
 					{
@@ -697,6 +756,7 @@ namespace tbp
 						for (const auto& candle_data : candles_arr)
 						{
 							tbp::data_t candle_info;
+							candle_info.reserve(5);
 							const auto& candle_obj = candle_data.as_object();
 							candle_info.insert({ values::instrument_data::c_timestamp, parse_time(candle_obj.at(L"time")) });
 							candle_info.insert({ values::instrument_data::c_volume, static_cast<__int64>(candle_obj.at(L"volume").as_integer()) });
@@ -711,6 +771,17 @@ namespace tbp
 					return result;
 				}
 
+				virtual candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, time_t* start, time_t* end) const override
+				{
+					return parse_candles<candle_series>(request_candles(instrument_id, granularity, start, end), [](const std::wstring& price) { return to_double(price); });
+				}
+
+				// SB: prices are parsed from strings exactly, without intermediate double
+				virtual fixed_candle_series get_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, time_t* start, time_t* end) const override
+				{
+					return parse_candles<fixed_candle_series>(request_candles(instrument_id, granularity, start, end), [precision](const std::wstring& price) { return parse_fixed(price, precision); });
+				}
+
 			public:
 				virtual std::vector<std::wstring> get_instruments() const override
 				{
@@ -835,14 +906,16 @@ namespace tbp
 
 			public:
 				connector_impl(const settings::ptr& settings, const authentication::ptr& auth)
-					: m_service(std::make_shared<service_client>(auth->get_token(), get_value<std::wstring>(settings, L"account_id"), std::make_shared<service_schema>(get_value<std::wstring>(settings, L"url"), L"v3")))
+					: m_service(std::make_shared<service_client>(auth->get_token(), get_value<std::wstring>(settings, L"account_id"), std::make_shared<service_schema>(get_value<std::wstring>(settings, L"url"), L"v3"), create_http_client_pool(settings)))
 				{
 					LOG_DBG << L"OANDA Connector has been created successfully!";
 				}
 
 				~connector_impl()
 				{
-					LOG_DBG << L"Connector has been destroyed!";
+					const auto stats = m_service->clients->stats();
+					LOG_DBG << L"Connector has been destroyed! HTTP requests: " << stats.checkouts << L" Connects: " << stats.connects << L" Reuses: " << stats.reuses
+						<< L" Expirations: " << stats.expirations << L" Waits: " << stats.waits;
 				}
 			};
 		}
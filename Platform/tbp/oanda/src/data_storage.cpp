@@ -1,6 +1,10 @@
 #include <oanda/data_storage.h>
+#include <oanda/tick_partitions.h>
 #include <logging/log.h>
 
+#include <algorithm>
+#include <utility>
+
 namespace tbp
 {
 	namespace oanda
@@ -9,53 +13,297 @@ namespace tbp
 		{
 			namespace instrument_data
 			{
-				const std::wstring c_timestamp(L"TIMESTAMP");
-				const std::wstring c_volume(L"VOLUME");
-				const std::wstring c_bid_candlestick(L"BID_CANDLESTICK");
-				const std::wstring c_ask_candlestick(L"ASK_CANDLESTICK");
-				const std::wstring c_complete(L"COMPLETE");
+				const tbp::field_id c_timestamp(L"TIMESTAMP");
+				const tbp::field_id c_volume(L"VOLUME");
+				const tbp::field_id c_bid_candlestick(L"BID_CANDLESTICK");
+				const tbp::field_id c_ask_candlestick(L"ASK_CANDLESTICK");
+				const tbp::field_id c_complete(L"COMPLETE");
 			}
 
 			namespace instant_data
 			{
-				const std::wstring c_bid_price(L"BID");
-				const std::wstring c_ask_price(L"ASK");
+				const tbp::field_id c_bid_price(L"BID");
+				const tbp::field_id c_ask_price(L"ASK");
 			}
 
 			namespace candlestick_data
 			{
-				const std::wstring c_open_price(L"O_PRICE");
-				const std::wstring c_high_price(L"H_PRICE");
-				const std::wstring c_low_price(L"L_PRICE");
-				const std::wstring c_close_price(L"C_PRICE");
+				const tbp::field_id c_open_price(L"O_PRICE");
+				const tbp::field_id c_high_price(L"H_PRICE");
+				const tbp::field_id c_low_price(L"L_PRICE");
+				const tbp::field_id c_close_price(L"C_PRICE");
 			}
 		}
 
 		namespace
 		{
-			const auto current_schema_version = 1;
+			// SB: version 1 kept bid / ask candlesticks in separate CANDLES table, version 2 keeps them inline in INSTRUMENT_CANDLES.
+			// Version 3 adds INSTANT_DATA_ARCHIVE table with compressed blocks of aged ticks, version 4 adds CANDLES_COVERAGE index.
+			// Version 5 keeps instant data in day partitions instead of INSTANT_INSTRUMENT_DATA table
+			const auto current_schema_version = 5;
+
+			// SB: version is kept in user version of DB, since schema version is the schema cookie which is changed by any DDL statement,
+			// f.e. by creation of the day partition, and by vacuum. Version 1 was kept in schema version, it's moved to user version once.
+			// Vacuum of empty DB changes schema version to 1 as well, so version 1 DB is recognized by its table
+			int get_schema_version(const sqlite::connection::ptr& db)
+			{
+				const auto version = db->user_version();
+				if (0 != version || 1 != db->schema_version())
+				{
+					return version;
+				}
+
+				auto st = db->create_statement(L"SELECT NAME FROM SQLITE_MASTER WHERE TYPE = 'table' AND NAME = 'INSTRUMENT_DATA'");
+				if (!st->step())
+				{
+					return 0;
+				}
+
+				db->set_user_version(1);
+				return 1;
+			}
+
+			// SB: amount of rows moved from version 1 tables in one transaction during migration
+			const int c_migration_batch_size = 10000;
+
+			// SB: candles are clustered by primary key, so range read is a single scan over contiguous rows
+			const wchar_t* const c_select_candles_query = LR"(
+				SELECT TIMESTAMP, VOLUME, BID_O, BID_H, BID_L, BID_C, ASK_O, ASK_H, ASK_L, ASK_C
+					FROM INSTRUMENT_CANDLES
+					WHERE INSTRUMENT_ID = (SELECT ID FROM INSTRUMENTS WHERE INSTRUMENTS.NAME = ?1) AND GRANULARITY = ?4 AND TIMESTAMP >= ?2 AND TIMESTAMP <= ?3 ORDER BY TIMESTAMP ASC )";
 
-			tbp::data_t read_candelstick_data(const std::shared_ptr<sqlite::statement>& candels_data_st)
+			// SB: one chunk of scanned range, ?5 is max amount of rows in chunk
+			const std::wstring c_select_candles_chunk_query = std::wstring(c_select_candles_query) + L"LIMIT ?5";
+
+			// SB: rows are inserted by bulk insert, VALUES clause is built by it
+			const wchar_t* const c_insert_candles_query = LR"(
+				INSERT OR REPLACE INTO INSTRUMENT_CANDLES(INSTRUMENT_ID, GRANULARITY, TIMESTAMP, VOLUME, BID_O, BID_H, BID_L, BID_C, ASK_O, ASK_H, ASK_L, ASK_C) )";
+			const int c_candle_columns = 12;
+
+			void create_candles_table(const sqlite::connection::ptr& db)
+			{
+				auto st = db->create_statement(LR"(
+					CREATE TABLE IF NOT EXISTS [INSTRUMENT_CANDLES]([INSTRUMENT_ID] INTEGER NOT NULL REFERENCES INSTRUMENTS(ID) ON DELETE CASCADE, [GRANULARITY] INTEGER NOT NULL, [TIMESTAMP] INTEGER NOT NULL, [VOLUME] INTEGER,
+						[BID_O] DOUBLE, [BID_H] DOUBLE, [BID_L] DOUBLE, [BID_C] DOUBLE, [ASK_O] DOUBLE, [ASK_H] DOUBLE, [ASK_L] DOUBLE, [ASK_C] DOUBLE,
+						PRIMARY KEY([INSTRUMENT_ID], [GRANULARITY], [TIMESTAMP])) WITHOUT ROWID )");
+				st->step();
+			}
+
+			// SB: each row is a range of candles which are known to be complete, ranges don't overlap
+			void create_coverage_table(const sqlite::connection::ptr& db)
+			{
+				auto st = db->create_statement(LR"(
+					CREATE TABLE IF NOT EXISTS [CANDLES_COVERAGE]([INSTRUMENT_ID] INTEGER NOT NULL REFERENCES INSTRUMENTS(ID) ON DELETE CASCADE, [GRANULARITY] INTEGER NOT NULL,
+						[START_TIMESTAMP] INTEGER NOT NULL, [END_TIMESTAMP] INTEGER NOT NULL, PRIMARY KEY([INSTRUMENT_ID], [GRANULARITY], [START_TIMESTAMP])) WITHOUT ROWID )");
+				st->step();
+			}
+
+			// SB: candlestick prices start from 'first_column'
+			tbp::data_t read_candelstick_data(const std::shared_ptr<sqlite::statement>& st, int first_column)
 			{
 				tbp::data_t candelstick_data;
+				candelstick_data.reserve(4);
 
-				candelstick_data[values::candlestick_data::c_open_price] = candels_data_st->get_value<double>(0);
-				candelstick_data[values::candlestick_data::c_high_price] = candels_data_st->get_value<double>(1);
-				candelstick_data[values::candlestick_data::c_low_price] = candels_data_st->get_value<double>(2);
-				candelstick_data[values::candlestick_data::c_close_price] = candels_data_st->get_value<double>(3);
+				candelstick_data[values::candlestick_data::c_open_price] = st->get_double(first_column);
+				candelstick_data[values::candlestick_data::c_high_price] = st->get_double(first_column + 1);
+				candelstick_data[values::candlestick_data::c_low_price] = st->get_double(first_column + 2);
+				candelstick_data[values::candlestick_data::c_close_price] = st->get_double(first_column + 3);
 
 				return candelstick_data;
 			}
+
+			// SB: columns of the row are the same as c_select_candles_query returns
+			tbp::data_t::ptr read_data_record(const std::shared_ptr<sqlite::statement>& st)
+			{
+				tbp::data_t record;
+				record.reserve(4);
+				record[values::instrument_data::c_timestamp] = tbp::time_t(tbp::time_t::duration(st->get_int64(0)));
+				record[values::instrument_data::c_volume] = st->get_int64(1);
+				record.emplace(values::instrument_data::c_bid_candlestick, read_candelstick_data(st, 2));
+				record.emplace(values::instrument_data::c_ask_candlestick, read_candelstick_data(st, 6));
+
+				return std::make_shared<tbp::data_t>(std::move(record));
+			}
+
+			// SB: row is instrument row ID and tick. Consecutive ticks of the same day are inserted into its partition by one bulk insert,
+			// partition is created if it doesn't exist
+			void insert_ticks(const sqlite::connection::ptr& db, const std::vector<std::pair<__int64, archive::tick>>& ticks)
+			{
+				size_t first = 0;
+				while (first < ticks.size())
+				{
+					const auto day = tick_partitions::get_day(ticks[first].second.timestamp);
+					size_t last = first + 1;
+					while (last < ticks.size() && tick_partitions::get_day(ticks[last].second.timestamp) == day)
+					{
+						++last;
+					}
+
+					const auto table_name = tick_partitions(db).create(day);
+					sqlite::bulk_insert insert(db, L"INSERT OR REPLACE INTO [" + table_name + L"](INSTRUMENT_ID, TIMESTAMP, BID, ASK)", 4);
+					insert.insert(last - first, [&ticks, first](sqlite::statement& st, size_t row, int first_index)
+					{
+						const auto& tick = ticks[first + row];
+						st.bind_int64(tick.first, first_index);
+						st.bind_int64(tick.second.timestamp, first_index + 1);
+						st.bind_double(tick.second.bid, first_index + 2);
+						st.bind_double(tick.second.ask, first_index + 3);
+					});
+
+					first = last;
+				}
+			}
+
+			tbp::data_t::ptr make_instant_data(__int64 timestamp, double bid, double ask)
+			{
+				tbp::data_t record;
+				record.reserve(3);
+				record.emplace(values::instrument_data::c_timestamp, tbp::time_t(tbp::time_t::duration(timestamp)));
+				record.emplace(values::instant_data::c_bid_price, bid);
+				record.emplace(values::instant_data::c_ask_price, ask);
+
+				return std::make_shared<tbp::data_t>(std::move(record));
+			}
+
+			/////////////////////////////////////////////////////////////////////
+			// candles_cursor
+			// SB: each chunk is a separate query which starts right after the last read timestamp (keyset pagination).
+			// So no statement stays active between chunks and the scan doesn't hold DB read lock while caller processes the chunk
+
+			class candles_cursor : public tbp::data_cursor
+			{
+				const sqlite::connection_pool::ptr m_pool;
+				const std::wstring m_instrument_id;
+				const unsigned long m_granularity;
+				const size_t m_chunk_size;
+				const __int64 m_end_timestamp;
+				__int64 m_next_timestamp;
+				bool m_finished;
+
+			public:
+				virtual std::vector<data_t::ptr> next() override
+				{
+					std::vector<data_t::ptr> result;
+					if (m_finished)
+					{
+						return result;
+					}
+
+					// SB: reader is taken for one chunk only, it isn't kept while caller processes the chunk
+					const auto db = m_pool->reader();
+					auto st = db->cached_statement(c_select_candles_chunk_query);
+					st->bind_text(m_instrument_id, 1);
+					st->bind_int64(m_next_timestamp, 2);
+					st->bind_int64(m_end_timestamp, 3);
+					st->bind_int(static_cast<int>(m_granularity), 4);
+					st->bind_int64(static_cast<__int64>(m_chunk_size), 5);
+
+					__int64 last_timestamp = m_next_timestamp;
+					while (st->step())
+					{
+						last_timestamp = st->get_int64(0);
+						result.emplace_back(read_data_record(st));
+					}
+
+					// SB: short chunk means there are no more rows in range
+					m_finished = result.size() < m_chunk_size || last_timestamp >= m_end_timestamp;
+					m_next_timestamp = last_timestamp + 1;
+
+					return result;
+				}
+
+			public:
+				candles_cursor(const sqlite::connection_pool::ptr& pool, const std::wstring& instrument_id, unsigned long granularity, tbp::time_t start_datetime, tbp::time_t end_datetime, size_t chunk_size)
+					: m_pool(pool)
+					, m_instrument_id(instrument_id)
+					, m_granularity(granularity)
+					, m_chunk_size(chunk_size)
+					, m_end_timestamp(end_datetime.time_since_epoch().count())
+					, m_next_timestamp(start_datetime.time_since_epoch().count())
+					, m_finished(start_datetime > end_datetime)
+				{
+				}
+			};
+
+			template <typename series_t, typename convert_t>
+			series_t read_candles(const sqlite::connection::ptr& db, const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime, const convert_t& convert)
+			{
+				if (nullptr == start_datetime || nullptr == end_datetime)
+				{
+					throw std::invalid_argument("start_datetime or end_datetime argument is null!");
+				}
+
+				auto st = db->cached_statement(c_select_candles_query);
+
+				st->bind_text(instrument_id, 1);
+				st->bind_int64(start_datetime->time_since_epoch().count(), 2);
+				st->bind_int64(end_datetime->time_since_epoch().count(), 3);
+				st->bind_int(static_cast<int>(granularity), 4);
+
+				series_t result;
+				while (st->step())
+				{
+					result.timestamp.push_back(tbp::time_t(tbp::time_t::duration(st->get_int64(0))));
+					result.volume.push_back(st->get_int64(1));
+
+					result.bid.open.push_back(convert(st->get_double(2)));
+					result.bid.high.push_back(convert(st->get_double(3)));
+					result.bid.low.push_back(convert(st->get_double(4)));
+					result.bid.close.push_back(convert(st->get_double(5)));
+
+					result.ask.open.push_back(convert(st->get_double(6)));
+					result.ask.high.push_back(convert(st->get_double(7)));
+					result.ask.low.push_back(convert(st->get_double(8)));
+					result.ask.close.push_back(convert(st->get_double(9)));
+
+					// SB: only complete candles are stored
+					result.complete.push_back(1);
+				}
+
+				if (result.size() <= 1)
+				{
+					*end_datetime = *start_datetime;
+
+					return result;
+				}
+
+				*start_datetime = result.timestamp.front();
+				*end_datetime = result.timestamp.back();
+
+				return result;
+			}
 		}
 
 		void data_storage::create_db_schema()
 		{
-			const auto version = m_db->schema_version();
+			const auto version = get_schema_version(m_db);
 			switch (version)
 			{
 			case 0:
 				break;
 
+			case 1:
+				migrate_db_schema_v1();
+				migrate_db_schema_v2();
+				migrate_db_schema_v3();
+				migrate_db_schema_v4();
+				return;
+
+			case 2:
+				migrate_db_schema_v2();
+				migrate_db_schema_v3();
+				migrate_db_schema_v4();
+				return;
+
+			case 3:
+				migrate_db_schema_v3();
+				migrate_db_schema_v4();
+				return;
+
+			case 4:
+				migrate_db_schema_v4();
+				return;
+
 			case current_schema_version:
 				return;
 
@@ -63,6 +311,9 @@ namespace tbp
 				throw std::runtime_error("Unknown data storage DB schema version!");
 			}
 
+			// SB: rebuilding of empty DB is cheap, DB file which already has the header (f.e. in WAL mode) can't change the mode otherwise
+			vacuum::enable(m_db);
+
 			sqlite::transaction t(m_db);
 
 			try
@@ -72,16 +323,212 @@ namespace tbp
 				auto st = m_db->create_statement(L"CREATE TABLE [INSTRUMENTS]([ID] INTEGER PRIMARY KEY NOT NULL, [NAME] TEXT)");
 				st->step();
 
-				st = m_db->create_statement(L"CREATE TABLE [CANDLES]([ID] INTEGER PRIMARY KEY NOT NULL, [O_PRICE] DOUBLE, [H_PRICE] DOUBLE, [L_PRICE] DOUBLE, [C_PRICE] DOUBLE)");
+				create_candles_table(m_db);
+
+				tick_partitions::create_table(m_db);
+				tick_archive::create_table(m_db);
+				create_coverage_table(m_db);
+
+				m_db->set_user_version(current_schema_version);
+
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+
+			LOG_INFO << "Oanda data storage DB schema has been created successfully!";
+		}
+
+		void data_storage::migrate_db_schema_v1()
+		{
+			LOG_INFO << "Oanda data storage DB schema version 1 found. Migrating to version 2";
+
+			create_candles_table(m_db);
+
+			// SB: rows are moved from version 1 tables by batches, each batch is a separate transaction.
+			// So DB isn't locked for the whole migration and interrupted migration continues from the same point on the next start
+			const auto batch_rows = L"SELECT ROWID FROM INSTRUMENT_DATA ORDER BY ROWID LIMIT ?1";
+			auto has_rows_st = m_db->create_statement(L"SELECT ROWID FROM INSTRUMENT_DATA LIMIT 1");
+			auto copy_st = m_db->create_statement(std::wstring(LR"(
+				INSERT OR REPLACE INTO INSTRUMENT_CANDLES(INSTRUMENT_ID, GRANULARITY, TIMESTAMP, VOLUME, BID_O, BID_H, BID_L, BID_C, ASK_O, ASK_H, ASK_L, ASK_C)
+					SELECT INSTRUMENT_DATA.INSTRUMENT_ID, INSTRUMENT_DATA.GRANULARITY, INSTRUMENT_DATA.TIMESTAMP, INSTRUMENT_DATA.VOLUME,
+						BID.O_PRICE, BID.H_PRICE, BID.L_PRICE, BID.C_PRICE,
+						ASK.O_PRICE, ASK.H_PRICE, ASK.L_PRICE, ASK.C_PRICE
+						FROM INSTRUMENT_DATA
+						JOIN CANDLES AS BID ON BID.ID = INSTRUMENT_DATA.BID_CANDLESTICK
+						JOIN CANDLES AS ASK ON ASK.ID = INSTRUMENT_DATA.ASK_CANDLESTICK
+						WHERE INSTRUMENT_DATA.ROWID IN ()") + batch_rows + L")");
+
+			auto delete_candles_st = m_db->create_statement(std::wstring(LR"(
+				DELETE FROM CANDLES WHERE ID IN (
+					SELECT BID_CANDLESTICK FROM INSTRUMENT_DATA WHERE ROWID IN ()") + batch_rows + LR"()
+					UNION ALL
+					SELECT ASK_CANDLESTICK FROM INSTRUMENT_DATA WHERE ROWID IN ()" + batch_rows + L"))");
+
+			auto delete_rows_st = m_db->create_statement(std::wstring(L"DELETE FROM INSTRUMENT_DATA WHERE ROWID IN (") + batch_rows + L")");
+
+			size_t batches_count = 0;
+			for (;;)
+			{
+				has_rows_st->reset();
+				if (!has_rows_st->step())
+				{
+					break;
+				}
+
+				sqlite::transaction t(m_db);
+
+				try
+				{
+					for (const auto& st : { copy_st, delete_candles_st, delete_rows_st })
+					{
+						st->reset();
+						st->bind_int(c_migration_batch_size, 1);
+						st->step();
+					}
+
+					t.commit();
+				}
+				catch (...)
+				{
+					t.rollback();
+					throw;
+				}
+
+				++batches_count;
+			}
+
+			sqlite::transaction t(m_db);
+
+			try
+			{
+				auto st = m_db->create_statement(L"DROP TABLE [INSTRUMENT_DATA]");
 				st->step();
 
-				st = m_db->create_statement(L"CREATE TABLE [INSTRUMENT_DATA]([INSTRUMENT_ID] REFERENCES INSTRUMENTS(ID) ON DELETE CASCADE, [TIMESTAMP] INTEGER, [GRANULARITY] INTEGER, [BID_CANDLESTICK] REFERENCES CANDLES(ID), [ASK_CANDLESTICK] REFERENCES CANDLES(ID), [VOLUME] INTEGER, PRIMARY KEY([INSTRUMENT_ID], [TIMESTAMP], [GRANULARITY]))");
+				st = m_db->create_statement(L"DROP TABLE [CANDLES]");
 				st->step();
 
-				st = m_db->create_statement(L"CREATE TABLE [INSTANT_INSTRUMENT_DATA]([INSTRUMENT_ID] REFERENCES INSTRUMENTS(ID) ON DELETE CASCADE, [TIMESTAMP] INTEGER, [BID] DOUBLE, [ASK] DOUBLE, PRIMARY KEY([INSTRUMENT_ID], [TIMESTAMP]))");
+				m_db->set_user_version(2);
+
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+
+			LOG_INFO << "Oanda data storage DB schema has been migrated successfully! Batches count: " << batches_count;
+		}
+
+		void data_storage::migrate_db_schema_v2()
+		{
+			LOG_INFO << "Oanda data storage DB schema version 2 found. Migrating to version 3";
+
+			sqlite::transaction t(m_db);
+
+			try
+			{
+				tick_archive::create_table(m_db);
+				m_db->set_user_version(3);
+
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+
+			LOG_INFO << "Oanda data storage DB schema has been migrated successfully!";
+		}
+
+		void data_storage::migrate_db_schema_v3()
+		{
+			LOG_INFO << "Oanda data storage DB schema version 3 found. Migrating to version 4";
+
+			// SB: coverage of candles which were stored before is unknown, they are downloaded once more on the first request
+			sqlite::transaction t(m_db);
+
+			try
+			{
+				create_coverage_table(m_db);
+				m_db->set_user_version(4);
+
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+
+			LOG_INFO << "Oanda data storage DB schema has been migrated successfully!";
+		}
+
+		void data_storage::migrate_db_schema_v4()
+		{
+			LOG_INFO << "Oanda data storage DB schema version 4 found. Migrating to version " << current_schema_version;
+
+			tick_partitions::create_table(m_db);
+
+			// SB: ticks are moved to partitions by batches, each batch is a separate transaction
+			auto delete_st = m_db->create_statement(L"DELETE FROM INSTANT_INSTRUMENT_DATA WHERE ROWID <= ?1");
+
+			size_t batches_count = 0;
+			for (;;)
+			{
+				sqlite::transaction t(m_db);
+
+				try
+				{
+					// SB: rows are read before insertion, because partitions are created meanwhile
+					std::vector<std::pair<__int64, archive::tick>> ticks;
+					__int64 last_row_id = 0;
+					{
+						auto st = m_db->cached_statement(L"SELECT ROWID, INSTRUMENT_ID, TIMESTAMP, BID, ASK FROM INSTANT_INSTRUMENT_DATA ORDER BY ROWID LIMIT ?1");
+						st->bind_int(c_migration_batch_size, 1);
+						while (st->step())
+						{
+							last_row_id = st->get_int64(0);
+							ticks.push_back({ st->get_int64(1), { st->get_int64(2), st->get_double(3), st->get_double(4) } });
+						}
+					}
+
+					if (ticks.empty())
+					{
+						t.commit();
+						break;
+					}
+
+					insert_ticks(m_db, ticks);
+
+					delete_st->reset();
+					delete_st->bind_int64(last_row_id, 1);
+					delete_st->step();
+
+					t.commit();
+				}
+				catch (...)
+				{
+					t.rollback();
+					throw;
+				}
+
+				++batches_count;
+			}
+
+			sqlite::transaction t(m_db);
+
+			try
+			{
+				auto st = m_db->create_statement(L"DROP TABLE [INSTANT_INSTRUMENT_DATA]");
 				st->step();
 
-				m_db->set_schema_version(current_schema_version);
+				m_db->set_user_version(current_schema_version);
 
 				t.commit();
 			}
@@ -91,7 +538,7 @@ namespace tbp
 				throw;
 			}
 
-			LOG_INFO << "Oanda data storage DB schema has been created successfully!";
+			LOG_INFO << "Oanda data storage DB schema has been migrated successfully! Batches count: " << batches_count;
 		}
 
 		void data_storage::verify_db_schema()
@@ -100,17 +547,17 @@ namespace tbp
 
 		__int64 data_storage::get_instrument_row_id(const std::wstring& instrument_id)
 		{
-			auto insert_instrument_st = m_db->create_statement(L"INSERT INTO INSTRUMENTS (NAME) VALUES (?1)");
-			auto select_instrument_id_st = m_db->create_statement(L"SELECT ID FROM INSTRUMENTS WHERE INSTRUMENTS.NAME = ?1");
-			select_instrument_id_st->bind_value(instrument_id, 1);
+			auto insert_instrument_st = m_db->cached_statement(L"INSERT INTO INSTRUMENTS (NAME) VALUES (?1)");
+			auto select_instrument_id_st = m_db->cached_statement(L"SELECT ID FROM INSTRUMENTS WHERE INSTRUMENTS.NAME = ?1");
+			select_instrument_id_st->bind_text(instrument_id, 1);
 			__int64 instrument_row_id = -1;
 			if (select_instrument_id_st->step())
 			{
-				instrument_row_id = select_instrument_id_st->get_value<__int64>(0);
+				instrument_row_id = select_instrument_id_st->get_int64(0);
 			}
 			else
 			{
-				insert_instrument_st->bind_value(instrument_id, 1);
+				insert_instrument_st->bind_text(instrument_id, 1);
 				insert_instrument_st->step();
 				instrument_row_id = insert_instrument_st->last_insert_row_id();
 			}
@@ -125,43 +572,17 @@ namespace tbp
 				throw std::invalid_argument("start_datetime or end_datetime argument is null!");
 			}
 
-			auto st = m_db->create_statement(LR"(
-				SELECT TIMESTAMP, BID_CANDLESTICK, ASK_CANDLESTICK, VOLUME 
-					FROM INSTRUMENT_DATA 
-					WHERE INSTRUMENT_ID IN (SELECT ID FROM INSTRUMENTS WHERE INSTRUMENTS.NAME = ?1) AND INSTRUMENT_DATA.TIMESTAMP >= ?2 AND INSTRUMENT_DATA.TIMESTAMP <= ?3 AND INSTRUMENT_DATA.GRANULARITY = ?4 ORDER BY TIMESTAMP ASC )");
-
-			st->bind_value(instrument_id, 1);
-			st->bind_value(start_datetime->time_since_epoch().count(), 2);
-			st->bind_value(end_datetime->time_since_epoch().count(), 3);
-			st->bind_value(static_cast<int>(granularity), 4);
-
-			auto candels_data_st = m_db->create_statement(LR"(
-				SELECT O_PRICE, H_PRICE, L_PRICE, C_PRICE 
-					FROM CANDLES 
-					WHERE ID = ?1 )");
+			const auto db = m_pool->reader();
+			auto st = db->cached_statement(c_select_candles_query);
+			st->bind_text(instrument_id, 1);
+			st->bind_int64(start_datetime->time_since_epoch().count(), 2);
+			st->bind_int64(end_datetime->time_since_epoch().count(), 3);
+			st->bind_int(static_cast<int>(granularity), 4);
 
 			std::vector<data_t::ptr> result;
 			while (st->step())
 			{
-				tbp::data_t record;
-				record[values::instrument_data::c_timestamp] = tbp::time_t(tbp::time_t::duration(st->get_value<__int64>(0)));
-				record[values::instrument_data::c_volume] = st->get_value<__int64>(3);
-
-				candels_data_st->reset();
-				candels_data_st->bind_value(st->get_value<__int64>(1), 1);
-				if (candels_data_st->step())
-				{
-					record.emplace(values::instrument_data::c_bid_candlestick, read_candelstick_data(candels_data_st));
-				}
-
-				candels_data_st->reset();
-				candels_data_st->bind_value(st->get_value<__int64>(2), 1);
-				if (candels_data_st->step())
-				{
-					record.emplace(values::instrument_data::c_ask_candlestick, read_candelstick_data(candels_data_st));
-				}
-
-				result.emplace_back(std::make_shared<tbp::data_t>(std::move(record)));
+				result.emplace_back(read_data_record(st));
 			}
 
 			if (result.size() <= 1)
@@ -184,6 +605,27 @@ namespace tbp
 			return result;
 		}
 
+		data_chunks data_storage::scan(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t start_datetime, tbp::time_t end_datetime, size_t chunk_size) const
+		{
+			if (0 == chunk_size)
+			{
+				throw std::invalid_argument("chunk_size argument is zero!");
+			}
+
+			return data_chunks(std::make_shared<candles_cursor>(m_pool, instrument_id, granularity, start_datetime, end_datetime, chunk_size));
+		}
+
+		candle_series data_storage::get_candles(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const
+		{
+			return read_candles<candle_series>(m_pool->reader(), instrument_id, granularity, start_datetime, end_datetime, [](double price) { return price; });
+		}
+
+		fixed_candle_series data_storage::get_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const
+		{
+			// SB: prices are converted while reading rows, without intermediate double series
+			return read_candles<fixed_candle_series>(m_pool->reader(), instrument_id, granularity, start_datetime, end_datetime, [precision](double price) { return to_fixed(price, precision); });
+		}
+
 		std::vector<data_t::ptr> data_storage::get_instant_data(const std::wstring& instrument_id, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const
 		{
 			if (nullptr == start_datetime || nullptr == end_datetime)
@@ -191,24 +633,66 @@ namespace tbp
 				throw std::invalid_argument("start_datetime or end_datetime argument is null!");
 			}
 
-			auto st = m_db->create_statement(LR"(
-				SELECT TIMESTAMP, BID, ASK
-					FROM INSTANT_INSTRUMENT_DATA 
-					WHERE INSTRUMENT_ID IN (SELECT ID FROM INSTRUMENTS WHERE INSTRUMENTS.NAME = ?1) AND INSTANT_INSTRUMENT_DATA.TIMESTAMP >= ?2 AND INSTANT_INSTRUMENT_DATA.TIMESTAMP <= ?3 ORDER BY TIMESTAMP ASC )");
+			const auto db = m_pool->reader();
+			const auto start = start_datetime->time_since_epoch().count();
+			const auto end = end_datetime->time_since_epoch().count();
+
+			// SB: partitions are read before archive, so tick which is moved to archive meanwhile is read at least once
+			std::vector<archive::tick> fresh;
+			tick_partitions partitions(db);
+			for (const auto day : partitions.find(start, end))
+			{
+				try
+				{
+					auto st = db->cached_statement(LR"(
+						SELECT TIMESTAMP, BID, ASK
+							FROM [)" + tick_partitions::get_table_name(day) + LR"(]
+							WHERE INSTRUMENT_ID = (SELECT ID FROM INSTRUMENTS WHERE INSTRUMENTS.NAME = ?1) AND TIMESTAMP >= ?2 AND TIMESTAMP <= ?3 ORDER BY TIMESTAMP ASC )");
+
+					st->bind_text(instrument_id, 1);
+					st->bind_int64(start, 2);
+					st->bind_int64(end, 3);
+					while (st->step())
+					{
+						fresh.push_back({ st->get_int64(0), st->get_double(1), st->get_double(2) });
+					}
+				}
+				catch (const sqlite::exception&)
+				{
+					// SB: partition has been dropped by compaction or expiration after it was found, its ticks are read from archive
+					if (partitions.exists(day))
+					{
+						throw;
+					}
+				}
+			}
 
-			st->bind_value(instrument_id, 1);
-			st->bind_value(start_datetime->time_since_epoch().count(), 2);
-			st->bind_value(end_datetime->time_since_epoch().count(), 3);
+			std::vector<archive::tick> archived;
+			tick_archive(db).read(instrument_id, *start_datetime, *end_datetime, &archived);
 
 			std::vector<data_t::ptr> result;
-			while (st->step())
+			result.reserve(fresh.size() + archived.size());
+
+			auto archived_it = archived.begin();
+			for (const auto& t : fresh)
 			{
-				tbp::data_t record;
-				record.emplace(values::instrument_data::c_timestamp, tbp::time_t(tbp::time_t::duration(st->get_value<__int64>(0))));
-				record.emplace(values::instant_data::c_bid_price, st->get_value<double>(1));
-				record.emplace(values::instant_data::c_ask_price, st->get_value<double>(2));
+				for (; archived.end() != archived_it && archived_it->timestamp < t.timestamp; ++archived_it)
+				{
+					result.emplace_back(make_instant_data(archived_it->timestamp, archived_it->bid, archived_it->ask));
+				}
+
+				// SB: tick which came after its hour was archived stays in the partition until the next compaction, it replaces archived one
+				if (archived.end() != archived_it && archived_it->timestamp == t.timestamp)
+				{
+					++archived_it;
+				}
 
-				result.emplace_back(std::make_shared<tbp::data_t>(std::move(record)));
+				result.emplace_back(make_instant_data(t.timestamp, t.bid, t.ask));
+			}
+
+			for (; archived.end() != archived_it; ++archived_it)
+			{
+				result.emplace_back(make_instant_data(archived_it->timestamp, archived_it->bid, archived_it->ask));
 			}
 
 			if (result.size() <= 1)
@@ -238,14 +722,23 @@ namespace tbp
 			try
 			{
 				const __int64 instrument_row_id = get_instrument_row_id(instrument_id);
-				auto insert_candle_data_st = m_db->create_statement(L"INSERT INTO CANDLES(O_PRICE, H_PRICE, L_PRICE, C_PRICE) VALUES (?1, ?2, ?3, ?4)");
-				auto insert_instrument_data_st = m_db->create_statement(L"INSERT OR REPLACE INTO INSTRUMENT_DATA(INSTRUMENT_ID, TIMESTAMP, GRANULARITY, BID_CANDLESTICK, ASK_CANDLESTICK, VOLUME) VALUES (?1, ?2, ?3, ?4, ?5, ?6)");
-				for (const auto& instrument_data : data)
+
+				const tbp::field_id candlestick_values[] =
 				{
-					insert_instrument_data_st->reset();
-					insert_instrument_data_st->bind_value(instrument_row_id, 1);
+					values::candlestick_data::c_open_price,
+					values::candlestick_data::c_high_price,
+					values::candlestick_data::c_low_price,
+					values::candlestick_data::c_close_price,
+				};
+
+				sqlite::bulk_insert insert(m_db, c_insert_candles_query, c_candle_columns);
+				insert.insert(data.size(), [&](sqlite::statement& st, size_t row, int first_index)
+				{
+					const auto& instrument_data = data[row];
+					st.bind_int64(instrument_row_id, first_index);
 
-					insert_candle_data_st->reset();
+					// GRANULARITY
+					st.bind_int(static_cast<int>(granularity), first_index + 1);
 
 					// TIMESTAMP
 					{
@@ -255,21 +748,21 @@ namespace tbp
 							throw std::runtime_error("TIMESTAMP value isn't provided by instrument data!");
 						}
 
-						insert_instrument_data_st->bind_value(boost::get<tbp::time_t>(it->second).time_since_epoch().count(), 2);
+						st.bind_int64(boost::get<tbp::time_t>(it->second).time_since_epoch().count(), first_index + 2);
 					}
 
-					// GRANULARITY
-					insert_instrument_data_st->bind_value(static_cast<int>(granularity), 3);
-
-					std::wstring candlestick_values[] =
+					// VOLUME
 					{
-						values::candlestick_data::c_open_price,
-						values::candlestick_data::c_high_price,
-						values::candlestick_data::c_low_price,
-						values::candlestick_data::c_close_price,
-					};
+						auto it = instrument_data->find(values::instrument_data::c_volume);
+						if (instrument_data->end() == it)
+						{
+							throw std::runtime_error("VOLUME value isn't provided by instrument data!");
+						}
 
-					auto save_candlestick_data = [&](const std::wstring& candlestick_name, int st_index)
+						st.bind_int64(boost::get<__int64>(it->second), first_index + 3);
+					}
+
+					auto bind_candlestick_data = [&](const tbp::field_id& candlestick_name, int st_index)
 					{
 						auto it = instrument_data->find(candlestick_name);
 						if (instrument_data->end() == it)
@@ -278,10 +771,6 @@ namespace tbp
 						}
 
 						const auto& candelstick_data = boost::get<tbp::data_t>(it->second);
-
-						insert_candle_data_st->reset();
-
-						int index = 1;
 						for (const auto& value_name : candlestick_values)
 						{
 							auto it = candelstick_data.find(value_name);
@@ -290,33 +779,52 @@ namespace tbp
 								throw std::runtime_error("Candlestick data incomplete!");
 							}
 
-							insert_candle_data_st->bind_value(boost::get<double>(it->second), index++);
+							st.bind_double(boost::get<double>(it->second), st_index++);
 						}
-
-						insert_candle_data_st->step();
-
-						insert_instrument_data_st->bind_value(insert_candle_data_st->last_insert_row_id(), st_index);
 					};
 
 					// BID_CANDLESTICK
-					save_candlestick_data(values::instrument_data::c_bid_candlestick, 4);
+					bind_candlestick_data(values::instrument_data::c_bid_candlestick, first_index + 4);
 
 					// ASK_CANDLESTICK
-					save_candlestick_data(values::instrument_data::c_ask_candlestick, 5);
+					bind_candlestick_data(values::instrument_data::c_ask_candlestick, first_index + 8);
+				});
 
-					// VOLUME
-					{
-						auto it = instrument_data->find(values::instrument_data::c_volume);
-						if (instrument_data->end() == it)
-						{
-							throw std::runtime_error("VOLUME value isn't provided by instrument data!");
-						}
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+		}
 
-						insert_instrument_data_st->bind_value(boost::get<__int64>(it->second), 6);
-					}
+		void data_storage::save_candles(const std::wstring& instrument_id, unsigned long granularity, const candle_series& candles)
+		{
+			sqlite::transaction t(m_db);
 
-					insert_instrument_data_st->step();
-				}
+			try
+			{
+				const __int64 instrument_row_id = get_instrument_row_id(instrument_id);
+
+				auto bind_candlestick_data = [](sqlite::statement& st, const candle_series::prices& prices, size_t index, int st_index)
+				{
+					st.bind_double(prices.open[index], st_index);
+					st.bind_double(prices.high[index], st_index + 1);
+					st.bind_double(prices.low[index], st_index + 2);
+					st.bind_double(prices.close[index], st_index + 3);
+				};
+
+				sqlite::bulk_insert insert(m_db, c_insert_candles_query, c_candle_columns);
+				insert.insert(candles.size(), [&](sqlite::statement& st, size_t row, int first_index)
+				{
+					st.bind_int64(instrument_row_id, first_index);
+					st.bind_int(static_cast<int>(granularity), first_index + 1);
+					st.bind_int64(candles.timestamp[row].time_since_epoch().count(), first_index + 2);
+					st.bind_int64(candles.volume[row], first_index + 3);
+					bind_candlestick_data(st, candles.bid, row, first_index + 4);
+					bind_candlestick_data(st, candles.ask, row, first_index + 8);
+				});
 
 				t.commit();
 			}
@@ -334,11 +842,12 @@ namespace tbp
 			try
 			{
 				const __int64 instrument_row_id = get_instrument_row_id(instrument_id);
-				auto insert_instrument_data_st = m_db->create_statement(L"INSERT OR REPLACE INTO INSTANT_INSTRUMENT_DATA(INSTRUMENT_ID, TIMESTAMP, BID, ASK) VALUES (?1, ?2, ?3, ?4)");
+
+				std::vector<std::pair<__int64, archive::tick>> ticks;
+				ticks.reserve(data.size());
 				for (const auto& instrument_data : data)
 				{
-					insert_instrument_data_st->reset();
-					insert_instrument_data_st->bind_value(instrument_row_id, 1);
+					archive::tick tick = {};
 
 					// TIMESTAMP
 					{
@@ -348,7 +857,7 @@ namespace tbp
 							throw std::runtime_error("TIMESTAMP value isn't provided by instant instrument data!");
 						}
 
-						insert_instrument_data_st->bind_value(tbp::get<tbp::time_t>(it->second).time_since_epoch().count(), 2);
+						tick.timestamp = tbp::get<tbp::time_t>(it->second).time_since_epoch().count();
 					}
 
 					// BID
@@ -359,7 +868,7 @@ namespace tbp
 							throw std::runtime_error("BID value isn't provided by instant instrument data!");
 						}
 
-						insert_instrument_data_st->bind_value(tbp::get<double>(it->second), 3);
+						tick.bid = tbp::get<double>(it->second);
 					}
 
 					// ASK
@@ -370,10 +879,106 @@ namespace tbp
 							throw std::runtime_error("ASK value isn't provided by instant instrument data!");
 						}
 
-						insert_instrument_data_st->bind_value(tbp::get<double>(it->second), 4);
+						tick.ask = tbp::get<double>(it->second);
+					}
+
+					ticks.push_back({ instrument_row_id, tick });
+				}
+
+				insert_ticks(m_db, ticks);
+
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+		}
+
+		void data_storage::save_batch(const std::function<void()>& save)
+		{
+			sqlite::transaction t(m_db);
+
+			try
+			{
+				save();
+
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+		}
+
+		bool data_storage::get_coverage(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t start_datetime, tbp::time_t end_datetime, std::vector<time_range>* result) const
+		{
+			const auto db = m_pool->reader();
+			auto st = db->cached_statement(LR"(
+				SELECT START_TIMESTAMP, END_TIMESTAMP
+					FROM CANDLES_COVERAGE
+					WHERE INSTRUMENT_ID = (SELECT ID FROM INSTRUMENTS WHERE INSTRUMENTS.NAME = ?1) AND GRANULARITY = ?2 AND START_TIMESTAMP <= ?4 AND END_TIMESTAMP >= ?3 ORDER BY START_TIMESTAMP ASC )");
+
+			st->bind_text(instrument_id, 1);
+			st->bind_int(static_cast<int>(granularity), 2);
+			st->bind_int64(start_datetime.time_since_epoch().count(), 3);
+			st->bind_int64(end_datetime.time_since_epoch().count(), 4);
+
+			while (st->step())
+			{
+				result->push_back({ tbp::time_t(tbp::time_t::duration(st->get_int64(0))), tbp::time_t(tbp::time_t::duration(st->get_int64(1))) });
+			}
+
+			return true;
+		}
+
+		void data_storage::add_coverage(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t start_datetime, tbp::time_t end_datetime)
+		{
+			if (start_datetime > end_datetime)
+			{
+				throw std::invalid_argument("start_datetime is greater than end_datetime!");
+			}
+
+			sqlite::transaction t(m_db);
+
+			try
+			{
+				const __int64 instrument_row_id = get_instrument_row_id(instrument_id);
+				__int64 start = start_datetime.time_since_epoch().count();
+				__int64 end = end_datetime.time_since_epoch().count();
+
+				// SB: new range absorbs ranges which overlap it or are adjacent to it
+				{
+					auto st = m_db->cached_statement(L"SELECT START_TIMESTAMP, END_TIMESTAMP FROM CANDLES_COVERAGE WHERE INSTRUMENT_ID = ?1 AND GRANULARITY = ?2 AND START_TIMESTAMP <= ?4 + 1 AND END_TIMESTAMP >= ?3 - 1");
+					st->bind_int64(instrument_row_id, 1);
+					st->bind_int(static_cast<int>(granularity), 2);
+					st->bind_int64(start_datetime.time_since_epoch().count(), 3);
+					st->bind_int64(end_datetime.time_since_epoch().count(), 4);
+					while (st->step())
+					{
+						start = std::min(start, st->get_int64(0));
+						end = std::max(end, st->get_int64(1));
 					}
+				}
 
-					insert_instrument_data_st->step();
+				{
+					auto st = m_db->cached_statement(L"DELETE FROM CANDLES_COVERAGE WHERE INSTRUMENT_ID = ?1 AND GRANULARITY = ?2 AND START_TIMESTAMP >= ?3 AND START_TIMESTAMP <= ?4");
+					st->bind_int64(instrument_row_id, 1);
+					st->bind_int(static_cast<int>(granularity), 2);
+					st->bind_int64(start, 3);
+					st->bind_int64(end, 4);
+					st->step();
+				}
+
+				{
+					auto st = m_db->cached_statement(L"INSERT INTO CANDLES_COVERAGE(INSTRUMENT_ID, GRANULARITY, START_TIMESTAMP, END_TIMESTAMP) VALUES (?1, ?2, ?3, ?4)");
+					st->bind_int64(instrument_row_id, 1);
+					st->bind_int(static_cast<int>(granularity), 2);
+					st->bind_int64(start, 3);
+					st->bind_int64(end, 4);
+					st->step();
 				}
 
 				t.commit();
@@ -385,8 +990,24 @@ namespace tbp
 			}
 		}
 
+		void data_storage::start_archiving(const sqlite::connection::ptr& db, std::chrono::seconds age, std::chrono::seconds retention, std::chrono::milliseconds interval)
+		{
+			m_compactor = std::make_unique<tick_compactor>(db, age, retention, interval);
+		}
+
+		void data_storage::start_vacuum(const sqlite::connection::ptr& db, std::chrono::milliseconds interval)
+		{
+			m_vacuum = std::make_unique<storage_vacuum>(db, interval);
+		}
+
 		data_storage::data_storage(const sqlite::connection::ptr& db)
-			: m_db(db)
+			: data_storage(std::make_shared<sqlite::connection_pool>(db, sqlite::connection_pool::open_function(), 0))
+		{
+		}
+
+		data_storage::data_storage(const sqlite::connection_pool::ptr& pool)
+			: m_db(pool->writer())
+			, m_pool(pool)
 		{
 			create_db_schema();
 		}
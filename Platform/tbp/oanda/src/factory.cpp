@@ -1,8 +1,12 @@
 #include <oanda/factory.h>
 #include <oanda/data_storage.h>
+#include <oanda/mapped_storage.h>
 #include <oanda/connector.h>
 #include <oanda/trader.h>
 
+#include <core/async_storage.h>
+#include <core/cached_storage.h>
+
 #include <common/string_cvt.h>
 
 #include <sqlite/sqlite.h>
@@ -12,6 +16,7 @@
 
 #include <cpprest/json.h>
 
+#include <chrono>
 #include <fstream>
 
 namespace tbp
@@ -42,6 +47,31 @@ namespace tbp
 			return s;
 		}
 
+		// SB: data storage and tick compactor write the same DB file by different connections, so they wait for each other
+		static const unsigned long c_db_busy_timeout = 10000;
+		static const std::chrono::hours c_tick_archive_interval(1);
+		static const std::chrono::hours c_vacuum_interval(1);
+
+		static sqlite::synchronous_mode parse_durability(const std::wstring& value)
+		{
+			if (L"full" == value)
+			{
+				return sqlite::synchronous_mode::full;
+			}
+
+			if (L"normal" == value)
+			{
+				return sqlite::synchronous_mode::normal;
+			}
+
+			if (L"off" == value)
+			{
+				return sqlite::synchronous_mode::off;
+			}
+
+			throw std::invalid_argument("Unknown DataStorageDurability setting value! Expected values: full, normal, off");
+		}
+
 		////////////////////////////////////////////////////////////////
 		// factory
 
@@ -55,27 +85,128 @@ namespace tbp
 			return connector::create(m_connector_settings, auth);
 		}
 
-		data_storage::ptr factory::create_storage()
+		data_storage::ptr factory::open_storage(bool archiving)
 		{
 			using win::fs::operator/;
-			std::wstring full_path = m_working_dir / L"DB" / L"oanda";
-			win::fs::create_path(full_path);
 
-			full_path = full_path / L"instruments_data.db";
-			if (win::fs::exists(full_path))
+			// SB: memory mapped storage is faster for research workloads, SQLite one is used by default
+			data_storage::ptr result;
+			const auto storage_type = get_value<std::wstring>(m_connector_settings, L"DataStorage", L"sqlite");
+			if (L"mapped" == storage_type)
+			{
+				LOG_INFO << "Open OANDA memory mapped data storage.";
+
+				result = std::make_shared<oanda::mapped_storage>(m_working_dir / L"DB" / L"oanda" / L"mapped");
+			}
+			else if (L"sqlite" == storage_type)
 			{
-				LOG_INFO << "Open existing OANDA database.";
+				std::wstring full_path = m_working_dir / L"DB" / L"oanda";
+				win::fs::create_path(full_path);
+
+				full_path = full_path / L"instruments_data.db";
+				if (win::fs::exists(full_path))
+				{
+					LOG_INFO << "Open existing OANDA database.";
+				}
+				else
+				{
+					LOG_INFO << "Create OANDA database.";
+				}
+
+				// SB: readers don't block writer and commit doesn't rewrite DB file in WAL mode. Durability is a trade off between
+				// safety and commit latency: 'normal' can lose the last commits on power loss but not on application crash
+				const auto durability = parse_durability(get_value<std::wstring>(m_connector_settings, L"DataStorageDurability", L"full"));
+				// SB: readers of the pool are opened later, so settings are captured by value
+				auto open_db = [full_path, durability]()
+				{
+					auto db = sqlite::connection::create(full_path);
+					db->set_journal_mode(sqlite::journal_mode::wal);
+					db->set_synchronous(durability);
+					db->set_busy_timeout(c_db_busy_timeout);
+
+					return db;
+				};
+
+				// SB: reads of strategy, collectors and backtests don't wait for each other and for writes
+				const auto readers = get_value<int>(m_connector_settings, L"DataStorageReaders", 4);
+				if (readers < 0)
+				{
+					throw std::invalid_argument("DataStorageReaders shouldn't be negative!");
+				}
+
+				auto storage = std::make_shared<oanda::data_storage>(std::make_shared<sqlite::connection_pool>(open_db(), open_db, static_cast<size_t>(readers)));
+
+				LOG_INFO << "OANDA database connection created successfully.";
+
+				// SB: ticks older than this amount of hours are moved to compressed archive, 0 disables archiving
+				const auto tick_archive_age = get_value<int>(m_connector_settings, L"TickArchiveAge", 24 * 7);
+				if (tick_archive_age < 0)
+				{
+					throw std::invalid_argument("TickArchiveAge shouldn't be negative!");
+				}
+
+				// SB: ticks older than this amount of days are removed, 0 keeps them forever
+				const auto tick_retention_days = get_value<int>(m_connector_settings, L"TickRetentionDays", 0);
+				if (tick_retention_days < 0)
+				{
+					throw std::invalid_argument("TickRetentionDays shouldn't be negative!");
+				}
+
+				if (archiving && (0 != tick_archive_age || 0 != tick_retention_days))
+				{
+					storage->start_archiving(open_db(), std::chrono::hours(tick_archive_age), std::chrono::hours(24 * tick_retention_days), c_tick_archive_interval);
+				}
+
+				// SB: space freed by compaction and retention is returned to file system, so DB file doesn't grow beyond live data
+				if (archiving && get_value<bool>(m_connector_settings, L"DataStorageVacuum", true))
+				{
+					storage->start_vacuum(open_db(), c_vacuum_interval);
+				}
+
+				result = storage;
 			}
 			else
 			{
-				LOG_INFO << "Create OANDA database.";
+				throw std::invalid_argument("Unknown DataStorage setting value! Expected values: sqlite, mapped");
 			}
 
-			auto db = sqlite::connection::create(full_path);
+			return result;
+		}
 
-			LOG_INFO << "OANDA database connection created successfully.";
+		data_storage::ptr factory::create_storage()
+		{
+			auto result = open_storage(true);
 
-			return std::make_shared<oanda::data_storage>(db);
+			// SB: collectors of all instruments share the storage, so saves are grouped and written by the background thread
+			if (get_value<bool>(m_connector_settings, L"AsyncDataStorage", true))
+			{
+				const auto batch_size = get_value<int>(m_connector_settings, L"DataStorageBatchSize", 1000);
+				if (batch_size <= 0)
+				{
+					throw std::invalid_argument("DataStorageBatchSize should be positive!");
+				}
+
+				result = std::make_shared<async_storage>(result, static_cast<size_t>(batch_size));
+			}
+
+			// SB: memory budget of candles cache in megabytes, 0 disables caching
+			const auto cache_size = get_value<int>(m_connector_settings, L"DataCacheSize", 64);
+			if (cache_size < 0)
+			{
+				throw std::invalid_argument("DataCacheSize shouldn't be negative!");
+			}
+
+			if (0 == cache_size)
+			{
+				return result;
+			}
+
+			return std::make_shared<cached_storage>(result, values::instrument_data::c_timestamp, static_cast<size_t>(cache_size) * 1024 * 1024);
+		}
+
+		data_storage::ptr factory::create_bulk_storage()
+		{
+			return open_storage(false);
 		}
 
 		tbp::trader::ptr factory::create_trader(const tbp::connector::ptr& c)
@@ -0,0 +1,220 @@
+#include <oanda/http_client_pool.h>
+
+#include <win/thread.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		namespace
+		{
+			struct idle_client
+			{
+				http_client_pool::client_ptr client;
+				std::chrono::steady_clock::time_point released;
+			};
+
+			struct host_clients : sb::noncopyable
+			{
+				// SB: the most recently released client goes last
+				std::vector<idle_client> idle;
+				size_t clients = 0;
+				win::event released_evt;
+
+			public:
+				host_clients()
+					: released_evt(false, false)
+				{
+				}
+			};
+		}
+
+		//////////////////////////////////////////////////////////
+		// http_client_pool_state
+		// SB: it's shared with deleters of checked out clients, so client may outlive the pool
+
+		class http_client_pool_state : sb::noncopyable
+		{
+			win::critical_section m_cs;
+			const std::chrono::milliseconds m_idle_timeout;
+			const web::http::client::http_client_config m_config;
+
+			// SB: hosts are never removed, so pointers to them stay valid for deleters of checked out clients
+			std::unordered_map<std::wstring, std::unique_ptr<host_clients>> m_hosts;
+			http_client_pool_stats m_stats;
+
+		private:
+			// SB: should be called under lock. Expired clients are returned to be closed outside of the lock
+			std::vector<idle_client> expire_idle_clients()
+			{
+				const auto now = std::chrono::steady_clock::now();
+
+				std::vector<idle_client> result;
+				for (auto& host : m_hosts)
+				{
+					auto& idle = host.second->idle;
+					const auto first_alive = std::find_if(idle.begin(), idle.end(), [&](const idle_client& c) { return now - c.released < m_idle_timeout; });
+					const auto expired = static_cast<size_t>(first_alive - idle.begin());
+					if (0 == expired)
+					{
+						continue;
+					}
+
+					result.insert(result.end(), std::make_move_iterator(idle.begin()), std::make_move_iterator(first_alive));
+					idle.erase(idle.begin(), first_alive);
+
+					host.second->clients -= expired;
+					m_stats.clients -= expired;
+					m_stats.idle_clients -= expired;
+					m_stats.expirations += expired;
+				}
+
+				return result;
+			}
+
+			void release(host_clients* host, const http_client_pool::client_ptr& client)
+			{
+				{
+					win::scoped_lock lock(m_cs);
+
+					host->idle.push_back({ client, std::chrono::steady_clock::now() });
+					++m_stats.idle_clients;
+				}
+
+				host->released_evt.set();
+			}
+
+		public:
+			static http_client_pool::client_ptr checkout(const std::shared_ptr<http_client_pool_state>& state, const web::uri& uri)
+			{
+				const auto authority = uri.authority();
+
+				http_client_pool::client_ptr client;
+				host_clients* host = nullptr;
+				bool idle_left = false;
+				std::vector<idle_client> expired;
+				for (bool waited = false; ; waited = true)
+				{
+					{
+						win::scoped_lock lock(state->m_cs);
+
+						if (!waited)
+						{
+							++state->m_stats.checkouts;
+							expired = state->expire_idle_clients();
+						}
+
+						auto& entry = state->m_hosts[authority.to_string()];
+						if (nullptr == entry)
+						{
+							entry = std::make_unique<host_clients>();
+						}
+
+						host = entry.get();
+						if (!host->idle.empty())
+						{
+							// SB: the most recently used connection is the least likely to be dropped by server
+							client = std::move(host->idle.back().client);
+							host->idle.pop_back();
+							idle_left = !host->idle.empty();
+
+							--state->m_stats.idle_clients;
+							++state->m_stats.reuses;
+							break;
+						}
+
+						if (host->clients < state->m_stats.max_connections)
+						{
+							++host->clients;
+							++state->m_stats.clients;
+							++state->m_stats.connects;
+							break;
+						}
+
+						if (!waited)
+						{
+							++state->m_stats.waits;
+						}
+					}
+
+					host->released_evt.wait(INFINITE);
+				}
+
+				// SB: several releases wake only one waiting checkout, so the next one is woken by this checkout
+				if (idle_left)
+				{
+					host->released_evt.set();
+				}
+
+				if (nullptr == client)
+				{
+					try
+					{
+						client = std::make_shared<web::http::client::http_client>(authority, state->m_config);
+					}
+					catch (...)
+					{
+						{
+							win::scoped_lock lock(state->m_cs);
+
+							--host->clients;
+							--state->m_stats.clients;
+						}
+
+						// SB: waiting checkout can create the client instead
+						host->released_evt.set();
+
+						throw;
+					}
+				}
+
+				return http_client_pool::client_ptr(client.get(), [state, host, client](web::http::client::http_client*) { state->release(host, client); });
+			}
+
+			http_client_pool_stats stats()
+			{
+				win::scoped_lock lock(m_cs);
+
+				return m_stats;
+			}
+
+		public:
+			http_client_pool_state(size_t max_connections, std::chrono::milliseconds idle_timeout, const web::http::client::http_client_config& config)
+				: m_idle_timeout(idle_timeout)
+				, m_config(config)
+			{
+				m_stats.max_connections = max_connections;
+			}
+		};
+
+		//////////////////////////////////////////////////////////
+		// http_client_pool impl
+
+		const size_t http_client_pool::default_max_connections;
+		const std::chrono::seconds http_client_pool::default_idle_timeout(30);
+
+		http_client_pool::client_ptr http_client_pool::checkout(const web::uri& uri) const
+		{
+			return http_client_pool_state::checkout(m_state, uri);
+		}
+
+		http_client_pool_stats http_client_pool::stats() const
+		{
+			return m_state->stats();
+		}
+
+		http_client_pool::http_client_pool(size_t max_connections, std::chrono::milliseconds idle_timeout, const web::http::client::http_client_config& config)
+			: m_state(std::make_shared<http_client_pool_state>(max_connections, idle_timeout, config))
+		{
+			if (0 == max_connections)
+			{
+				throw std::invalid_argument("max_connections argument is zero!");
+			}
+		}
+	}
+}
\ No newline at end of file
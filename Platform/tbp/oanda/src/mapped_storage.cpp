@@ -0,0 +1,607 @@
+#include <oanda/mapped_storage.h>
+#include <oanda/data_storage.h>
+#include <logging/log.h>
+
+#include <common/string_cvt.h>
+
+#include <win/fs.h>
+#include <win/handle.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include <windows.h>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		namespace
+		{
+			const char c_file_magic[4] = { 'T', 'B', 'P', 'M' };
+			const unsigned long c_file_version = 1;
+
+			const unsigned long c_candles_record_type = 1;
+			const unsigned long c_ticks_record_type = 2;
+
+			// SB: header is written once when file is created, records start right after it
+			struct file_header
+			{
+				char magic[4];
+				unsigned long version;
+				unsigned long record_type;
+				unsigned long record_size;
+				unsigned long granularity;
+				unsigned long reserved[3];
+			};
+
+			static_assert(sizeof(file_header) == 32, "Mapped storage file header size is changed!");
+			static_assert(sizeof(mapped::candle_record) == 80, "Mapped storage candle record size is changed!");
+			static_assert(sizeof(mapped::tick_record) == 24, "Mapped storage tick record size is changed!");
+
+			/////////////////////////////////////////////////////////////////////
+			// region
+			// SB: read only view of the file beginning, it's shared by all record views created from it
+
+			class region : sb::noncopyable
+			{
+				win::common_handle m_section;
+				const byte_t* m_data;
+
+			private:
+				static HANDLE create_section(HANDLE file, size_t size)
+				{
+					ULARGE_INTEGER max_size;
+					max_size.QuadPart = size;
+					auto result = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, max_size.HighPart, max_size.LowPart, nullptr);
+					if (nullptr == result)
+					{
+						throw win::exception(L"CreateFileMappingW call failed!");
+					}
+
+					return result;
+				}
+
+				static const byte_t* map_view(HANDLE section, size_t size)
+				{
+					auto result = ::MapViewOfFile(section, FILE_MAP_READ, 0, 0, size);
+					if (nullptr == result)
+					{
+						throw win::exception(L"MapViewOfFile call failed!");
+					}
+
+					return static_cast<const byte_t*>(result);
+				}
+
+			public:
+				const byte_t* data() const
+				{
+					return m_data;
+				}
+
+			public:
+				region(HANDLE file, size_t size)
+					: m_section(create_section(file, size))
+					, m_data(map_view(m_section.value, size))
+				{
+				}
+
+				~region()
+				{
+					::UnmapViewOfFile(m_data);
+				}
+			};
+
+			HANDLE open_file(const std::wstring& path)
+			{
+				// SB: other processes can read the file while it's opened for append
+				auto result = ::CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (INVALID_HANDLE_VALUE == result)
+				{
+					throw win::exception(L"CreateFileW call failed!");
+				}
+
+				return result;
+			}
+
+			void set_position(HANDLE file, __int64 offset)
+			{
+				LARGE_INTEGER position;
+				position.QuadPart = offset;
+				if (0 == ::SetFilePointerEx(file, position, nullptr, FILE_BEGIN))
+				{
+					throw win::exception(L"SetFilePointerEx call failed!");
+				}
+			}
+
+			void read_file(HANDLE file, __int64 offset, void* data, size_t size)
+			{
+				set_position(file, offset);
+
+				DWORD read = 0;
+				if (0 == ::ReadFile(file, data, static_cast<DWORD>(size), &read, nullptr) || read != size)
+				{
+					throw win::exception(L"ReadFile call failed!");
+				}
+			}
+
+			void write_file(HANDLE file, __int64 offset, const void* data, size_t size)
+			{
+				set_position(file, offset);
+
+				DWORD written = 0;
+				if (0 == ::WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr) || written != size)
+				{
+					throw win::exception(L"WriteFile call failed!");
+				}
+			}
+
+			__int64 get_file_size(HANDLE file)
+			{
+				LARGE_INTEGER result;
+				if (0 == ::GetFileSizeEx(file, &result))
+				{
+					throw win::exception(L"GetFileSizeEx call failed!");
+				}
+
+				return result.QuadPart;
+			}
+
+			std::wstring candles_file_name(const std::wstring& instrument_id, unsigned long granularity)
+			{
+				return instrument_id + L"_" + std::to_wstring(granularity) + L".candles";
+			}
+
+			std::wstring ticks_file_name(const std::wstring& instrument_id)
+			{
+				return instrument_id + L".ticks";
+			}
+
+			// SB: the same range ends as SQLite storage returns
+			template <typename record_t>
+			void set_range(const mapped::view<record_t>& records, tbp::time_t* start_datetime, tbp::time_t* end_datetime)
+			{
+				if (records.size() <= 1)
+				{
+					*end_datetime = *start_datetime;
+
+					return;
+				}
+
+				*start_datetime = tbp::time_t(tbp::time_t::duration(records.begin()->timestamp));
+				*end_datetime = tbp::time_t(tbp::time_t::duration((records.end() - 1)->timestamp));
+			}
+
+			tbp::data_t to_candlestick_data(double open, double high, double low, double close)
+			{
+				tbp::data_t result;
+				result.reserve(4);
+
+				result[values::candlestick_data::c_open_price] = open;
+				result[values::candlestick_data::c_high_price] = high;
+				result[values::candlestick_data::c_low_price] = low;
+				result[values::candlestick_data::c_close_price] = close;
+
+				return result;
+			}
+
+			// SB: returns open, high, low, close prices
+			std::array<double, 4> from_candlestick_data(const tbp::data_t& instrument_data, const tbp::field_id& candlestick_name)
+			{
+				auto it = instrument_data.find(candlestick_name);
+				if (instrument_data.end() == it)
+				{
+					throw std::runtime_error("Candlestick value isn't provided by instrument data!");
+				}
+
+				const tbp::field_id candlestick_values[] =
+				{
+					values::candlestick_data::c_open_price,
+					values::candlestick_data::c_high_price,
+					values::candlestick_data::c_low_price,
+					values::candlestick_data::c_close_price,
+				};
+
+				std::array<double, 4> result;
+				const auto& candelstick_data = tbp::get<tbp::data_t>(it->second);
+				for (size_t i = 0; i < result.size(); ++i)
+				{
+					auto value_it = candelstick_data.find(candlestick_values[i]);
+					if (candelstick_data.end() == value_it)
+					{
+						throw std::runtime_error("Candlestick data incomplete!");
+					}
+
+					result[i] = tbp::get<double>(value_it->second);
+				}
+
+				return result;
+			}
+
+			template <typename T>
+			const T& get_field(const tbp::data_t& instrument_data, const tbp::field_id& name)
+			{
+				auto it = instrument_data.find(name);
+				if (instrument_data.end() == it)
+				{
+					throw std::runtime_error(sb::to_str(name.name() + L" value isn't provided by instrument data!"));
+				}
+
+				return tbp::get<T>(it->second);
+			}
+
+			template <typename series_t, typename convert_t>
+			series_t to_series(const mapped::candle_view& records, const convert_t& convert)
+			{
+				series_t result;
+				result.reserve(records.size());
+				for (const auto& r : records)
+				{
+					result.timestamp.push_back(tbp::time_t(tbp::time_t::duration(r.timestamp)));
+					result.volume.push_back(r.volume);
+					result.bid.open.push_back(convert(r.bid_open));
+					result.bid.high.push_back(convert(r.bid_high));
+					result.bid.low.push_back(convert(r.bid_low));
+					result.bid.close.push_back(convert(r.bid_close));
+					result.ask.open.push_back(convert(r.ask_open));
+					result.ask.high.push_back(convert(r.ask_high));
+					result.ask.low.push_back(convert(r.ask_low));
+					result.ask.close.push_back(convert(r.ask_close));
+
+					// SB: only complete candles are stored
+					result.complete.push_back(1);
+				}
+
+				return result;
+			}
+		}
+
+		/////////////////////////////////////////////////////////////////////
+		// mapped_storage::file
+
+		class mapped_storage::file : sb::noncopyable
+		{
+			const win::common_handle m_handle;
+			const size_t m_record_size;
+			win::critical_section m_cs;
+			size_t m_count;
+			__int64 m_last_timestamp;
+
+			// SB: region is remapped only when new records were appended since the last read
+			std::shared_ptr<const region> m_region;
+			size_t m_region_count;
+
+		private:
+			void init(const std::wstring& path, unsigned long record_type, unsigned long granularity)
+			{
+				const auto size = get_file_size(m_handle.value);
+				if (0 == size)
+				{
+					file_header header = {};
+					std::copy(std::begin(c_file_magic), std::end(c_file_magic), header.magic);
+					header.version = c_file_version;
+					header.record_type = record_type;
+					header.record_size = static_cast<unsigned long>(m_record_size);
+					header.granularity = granularity;
+
+					write_file(m_handle.value, 0, &header, sizeof(header));
+
+					return;
+				}
+
+				file_header header = {};
+				if (size < static_cast<__int64>(sizeof(header)))
+				{
+					throw std::runtime_error("Mapped storage file is corrupted! Path: " + sb::to_str(path));
+				}
+
+				read_file(m_handle.value, 0, &header, sizeof(header));
+				if (!std::equal(std::begin(c_file_magic), std::end(c_file_magic), header.magic) ||
+					c_file_version != header.version ||
+					record_type != header.record_type ||
+					m_record_size != header.record_size ||
+					granularity != header.granularity)
+				{
+					throw std::runtime_error("Mapped storage file has unexpected format! Path: " + sb::to_str(path));
+				}
+
+				// SB: partial record can be left by interrupted append, it's ignored and overwritten by the next one
+				const auto records_size = size - static_cast<__int64>(sizeof(header));
+				m_count = static_cast<size_t>(records_size / m_record_size);
+				if (0 != records_size % m_record_size)
+				{
+					LOG_WARN << L"Mapped storage file has incomplete record at the end. Path: " << path;
+				}
+
+				if (0 != m_count)
+				{
+					// SB: timestamp is the first field of each record type
+					read_file(m_handle.value, sizeof(header) + static_cast<__int64>(m_count - 1) * m_record_size, &m_last_timestamp, sizeof(m_last_timestamp));
+				}
+			}
+
+		public:
+			template <typename record_t>
+			mapped::view<record_t> get_range(const tbp::time_t& start_datetime, const tbp::time_t& end_datetime)
+			{
+				std::shared_ptr<const region> r;
+				size_t count = 0;
+				{
+					win::scoped_lock lock(m_cs);
+
+					if (0 == m_count)
+					{
+						return mapped::view<record_t>();
+					}
+
+					if (m_region_count != m_count)
+					{
+						m_region = std::make_shared<region>(m_handle.value, sizeof(file_header) + m_count * m_record_size);
+						m_region_count = m_count;
+					}
+
+					r = m_region;
+					count = m_region_count;
+				}
+
+				const auto start = start_datetime.time_since_epoch().count();
+				const auto end = end_datetime.time_since_epoch().count();
+				const auto first = reinterpret_cast<const record_t*>(r->data() + sizeof(file_header));
+				const auto last = first + count;
+
+				auto range_first = std::lower_bound(first, last, start, [](const record_t& record, __int64 timestamp) { return record.timestamp < timestamp; });
+				auto range_last = std::upper_bound(range_first, last, end, [](__int64 timestamp, const record_t& record) { return timestamp < record.timestamp; });
+
+				return mapped::view<record_t>(r, range_first, static_cast<size_t>(range_last - range_first));
+			}
+
+			// SB: records with timestamp not greater than the last stored one are skipped
+			template <typename record_t>
+			void append(const std::vector<record_t>& records)
+			{
+				win::scoped_lock lock(m_cs);
+
+				std::vector<record_t> new_records;
+				new_records.reserve(records.size());
+
+				auto last_timestamp = m_last_timestamp;
+				for (const auto& r : records)
+				{
+					if (r.timestamp > last_timestamp)
+					{
+						new_records.push_back(r);
+						last_timestamp = r.timestamp;
+					}
+				}
+
+				if (new_records.size() != records.size())
+				{
+					LOG_DBG << L"Mapped storage skips records which are older than stored ones. Count: " << records.size() - new_records.size();
+				}
+
+				if (new_records.empty())
+				{
+					return;
+				}
+
+				write_file(m_handle.value, sizeof(file_header) + static_cast<__int64>(m_count) * m_record_size, new_records.data(), new_records.size() * sizeof(record_t));
+
+				m_count += new_records.size();
+				m_last_timestamp = last_timestamp;
+			}
+
+		public:
+			file(const std::wstring& path, unsigned long record_type, size_t record_size, unsigned long granularity)
+				: m_handle(open_file(path))
+				, m_record_size(record_size)
+				, m_count(0)
+				, m_last_timestamp(std::numeric_limits<__int64>::min())
+				, m_region_count(0)
+			{
+				init(path, record_type, granularity);
+			}
+		};
+
+		/////////////////////////////////////////////////////////////////////
+		// mapped_storage
+
+		mapped_storage::file_ptr mapped_storage::get_file(const std::wstring& file_name, unsigned long record_type, unsigned long granularity, bool create) const
+		{
+			win::scoped_lock lock(m_files_cs);
+
+			auto it = m_files.find(file_name);
+			if (m_files.end() != it)
+			{
+				return it->second;
+			}
+
+			using win::fs::operator/;
+			const auto path = m_path / file_name;
+			if (!create && !win::fs::exists(path))
+			{
+				return nullptr;
+			}
+
+			const auto record_size = c_candles_record_type == record_type ? sizeof(mapped::candle_record) : sizeof(mapped::tick_record);
+			auto result = std::make_shared<file>(path, record_type, record_size, granularity);
+			m_files.emplace(file_name, result);
+
+			return result;
+		}
+
+		mapped::candle_view mapped_storage::get_candle_view(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const
+		{
+			if (nullptr == start_datetime || nullptr == end_datetime)
+			{
+				throw std::invalid_argument("start_datetime or end_datetime argument is null!");
+			}
+
+			mapped::candle_view result;
+			auto f = get_file(candles_file_name(instrument_id, granularity), c_candles_record_type, granularity, false);
+			if (nullptr != f)
+			{
+				result = f->get_range<mapped::candle_record>(*start_datetime, *end_datetime);
+			}
+
+			set_range(result, start_datetime, end_datetime);
+
+			return result;
+		}
+
+		mapped::tick_view mapped_storage::get_tick_view(const std::wstring& instrument_id, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const
+		{
+			if (nullptr == start_datetime || nullptr == end_datetime)
+			{
+				throw std::invalid_argument("start_datetime or end_datetime argument is null!");
+			}
+
+			mapped::tick_view result;
+			auto f = get_file(ticks_file_name(instrument_id), c_ticks_record_type, 0, false);
+			if (nullptr != f)
+			{
+				result = f->get_range<mapped::tick_record>(*start_datetime, *end_datetime);
+			}
+
+			set_range(result, start_datetime, end_datetime);
+
+			return result;
+		}
+
+		std::vector<data_t::ptr> mapped_storage::get_data(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const
+		{
+			const auto records = get_candle_view(instrument_id, granularity, start_datetime, end_datetime);
+
+			std::vector<data_t::ptr> result;
+			result.reserve(records.size());
+			for (const auto& r : records)
+			{
+				tbp::data_t record;
+				record.reserve(4);
+				record[values::instrument_data::c_timestamp] = tbp::time_t(tbp::time_t::duration(r.timestamp));
+				record[values::instrument_data::c_volume] = r.volume;
+				record.emplace(values::instrument_data::c_bid_candlestick, to_candlestick_data(r.bid_open, r.bid_high, r.bid_low, r.bid_close));
+				record.emplace(values::instrument_data::c_ask_candlestick, to_candlestick_data(r.ask_open, r.ask_high, r.ask_low, r.ask_close));
+
+				result.emplace_back(std::make_shared<tbp::data_t>(std::move(record)));
+			}
+
+			return result;
+		}
+
+		std::vector<data_t::ptr> mapped_storage::get_instant_data(const std::wstring& instrument_id, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const
+		{
+			const auto records = get_tick_view(instrument_id, start_datetime, end_datetime);
+
+			std::vector<data_t::ptr> result;
+			result.reserve(records.size());
+			for (const auto& r : records)
+			{
+				tbp::data_t record;
+				record.reserve(3);
+				record.emplace(values::instrument_data::c_timestamp, tbp::time_t(tbp::time_t::duration(r.timestamp)));
+				record.emplace(values::instant_data::c_bid_price, r.bid);
+				record.emplace(values::instant_data::c_ask_price, r.ask);
+
+				result.emplace_back(std::make_shared<tbp::data_t>(std::move(record)));
+			}
+
+			return result;
+		}
+
+		candle_series mapped_storage::get_candles(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const
+		{
+			return to_series<candle_series>(get_candle_view(instrument_id, granularity, start_datetime, end_datetime), [](double price) { return price; });
+		}
+
+		fixed_candle_series mapped_storage::get_fixed_candles(const std::wstring& instrument_id, unsigned long granularity, unsigned long precision, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const
+		{
+			return to_series<fixed_candle_series>(get_candle_view(instrument_id, granularity, start_datetime, end_datetime), [precision](double price) { return to_fixed(price, precision); });
+		}
+
+		void mapped_storage::save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<data_t::ptr>& data)
+		{
+			std::vector<mapped::candle_record> records;
+			records.reserve(data.size());
+			for (const auto& instrument_data : data)
+			{
+				auto complete_it = instrument_data->find(values::instrument_data::c_complete);
+				if (instrument_data->end() != complete_it && !tbp::get<bool>(complete_it->second))
+				{
+					continue;
+				}
+
+				const auto bid = from_candlestick_data(*instrument_data, values::instrument_data::c_bid_candlestick);
+				const auto ask = from_candlestick_data(*instrument_data, values::instrument_data::c_ask_candlestick);
+
+				mapped::candle_record r;
+				r.timestamp = get_field<tbp::time_t>(*instrument_data, values::instrument_data::c_timestamp).time_since_epoch().count();
+				r.volume = get_field<__int64>(*instrument_data, values::instrument_data::c_volume);
+				r.bid_open = bid[0];
+				r.bid_high = bid[1];
+				r.bid_low = bid[2];
+				r.bid_close = bid[3];
+				r.ask_open = ask[0];
+				r.ask_high = ask[1];
+				r.ask_low = ask[2];
+				r.ask_close = ask[3];
+
+				records.push_back(r);
+			}
+
+			get_file(candles_file_name(instrument_id, granularity), c_candles_record_type, granularity, true)->append(records);
+		}
+
+		void mapped_storage::save_instant_data(const std::wstring& instrument_id, const std::vector<data_t::ptr>& data)
+		{
+			std::vector<mapped::tick_record> records;
+			records.reserve(data.size());
+			for (const auto& instrument_data : data)
+			{
+				mapped::tick_record r;
+				r.timestamp = get_field<tbp::time_t>(*instrument_data, values::instrument_data::c_timestamp).time_since_epoch().count();
+				r.bid = get_field<double>(*instrument_data, values::instant_data::c_bid_price);
+				r.ask = get_field<double>(*instrument_data, values::instant_data::c_ask_price);
+
+				records.push_back(r);
+			}
+
+			get_file(ticks_file_name(instrument_id), c_ticks_record_type, 0, true)->append(records);
+		}
+
+		void mapped_storage::save_candles(const std::wstring& instrument_id, unsigned long granularity, const candle_series& candles)
+		{
+			std::vector<mapped::candle_record> records;
+			records.reserve(candles.size());
+			for (size_t i = 0; i < candles.size(); ++i)
+			{
+				if (0 == candles.complete[i])
+				{
+					continue;
+				}
+
+				mapped::candle_record r;
+				r.timestamp = candles.timestamp[i].time_since_epoch().count();
+				r.volume = candles.volume[i];
+				r.bid_open = candles.bid.open[i];
+				r.bid_high = candles.bid.high[i];
+				r.bid_low = candles.bid.low[i];
+				r.bid_close = candles.bid.close[i];
+				r.ask_open = candles.ask.open[i];
+				r.ask_high = candles.ask.high[i];
+				r.ask_low = candles.ask.low[i];
+				r.ask_close = candles.ask.close[i];
+
+				records.push_back(r);
+			}
+
+			get_file(candles_file_name(instrument_id, granularity), c_candles_record_type, granularity, true)->append(records);
+		}
+
+		mapped_storage::mapped_storage(const std::wstring& path)
+			: m_path(path)
+		{
+			win::fs::create_path(m_path);
+		}
+	}
+}
\ No newline at end of file
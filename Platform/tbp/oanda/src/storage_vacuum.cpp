@@ -0,0 +1,145 @@
+#include <oanda/storage_vacuum.h>
+#include <logging/log.h>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		namespace
+		{
+			// SB: 4 MB of default 4 KB pages
+			const size_t c_step_pages = 1000;
+
+			// SB: writes of data storage take the lock between steps
+			const unsigned long c_step_pause = 100;
+		}
+
+		namespace vacuum
+		{
+			void enable(const sqlite::connection::ptr& db)
+			{
+				if (sqlite::auto_vacuum_mode::incremental == db->auto_vacuum())
+				{
+					return;
+				}
+
+				LOG_INFO << L"Rebuilding DB file to enable incremental vacuum. Pages count: " << db->page_count() << L" Free pages count: " << db->freelist_count();
+
+				db->set_auto_vacuum(sqlite::auto_vacuum_mode::incremental);
+				db->vacuum();
+
+				LOG_INFO << L"DB file has been rebuilt successfully! Pages count: " << db->page_count();
+			}
+
+			size_t step(const sqlite::connection::ptr& db, size_t pages)
+			{
+				if (0 == pages)
+				{
+					throw std::invalid_argument("pages argument is zero!");
+				}
+
+				sqlite::transaction t(db);
+
+				try
+				{
+					// SB: zero argument of incremental vacuum means all free pages
+					const auto free_pages = db->freelist_count();
+					if (0 != free_pages)
+					{
+						db->incremental_vacuum(std::min(pages, free_pages));
+					}
+
+					const auto released_pages = free_pages - db->freelist_count();
+
+					t.commit();
+
+					return released_pages;
+				}
+				catch (...)
+				{
+					t.rollback();
+					throw;
+				}
+			}
+		}
+
+		//////////////////////////////////////////////////////////////////
+		// storage_vacuum impl
+
+		void storage_vacuum::vacuum_thread()
+		{
+			// SB: rebuild takes a while for big DB, so it's done here instead of the thread which starts vacuum.
+			// Steps of vacuum are still useful for DB which has failed to be rebuilt, it's rebuilt on the next start
+			try
+			{
+				vacuum::enable(m_db);
+			}
+			catch (const sqlite::exception& ex)
+			{
+				LOG_ERR << L"DB error during rebuild of DB file. Code: " << ex.code << L" Info: " << ex.description;
+			}
+			catch (const std::exception& ex)
+			{
+				LOG_ERR << L"Exception was thrown during rebuild of DB file. Info: " << ex.what();
+			}
+			catch (...)
+			{
+				LOG_ERR << L"Unknown error! Exception was thrown during rebuild of DB file!";
+			}
+
+			do
+			{
+				try
+				{
+					size_t released_pages = 0;
+					for (;;)
+					{
+						const auto pages = vacuum::step(m_db, c_step_pages);
+						released_pages += pages;
+
+						if (pages < c_step_pages || m_stop_evt.wait(c_step_pause))
+						{
+							break;
+						}
+					}
+
+					if (0 != released_pages)
+					{
+						LOG_INFO << L"Free DB pages have been released. Count: " << released_pages << L" Pages count: " << m_db->page_count();
+					}
+				}
+				catch (const sqlite::exception& ex)
+				{
+					LOG_ERR << L"DB error during storage vacuum. Code: " << ex.code << L" Info: " << ex.description;
+				}
+				catch (const std::exception& ex)
+				{
+					LOG_ERR << L"Exception was thrown during storage vacuum. Info: " << ex.what();
+				}
+				catch (...)
+				{
+					LOG_ERR << L"Unknown error! Exception was thrown during storage vacuum!";
+				}
+			}
+			while (!m_stop_evt.wait(m_interval));
+		}
+
+		storage_vacuum::storage_vacuum(const sqlite::connection::ptr& db, std::chrono::milliseconds interval)
+			: m_db(db)
+			, m_interval(static_cast<unsigned long>(interval.count()))
+			, m_stop_evt(true, false)
+			, m_worker(std::bind(&storage_vacuum::vacuum_thread, this))
+		{
+		}
+
+		storage_vacuum::~storage_vacuum()
+		{
+			m_stop_evt.set();
+			m_worker.join();
+		}
+	}
+}
\ No newline at end of file
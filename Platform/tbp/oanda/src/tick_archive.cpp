@@ -0,0 +1,655 @@
+#include <oanda/tick_archive.h>
+#include <oanda/tick_partitions.h>
+#include <logging/log.h>
+
+#include <zlib/zlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		namespace archive
+		{
+			namespace
+			{
+				const byte_t c_block_version = 1;
+
+				// SB: price scale exponent which means that prices are stored as XOR of bits
+				const byte_t c_xor_prices = 0xFF;
+				const int c_max_price_scale_exponent = 9;
+
+				// SB: integer quotes should be exactly representable by double
+				const double c_max_quote = 9007199254740992.0;
+
+				void corrupted_block()
+				{
+					throw std::runtime_error("Tick archive block is corrupted!");
+				}
+
+				template <typename T>
+				void put_fixed(T value, binary_t* out)
+				{
+					const auto pos = out->size();
+					out->resize(pos + sizeof(T));
+					std::memcpy(&(*out)[pos], &value, sizeof(T));
+				}
+
+				template <typename T>
+				T get_fixed(const byte_t** pos, const byte_t* end)
+				{
+					if (end - *pos < static_cast<ptrdiff_t>(sizeof(T)))
+					{
+						corrupted_block();
+					}
+
+					T value;
+					std::memcpy(&value, *pos, sizeof(T));
+					*pos += sizeof(T);
+
+					return value;
+				}
+
+				unsigned __int64 zigzag(__int64 value)
+				{
+					return (static_cast<unsigned __int64>(value) << 1) ^ static_cast<unsigned __int64>(value >> 63);
+				}
+
+				__int64 unzigzag(unsigned __int64 value)
+				{
+					return static_cast<__int64>(value >> 1) ^ -static_cast<__int64>(value & 1);
+				}
+
+				void put_varint(__int64 value, binary_t* out)
+				{
+					auto bits = zigzag(value);
+					while (bits >= 0x80)
+					{
+						out->push_back(static_cast<byte_t>(bits | 0x80));
+						bits >>= 7;
+					}
+
+					out->push_back(static_cast<byte_t>(bits));
+				}
+
+				__int64 get_varint(const byte_t** pos, const byte_t* end)
+				{
+					unsigned __int64 bits = 0;
+					for (int shift = 0; shift < 64; shift += 7)
+					{
+						if (*pos == end)
+						{
+							corrupted_block();
+						}
+
+						const byte_t b = *(*pos)++;
+						bits |= static_cast<unsigned __int64>(b & 0x7F) << shift;
+						if (0 == (b & 0x80))
+						{
+							return unzigzag(bits);
+						}
+					}
+
+					corrupted_block();
+					return 0;
+				}
+
+				__int64 to_quote(double price, double scale)
+				{
+					return static_cast<__int64>(std::floor(price * scale + 0.5));
+				}
+
+				// SB: returns the greatest common divisor of timestamp offsets from the first tick
+				__int64 find_timestamp_unit(const std::vector<tick>& ticks)
+				{
+					__int64 unit = 0;
+					for (const auto& t : ticks)
+					{
+						auto offset = t.timestamp - ticks.front().timestamp;
+						while (0 != offset)
+						{
+							const auto rest = unit % offset;
+							unit = offset;
+							offset = rest;
+						}
+					}
+
+					return 0 == unit ? 1 : std::abs(unit);
+				}
+
+				// SB: returns the smallest decimal exponent which turns all prices to integer quotes without loss, or c_xor_prices
+				byte_t find_price_scale_exponent(const std::vector<tick>& ticks)
+				{
+					double scale = 1.0;
+					for (int exponent = 0; exponent <= c_max_price_scale_exponent; ++exponent, scale *= 10.0)
+					{
+						const bool exact = std::all_of(ticks.begin(), ticks.end(), [scale](const tick& t)
+						{
+							for (const auto price : { t.bid, t.ask })
+							{
+								if (!(std::fabs(price * scale) < c_max_quote) || static_cast<double>(to_quote(price, scale)) / scale != price)
+								{
+									return false;
+								}
+							}
+
+							return true;
+						});
+
+						if (exact)
+						{
+							return static_cast<byte_t>(exponent);
+						}
+					}
+
+					return c_xor_prices;
+				}
+
+				// SB: bytes of XOR values are transposed, so zero high bytes of all values go one after another and compress well
+				void put_xor_prices(const std::vector<tick>& ticks, double tick::* price, binary_t* out)
+				{
+					const auto count = ticks.size();
+					const auto pos = out->size();
+					out->resize(pos + count * sizeof(unsigned __int64));
+
+					unsigned __int64 prev_bits = 0;
+					for (size_t i = 0; i < count; ++i)
+					{
+						unsigned __int64 bits;
+						std::memcpy(&bits, &(ticks[i].*price), sizeof(bits));
+
+						const auto value = bits ^ prev_bits;
+						prev_bits = bits;
+
+						for (size_t b = 0; b < sizeof(value); ++b)
+						{
+							(*out)[pos + b * count + i] = static_cast<byte_t>(value >> (8 * b));
+						}
+					}
+				}
+
+				void get_xor_prices(const byte_t** pos, const byte_t* end, double tick::* price, tick* ticks, size_t count)
+				{
+					if (static_cast<size_t>(end - *pos) / sizeof(unsigned __int64) < count)
+					{
+						corrupted_block();
+					}
+
+					const byte_t* planes = *pos;
+					unsigned __int64 bits = 0;
+					for (size_t i = 0; i < count; ++i)
+					{
+						unsigned __int64 value = 0;
+						for (size_t b = 0; b < sizeof(value); ++b)
+						{
+							value |= static_cast<unsigned __int64>(planes[b * count + i]) << (8 * b);
+						}
+
+						bits ^= value;
+						std::memcpy(&(ticks[i].*price), &bits, sizeof(bits));
+					}
+
+					*pos += count * sizeof(unsigned __int64);
+				}
+			}
+
+			binary_t encode_block(const std::vector<tick>& ticks)
+			{
+				const auto price_scale_exponent = find_price_scale_exponent(ticks);
+
+				binary_t raw;
+				raw.reserve(ticks.size() * 8 + 16);
+				raw.push_back(c_block_version);
+				raw.push_back(price_scale_exponent);
+				put_fixed(static_cast<unsigned long>(ticks.size()), &raw);
+
+				// TIMESTAMP
+				// SB: timestamps are stored in units of their common precision (e.g. microseconds of OANDA API), it keeps deltas short
+				const __int64 first_timestamp = ticks.empty() ? 0 : ticks.front().timestamp;
+				const auto unit = find_timestamp_unit(ticks);
+				put_varint(first_timestamp, &raw);
+				put_varint(unit, &raw);
+
+				__int64 prev_timestamp = 0;
+				__int64 prev_delta = 0;
+				for (const auto& t : ticks)
+				{
+					const auto timestamp = (t.timestamp - first_timestamp) / unit;
+					const auto delta = timestamp - prev_timestamp;
+					put_varint(delta - prev_delta, &raw);
+
+					prev_timestamp = timestamp;
+					prev_delta = delta;
+				}
+
+				// BID, ASK
+				if (c_xor_prices == price_scale_exponent)
+				{
+					put_xor_prices(ticks, &tick::bid, &raw);
+					put_xor_prices(ticks, &tick::ask, &raw);
+				}
+				else
+				{
+					const auto scale = std::pow(10.0, price_scale_exponent);
+
+					__int64 prev_bid = 0;
+					for (const auto& t : ticks)
+					{
+						const auto bid = to_quote(t.bid, scale);
+						put_varint(bid - prev_bid, &raw);
+						prev_bid = bid;
+					}
+
+					// SB: spread changes rarely, so ask is stored as delta of spread
+					__int64 prev_spread = 0;
+					for (const auto& t : ticks)
+					{
+						const auto spread = to_quote(t.ask, scale) - to_quote(t.bid, scale);
+						put_varint(spread - prev_spread, &raw);
+						prev_spread = spread;
+					}
+				}
+
+				// SB: block starts with raw size, so decoder allocates output buffer once
+				auto compressed_size = ::compressBound(static_cast<uLong>(raw.size()));
+				binary_t result;
+				put_fixed(static_cast<unsigned long>(raw.size()), &result);
+
+				const auto header_size = result.size();
+				result.resize(header_size + compressed_size);
+				if (Z_OK != ::compress2(&result[header_size], &compressed_size, raw.data(), static_cast<uLong>(raw.size()), Z_BEST_COMPRESSION))
+				{
+					throw std::runtime_error("Tick archive block compression failed!");
+				}
+
+				result.resize(header_size + compressed_size);
+
+				return result;
+			}
+
+			void decode_block(const byte_t* data, size_t size, std::vector<tick>* result)
+			{
+				const byte_t* pos = data;
+				const byte_t* end = pos + size;
+
+				uLongf raw_size = get_fixed<unsigned long>(&pos, end);
+				binary_t raw(raw_size);
+				if (Z_OK != ::uncompress(raw.data(), &raw_size, pos, static_cast<uLong>(end - pos)) || raw_size != raw.size())
+				{
+					corrupted_block();
+				}
+
+				pos = raw.data();
+				end = pos + raw.size();
+
+				const auto version = get_fixed<byte_t>(&pos, end);
+				if (c_block_version != version)
+				{
+					throw std::runtime_error("Unknown tick archive block version!");
+				}
+
+				const auto price_scale_exponent = get_fixed<byte_t>(&pos, end);
+				const size_t count = get_fixed<unsigned long>(&pos, end);
+
+				// SB: each tick takes at least one byte per value
+				if (count > raw.size())
+				{
+					corrupted_block();
+				}
+
+				const auto first = result->size();
+				result->resize(first + count);
+				tick* ticks = result->data() + first;
+
+				// TIMESTAMP
+				const auto first_timestamp = get_varint(&pos, end);
+				const auto unit = get_varint(&pos, end);
+				if (unit <= 0)
+				{
+					corrupted_block();
+				}
+
+				__int64 timestamp = 0;
+				__int64 delta = 0;
+				for (size_t i = 0; i < count; ++i)
+				{
+					delta += get_varint(&pos, end);
+					timestamp += delta;
+					ticks[i].timestamp = first_timestamp + timestamp * unit;
+				}
+
+				// BID, ASK
+				if (c_xor_prices == price_scale_exponent)
+				{
+					get_xor_prices(&pos, end, &tick::bid, ticks, count);
+					get_xor_prices(&pos, end, &tick::ask, ticks, count);
+				}
+				else
+				{
+					if (price_scale_exponent > c_max_price_scale_exponent)
+					{
+						corrupted_block();
+					}
+
+					const auto scale = std::pow(10.0, price_scale_exponent);
+
+					std::vector<__int64> bids(count);
+					__int64 bid = 0;
+					for (size_t i = 0; i < count; ++i)
+					{
+						bid += get_varint(&pos, end);
+						bids[i] = bid;
+						ticks[i].bid = static_cast<double>(bid) / scale;
+					}
+
+					__int64 spread = 0;
+					for (size_t i = 0; i < count; ++i)
+					{
+						spread += get_varint(&pos, end);
+						ticks[i].ask = static_cast<double>(bids[i] + spread) / scale;
+					}
+				}
+			}
+
+			void decode_block(const binary_t& block, std::vector<tick>* result)
+			{
+				decode_block(block.data(), block.size(), result);
+			}
+		}
+
+		namespace
+		{
+			const __int64 c_block_duration = std::chrono::duration_cast<time_t::duration>(std::chrono::hours(1)).count();
+
+			const wchar_t* const c_select_block_query = L"SELECT DATA FROM INSTANT_DATA_ARCHIVE WHERE INSTRUMENT_ID = ?1 AND START_TIMESTAMP = ?2";
+
+			// SB: ticks of 'fresh' replace ticks of 'archived' with the same timestamp, both sequences are sorted
+			std::vector<archive::tick> merge(const std::vector<archive::tick>& archived, const std::vector<archive::tick>& fresh)
+			{
+				std::vector<archive::tick> result;
+				result.reserve(archived.size() + fresh.size());
+
+				auto it = archived.begin();
+				for (const auto& t : fresh)
+				{
+					for (; archived.end() != it && it->timestamp < t.timestamp; ++it)
+					{
+						result.push_back(*it);
+					}
+
+					if (archived.end() != it && it->timestamp == t.timestamp)
+					{
+						++it;
+					}
+
+					result.push_back(t);
+				}
+
+				result.insert(result.end(), it, archived.end());
+
+				return result;
+			}
+		}
+
+		//////////////////////////////////////////////////////////////////
+		// tick_archive impl
+
+		void tick_archive::create_table(const sqlite::connection::ptr& db)
+		{
+			auto st = db->create_statement(LR"(
+				CREATE TABLE IF NOT EXISTS [INSTANT_DATA_ARCHIVE]([INSTRUMENT_ID] INTEGER NOT NULL REFERENCES INSTRUMENTS(ID) ON DELETE CASCADE, [START_TIMESTAMP] INTEGER NOT NULL,
+					[END_TIMESTAMP] INTEGER NOT NULL, [COUNT] INTEGER NOT NULL, [DATA] BLOB NOT NULL, PRIMARY KEY([INSTRUMENT_ID], [START_TIMESTAMP])) WITHOUT ROWID )");
+			st->step();
+		}
+
+		void tick_archive::read(const std::wstring& instrument_id, time_t start_datetime, time_t end_datetime, std::vector<archive::tick>* result) const
+		{
+			const auto start = start_datetime.time_since_epoch().count();
+			const auto end = end_datetime.time_since_epoch().count();
+
+			// SB: block starts at the beginning of its hour, so blocks which started earlier than one hour before the range can't overlap it
+			auto st = m_db->cached_statement(LR"(
+				SELECT DATA
+					FROM INSTANT_DATA_ARCHIVE
+					WHERE INSTRUMENT_ID = (SELECT ID FROM INSTRUMENTS WHERE INSTRUMENTS.NAME = ?1) AND START_TIMESTAMP > ?2 AND START_TIMESTAMP <= ?3 AND END_TIMESTAMP >= ?4 ORDER BY START_TIMESTAMP ASC )");
+
+			st->bind_text(instrument_id, 1);
+			st->bind_int64(start - c_block_duration, 2);
+			st->bind_int64(end, 3);
+			st->bind_int64(start, 4);
+
+			std::vector<archive::tick> ticks;
+			while (st->step())
+			{
+				ticks.clear();
+				const auto block = st->get_blob_span(0);
+				archive::decode_block(block.data, block.size, &ticks);
+
+				auto first = std::lower_bound(ticks.begin(), ticks.end(), start, [](const archive::tick& t, __int64 timestamp) { return t.timestamp < timestamp; });
+				auto last = std::upper_bound(first, ticks.end(), end, [](__int64 timestamp, const archive::tick& t) { return timestamp < t.timestamp; });
+				result->insert(result->end(), first, last);
+			}
+		}
+
+		size_t tick_archive::compact(time_t cutoff)
+		{
+			// SB: only complete hours are archived
+			const auto cutoff_timestamp = cutoff.time_since_epoch().count() / c_block_duration * c_block_duration;
+
+			std::vector<__int64> instruments;
+			{
+				auto st = m_db->cached_statement(L"SELECT ID FROM INSTRUMENTS");
+				while (st->step())
+				{
+					instruments.push_back(st->get_int64(0));
+				}
+			}
+
+			tick_partitions partitions(m_db);
+
+			size_t moved_ticks = 0;
+			for (const auto day : partitions.find(std::numeric_limits<__int64>::min(), cutoff_timestamp - 1))
+			{
+				// SB: day starts at the beginning of hour, so blocks never cross partitions
+				const auto table_name = tick_partitions::get_table_name(day);
+				const auto select_first_query = L"SELECT TIMESTAMP FROM [" + table_name + L"] WHERE INSTRUMENT_ID = ?1 AND TIMESTAMP < ?2 ORDER BY TIMESTAMP ASC LIMIT 1";
+				const auto select_block_ticks_query = L"SELECT TIMESTAMP, BID, ASK FROM [" + table_name + L"] WHERE INSTRUMENT_ID = ?1 AND TIMESTAMP >= ?2 AND TIMESTAMP < ?3 ORDER BY TIMESTAMP ASC";
+				const auto delete_block_ticks_query = L"DELETE FROM [" + table_name + L"] WHERE INSTRUMENT_ID = ?1 AND TIMESTAMP >= ?2 AND TIMESTAMP < ?3";
+
+				for (const auto instrument_row_id : instruments)
+				{
+					for (;;)
+					{
+						__int64 block_start = 0;
+						{
+							auto st = m_db->cached_statement(select_first_query);
+							st->bind_int64(instrument_row_id, 1);
+							st->bind_int64(cutoff_timestamp, 2);
+							if (!st->step())
+							{
+								break;
+							}
+
+							const auto first_timestamp = st->get_int64(0);
+							block_start = first_timestamp - (first_timestamp % c_block_duration + c_block_duration) % c_block_duration;
+						}
+
+						const auto block_end = block_start + c_block_duration;
+
+						sqlite::transaction t(m_db);
+
+						try
+						{
+							std::vector<archive::tick> fresh;
+							{
+								auto st = m_db->cached_statement(select_block_ticks_query);
+								st->bind_int64(instrument_row_id, 1);
+								st->bind_int64(block_start, 2);
+								st->bind_int64(block_end, 3);
+								while (st->step())
+								{
+									fresh.push_back({ st->get_int64(0), st->get_double(1), st->get_double(2) });
+								}
+							}
+
+							std::vector<archive::tick> archived;
+							{
+								auto st = m_db->cached_statement(c_select_block_query);
+								st->bind_int64(instrument_row_id, 1);
+								st->bind_int64(block_start, 2);
+								if (st->step())
+								{
+									const auto block = st->get_blob_span(0);
+									archive::decode_block(block.data, block.size, &archived);
+								}
+							}
+
+							const auto ticks = merge(archived, fresh);
+
+							{
+								const auto block = archive::encode_block(ticks);
+								auto st = m_db->cached_statement(L"INSERT OR REPLACE INTO INSTANT_DATA_ARCHIVE(INSTRUMENT_ID, START_TIMESTAMP, END_TIMESTAMP, COUNT, DATA) VALUES (?1, ?2, ?3, ?4, ?5)");
+								st->bind_int64(instrument_row_id, 1);
+								st->bind_int64(block_start, 2);
+								st->bind_int64(ticks.back().timestamp, 3);
+								st->bind_int64(static_cast<__int64>(ticks.size()), 4);
+								st->bind_blob(block, 5);
+								st->step();
+							}
+
+							{
+								auto st = m_db->cached_statement(delete_block_ticks_query);
+								st->bind_int64(instrument_row_id, 1);
+								st->bind_int64(block_start, 2);
+								st->bind_int64(block_end, 3);
+								st->step();
+							}
+
+							t.commit();
+
+							moved_ticks += fresh.size();
+						}
+						catch (...)
+						{
+							t.rollback();
+							throw;
+						}
+					}
+				}
+
+				// SB: the table stays until its day is over, ticks which are saved later are archived by the next compaction
+				if (tick_partitions::get_day_start(day + 1) <= cutoff_timestamp)
+				{
+					partitions.drop(day, true);
+				}
+			}
+
+			return moved_ticks;
+		}
+
+		size_t tick_archive::expire(time_t cutoff)
+		{
+			// SB: only complete days are removed
+			const auto cutoff_day_start = tick_partitions::get_day_start(tick_partitions::get_day(cutoff.time_since_epoch().count()));
+
+			tick_partitions partitions(m_db);
+
+			size_t dropped_partitions = 0;
+			for (const auto day : partitions.find(std::numeric_limits<__int64>::min(), cutoff_day_start - 1))
+			{
+				if (partitions.drop(day, false))
+				{
+					++dropped_partitions;
+				}
+			}
+
+			sqlite::transaction t(m_db);
+
+			try
+			{
+				auto st = m_db->cached_statement(L"DELETE FROM INSTANT_DATA_ARCHIVE WHERE INSTRUMENT_ID IN (SELECT ID FROM INSTRUMENTS) AND START_TIMESTAMP < ?1");
+				st->bind_int64(cutoff_day_start, 1);
+				st->step();
+
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+
+			return dropped_partitions;
+		}
+
+		tick_archive::tick_archive(const sqlite::connection::ptr& db)
+			: m_db(db)
+		{
+		}
+
+		//////////////////////////////////////////////////////////////////
+		// tick_compactor impl
+
+		void tick_compactor::compactor_thread()
+		{
+			do
+			{
+				try
+				{
+					if (std::chrono::seconds::zero() != m_age)
+					{
+						const auto moved_ticks = m_archive.compact(time_t::clock::now() - m_age);
+						if (0 != moved_ticks)
+						{
+							LOG_INFO << L"Ticks have been moved to archive. Count: " << moved_ticks;
+						}
+					}
+
+					if (std::chrono::seconds::zero() != m_retention)
+					{
+						const auto expired_days = m_archive.expire(time_t::clock::now() - m_retention);
+						if (0 != expired_days)
+						{
+							LOG_INFO << L"Expired ticks have been removed. Days count: " << expired_days;
+						}
+					}
+				}
+				catch (const sqlite::exception& ex)
+				{
+					LOG_ERR << L"DB error during tick archive compaction. Code: " << ex.code << L" Info: " << ex.description;
+				}
+				catch (const std::exception& ex)
+				{
+					LOG_ERR << L"Exception was thrown during tick archive compaction. Info: " << ex.what();
+				}
+				catch (...)
+				{
+					LOG_ERR << L"Unknown error! Exception was thrown during tick archive compaction!";
+				}
+			}
+			while (!m_stop_evt.wait(m_interval));
+		}
+
+		tick_compactor::tick_compactor(const sqlite::connection::ptr& db, std::chrono::seconds age, std::chrono::seconds retention, std::chrono::milliseconds interval)
+			: m_archive(db)
+			, m_age(age)
+			, m_retention(retention)
+			, m_interval(static_cast<unsigned long>(interval.count()))
+			, m_stop_evt(true, false)
+			, m_worker(std::bind(&tick_compactor::compactor_thread, this))
+		{
+		}
+
+		tick_compactor::~tick_compactor()
+		{
+			m_stop_evt.set();
+			m_worker.join();
+		}
+	}
+}
\ No newline at end of file
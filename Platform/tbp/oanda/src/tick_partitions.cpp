@@ -0,0 +1,146 @@
+#include <oanda/tick_partitions.h>
+
+#include <chrono>
+
+namespace tbp
+{
+	namespace oanda
+	{
+		namespace
+		{
+			const __int64 c_day_duration = std::chrono::duration_cast<time_t::duration>(std::chrono::hours(24)).count();
+		}
+
+		//////////////////////////////////////////////////////////////////
+		// tick_partitions impl
+
+		void tick_partitions::create_table(const sqlite::connection::ptr& db)
+		{
+			auto st = db->create_statement(L"CREATE TABLE IF NOT EXISTS [INSTANT_DATA_PARTITIONS]([DAY] INTEGER PRIMARY KEY NOT NULL)");
+			st->step();
+		}
+
+		__int64 tick_partitions::get_day(__int64 timestamp)
+		{
+			// SB: days before epoch are rounded down as well
+			const auto day = timestamp / c_day_duration;
+			return timestamp % c_day_duration < 0 ? day - 1 : day;
+		}
+
+		__int64 tick_partitions::get_day_start(__int64 day)
+		{
+			return day * c_day_duration;
+		}
+
+		std::wstring tick_partitions::get_table_name(__int64 day)
+		{
+			return L"INSTANT_INSTRUMENT_DATA_" + std::to_wstring(day);
+		}
+
+		std::vector<__int64> tick_partitions::find(__int64 start_timestamp, __int64 end_timestamp) const
+		{
+			auto st = m_db->cached_statement(L"SELECT DAY FROM INSTANT_DATA_PARTITIONS WHERE DAY >= ?1 AND DAY <= ?2 ORDER BY DAY ASC");
+			st->bind_int64(get_day(start_timestamp), 1);
+			st->bind_int64(get_day(end_timestamp), 2);
+
+			std::vector<__int64> result;
+			while (st->step())
+			{
+				result.push_back(st->get_int64(0));
+			}
+
+			return result;
+		}
+
+		bool tick_partitions::exists(__int64 day) const
+		{
+			auto st = m_db->cached_statement(L"SELECT DAY FROM INSTANT_DATA_PARTITIONS WHERE DAY = ?1");
+			st->bind_int64(day, 1);
+
+			return st->step();
+		}
+
+		std::wstring tick_partitions::create(__int64 day)
+		{
+			const auto table_name = get_table_name(day);
+			if (exists(day))
+			{
+				return table_name;
+			}
+
+			sqlite::transaction t(m_db);
+
+			try
+			{
+				auto st = m_db->create_statement(L"CREATE TABLE IF NOT EXISTS [" + table_name + LR"(]([INSTRUMENT_ID] INTEGER NOT NULL REFERENCES INSTRUMENTS(ID) ON DELETE CASCADE,
+					[TIMESTAMP] INTEGER NOT NULL, [BID] DOUBLE, [ASK] DOUBLE, PRIMARY KEY([INSTRUMENT_ID], [TIMESTAMP])) WITHOUT ROWID )");
+				st->step();
+
+				st = m_db->cached_statement(L"INSERT OR IGNORE INTO INSTANT_DATA_PARTITIONS(DAY) VALUES (?1)");
+				st->bind_int64(day, 1);
+				st->step();
+
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+
+			return table_name;
+		}
+
+		bool tick_partitions::drop(__int64 day, bool only_empty)
+		{
+			const auto table_name = get_table_name(day);
+
+			sqlite::transaction t(m_db);
+
+			try
+			{
+				// SB: partition could be dropped by another connection meanwhile
+				if (!exists(day))
+				{
+					t.commit();
+					return false;
+				}
+
+				// SB: table can't be dropped while the statement is active, so it's finished first
+				bool has_ticks = false;
+				if (only_empty)
+				{
+					auto st = m_db->create_statement(L"SELECT TIMESTAMP FROM [" + table_name + L"] LIMIT 1");
+					has_ticks = st->step();
+				}
+
+				if (has_ticks)
+				{
+					t.commit();
+					return false;
+				}
+
+				auto st = m_db->create_statement(L"DROP TABLE IF EXISTS [" + table_name + L"]");
+				st->step();
+
+				st = m_db->cached_statement(L"DELETE FROM INSTANT_DATA_PARTITIONS WHERE DAY = ?1");
+				st->bind_int64(day, 1);
+				st->step();
+
+				t.commit();
+			}
+			catch (...)
+			{
+				t.rollback();
+				throw;
+			}
+
+			return true;
+		}
+
+		tick_partitions::tick_partitions(const sqlite::connection::ptr& db)
+			: m_db(db)
+		{
+		}
+	}
+}
\ No newline at end of file
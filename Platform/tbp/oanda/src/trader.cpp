@@ -11,6 +11,7 @@
 #include <boost/numeric/conversion/cast.hpp>
 
 #include <functional>
+#include <utility>
 
 namespace tbp
 {
@@ -18,7 +19,27 @@ namespace tbp
 	{
 		namespace
 		{
-			const int current_schema_version = 1;
+			const int current_schema_version = 2;
+
+			// SB: version is kept in user version of DB, since schema version is the schema cookie which is changed by any DDL statement
+			// and by vacuum. Version 1 was kept in schema version, it's recognized by its table and moved to user version once
+			int get_schema_version(const sqlite::connection::ptr& db)
+			{
+				const auto version = db->user_version();
+				if (0 != version || 1 != db->schema_version())
+				{
+					return version;
+				}
+
+				auto st = db->create_statement(L"SELECT NAME FROM SQLITE_MASTER WHERE TYPE = 'table' AND NAME = 'IDS'");
+				if (!st->step())
+				{
+					return 0;
+				}
+
+				db->set_user_version(1);
+				return 1;
+			}
 
 			std::wstring get_db_path(const std::wstring& working_dir)
 			{
@@ -56,6 +77,10 @@ namespace tbp
 				std::wstring internal_id;
 			};
 
+			// SB: internal ID and new state
+			using order_state = std::pair<std::wstring, order::state_t>;
+			using trade_state = std::pair<std::wstring, trade::state_t>;
+
 		private:
 			sqlite::connection::ptr m_db;
 
@@ -73,14 +98,61 @@ namespace tbp
 				return db;
 			}
 
+			// SB: states are looked up by STATE, updates find rows by LOCAL_ID and then by ID.
+			// State indexes include ID, so pending objects are selected without reading table rows
+			void create_indexes()
+			{
+				const wchar_t* const queries[] =
+				{
+					L"CREATE INDEX IF NOT EXISTS [IDS_LOCAL_ID] ON [IDS]([LOCAL_ID])",
+					L"CREATE INDEX IF NOT EXISTS [IDS_REMOTE_ID] ON [IDS]([REMOTE_ID])",
+					L"CREATE INDEX IF NOT EXISTS [ORDERS_ID] ON [ORDERS]([ID])",
+					L"CREATE INDEX IF NOT EXISTS [ORDERS_STATE] ON [ORDERS]([STATE], [ID])",
+					L"CREATE INDEX IF NOT EXISTS [TRADES_ID] ON [TRADES]([ID])",
+					L"CREATE INDEX IF NOT EXISTS [TRADES_STATE] ON [TRADES]([STATE], [ID])",
+				};
+
+				for (const auto query : queries)
+				{
+					auto st = m_db->create_statement(query);
+					st->step();
+				}
+			}
+
+			void migrate_schema_v1()
+			{
+				sqlite::transaction t(m_db);
+
+				try
+				{
+					LOG_INFO << "Migrating trading DB schema from version 1 to version 2...";
+
+					create_indexes();
+					m_db->set_user_version(current_schema_version);
+
+					t.commit();
+				}
+				catch (...)
+				{
+					t.rollback();
+					throw;
+				}
+
+				LOG_INFO << "Trading DB schema has been migrated successfully!";
+			}
+
 			void create_schema()
 			{
-				const auto version = m_db->schema_version();
+				const auto version = get_schema_version(m_db);
 				switch (version)
 				{
 				case 0:
 					break;
 
+				case 1:
+					migrate_schema_v1();
+					return;
+
 				case current_schema_version:
 					return;
 
@@ -103,7 +175,9 @@ namespace tbp
 					st = m_db->create_statement(L"CREATE TABLE [TRADES]([ID] REFERENCES IDS(ID) ON DELETE CASCADE, [OPENED] INTEGER, [STATE] INTEGER, [LINKED_ORDER] REFERENCES IDS(ID))");
 					st->step();
 
-					m_db->set_schema_version(current_schema_version);
+					create_indexes();
+
+					m_db->set_user_version(current_schema_version);
 
 					t.commit();
 				}
@@ -119,18 +193,18 @@ namespace tbp
 		public:
 			std::vector<object_id> get_pending_trades()
 			{
-				auto st = m_db->create_statement(LR"(
+				auto st = m_db->cached_statement(LR"(
 					SELECT REMOTE_ID, LOCAL_ID
 					FROM IDS 
 					WHERE ID IN (SELECT ID FROM TRADES WHERE TRADES.STATE = ?1)
 					)");
 
-				st->bind_value(static_cast<int>(trade::state_t::opened), 1);
+				st->bind_int(static_cast<int>(trade::state_t::opened), 1);
 
 				std::vector<object_id> result;
 				while (st->step())
 				{
-					result.push_back({ st->get_value<std::wstring>(0), st->get_value<std::wstring>(1) });
+					result.push_back({ st->get_text_view(0).str(), st->get_text_view(1).str() });
 				}
 
 				return result;
@@ -138,18 +212,18 @@ namespace tbp
 
 			std::vector<object_id> get_pending_orders()
 			{
-				auto st = m_db->create_statement(LR"(
+				auto st = m_db->cached_statement(LR"(
 					SELECT REMOTE_ID, LOCAL_ID
 					FROM IDS 
 					WHERE ID IN (SELECT ID FROM ORDERS WHERE ORDERS.STATE = ?1)
 					)");
 
-				st->bind_value(static_cast<int>(order::state_t::pending), 1);
+				st->bind_int(static_cast<int>(order::state_t::pending), 1);
 
 				std::vector<object_id> result;
 				while (st->step())
 				{
-					result.push_back({ st->get_value<std::wstring>(0), st->get_value<std::wstring>(1) });
+					result.push_back({ st->get_text_view(0).str(), st->get_text_view(1).str() });
 				}
 
 				return result;
@@ -157,13 +231,13 @@ namespace tbp
 
 			void set_order_state(const std::wstring& internal_id, order::state_t state)
 			{
-				auto st = m_db->create_statement(LR"(
+				auto st = m_db->cached_statement(LR"(
 					UPDATE ORDERS
 					SET STATE = ?1 WHERE ID IN (SELECT ID FROM IDS WHERE IDS.LOCAL_ID = ?2)
 					)");
 
-				st->bind_value(static_cast<int>(state), 1);
-				st->bind_value(internal_id, 2);
+				st->bind_int(static_cast<int>(state), 1);
+				st->bind_text(internal_id, 2);
 
 				if (!st->step())
 				{
@@ -173,13 +247,13 @@ namespace tbp
 
 			void set_trade_state(const std::wstring& internal_id, trade::state_t state)
 			{
-				auto st = m_db->create_statement(LR"(
+				auto st = m_db->cached_statement(LR"(
 					UPDATE TRADES
 					SET STATE = ?1 WHERE ID IN (SELECT ID FROM IDS WHERE IDS.LOCAL_ID = ?2)
 					)");
 
-				st->bind_value(static_cast<int>(state), 1);
-				st->bind_value(internal_id, 2);
+				st->bind_int(static_cast<int>(state), 1);
+				st->bind_text(internal_id, 2);
 
 				if (!st->step())
 				{
@@ -187,22 +261,53 @@ namespace tbp
 				}
 			}
 
+			// SB: all states are updated by one transaction
+			void set_states(const std::vector<order_state>& orders_states, const std::vector<trade_state>& trades_states)
+			{
+				if (orders_states.empty() && trades_states.empty())
+				{
+					return;
+				}
+
+				sqlite::transaction t(m_db);
+
+				try
+				{
+					for (const auto& s : orders_states)
+					{
+						set_order_state(s.first, s.second);
+					}
+
+					for (const auto& s : trades_states)
+					{
+						set_trade_state(s.first, s.second);
+					}
+
+					t.commit();
+				}
+				catch (...)
+				{
+					t.rollback();
+					throw;
+				}
+			}
+
 			std::wstring get_remote_id(const std::wstring& internal_id) const
 			{
-				auto st = m_db->create_statement(LR"(
+				auto st = m_db->cached_statement(LR"(
 					SELECT REMOTE_ID
 					FROM IDS 
 					WHERE IDS.LOCAL_ID = ?1
 					)");
 
-				st->bind_value(internal_id, 1);
+				st->bind_text(internal_id, 1);
 
 				if (!st->step())
 				{
 					throw std::runtime_error("Could not find remote ID by internal ID! InternalID: " + sb::to_str(internal_id));
 				}
 				{
-					return st->get_value<std::wstring>(0);
+					return st->get_text_view(0).str();
 				}
 			}
 
@@ -214,13 +319,13 @@ namespace tbp
 				{
 					auto insert_into_ids = [this](const auto& internal_id, const auto& remote_id)
 					{
-						auto st = m_db->create_statement(LR"(
+						auto st = m_db->cached_statement(LR"(
 							INSERT OR FAIL INTO IDS(LOCAL_ID, REMOTE_ID)
 							VALUES (?1, ?2)
 							)");
 
-						st->bind_value(internal_id, 1);
-						st->bind_value(remote_id, 2);
+						st->bind_text(internal_id, 1);
+						st->bind_text(remote_id, 2);
 
 						st->step();
 
@@ -237,36 +342,36 @@ namespace tbp
 						// SB: insert trade into IDS
 						trade_ids_row_id = insert_into_ids(linked_trade->id(), linked_trade->id());
 
-						auto st = m_db->create_statement(LR"(
+						auto st = m_db->cached_statement(LR"(
 							INSERT OR FAIL INTO TRADES(ID, OPENED, STATE, LINKED_ORDER)
 							VALUES (?1, ?2, ?3, ?4)
 							)");
 
 						const auto open_time = std::chrono::system_clock::now().time_since_epoch().count();
-						st->bind_value(trade_ids_row_id, 1);
-						st->bind_value(open_time, 2);
-						st->bind_value(int(linked_trade->state()), 3);
-						st->bind_value(order_ids_row_id, 4);
+						st->bind_int64(trade_ids_row_id, 1);
+						st->bind_int64(open_time, 2);
+						st->bind_int(int(linked_trade->state()), 3);
+						st->bind_int64(order_ids_row_id, 4);
 
 						st->step();
 					}
 
 					// SB: insert into ORDERS
 					{
-						auto st = m_db->create_statement(LR"(
+						auto st = m_db->cached_statement(LR"(
 							INSERT OR FAIL INTO ORDERS(ID, CREATED, PROCESSED, STATE, LINKED_TRADE)
 							VALUES (?1, ?2, ?3, ?4, ?5)
 							)");
 
-						st->bind_value(order_ids_row_id, 1);
+						st->bind_int64(order_ids_row_id, 1);
 
 						const auto creation_time = std::chrono::system_clock::now().time_since_epoch().count();
-						st->bind_value(creation_time, 2);
+						st->bind_int64(creation_time, 2);
 
 						const auto state = order->state();
 						if (tbp::order::state_t::filled == state || tbp::order::state_t::canceled == state)
 						{
-							st->bind_value(creation_time, 3);
+							st->bind_int64(creation_time, 3);
 						}
 						else
 						{
@@ -274,7 +379,7 @@ namespace tbp
 							st->bind_value(sqlite::vnull, 3);
 						}
 
-						st->bind_value(int(state), 4);
+						st->bind_int(int(state), 4);
 						st->bind_value(nullptr != linked_trade ? sqlite::value_t(trade_ids_row_id) : sqlite::vnull, 5);
 
 						st->step();
@@ -409,6 +514,10 @@ namespace tbp
 
 		void trader::update_objects_states()
 		{
+			// SB: states of all objects are saved by one transaction, there can be thousands of them at startup
+			std::vector<trading_db::order_state> orders_states;
+			std::vector<trading_db::trade_state> trades_states;
+
 			// SB: update all pending orders
 			auto pending_orders = m_db->get_pending_orders();
 			for (const auto& order_id : pending_orders)
@@ -416,7 +525,7 @@ namespace tbp
 				auto order = m_connector->find_order(order_id.remote_id);
 				if (nullptr != order)
 				{
-					m_db->set_order_state(order_id.internal_id, order->state());
+					orders_states.emplace_back(order_id.internal_id, order->state());
 				}
 				else
 				{
@@ -431,60 +540,76 @@ namespace tbp
 				auto trade = m_connector->find_trade(trade_id.remote_id);
 				if (nullptr != trade)
 				{
-					m_db->set_trade_state(trade_id.internal_id, trade->state());
+					trades_states.emplace_back(trade_id.internal_id, trade->state());
 				}
 				else
 				{
 					LOG_WARN << L"Unable update trade state. Trade wasn't found by connector. Trade remote ID: " << trade_id.remote_id;
 				}
 			}
+
+			m_db->set_states(orders_states, trades_states);
 		}
 
 		void trader::close_pending_trades()
 		{
 			LOG_DBG << L"Closing all opened trades...";
 
-			// SB: cancel all pending orders
-			auto pending_orders = m_db->get_pending_orders();
-			for (const auto& order_id : pending_orders)
+			std::vector<trading_db::order_state> orders_states;
+			std::vector<trading_db::trade_state> trades_states;
+
+			try
 			{
-				auto order = m_connector->find_order(order_id.remote_id);
-				if (nullptr != order)
+				// SB: cancel all pending orders
+				auto pending_orders = m_db->get_pending_orders();
+				for (const auto& order_id : pending_orders)
 				{
-					auto state = order->state();
-					if (order::state_t::pending == state)
+					auto order = m_connector->find_order(order_id.remote_id);
+					if (nullptr != order)
 					{
-						order->cancel();
-						state = order->state();
+						auto state = order->state();
+						if (order::state_t::pending == state)
+						{
+							order->cancel();
+							state = order->state();
 
-						LOG_DBG << L"Order has been canceld. Remote ID: " + order_id.remote_id;
-					}
+							LOG_DBG << L"Order has been canceld. Remote ID: " + order_id.remote_id;
+						}
 
-					m_db->set_order_state(order_id.internal_id, state);
-				}
-				else
-				{
-					LOG_WARN << L"Unable to close order!. Order wasn't found by connector. Order remote ID: " << order_id.remote_id;
+						orders_states.emplace_back(order_id.internal_id, state);
+					}
+					else
+					{
+						LOG_WARN << L"Unable to close order!. Order wasn't found by connector. Order remote ID: " << order_id.remote_id;
+					}
 				}
-			}
 
-			// SB: close all pending trades
-			auto pending_trades = m_db->get_pending_trades();
-			for (const auto& trade_id : pending_trades)
-			{
-				auto trade = m_connector->find_trade(trade_id.remote_id);
-				if (nullptr != trade)
+				// SB: close all pending trades
+				auto pending_trades = m_db->get_pending_trades();
+				for (const auto& trade_id : pending_trades)
 				{
-					trade->close(0.0);
-					m_db->set_trade_state(trade->id(), trade->state());
+					auto trade = m_connector->find_trade(trade_id.remote_id);
+					if (nullptr != trade)
+					{
+						trade->close(0.0);
+						trades_states.emplace_back(trade->id(), trade->state());
 
-					LOG_DBG << (L"Trade has been closed. Remote ID: " + trade_id.remote_id + L". Realized profit: " + std::to_wstring(trade->profit(false)));
-				}
-				else
-				{
-					LOG_WARN << L"Unable to close trade!. Trade wasn't found by connector. Trade remote ID: " << trade_id.remote_id;
+						LOG_DBG << (L"Trade has been closed. Remote ID: " + trade_id.remote_id + L". Realized profit: " + std::to_wstring(trade->profit(false)));
+					}
+					else
+					{
+						LOG_WARN << L"Unable to close trade!. Trade wasn't found by connector. Trade remote ID: " << trade_id.remote_id;
+					}
 				}
 			}
+			catch (...)
+			{
+				// SB: states of objects which have been already closed are saved anyway
+				m_db->set_states(orders_states, trades_states);
+				throw;
+			}
+
+			m_db->set_states(orders_states, trades_states);
 
 			LOG_DBG << L"All pending trades has beed closed!";
 		}
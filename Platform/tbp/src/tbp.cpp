@@ -4,6 +4,7 @@
 
 #include <oanda/factory.h>
 #include <core/factory.h>
+#include <core/data_transfer.h>
 
 #include <sqlite/sqlite.h>
 #include <logging/log.h>
@@ -11,6 +12,8 @@
 #include <win/fs.h>
 #include <win/exception.h>
 
+#include <chrono>
+#include <fstream>
 #include <iostream>
 
 namespace tbp
@@ -32,10 +35,77 @@ namespace tbp
 
 			return it->second(working_dir);
 		}
+
+		// SB: files with .csv extension are CSV, other ones are binary
+		transfer_format get_transfer_format(const std::wstring& path)
+		{
+			const std::wstring csv_extension = L".csv";
+			if (path.size() >= csv_extension.size() && 0 == ::_wcsicmp(path.c_str() + path.size() - csv_extension.size(), csv_extension.c_str()))
+			{
+				return transfer_format::csv;
+			}
+
+			return transfer_format::binary;
+		}
+
+		unsigned long get_granularity(const std::wstring& arg)
+		{
+			const auto result = std::stoul(arg);
+			if (0 == result)
+			{
+				throw std::invalid_argument("Granularity should be positive!");
+			}
+
+			return result;
+		}
+
+		// SB: tbp.exe import <instrument> <granularity> <file>
+		// tbp.exe export <instrument> <granularity> <start> <end> <file>, range is in Unix seconds
+		void run_transfer_command(const tbp::factory::ptr& f, const std::vector<std::wstring>& args)
+		{
+			const auto start_time = std::chrono::steady_clock::now();
+			if (args.size() == 4 && L"import" == args[0])
+			{
+				const auto granularity = get_granularity(args[2]);
+
+				std::ifstream input(args[3], std::ios::binary);
+				if (!input)
+				{
+					throw std::runtime_error("Failed to open file " + sb::to_str(args[3]));
+				}
+
+				const auto count = import_candles(input, get_transfer_format(args[3]), *f->create_bulk_storage(), args[1], granularity);
+
+				LOG_INFO << L"Imported " << count << L" candles in " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start_time).count() << L" s";
+			}
+			else if (args.size() == 6 && L"export" == args[0])
+			{
+				const auto granularity = get_granularity(args[2]);
+
+				std::ofstream output(args[5], std::ios::binary);
+				if (!output)
+				{
+					throw std::runtime_error("Failed to create file " + sb::to_str(args[5]));
+				}
+
+				const auto start = time_t(std::chrono::seconds(std::stoll(args[3])));
+				const auto end = time_t(std::chrono::seconds(std::stoll(args[4])));
+				const auto count = export_candles(*f->create_bulk_storage(), args[1], granularity, start, end, get_transfer_format(args[5]), output);
+
+				LOG_INFO << L"Exported " << count << L" candles in " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start_time).count() << L" s";
+			}
+			else
+			{
+				std::wcout << L"Usage: tbp.exe import <instrument> <granularity> <file>" << std::endl;
+				std::wcout << L"       tbp.exe export <instrument> <granularity> <start> <end> <file>" << std::endl;
+
+				throw std::invalid_argument("Invalid command line!");
+			}
+		}
 	}
 }
 
-int wmain()
+int wmain(int argc, wchar_t* argv[])
 {
 	try
 	{
@@ -46,8 +116,16 @@ int wmain()
 		const std::wstring working_dir = win::fs::get_current_module_dir();
 		logging::init(logging::level::debug, working_dir / L"Logs", true);
 
-		tbp::application app(tbp::get_broker_factory(L"OANDA", working_dir), working_dir);
-		app.start();
+		// SB: command line arguments run bulk data command instead of trading
+		if (argc > 1)
+		{
+			tbp::run_transfer_command(tbp::get_broker_factory(L"OANDA", working_dir), std::vector<std::wstring>(argv + 1, argv + argc));
+		}
+		else
+		{
+			tbp::application app(tbp::get_broker_factory(L"OANDA", working_dir), working_dir);
+			app.start();
+		}
 	}
 	catch (const std::exception& ex)
 	{
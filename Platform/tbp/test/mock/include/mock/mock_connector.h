@@ -4,6 +4,8 @@
 
 #include <core/connector.h>
 
+#include <win/thread.h>
+
 #include <string>
 
 ////////////////////////////////////////////////////////////////////////
@@ -124,7 +126,11 @@ public:
 
 public:
 	tbp::data_t::ptr value;
+	tbp::candle_series candles;
 	mutable std::vector<request_info> data_request_log;
+
+	// SB: missing ranges are requested concurrently
+	mutable win::critical_section data_request_log_cs;
 	mutable std::vector<std::wstring> instant_data_request_log;
 	std::vector<std::shared_ptr<mock_order>> orders_log;
 	std::vector<std::shared_ptr<mock_trade>> trades_log;
@@ -156,11 +162,37 @@ public:
 
 	virtual std::vector<tbp::data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
 	{
-		data_request_log.push_back({ instrument_id, *start_datetime, *end_datetime });
+		{
+			win::scoped_lock lock(data_request_log_cs);
+			data_request_log.push_back({ instrument_id, *start_datetime, *end_datetime });
+		}
 
 		return { value };
 	}
 
+	virtual tbp::candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
+	{
+		// SB: end datetime isn't specified when connector is polled for the latest candle
+		const auto end = nullptr != end_datetime ? *end_datetime : *start_datetime + std::chrono::seconds(granularity);
+		{
+			win::scoped_lock lock(data_request_log_cs);
+			data_request_log.push_back({ instrument_id, *start_datetime, end });
+		}
+
+		if (!candles.empty())
+		{
+			return candles;
+		}
+
+		tbp::candlestick_data candle;
+		candle.timestamp = *start_datetime;
+
+		tbp::candle_series result;
+		result.push_back(candle);
+
+		return result;
+	}
+
 	virtual tbp::order::ptr create_order(const tbp::data_t& params) override
 	{
 		auto mo = std::make_shared<mock_order>(params);
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <core/data_storage.h>
+
+#include <win/thread.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////
+// mock candles
+
+// SB: candle of index 'i' starts at 'granularity' * i seconds and has volume 'i'
+inline tbp::candle_series generate_candles(unsigned long granularity, size_t count, size_t first_index)
+{
+	tbp::candle_series result;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto index = first_index + i;
+
+		tbp::candlestick_data candle;
+		candle.timestamp = tbp::time_t(std::chrono::seconds(granularity * index));
+		candle.volume = static_cast<__int64>(index);
+		candle.bid.open = 1.1 + index * 0.00001;
+		candle.bid.high = 1.2;
+		candle.bid.low = 1.0;
+		candle.bid.close = 1.12345;
+		candle.ask.open = candle.bid.open + 0.00002;
+		candle.ask.high = 1.20002;
+		candle.ask.low = 1.00002;
+
+		// SB: price which has no short decimal representation
+		candle.ask.close = 1.0 / 3.0;
+		candle.complete = true;
+
+		result.push_back(candle);
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////
+// mock_data_storage
+
+struct mock_data_storage : public tbp::data_storage
+{
+	// SB: records of data are looked up by this field
+	static const wchar_t* timestamp_field()
+	{
+		return L"timestamp";
+	}
+
+	tbp::candle_series candles;
+	std::vector<tbp::data_t::ptr> data;
+	mutable size_t reads = 0;
+
+	// SB: amount of saves of each batch
+	std::vector<size_t> batches;
+	bool in_batch = false;
+
+	// SB: save outside of batch fails if it's set
+	bool batch_only = false;
+
+	// SB: covered ranges with index of the batch which has added them
+	std::vector<std::pair<size_t, tbp::time_range>> coverage;
+
+	bool fail = false;
+
+	// SB: save of candles with this volume fails
+	__int64 fail_volume = -1;
+
+	// SB: the first save waits until it's released, so next saves are queued meanwhile
+	win::event first_save_started;
+	win::event release_first_save;
+	bool block_first_save = false;
+
+public:
+	virtual std::vector<tbp::data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
+	{
+		++reads;
+
+		std::vector<tbp::data_t::ptr> result;
+		std::copy_if(data.begin(), data.end(), std::back_inserter(result), [&](const tbp::data_t::ptr& record)
+		{
+			const auto timestamp = boost::get<tbp::time_t>(record->at(timestamp_field()));
+			return timestamp >= *start_datetime && timestamp <= *end_datetime;
+		});
+
+		return result;
+	}
+
+	virtual std::vector<tbp::data_t::ptr> get_instant_data(const std::wstring& instrument_id, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
+	{
+		return std::vector<tbp::data_t::ptr>();
+	}
+
+	virtual tbp::candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
+	{
+		++reads;
+
+		const auto first = std::lower_bound(candles.timestamp.begin(), candles.timestamp.end(), *start_datetime);
+		const auto last = std::upper_bound(first, candles.timestamp.end(), *end_datetime);
+
+		tbp::candle_series result;
+		result.append(candles, first - candles.timestamp.begin(), last - first);
+
+		return result;
+	}
+
+	virtual void save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<tbp::data_t::ptr>& data) override
+	{
+		this->data.insert(this->data.end(), data.begin(), data.end());
+	}
+
+	virtual void save_instant_data(const std::wstring& instrument_id, const std::vector<tbp::data_t::ptr>& data) override
+	{
+	}
+
+	virtual void save_candles(const std::wstring& instrument_id, unsigned long granularity, const tbp::candle_series& data) override
+	{
+		if (batch_only && !in_batch)
+		{
+			throw std::logic_error("Save outside of batch!");
+		}
+
+		if (!std::is_sorted(data.timestamp.begin(), data.timestamp.end()))
+		{
+			throw std::logic_error("Candles aren't sorted!");
+		}
+
+		if (block_first_save)
+		{
+			block_first_save = false;
+			first_save_started.set();
+			release_first_save.wait(INFINITE);
+		}
+
+		if (fail || data.volume.end() != std::find(data.volume.begin(), data.volume.end(), fail_volume))
+		{
+			throw std::runtime_error("Write failed!");
+		}
+
+		if (in_batch)
+		{
+			++batches.back();
+		}
+
+		candles.append(data);
+	}
+
+	virtual void save_batch(const std::function<void()>& save) override
+	{
+		batches.push_back(0);
+		in_batch = true;
+
+		// SB: failed batch is rolled back like transaction
+		const auto saved_candles = candles;
+		try
+		{
+			save();
+		}
+		catch (...)
+		{
+			in_batch = false;
+			candles = saved_candles;
+			throw;
+		}
+
+		in_batch = false;
+	}
+
+	virtual void add_coverage(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t start_datetime, tbp::time_t end_datetime) override
+	{
+		coverage.push_back({ batches.size() - 1, { start_datetime, end_datetime } });
+	}
+
+public:
+	mock_data_storage()
+		: first_save_started(false, false)
+		, release_first_save(false, false)
+	{
+	}
+};
\ No newline at end of file
@@ -89,6 +89,44 @@ namespace
 			return result;
 		}
 
+		tbp::candle_series generate_candles(size_t count)
+		{
+			tbp::candle_series result;
+			auto timestamp = std::chrono::system_clock::now();
+			for (size_t i = 0; i < count; ++i)
+			{
+				tbp::candlestick_data candle;
+				candle.timestamp = timestamp;
+				candle.volume = rand() % 1000;
+
+				const auto ask_price = generate<double>();
+				candle.ask.open = ask_price + generate_fractional_part();
+				candle.ask.high = candle.ask.open + generate_delta();
+				candle.ask.low = candle.ask.open - generate_delta();
+				candle.ask.close = candle.ask.low + generate_delta();
+
+				candle.bid.open = candle.ask.open - generate_delta();
+				candle.bid.high = candle.bid.open + generate_delta();
+				candle.bid.low = candle.bid.open - generate_delta();
+				candle.bid.close = candle.bid.low + generate_delta();
+
+				result.push_back(candle);
+
+				timestamp += std::chrono::seconds(default_granularity);
+			}
+
+			return result;
+		}
+
+		template <typename price_t>
+		bool is_equal(const tbp::basic_candle_series<price_t>& lhs, const tbp::basic_candle_series<price_t>& rhs)
+		{
+			return lhs.timestamp == rhs.timestamp &&
+				lhs.volume == rhs.volume &&
+				lhs.bid.open == rhs.bid.open && lhs.bid.high == rhs.bid.high && lhs.bid.low == rhs.bid.low && lhs.bid.close == rhs.bid.close &&
+				lhs.ask.open == rhs.ask.open && lhs.ask.high == rhs.ask.high && lhs.ask.low == rhs.ask.low && lhs.ask.close == rhs.ask.close;
+		}
+
 		bool is_equal(const std::vector<tbp::data_t::ptr>& lhs, const std::vector<tbp::data_t::ptr>& rhs)
 		{
 			if (lhs.size() != rhs.size())
@@ -228,6 +266,152 @@ BOOST_FIXTURE_TEST_CASE(get_data_requested_range_bigger_than_available, common_f
 	BOOST_ASSERT(is_equal(data, instrument_data));
 }
 
+BOOST_FIXTURE_TEST_CASE(scan_data, common_fixture)
+{
+	// INIT (generate data)
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto start_time = std::chrono::system_clock::now();
+	auto instrument_data = generate_data(100);
+	auto end_time = std::chrono::system_clock::now();
+
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+	ds.save_data(instrument_id, default_granularity, instrument_data);
+
+	// ACT
+	std::vector<size_t> chunk_sizes;
+	std::vector<tbp::data_t::ptr> data;
+	for (auto& chunk : ds.scan(instrument_id, default_granularity, start_time, end_time, 7))
+	{
+		chunk_sizes.push_back(chunk.size());
+		data.insert(data.end(), chunk.begin(), chunk.end());
+	}
+
+	// ASSERT
+	BOOST_ASSERT(15 == chunk_sizes.size());
+	BOOST_ASSERT(std::all_of(chunk_sizes.begin(), chunk_sizes.end() - 1, [](size_t size) { return 7 == size; }));
+	BOOST_ASSERT(2 == chunk_sizes.back());
+	BOOST_ASSERT(is_equal(data, instrument_data));
+}
+
+BOOST_FIXTURE_TEST_CASE(scan_data_range, common_fixture)
+{
+	// INIT (generate data)
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto instrument_data = generate_data(100);
+
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+	ds.save_data(instrument_id, default_granularity, instrument_data);
+
+	// ACT
+	std::vector<tbp::data_t::ptr> data;
+	for (auto& chunk : ds.scan(instrument_id, default_granularity, get_timestamp(instrument_data[10]), get_timestamp(instrument_data[50]), 10))
+	{
+		BOOST_ASSERT(chunk.size() <= 10);
+		data.insert(data.end(), chunk.begin(), chunk.end());
+	}
+
+	// ASSERT
+	BOOST_ASSERT(is_equal(data, std::vector<tbp::data_t::ptr>(instrument_data.begin() + 10, instrument_data.begin() + 51)));
+
+	// ACT
+	// SB: range without data gives no chunks
+	auto chunks = ds.scan(instrument_id, default_granularity, get_timestamp(instrument_data[99]) + std::chrono::seconds(1), get_timestamp(instrument_data[99]) + std::chrono::seconds(10));
+
+	// ASSERT
+	BOOST_ASSERT(chunks.begin() == chunks.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(coverage, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	const auto start = tbp::time_t(std::chrono::hours(420000));
+	const auto tick = tbp::time_t::duration(1);
+
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+
+	// ACT
+	ds.add_coverage(instrument_id, default_granularity, start, start + std::chrono::minutes(10) - tick);
+	ds.add_coverage(instrument_id, default_granularity, start + std::chrono::minutes(20), start + std::chrono::minutes(30));
+	ds.add_coverage(instrument_id, default_granularity * 2, start, start + std::chrono::minutes(60));
+
+	// SB: adjacent to the first range and overlaps the second one
+	ds.add_coverage(instrument_id, default_granularity, start + std::chrono::minutes(10), start + std::chrono::minutes(25));
+	ds.add_coverage(instrument_id, default_granularity, start + std::chrono::minutes(40), start + std::chrono::minutes(50));
+
+	std::vector<tbp::time_range> coverage;
+	const bool has_coverage = ds.get_coverage(instrument_id, default_granularity, start + std::chrono::minutes(5), start + std::chrono::minutes(45), &coverage);
+
+	// ASSERT
+	BOOST_ASSERT(has_coverage);
+	BOOST_ASSERT(2 == coverage.size());
+	BOOST_ASSERT(start == coverage[0].start);
+	BOOST_ASSERT(start + std::chrono::minutes(30) == coverage[0].end);
+	BOOST_ASSERT(start + std::chrono::minutes(40) == coverage[1].start);
+	BOOST_ASSERT(start + std::chrono::minutes(50) == coverage[1].end);
+}
+
+BOOST_FIXTURE_TEST_CASE(pooled_reads, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_path = tmp_folder.path + L"\\" + unique_string();
+	auto open_db = [db_path]()
+	{
+		auto db = sqlite::connection::create(db_path);
+		db->set_journal_mode(sqlite::journal_mode::wal);
+
+		return db;
+	};
+
+	auto pool = std::make_shared<sqlite::connection_pool>(open_db(), open_db, 2);
+	tbp::oanda::data_storage ds(pool);
+
+	auto instrument_data = generate_data(20);
+	ds.save_data(instrument_id, default_granularity, std::vector<tbp::data_t::ptr>(instrument_data.begin(), instrument_data.begin() + 10));
+
+	// ACT
+	// SB: reader sees the last committed state while writer transaction is opened
+	std::vector<tbp::data_t::ptr> data_in_batch;
+	ds.save_batch([&]()
+	{
+		ds.save_data(instrument_id, default_granularity, std::vector<tbp::data_t::ptr>(instrument_data.begin() + 10, instrument_data.end()));
+
+		auto start = get_timestamp(instrument_data.front());
+		auto end = get_timestamp(instrument_data.back());
+		data_in_batch = ds.get_data(instrument_id, default_granularity, &start, &end);
+	});
+
+	auto start = get_timestamp(instrument_data.front());
+	auto end = get_timestamp(instrument_data.back());
+	const auto data = ds.get_data(instrument_id, default_granularity, &start, &end);
+
+	std::vector<tbp::data_t::ptr> scanned_data;
+	for (auto& chunk : ds.scan(instrument_id, default_granularity, get_timestamp(instrument_data.front()), get_timestamp(instrument_data.back()), 7))
+	{
+		scanned_data.insert(scanned_data.end(), chunk.begin(), chunk.end());
+	}
+
+	// ASSERT
+	BOOST_ASSERT(is_equal(data_in_batch, std::vector<tbp::data_t::ptr>(instrument_data.begin(), instrument_data.begin() + 10)));
+	BOOST_ASSERT(is_equal(data, instrument_data));
+	BOOST_ASSERT(is_equal(scanned_data, instrument_data));
+
+	const auto stats = pool->stats();
+	BOOST_ASSERT(0 == stats.busy);
+	BOOST_ASSERT(stats.readers >= 1);
+}
+
 BOOST_FIXTURE_TEST_CASE(save_instant_data, common_fixture)
 {
 	// INIT (generate data)
@@ -276,6 +460,46 @@ BOOST_FIXTURE_TEST_CASE(get_instant_data, common_fixture)
 	BOOST_ASSERT(is_equal(data, std::vector<tbp::data_t::ptr>(instrument_data.begin() + 10, instrument_data.begin() + 51)));
 }
 
+BOOST_FIXTURE_TEST_CASE(instant_data_day_partitions, common_fixture)
+{
+	// INIT (ticks of three days, one tick per hour)
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	const auto first_timestamp = tbp::time_t(std::chrono::seconds(1500000000));
+
+	std::vector<tbp::data_t::ptr> instrument_data;
+	for (int i = 0; i < 3 * 24; ++i)
+	{
+		tbp::data_t tick;
+		tick[tbp::oanda::values::instrument_data::c_timestamp] = first_timestamp + std::chrono::hours(i);
+		tick[tbp::oanda::values::instant_data::c_bid_price] = 1.12345;
+		tick[tbp::oanda::values::instant_data::c_ask_price] = 1.12347;
+
+		instrument_data.emplace_back(std::make_shared<tbp::data_t>(std::move(tick)));
+	}
+
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+
+	// ACT
+	ds.save_instant_data(instrument_id, instrument_data);
+
+	// SB: created partitions don't change version of DB schema, so storage is opened again
+	tbp::oanda::data_storage reopened_ds(db);
+
+	auto start_time = get_timestamp(instrument_data[10]);
+	auto end_time = get_timestamp(instrument_data[60]);
+	auto data = reopened_ds.get_instant_data(instrument_id, &start_time, &end_time);
+
+	// ASSERT
+	auto partitions_st = db->create_statement(L"SELECT COUNT(*) FROM INSTANT_DATA_PARTITIONS");
+	partitions_st->step();
+
+	BOOST_ASSERT(4 == partitions_st->get_value<__int64>(0));
+	BOOST_ASSERT(is_equal(data, std::vector<tbp::data_t::ptr>(instrument_data.begin() + 10, instrument_data.begin() + 61)));
+}
+
 BOOST_FIXTURE_TEST_CASE(data_with_different_garnurality_independent, common_fixture)
 {
 	// INIT (generate data)
@@ -313,4 +537,172 @@ BOOST_FIXTURE_TEST_CASE(data_with_different_garnurality_independent, common_fixt
 	BOOST_ASSERT(start_time2_g2 == get_timestamp(instrument_data_g2[10]));
 	BOOST_ASSERT(end_time2_g2 == get_timestamp(instrument_data_g2[50]));
 	BOOST_ASSERT(is_equal(data_g2, std::vector<tbp::data_t::ptr>(instrument_data_g2.begin() + 10, instrument_data_g2.begin() + 51)));
+}
+
+BOOST_FIXTURE_TEST_CASE(save_candles, common_fixture)
+{
+	// INIT (generate data)
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto candles = generate_candles(100);
+	auto start_time = candles.timestamp.front();
+	auto end_time = candles.timestamp.back();
+
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+
+	// ACT
+	ds.save_candles(instrument_id, default_granularity, candles);
+	auto data = ds.get_candles(instrument_id, default_granularity, &start_time, &end_time);
+
+	// ASSERT
+	BOOST_ASSERT(start_time == candles.timestamp.front());
+	BOOST_ASSERT(end_time == candles.timestamp.back());
+	BOOST_ASSERT(is_equal(data, candles));
+}
+
+BOOST_FIXTURE_TEST_CASE(get_fixed_candles, common_fixture)
+{
+	// INIT (generate data)
+	const auto instrument_id = L"instrument1";
+	const unsigned long precision = 5;
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto candles = generate_candles(100);
+	auto start_time = candles.timestamp.front();
+	auto end_time = candles.timestamp.back();
+
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+	ds.save_candles(instrument_id, default_granularity, candles);
+
+	// ACT
+	auto fixed_candles = ds.get_fixed_candles(instrument_id, default_granularity, precision, &start_time, &end_time);
+
+	// ASSERT
+	BOOST_ASSERT(start_time == candles.timestamp.front());
+	BOOST_ASSERT(end_time == candles.timestamp.back());
+	BOOST_ASSERT(is_equal(fixed_candles, tbp::to_fixed(candles, precision)));
+}
+
+BOOST_FIXTURE_TEST_CASE(get_candles_saved_as_data, common_fixture)
+{
+	// INIT (generate data)
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto start_time = std::chrono::system_clock::now();
+	auto instrument_data = generate_data(100);
+	auto end_time = std::chrono::system_clock::now();
+
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+
+	// ACT
+	ds.save_data(instrument_id, default_granularity, instrument_data);
+	auto candles = ds.get_candles(instrument_id, default_granularity, &start_time, &end_time);
+
+	// ASSERT
+	BOOST_ASSERT(candles.size() == instrument_data.size());
+	BOOST_ASSERT(start_time == get_timestamp(*instrument_data.begin()));
+	BOOST_ASSERT(end_time == get_timestamp(*instrument_data.rbegin()));
+
+	for (size_t i = 0; i < candles.size(); ++i)
+	{
+		const auto& ask_data = tbp::get<tbp::data_t>(instrument_data[i]->at(tbp::oanda::values::instrument_data::c_ask_candlestick));
+		const auto& bid_data = tbp::get<tbp::data_t>(instrument_data[i]->at(tbp::oanda::values::instrument_data::c_bid_candlestick));
+
+		BOOST_ASSERT(candles.timestamp[i] == get_timestamp(instrument_data[i]));
+		BOOST_ASSERT(candles.ask.close[i] == tbp::get<double>(ask_data.at(tbp::oanda::values::candlestick_data::c_close_price)));
+		BOOST_ASSERT(candles.bid.open[i] == tbp::get<double>(bid_data.at(tbp::oanda::values::candlestick_data::c_open_price)));
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(migrate_schema_from_v1, common_fixture)
+{
+	// INIT (create DB with version 1 schema)
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto candles = generate_candles(100);
+	auto start_time = candles.timestamp.front();
+	auto end_time = candles.timestamp.back();
+	const auto instant_data = generate_instant_data(10);
+
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	{
+		db->create_statement(L"CREATE TABLE [INSTRUMENTS]([ID] INTEGER PRIMARY KEY NOT NULL, [NAME] TEXT)")->step();
+		db->create_statement(L"CREATE TABLE [CANDLES]([ID] INTEGER PRIMARY KEY NOT NULL, [O_PRICE] DOUBLE, [H_PRICE] DOUBLE, [L_PRICE] DOUBLE, [C_PRICE] DOUBLE)")->step();
+		db->create_statement(L"CREATE TABLE [INSTRUMENT_DATA]([INSTRUMENT_ID] REFERENCES INSTRUMENTS(ID) ON DELETE CASCADE, [TIMESTAMP] INTEGER, [GRANULARITY] INTEGER, [BID_CANDLESTICK] REFERENCES CANDLES(ID), [ASK_CANDLESTICK] REFERENCES CANDLES(ID), [VOLUME] INTEGER, PRIMARY KEY([INSTRUMENT_ID], [TIMESTAMP], [GRANULARITY]))")->step();
+		db->create_statement(L"CREATE TABLE [INSTANT_INSTRUMENT_DATA]([INSTRUMENT_ID] REFERENCES INSTRUMENTS(ID) ON DELETE CASCADE, [TIMESTAMP] INTEGER, [BID] DOUBLE, [ASK] DOUBLE, PRIMARY KEY([INSTRUMENT_ID], [TIMESTAMP]))")->step();
+
+		auto insert_instrument_st = db->create_statement(L"INSERT INTO INSTRUMENTS (NAME) VALUES (?1)");
+		insert_instrument_st->bind_value(std::wstring(instrument_id), 1);
+		insert_instrument_st->step();
+
+		// SB: last insert row id is per connection, so it's taken before candles are inserted
+		const auto instrument_row_id = insert_instrument_st->last_insert_row_id();
+
+		auto insert_candle_st = db->create_statement(L"INSERT INTO CANDLES(O_PRICE, H_PRICE, L_PRICE, C_PRICE) VALUES (?1, ?2, ?3, ?4)");
+		auto insert_data_st = db->create_statement(L"INSERT INTO INSTRUMENT_DATA(INSTRUMENT_ID, TIMESTAMP, GRANULARITY, BID_CANDLESTICK, ASK_CANDLESTICK, VOLUME) VALUES (?1, ?2, ?3, ?4, ?5, ?6)");
+		auto insert_prices = [&](const tbp::candle_series::prices& prices, size_t index)
+		{
+			insert_candle_st->reset();
+			insert_candle_st->bind_value(prices.open[index], 1);
+			insert_candle_st->bind_value(prices.high[index], 2);
+			insert_candle_st->bind_value(prices.low[index], 3);
+			insert_candle_st->bind_value(prices.close[index], 4);
+			insert_candle_st->step();
+
+			return insert_candle_st->last_insert_row_id();
+		};
+
+		for (size_t i = 0; i < candles.size(); ++i)
+		{
+			insert_data_st->reset();
+			insert_data_st->bind_value(instrument_row_id, 1);
+			insert_data_st->bind_value(candles.timestamp[i].time_since_epoch().count(), 2);
+			insert_data_st->bind_value(static_cast<int>(default_granularity), 3);
+			insert_data_st->bind_value(insert_prices(candles.bid, i), 4);
+			insert_data_st->bind_value(insert_prices(candles.ask, i), 5);
+			insert_data_st->bind_value(candles.volume[i], 6);
+			insert_data_st->step();
+		}
+
+		auto insert_instant_data_st = db->create_statement(L"INSERT INTO INSTANT_INSTRUMENT_DATA(INSTRUMENT_ID, TIMESTAMP, BID, ASK) VALUES (?1, ?2, ?3, ?4)");
+		for (const auto& tick : instant_data)
+		{
+			insert_instant_data_st->reset();
+			insert_instant_data_st->bind_value(instrument_row_id, 1);
+			insert_instant_data_st->bind_value(get_timestamp(tick).time_since_epoch().count(), 2);
+			insert_instant_data_st->bind_value(tbp::get<double>(tick->at(tbp::oanda::values::instant_data::c_bid_price)), 3);
+			insert_instant_data_st->bind_value(tbp::get<double>(tick->at(tbp::oanda::values::instant_data::c_ask_price)), 4);
+			insert_instant_data_st->step();
+		}
+
+		db->set_schema_version(1);
+	}
+
+	// ACT
+	tbp::oanda::data_storage ds(db);
+	auto data = ds.get_candles(instrument_id, default_granularity, &start_time, &end_time);
+
+	auto instant_start_time = get_timestamp(instant_data.front());
+	auto instant_end_time = get_timestamp(instant_data.back());
+	auto migrated_instant_data = ds.get_instant_data(instrument_id, &instant_start_time, &instant_end_time);
+
+	// ASSERT
+	BOOST_ASSERT(5 == db->user_version());
+	BOOST_ASSERT(start_time == candles.timestamp.front());
+	BOOST_ASSERT(end_time == candles.timestamp.back());
+	BOOST_ASSERT(is_equal(data, candles));
+	BOOST_ASSERT(is_equal(migrated_instant_data, instant_data));
+
+	auto old_tables_st = db->create_statement(L"SELECT NAME FROM SQLITE_MASTER WHERE TYPE = 'table' AND NAME IN ('CANDLES', 'INSTRUMENT_DATA', 'INSTANT_INSTRUMENT_DATA')");
+	BOOST_ASSERT(!old_tables_st->step());
+
+	// SB: DDL of migration changes schema cookie of DB, migrated DB is opened again as version 5 one
+	tbp::oanda::data_storage migrated_ds(db);
+	BOOST_ASSERT(5 == db->user_version());
 }
\ No newline at end of file
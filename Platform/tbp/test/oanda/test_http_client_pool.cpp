@@ -0,0 +1,128 @@
+#include <boost/test/unit_test.hpp>
+
+#include <oanda/http_client_pool.h>
+
+#include <cpprest/http_listener.h>
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+	// SB: local stand-in of service, it replies with path of the request
+	struct listener_fixture
+	{
+		const std::wstring url = L"http://localhost:34568/";
+		web::http::experimental::listener::http_listener listener;
+		std::atomic<size_t> requests;
+
+	public:
+		web::json::value execute_request(const tbp::oanda::http_client_pool& pool, const std::wstring& request_url)
+		{
+			const web::uri uri(request_url);
+			const auto client = pool.checkout(uri);
+
+			web::http::http_request request(web::http::methods::GET);
+			request.set_request_uri(uri.resource());
+
+			auto response = client->request(request).get();
+			BOOST_ASSERT(web::http::status_codes::OK == response.status_code());
+
+			return response.extract_json().get();
+		}
+
+	public:
+		listener_fixture()
+			: listener(web::uri(url))
+			, requests(0)
+		{
+			listener.support([this](web::http::http_request request)
+			{
+				++requests;
+
+				web::json::value body;
+				body[L"path"] = web::json::value(request.relative_uri().path());
+				request.reply(web::http::status_codes::OK, body);
+			});
+
+			listener.open().wait();
+		}
+
+		~listener_fixture()
+		{
+			listener.close().wait();
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(http_client_pool_reuses_client, listener_fixture)
+{
+	// INIT
+	tbp::oanda::http_client_pool pool;
+
+	// ACT
+	const auto first = execute_request(pool, url + L"v3/accounts");
+	const auto second = execute_request(pool, url + L"v3/orders?state=PENDING");
+	const auto third = execute_request(pool, url + L"v3/trades");
+
+	// ASSERT
+	BOOST_ASSERT(L"/v3/accounts" == first.at(L"path").as_string());
+	BOOST_ASSERT(L"/v3/orders" == second.at(L"path").as_string());
+	BOOST_ASSERT(L"/v3/trades" == third.at(L"path").as_string());
+	BOOST_ASSERT(3 == requests);
+
+	const auto stats = pool.stats();
+	BOOST_ASSERT(3 == stats.checkouts);
+	BOOST_ASSERT(1 == stats.connects);
+	BOOST_ASSERT(2 == stats.reuses);
+	BOOST_ASSERT(1 == stats.clients);
+	BOOST_ASSERT(1 == stats.idle_clients);
+}
+
+BOOST_FIXTURE_TEST_CASE(http_client_pool_closes_idle_client, listener_fixture)
+{
+	// INIT
+	tbp::oanda::http_client_pool pool(1, std::chrono::milliseconds(0));
+	execute_request(pool, url + L"v3/accounts");
+
+	// ACT
+	execute_request(pool, url + L"v3/accounts");
+
+	// ASSERT
+	const auto stats = pool.stats();
+	BOOST_ASSERT(2 == requests);
+	BOOST_ASSERT(2 == stats.connects);
+	BOOST_ASSERT(0 == stats.reuses);
+	BOOST_ASSERT(1 == stats.expirations);
+	BOOST_ASSERT(1 == stats.clients);
+}
+
+BOOST_FIXTURE_TEST_CASE(http_client_pool_waits_for_client, listener_fixture)
+{
+	// INIT
+	tbp::oanda::http_client_pool pool(1, std::chrono::seconds(30));
+	auto client = pool.checkout(web::uri(url));
+
+	// ACT
+	web::json::value response;
+	std::thread worker([&]() { response = execute_request(pool, url + L"v3/trades"); });
+
+	// SB: worker waits for the only client of the host
+	while (0 == pool.stats().waits)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	client.reset();
+	worker.join();
+
+	// ASSERT
+	BOOST_ASSERT(L"/v3/trades" == response.at(L"path").as_string());
+
+	const auto stats = pool.stats();
+	BOOST_ASSERT(2 == stats.checkouts);
+	BOOST_ASSERT(1 == stats.waits);
+	BOOST_ASSERT(1 == stats.connects);
+	BOOST_ASSERT(1 == stats.reuses);
+	BOOST_ASSERT(1 == stats.clients);
+}
\ No newline at end of file
@@ -0,0 +1,324 @@
+#include <boost/test/unit_test.hpp>
+
+#include <oanda/mapped_storage.h>
+#include <oanda/data_storage.h>
+
+#include <test_helpers/base_fixture.h>
+
+#include <random>
+
+namespace
+{
+	struct common_fixture : test_helpers::temp_dir_fixture
+	{
+		std::random_device rand;
+		const unsigned long default_granularity = 5;
+		const tbp::time_t start_time = tbp::time_t(std::chrono::seconds(1500000000));
+
+		double generate_price()
+		{
+			return 1.0 + (rand() % 10000) / 10000.0;
+		}
+
+		tbp::candle_series generate_candles(size_t count, tbp::time_t timestamp)
+		{
+			tbp::candle_series result;
+			for (size_t i = 0; i < count; ++i)
+			{
+				tbp::candlestick_data candle;
+				candle.timestamp = timestamp;
+				candle.volume = rand() % 1000;
+				candle.ask.open = generate_price();
+				candle.ask.high = candle.ask.open + 0.01;
+				candle.ask.low = candle.ask.open - 0.01;
+				candle.ask.close = generate_price();
+				candle.bid.open = candle.ask.open - 0.001;
+				candle.bid.high = candle.ask.high - 0.001;
+				candle.bid.low = candle.ask.low - 0.001;
+				candle.bid.close = candle.ask.close - 0.001;
+
+				result.push_back(candle);
+
+				timestamp += std::chrono::seconds(default_granularity);
+			}
+
+			return result;
+		}
+
+		std::vector<tbp::data_t::ptr> generate_instant_data(size_t count)
+		{
+			std::vector<tbp::data_t::ptr> result;
+			for (size_t i = 0; i < count; ++i)
+			{
+				tbp::data_t instrument_data;
+				instrument_data[tbp::oanda::values::instrument_data::c_timestamp] = start_time + std::chrono::milliseconds(100 * i);
+				instrument_data[tbp::oanda::values::instant_data::c_bid_price] = generate_price();
+				instrument_data[tbp::oanda::values::instant_data::c_ask_price] = generate_price();
+
+				result.emplace_back(std::make_shared<tbp::data_t>(std::move(instrument_data)));
+			}
+
+			return result;
+		}
+
+		tbp::data_t to_candlestick_data(const tbp::candle_series::prices& prices, size_t index)
+		{
+			tbp::data_t result;
+			result[tbp::oanda::values::candlestick_data::c_open_price] = prices.open[index];
+			result[tbp::oanda::values::candlestick_data::c_high_price] = prices.high[index];
+			result[tbp::oanda::values::candlestick_data::c_low_price] = prices.low[index];
+			result[tbp::oanda::values::candlestick_data::c_close_price] = prices.close[index];
+
+			return result;
+		}
+
+		std::vector<tbp::data_t::ptr> to_data(const tbp::candle_series& candles)
+		{
+			std::vector<tbp::data_t::ptr> result;
+			for (size_t i = 0; i < candles.size(); ++i)
+			{
+				tbp::data_t instrument_data;
+				instrument_data[tbp::oanda::values::instrument_data::c_timestamp] = candles.timestamp[i];
+				instrument_data[tbp::oanda::values::instrument_data::c_volume] = candles.volume[i];
+				instrument_data[tbp::oanda::values::instrument_data::c_bid_candlestick] = to_candlestick_data(candles.bid, i);
+				instrument_data[tbp::oanda::values::instrument_data::c_ask_candlestick] = to_candlestick_data(candles.ask, i);
+				instrument_data[tbp::oanda::values::instrument_data::c_complete] = true;
+
+				result.emplace_back(std::make_shared<tbp::data_t>(std::move(instrument_data)));
+			}
+
+			return result;
+		}
+
+		bool is_equal(const tbp::candle_series& lhs, const tbp::candle_series& rhs)
+		{
+			return lhs.timestamp == rhs.timestamp &&
+				lhs.volume == rhs.volume &&
+				lhs.bid.open == rhs.bid.open && lhs.bid.high == rhs.bid.high && lhs.bid.low == rhs.bid.low && lhs.bid.close == rhs.bid.close &&
+				lhs.ask.open == rhs.ask.open && lhs.ask.high == rhs.ask.high && lhs.ask.low == rhs.ask.low && lhs.ask.close == rhs.ask.close;
+		}
+
+		tbp::candle_series slice(const tbp::candle_series& candles, size_t first, size_t count)
+		{
+			tbp::candle_series result;
+			result.append(candles, first, count);
+
+			return result;
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(mapped_storage_save_candles, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	auto candles = generate_candles(100, start_time);
+	auto start = candles.timestamp.front() - std::chrono::seconds(60);
+	auto end = candles.timestamp.back() + std::chrono::seconds(60);
+
+	tbp::oanda::mapped_storage ds(tmp_folder.path);
+
+	// ACT
+	ds.save_candles(instrument_id, default_granularity, candles);
+	auto data = ds.get_candles(instrument_id, default_granularity, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(start == candles.timestamp.front());
+	BOOST_ASSERT(end == candles.timestamp.back());
+	BOOST_ASSERT(is_equal(data, candles));
+	BOOST_ASSERT(std::all_of(data.complete.begin(), data.complete.end(), [](tbp::byte_t complete) { return 1 == complete; }));
+}
+
+BOOST_FIXTURE_TEST_CASE(mapped_storage_candle_view_range, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	auto candles = generate_candles(100, start_time);
+	auto start = candles.timestamp[10];
+	auto end = candles.timestamp[50] + std::chrono::seconds(1);
+
+	tbp::oanda::mapped::candle_view view;
+	{
+		tbp::oanda::mapped_storage ds(tmp_folder.path);
+		ds.save_candles(instrument_id, default_granularity, candles);
+
+		// ACT
+		view = ds.get_candle_view(instrument_id, default_granularity, &start, &end);
+	}
+
+	// ASSERT
+	// SB: view is still valid after storage is destroyed
+	BOOST_ASSERT(41 == view.size());
+	BOOST_ASSERT(start == candles.timestamp[10]);
+	BOOST_ASSERT(end == candles.timestamp[50]);
+
+	for (size_t i = 0; i < view.size(); ++i)
+	{
+		BOOST_ASSERT(view[i].timestamp == candles.timestamp[10 + i].time_since_epoch().count());
+		BOOST_ASSERT(view[i].ask_close == candles.ask.close[10 + i]);
+		BOOST_ASSERT(view[i].bid_open == candles.bid.open[10 + i]);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(mapped_storage_append_only, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	auto candles = generate_candles(100, start_time);
+	auto first_part = slice(candles, 0, 60);
+
+	// SB: the last candle isn't complete yet, it's stored with the next part
+	first_part.complete.back() = 0;
+
+	tbp::oanda::mapped_storage ds(tmp_folder.path);
+	ds.save_candles(instrument_id, default_granularity, first_part);
+
+	// ACT
+	// SB: overlapped candles are skipped, only the new ones are appended
+	auto second_part = slice(candles, 50, 50);
+	second_part.ask.close.front() += 1.0;
+	ds.save_candles(instrument_id, default_granularity, second_part);
+
+	auto start = candles.timestamp.front();
+	auto end = candles.timestamp.back();
+	auto data = ds.get_candles(instrument_id, default_granularity, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(is_equal(data, candles));
+}
+
+BOOST_FIXTURE_TEST_CASE(mapped_storage_reopen, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	auto candles = generate_candles(100, start_time);
+
+	{
+		tbp::oanda::mapped_storage ds(tmp_folder.path);
+		ds.save_candles(instrument_id, default_granularity, slice(candles, 0, 50));
+	}
+
+	// ACT
+	tbp::oanda::mapped_storage ds(tmp_folder.path);
+	ds.save_candles(instrument_id, default_granularity, slice(candles, 50, 50));
+
+	auto start = candles.timestamp.front();
+	auto end = candles.timestamp.back();
+	auto data = ds.get_candles(instrument_id, default_granularity, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(is_equal(data, candles));
+
+	// INIT
+	auto other_start = start;
+	auto other_end = end;
+
+	// ACT
+	auto other_data = ds.get_candles(instrument_id, default_granularity * 2, &other_start, &other_end);
+
+	// ASSERT
+	BOOST_ASSERT(other_data.empty());
+	BOOST_ASSERT(other_start == other_end);
+}
+
+BOOST_FIXTURE_TEST_CASE(mapped_storage_get_data, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	auto candles = generate_candles(20, start_time);
+	auto instrument_data = to_data(candles);
+
+	// SB: incomplete candle isn't stored
+	(*instrument_data.back())[tbp::oanda::values::instrument_data::c_complete] = false;
+	candles = slice(candles, 0, candles.size() - 1);
+
+	tbp::oanda::mapped_storage ds(tmp_folder.path);
+
+	// ACT
+	ds.save_data(instrument_id, default_granularity, instrument_data);
+
+	auto start = candles.timestamp.front();
+	auto end = candles.timestamp.back();
+	auto data = ds.get_data(instrument_id, default_granularity, &start, &end);
+	auto saved_candles = ds.get_candles(instrument_id, default_granularity, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(data.size() == candles.size());
+	BOOST_ASSERT(is_equal(saved_candles, candles));
+
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		const auto& ask_data = tbp::get<tbp::data_t>(data[i]->at(tbp::oanda::values::instrument_data::c_ask_candlestick));
+
+		BOOST_ASSERT(tbp::get<tbp::time_t>(data[i]->at(tbp::oanda::values::instrument_data::c_timestamp)) == candles.timestamp[i]);
+		BOOST_ASSERT(tbp::get<double>(ask_data.at(tbp::oanda::values::candlestick_data::c_close_price)) == candles.ask.close[i]);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(mapped_storage_instant_data, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	auto instrument_data = generate_instant_data(100);
+
+	tbp::oanda::mapped_storage ds(tmp_folder.path);
+
+	// ACT
+	ds.save_instant_data(instrument_id, instrument_data);
+
+	auto start = start_time + std::chrono::milliseconds(1000);
+	auto end = start_time + std::chrono::milliseconds(5000);
+	auto data = ds.get_instant_data(instrument_id, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(41 == data.size());
+	BOOST_ASSERT(start == start_time + std::chrono::milliseconds(1000));
+	BOOST_ASSERT(end == start_time + std::chrono::milliseconds(5000));
+
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		BOOST_ASSERT(*data[i] == *instrument_data[10 + i]);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(mapped_storage_scan, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	auto candles = generate_candles(100, start_time);
+
+	// SB: gap in data, windows without candles are skipped
+	auto second_part = slice(candles, 50, 50);
+	for (auto& timestamp : second_part.timestamp)
+	{
+		timestamp += std::chrono::hours(1);
+	}
+
+	tbp::oanda::mapped_storage ds(tmp_folder.path);
+	ds.save_candles(instrument_id, default_granularity, slice(candles, 0, 50));
+	ds.save_candles(instrument_id, default_granularity, second_part);
+
+	auto start = candles.timestamp.front();
+	auto end = second_part.timestamp.back();
+	auto expected = ds.get_data(instrument_id, default_granularity, &start, &end);
+
+	// ACT
+	std::vector<tbp::data_t::ptr> data;
+	for (auto& chunk : ds.scan(instrument_id, default_granularity, start, end, 7))
+	{
+		BOOST_ASSERT(!chunk.empty());
+		BOOST_ASSERT(chunk.size() <= 7);
+		data.insert(data.end(), chunk.begin(), chunk.end());
+	}
+
+	// ASSERT
+	BOOST_ASSERT(100 == data.size());
+	BOOST_ASSERT(std::equal(data.begin(), data.end(), expected.begin(), [](const tbp::data_t::ptr& lhs, const tbp::data_t::ptr& rhs) { return *lhs == *rhs; }));
+}
\ No newline at end of file
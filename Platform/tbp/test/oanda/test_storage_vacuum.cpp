@@ -0,0 +1,128 @@
+#include <boost/test/unit_test.hpp>
+
+#include <oanda/data_storage.h>
+#include <oanda/storage_vacuum.h>
+#include <oanda/tick_archive.h>
+
+#include <test_helpers/base_fixture.h>
+
+namespace
+{
+	struct common_fixture : test_helpers::temp_dir_fixture
+	{
+		// SB: ticks of three days, one tick per second
+		std::vector<tbp::data_t::ptr> generate_instant_data()
+		{
+			const auto first_timestamp = tbp::time_t(std::chrono::seconds(1500000000));
+
+			std::vector<tbp::data_t::ptr> result;
+			for (int i = 0; i < 3 * 24 * 60 * 60; ++i)
+			{
+				tbp::data_t tick;
+				tick[tbp::oanda::values::instrument_data::c_timestamp] = first_timestamp + std::chrono::seconds(i);
+				tick[tbp::oanda::values::instant_data::c_bid_price] = 1.1 + (i % 100) / 100000.0;
+				tick[tbp::oanda::values::instant_data::c_ask_price] = 1.1 + (i % 100 + 2) / 100000.0;
+
+				result.emplace_back(std::make_shared<tbp::data_t>(std::move(tick)));
+			}
+
+			return result;
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(storage_vacuum_releases_free_pages, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+
+	const auto instrument_data = generate_instant_data();
+	ds.save_instant_data(instrument_id, instrument_data);
+
+	// SB: compaction drops partitions of archived days, their pages become free
+	tbp::oanda::tick_archive(db).compact(tbp::time_t(std::chrono::seconds(1500000000)) + std::chrono::hours(72));
+	const auto page_count = db->page_count();
+	const auto free_pages = db->freelist_count();
+
+	// ACT
+	size_t released_pages = 0;
+	while (const auto pages = tbp::oanda::vacuum::step(db, 100))
+	{
+		released_pages += pages;
+	}
+
+	// ASSERT
+	BOOST_ASSERT(sqlite::auto_vacuum_mode::incremental == db->auto_vacuum());
+	BOOST_ASSERT(free_pages > 100);
+	BOOST_ASSERT(released_pages == free_pages);
+	BOOST_ASSERT(0 == db->freelist_count());
+	// SB: pointer map pages of released pages are released as well
+	BOOST_ASSERT(db->page_count() <= page_count - free_pages);
+}
+
+BOOST_FIXTURE_TEST_CASE(storage_vacuum_enable_existing_db, common_fixture)
+{
+	// INIT
+	// SB: DB which was created without auto vacuum
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	db->create_statement(L"CREATE TABLE [DATA]([VALUE] BLOB)")->step();
+	db->create_statement(L"INSERT INTO DATA(VALUE) VALUES (ZEROBLOB(1000000))")->step();
+	db->create_statement(L"DELETE FROM DATA")->step();
+
+	BOOST_ASSERT(sqlite::auto_vacuum_mode::none == db->auto_vacuum());
+	BOOST_ASSERT(0 != db->freelist_count());
+	BOOST_ASSERT(0 == tbp::oanda::vacuum::step(db, 100));
+
+	// ACT
+	tbp::oanda::vacuum::enable(db);
+
+	// ASSERT
+	BOOST_ASSERT(sqlite::auto_vacuum_mode::incremental == db->auto_vacuum());
+	BOOST_ASSERT(0 == db->freelist_count());
+}
+
+BOOST_FIXTURE_TEST_CASE(storage_vacuum_start_existing_db, common_fixture)
+{
+	// INIT
+	// SB: DB of the current schema version which was created before incremental vacuum was supported
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	const auto db_path = tmp_folder.path + L"\\" + db_name;
+	const auto instrument_data = generate_instant_data();
+	const auto saved_data = std::vector<tbp::data_t::ptr>(instrument_data.begin(), instrument_data.begin() + 1000);
+	{
+		auto db = sqlite::connection::create(db_path);
+		tbp::oanda::data_storage ds(db);
+		ds.save_instant_data(instrument_id, saved_data);
+
+		db->set_auto_vacuum(sqlite::auto_vacuum_mode::none);
+		db->vacuum();
+	}
+
+	// ACT
+	// SB: DB is rebuilt by vacuum thread, storage waits for it on destruction
+	{
+		tbp::oanda::data_storage ds(sqlite::connection::create(db_path));
+		ds.start_vacuum(sqlite::connection::create(db_path), std::chrono::seconds(60));
+	}
+
+	// SB: rebuild of DB file changes schema cookie, it doesn't affect version of DB schema
+	auto db = sqlite::connection::create(db_path);
+	tbp::oanda::data_storage ds(db);
+
+	auto start = tbp::time_t(std::chrono::seconds(1500000000));
+	auto end = start + std::chrono::hours(1);
+	const auto data = ds.get_instant_data(instrument_id, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(sqlite::auto_vacuum_mode::incremental == db->auto_vacuum());
+	BOOST_ASSERT(5 == db->user_version());
+	BOOST_ASSERT(data.size() == saved_data.size());
+}
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include <boost/test/unit_test.hpp>
+
+#include <oanda/tick_archive.h>
+#include <oanda/tick_partitions.h>
+#include <oanda/data_storage.h>
+
+#include <test_helpers/base_fixture.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace
+{
+	struct common_fixture : test_helpers::temp_dir_fixture
+	{
+		std::mt19937 rand;
+		const tbp::time_t start_time = tbp::time_t(std::chrono::seconds(1500000000));
+
+		// SB: random walk of 5 digits quotes with irregular intervals, like real ticks
+		std::vector<tbp::oanda::archive::tick> generate_ticks(size_t count, tbp::time_t first_timestamp)
+		{
+			std::vector<tbp::oanda::archive::tick> result;
+			auto timestamp = first_timestamp.time_since_epoch().count();
+			__int64 bid = 112345;
+			for (size_t i = 0; i < count; ++i)
+			{
+				timestamp += std::chrono::duration_cast<tbp::time_t::duration>(std::chrono::milliseconds(100 + rand() % 1000)).count();
+				bid += static_cast<__int64>(rand() % 5) - 2;
+				const __int64 spread = 0 == rand() % 10 ? 3 : 2;
+
+				result.push_back({ timestamp, bid / 100000.0, (bid + spread) / 100000.0 });
+			}
+
+			return result;
+		}
+
+		std::vector<tbp::data_t::ptr> to_data(const std::vector<tbp::oanda::archive::tick>& ticks)
+		{
+			std::vector<tbp::data_t::ptr> result;
+			for (const auto& t : ticks)
+			{
+				tbp::data_t instrument_data;
+				instrument_data[tbp::oanda::values::instrument_data::c_timestamp] = tbp::time_t(tbp::time_t::duration(t.timestamp));
+				instrument_data[tbp::oanda::values::instant_data::c_bid_price] = t.bid;
+				instrument_data[tbp::oanda::values::instant_data::c_ask_price] = t.ask;
+
+				result.emplace_back(std::make_shared<tbp::data_t>(std::move(instrument_data)));
+			}
+
+			return result;
+		}
+
+		bool is_equal(const std::vector<tbp::oanda::archive::tick>& lhs, const std::vector<tbp::oanda::archive::tick>& rhs)
+		{
+			// SB: prices should be bit exact
+			return lhs.size() == rhs.size() && (lhs.empty() || 0 == std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(tbp::oanda::archive::tick)));
+		}
+
+		bool is_equal(const std::vector<tbp::data_t::ptr>& lhs, const std::vector<tbp::data_t::ptr>& rhs)
+		{
+			return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const tbp::data_t::ptr& l, const tbp::data_t::ptr& r) { return *l == *r; });
+		}
+
+		size_t count_rows(const sqlite::connection::ptr& db, const std::wstring& table)
+		{
+			auto st = db->create_statement(L"SELECT COUNT(*) FROM " + table);
+			st->step();
+
+			return static_cast<size_t>(st->get_value<__int64>(0));
+		}
+
+		size_t count_partitions(const sqlite::connection::ptr& db)
+		{
+			return count_rows(db, L"INSTANT_DATA_PARTITIONS");
+		}
+
+		// SB: ticks which aren't archived yet
+		size_t count_ticks(const sqlite::connection::ptr& db)
+		{
+			size_t result = 0;
+			for (const auto day : tbp::oanda::tick_partitions(db).find(0, std::numeric_limits<__int64>::max()))
+			{
+				result += count_rows(db, tbp::oanda::tick_partitions::get_table_name(day));
+			}
+
+			return result;
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(tick_archive_block_roundtrip, common_fixture)
+{
+	// INIT
+	const auto ticks = generate_ticks(10000, start_time);
+
+	// ACT
+	const auto block = tbp::oanda::archive::encode_block(ticks);
+
+	std::vector<tbp::oanda::archive::tick> decoded;
+	tbp::oanda::archive::decode_block(block, &decoded);
+
+	// ASSERT
+	BOOST_ASSERT(is_equal(decoded, ticks));
+
+	// SB: tick takes 24 bytes in memory and even more as SQLite row
+	BOOST_ASSERT(block.size() * 10 < ticks.size() * sizeof(tbp::oanda::archive::tick));
+}
+
+BOOST_FIXTURE_TEST_CASE(tick_archive_block_arbitrary_prices, common_fixture)
+{
+	// INIT
+	// SB: prices which aren't decimal quotes are stored as XOR of bits
+	auto ticks = generate_ticks(1000, start_time);
+	std::uniform_real_distribution<double> price(0.5, 2.0);
+	for (auto& t : ticks)
+	{
+		t.bid = price(rand);
+		t.ask = t.bid + price(rand) / 1000.0;
+	}
+
+	// ACT
+	const auto block = tbp::oanda::archive::encode_block(ticks);
+
+	std::vector<tbp::oanda::archive::tick> decoded;
+	tbp::oanda::archive::decode_block(block, &decoded);
+
+	// ASSERT
+	BOOST_ASSERT(is_equal(decoded, ticks));
+}
+
+BOOST_FIXTURE_TEST_CASE(tick_archive_corrupted_block, common_fixture)
+{
+	// INIT
+	auto block = tbp::oanda::archive::encode_block(generate_ticks(100, start_time));
+	block.resize(block.size() / 2);
+
+	// ACT
+	std::vector<tbp::oanda::archive::tick> decoded;
+
+	// ASSERT
+	BOOST_ASSERT_EXCEPT(tbp::oanda::archive::decode_block(block, &decoded), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(tick_archive_compact, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+
+	// SB: about 3 hours of ticks
+	const auto ticks = generate_ticks(20000, start_time);
+	const auto instrument_data = to_data(ticks);
+	ds.save_instant_data(instrument_id, instrument_data);
+
+	auto start = start_time;
+	auto end = tbp::time_t(tbp::time_t::duration(ticks.back().timestamp));
+	const auto expected = ds.get_instant_data(instrument_id, &start, &end);
+
+	// ACT
+	// SB: the last hour isn't complete before cutoff, it stays in the table
+	tbp::oanda::tick_archive archive(db);
+	const auto moved_ticks = archive.compact(end);
+
+	start = start_time;
+	end = tbp::time_t(tbp::time_t::duration(ticks.back().timestamp));
+	const auto data = ds.get_instant_data(instrument_id, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(moved_ticks > 0);
+	BOOST_ASSERT(moved_ticks < ticks.size());
+	BOOST_ASSERT(count_ticks(db) == ticks.size() - moved_ticks);
+	BOOST_ASSERT(count_rows(db, L"INSTANT_DATA_ARCHIVE") > 0);
+	BOOST_ASSERT(is_equal(data, expected));
+
+	// INIT
+	// SB: range in the middle of archived block
+	auto range_start = tbp::time_t(tbp::time_t::duration(ticks[100].timestamp));
+	auto range_end = tbp::time_t(tbp::time_t::duration(ticks[200].timestamp));
+
+	// ACT
+	const auto range_data = ds.get_instant_data(instrument_id, &range_start, &range_end);
+
+	// ASSERT
+	BOOST_ASSERT(is_equal(range_data, std::vector<tbp::data_t::ptr>(instrument_data.begin() + 100, instrument_data.begin() + 201)));
+}
+
+BOOST_FIXTURE_TEST_CASE(tick_archive_late_ticks, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+	tbp::oanda::tick_archive archive(db);
+
+	auto ticks = generate_ticks(100, start_time);
+	ds.save_instant_data(instrument_id, to_data(ticks));
+	archive.compact(start_time + std::chrono::hours(2));
+
+	// ACT
+	// SB: tick of archived hour is updated after archiving
+	ticks[50].bid -= 0.001;
+	ds.save_instant_data(instrument_id, to_data({ ticks[50] }));
+
+	auto start = start_time;
+	auto end = start_time + std::chrono::hours(2);
+	const auto data = ds.get_instant_data(instrument_id, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(is_equal(data, to_data(ticks)));
+
+	// ACT
+	const auto moved_ticks = archive.compact(start_time + std::chrono::hours(2));
+
+	start = start_time;
+	end = start_time + std::chrono::hours(2);
+	const auto compacted_data = ds.get_instant_data(instrument_id, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(1 == moved_ticks);
+	BOOST_ASSERT(0 == count_ticks(db));
+	BOOST_ASSERT(is_equal(compacted_data, to_data(ticks)));
+}
+
+BOOST_FIXTURE_TEST_CASE(tick_archive_compact_drops_partitions, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+
+	// SB: ticks of three days, one tick per 10 minutes
+	std::vector<tbp::oanda::archive::tick> ticks;
+	for (size_t i = 0; i < 3 * 24 * 6; ++i)
+	{
+		ticks.push_back({ (start_time + std::chrono::minutes(10 * i)).time_since_epoch().count(), 1.12345, 1.12347 });
+	}
+
+	ds.save_instant_data(instrument_id, to_data(ticks));
+	const auto partitions_count = count_partitions(db);
+
+	// ACT
+	// SB: the last day isn't over before cutoff
+	tbp::oanda::tick_archive archive(db);
+	archive.compact(tbp::time_t(tbp::time_t::duration(ticks.back().timestamp)));
+
+	// SB: dropped partitions don't change version of DB schema, so storage is opened again
+	tbp::oanda::data_storage reopened_ds(db);
+
+	auto start = start_time;
+	auto end = tbp::time_t(tbp::time_t::duration(ticks.back().timestamp));
+	const auto data = reopened_ds.get_instant_data(instrument_id, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(4 == partitions_count);
+	BOOST_ASSERT(1 == count_partitions(db));
+	BOOST_ASSERT(is_equal(data, to_data(ticks)));
+}
+
+BOOST_FIXTURE_TEST_CASE(tick_archive_expire, common_fixture)
+{
+	// INIT
+	const auto instrument_id = L"instrument1";
+	temp_folder tmp_folder;
+	const auto db_name = unique_string();
+	auto db = sqlite::connection::create(tmp_folder.path + L"\\" + db_name);
+	tbp::oanda::data_storage ds(db);
+	tbp::oanda::tick_archive archive(db);
+
+	// SB: ticks of the first day are archived, ticks of the next days stay in partitions
+	const auto first_day_start = tbp::time_t(tbp::time_t::duration(tbp::oanda::tick_partitions::get_day_start(tbp::oanda::tick_partitions::get_day(start_time.time_since_epoch().count()))));
+	std::vector<tbp::oanda::archive::tick> ticks;
+	for (size_t i = 0; i < 3 * 24; ++i)
+	{
+		ticks.push_back({ (first_day_start + std::chrono::minutes(30 + 60 * i)).time_since_epoch().count(), 1.12345, 1.12347 });
+	}
+
+	ds.save_instant_data(instrument_id, to_data(ticks));
+	archive.compact(first_day_start + std::chrono::hours(24));
+
+	// ACT
+	// SB: cutoff in the middle of the third day, so only complete days are removed
+	const auto expired_days = archive.expire(first_day_start + std::chrono::hours(60));
+
+	auto start = first_day_start;
+	auto end = first_day_start + std::chrono::hours(72);
+	const auto data = ds.get_instant_data(instrument_id, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(1 == expired_days);
+	BOOST_ASSERT(0 == count_rows(db, L"INSTANT_DATA_ARCHIVE"));
+	BOOST_ASSERT(1 == count_partitions(db));
+	BOOST_ASSERT(is_equal(data, to_data(std::vector<tbp::oanda::archive::tick>(ticks.begin() + 48, ticks.end()))));
+}
\ No newline at end of file
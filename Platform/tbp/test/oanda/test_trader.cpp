@@ -4,7 +4,9 @@
 
 #include <mock/mock_connector.h>
 
+#include <sqlite/sqlite.h>
 #include <test_helpers/base_fixture.h>
+#include <win/fs.h>
 
 #include <algorithm>
 #include <functional>
@@ -14,6 +16,17 @@ namespace
 {
 	struct common_fixture : test_helpers::temp_dir_fixture
 	{
+	public:
+		// SB: file change counter of DB header is incremented by each committed transaction in rollback journal mode
+		unsigned long get_change_counter(const std::wstring& db_path)
+		{
+			unsigned char header[28] = {};
+			std::ifstream db_file(db_path, std::ios::binary);
+			db_file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+			return (static_cast<unsigned long>(header[24]) << 24) | (header[25] << 16) | (header[26] << 8) | header[27];
+		}
+
 	public:
 		common_fixture()
 			: temp_dir_fixture(L"")
@@ -260,4 +273,93 @@ BOOST_FIXTURE_TEST_CASE(trader_throws_on_cancelled_trade, common_fixture)
 
 	// ACT / ASSERT
 	BOOST_ASSERT_EXCEPT(trader.open_trade(L"EUR_USD", 2000), tbp::trader::trade_canceled);
+}
+
+BOOST_FIXTURE_TEST_CASE(trader_reopen_existing_db, common_fixture)
+{
+	// INIT
+	temp_folder working_dir;
+	mock_connector::ptr connector = std::make_shared<mock_connector>();
+	connector->fill_order_after_creation = true;
+	{
+		tbp::oanda::trader trader(connector, working_dir.path);
+		trader.open_trade(L"EUR_USD", 2000);
+		trader.open_trade(L"EUR_USD", 1000);
+	}
+
+	// ACT
+	// SB: existing trading DB is opened and states of its objects are reconciled with connector
+	tbp::oanda::trader trader(connector, working_dir.path);
+	trader.close_pending_trades();
+
+	// ASSERT
+	BOOST_ASSERT(connector->orders_log.size() == 2);
+	BOOST_ASSERT(connector->trades_log.size() == 2);
+	BOOST_ASSERT(connector->trades_log[0]->state() == tbp::trade::state_t::closed);
+	BOOST_ASSERT(connector->trades_log[1]->state() == tbp::trade::state_t::closed);
+}
+
+BOOST_FIXTURE_TEST_CASE(trader_migrate_db_from_v1, common_fixture)
+{
+	// INIT
+	// SB: version 1 DB has no indexes and keeps its version in schema version
+	temp_folder working_dir;
+	const auto db_path = working_dir.path + L"\\DB\\oanda\\trading.db";
+	mock_connector::ptr connector = std::make_shared<mock_connector>();
+	connector->fill_order_after_creation = true;
+	{
+		win::fs::create_path(working_dir.path + L"\\DB\\oanda");
+		auto db = sqlite::connection::create(db_path);
+
+		auto st = db->create_statement(L"CREATE TABLE [IDS]([ID] INTEGER PRIMARY KEY NOT NULL, [LOCAL_ID] TEXT, [REMOTE_ID] TEXT)");
+		st->step();
+
+		st = db->create_statement(L"CREATE TABLE [ORDERS]([ID] REFERENCES IDS(ID) ON DELETE CASCADE, [CREATED] INTEGER, [PROCESSED] INTEGER, [STATE] INTEGER, [LINKED_TRADE] REFERENCES IDS(ID))");
+		st->step();
+
+		st = db->create_statement(L"CREATE TABLE [TRADES]([ID] REFERENCES IDS(ID) ON DELETE CASCADE, [OPENED] INTEGER, [STATE] INTEGER, [LINKED_ORDER] REFERENCES IDS(ID))");
+		st->step();
+
+		db->set_schema_version(1);
+
+		for (size_t i = 0; i < 2; ++i)
+		{
+			connector->create_order(tbp::data_t());
+			const auto trade_id = connector->trades_log.back()->id();
+
+			st = db->create_statement(L"INSERT INTO IDS(LOCAL_ID, REMOTE_ID) VALUES (?1, ?1)");
+			st->bind_text(trade_id, 1);
+			st->step();
+
+			const auto trade_row_id = st->last_insert_row_id();
+			st = db->create_statement(L"INSERT INTO TRADES(ID, OPENED, STATE) VALUES (?1, 0, ?2)");
+			st->bind_int64(trade_row_id, 1);
+			st->bind_int(static_cast<int>(tbp::trade::state_t::opened), 2);
+			st->step();
+		}
+	}
+
+	// ACT
+	tbp::oanda::trader trader(connector, working_dir.path);
+
+	const auto change_counter = get_change_counter(db_path);
+	trader.close_pending_trades();
+
+	// ASSERT
+	// SB: states of all closed trades are saved by one transaction
+	BOOST_ASSERT(change_counter + 1 == get_change_counter(db_path));
+	BOOST_ASSERT(connector->trades_log[0]->state() == tbp::trade::state_t::closed);
+	BOOST_ASSERT(connector->trades_log[1]->state() == tbp::trade::state_t::closed);
+
+	auto db = sqlite::connection::create(db_path);
+	BOOST_ASSERT(2 == db->user_version());
+
+	auto st = db->create_statement(L"SELECT COUNT(*) FROM SQLITE_MASTER WHERE TYPE = 'index'");
+	BOOST_ASSERT(st->step());
+	BOOST_ASSERT(6 == st->get_value<int>(0));
+
+	st = db->create_statement(L"SELECT COUNT(*) FROM TRADES WHERE STATE = ?1");
+	st->bind_int(static_cast<int>(tbp::trade::state_t::closed), 1);
+	BOOST_ASSERT(st->step());
+	BOOST_ASSERT(2 == st->get_value<int>(0));
 }
\ No newline at end of file
@@ -202,4 +202,131 @@ BOOST_FIXTURE_TEST_CASE(ema_calculation_for_different_containers, common_fixture
 		// ASSERT
 		BOOST_ASSERT(is_equal(ema, ethalon_ema));
 	}
+}
+
+BOOST_FIXTURE_TEST_CASE(ema_state_matches_calculate_ema, common_fixture)
+{
+	// INIT
+	tbp::analysis::ema_state ema(4);
+	std::deque<double> ema_values;
+
+	// ACT
+	for (const auto& price : prices)
+	{
+		ema_values.push_back(ema.update(price));
+	}
+
+	// ASSERT
+	BOOST_ASSERT(is_equal(ema_values, ethalon_ema));
+	BOOST_ASSERT(ema.ready());
+}
+
+BOOST_FIXTURE_TEST_CASE(ema_state_seed_and_continue, common_fixture)
+{
+	for (size_t i = 0; i < prices.size(); ++i)
+	{
+		// INIT
+		tbp::analysis::ema_state ema(4);
+		ema.seed(prices.begin(), prices.begin() + i);
+
+		// ACT
+		for (size_t j = i; j < prices.size(); ++j)
+		{
+			ema.update(prices[j]);
+		}
+
+		// ASSERT
+		BOOST_ASSERT(round_to(ema.value(), 10) == round_to(ethalon_ema.back(), 10));
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(ema_state_invalid_length, common_fixture)
+{
+	// ACT / ASSERT
+	BOOST_ASSERT_EXCEPT(tbp::analysis::ema_state(0), std::runtime_error);
+	BOOST_ASSERT_EXCEPT(tbp::analysis::sma_state(0), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(sma_state_calculation, common_fixture)
+{
+	// INIT
+	const unsigned long length = 3;
+	tbp::analysis::sma_state sma(length);
+
+	for (size_t i = 0; i < prices.size(); ++i)
+	{
+		// ACT
+		auto value = sma.update(prices[i]);
+
+		// ASSERT
+		if (i + 1 < length)
+		{
+			BOOST_ASSERT(!sma.ready());
+			BOOST_ASSERT(0.0 == value);
+		}
+		else
+		{
+			auto expected = (prices[i] + prices[i - 1] + prices[i - 2]) / length;
+			BOOST_ASSERT(sma.ready());
+			BOOST_ASSERT(round_to(value, 1000) == round_to(expected, 1000));
+		}
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(indicator_states_save_load, common_fixture)
+{
+	// INIT
+	tbp::analysis::sma_state sma(3);
+	tbp::analysis::ema_state ema(4);
+	tbp::analysis::macd_state macd(3, 5, 2);
+
+	tbp::analysis::sma_state sma_ethalon(3);
+	tbp::analysis::ema_state ema_ethalon(4);
+	tbp::analysis::macd_state macd_ethalon(3, 5, 2);
+
+	const size_t half = prices.size() / 2;
+	sma.seed(prices.begin(), prices.begin() + half);
+	ema.seed(prices.begin(), prices.begin() + half);
+	macd.seed(prices.begin(), prices.begin() + half);
+
+	sma_ethalon.seed(prices);
+	ema_ethalon.seed(prices);
+	macd_ethalon.seed(prices);
+
+	// ACT
+	auto sma_loaded = tbp::analysis::sma_state::load(sma.save());
+	auto ema_loaded = tbp::analysis::ema_state::load(ema.save());
+	auto macd_loaded = tbp::analysis::macd_state::load(macd.save());
+
+	for (size_t i = half; i < prices.size(); ++i)
+	{
+		sma_loaded.update(prices[i]);
+		ema_loaded.update(prices[i]);
+		macd_loaded.update(prices[i]);
+	}
+
+	// ASSERT
+	BOOST_ASSERT(sma_loaded.value() == sma_ethalon.value());
+	BOOST_ASSERT(ema_loaded.value() == ema_ethalon.value());
+	BOOST_ASSERT(macd_loaded.value() == macd_ethalon.value());
+	BOOST_ASSERT(macd_loaded.signal() == macd_ethalon.signal());
+	BOOST_ASSERT(macd_loaded.histogram() == macd_ethalon.histogram());
+}
+
+BOOST_FIXTURE_TEST_CASE(macd_state_calculation, common_fixture)
+{
+	// INIT
+	tbp::analysis::macd_state macd(3, 5, 2);
+	std::deque<double> fast_ema;
+	std::deque<double> slow_ema;
+	tbp::analysis::calculate_ema(prices, &fast_ema, 3);
+	tbp::analysis::calculate_ema(prices, &slow_ema, 5);
+
+	// ACT
+	macd.seed(prices);
+
+	// ASSERT
+	BOOST_ASSERT(macd.ready());
+	BOOST_ASSERT(round_to(macd.value(), 1000) == round_to(fast_ema.back() - slow_ema.back(), 1000));
+	BOOST_ASSERT(round_to(macd.histogram(), 1000) == round_to(macd.value() - macd.signal(), 1000));
 }
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include <boost/test/unit_test.hpp>
+
+#include <core/async_storage.h>
+
+#include <mock/mock_data_storage.h>
+
+#include <test_helpers/base_fixture.h>
+
+#include <win/thread.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	struct common_fixture : test_helpers::base_fixture
+	{
+		const std::wstring instrument_id = L"instrument1";
+		const unsigned long granularity = 5;
+
+	public:
+		// SB: async storage writes candles by batches only
+		std::shared_ptr<mock_data_storage> create_storage()
+		{
+			auto result = std::make_shared<mock_data_storage>();
+			result->batch_only = true;
+
+			return result;
+		}
+
+	public:
+		common_fixture()
+			: base_fixture(L"async_storage")
+		{
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(async_storage_reads_own_writes, common_fixture)
+{
+	// INIT
+	auto storage = create_storage();
+	tbp::async_storage s(storage);
+	auto candles = generate_candles(granularity, 10, 0);
+
+	// ACT
+	s.save_candles(instrument_id, granularity, candles);
+
+	auto start = candles.timestamp.front();
+	auto end = candles.timestamp.back();
+	auto result = s.get_candles(instrument_id, granularity, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(result.timestamp == candles.timestamp);
+	BOOST_ASSERT(result.volume == candles.volume);
+}
+
+BOOST_FIXTURE_TEST_CASE(async_storage_group_commit, common_fixture)
+{
+	// INIT
+	auto storage = create_storage();
+	storage->block_first_save = true;
+	tbp::async_storage s(storage);
+
+	s.save_candles(instrument_id, granularity, generate_candles(granularity, 1, 0));
+	storage->first_save_started.wait(INFINITE);
+
+	// ACT
+	// SB: writer is busy, so these saves are queued and written by the next batch
+	for (size_t i = 1; i <= 10; ++i)
+	{
+		s.save_candles(instrument_id, granularity, generate_candles(granularity, 1, i));
+	}
+
+	storage->release_first_save.set();
+	s.flush();
+
+	// ASSERT
+	BOOST_ASSERT(2 == storage->batches.size());
+	BOOST_ASSERT(1 == storage->batches[0]);
+	BOOST_ASSERT(10 == storage->batches[1]);
+	BOOST_ASSERT(storage->candles.volume == generate_candles(granularity, 11, 0).volume);
+}
+
+BOOST_FIXTURE_TEST_CASE(async_storage_max_batch_size, common_fixture)
+{
+	// INIT
+	auto storage = create_storage();
+	storage->block_first_save = true;
+	tbp::async_storage s(storage, 4);
+
+	s.save_candles(instrument_id, granularity, generate_candles(granularity, 1, 0));
+	storage->first_save_started.wait(INFINITE);
+
+	// ACT
+	for (size_t i = 1; i <= 10; ++i)
+	{
+		s.save_candles(instrument_id, granularity, generate_candles(granularity, 1, i));
+	}
+
+	storage->release_first_save.set();
+	s.flush();
+
+	// ASSERT
+	BOOST_ASSERT(storage->batches.size() >= 4);
+	BOOST_ASSERT(std::all_of(storage->batches.begin(), storage->batches.end(), [](size_t count) { return count <= 4; }));
+	BOOST_ASSERT(storage->candles.volume == generate_candles(granularity, 11, 0).volume);
+}
+
+BOOST_FIXTURE_TEST_CASE(async_storage_flush_rethrows_write_error, common_fixture)
+{
+	// INIT
+	auto storage = create_storage();
+	storage->fail = true;
+	tbp::async_storage s(storage);
+
+	// ACT
+	s.save_candles(instrument_id, granularity, generate_candles(granularity, 1, 0));
+
+	// ASSERT
+	BOOST_ASSERT_EXCEPT(s.flush(), std::runtime_error);
+
+	// SB: error is reported once
+	s.flush();
+}
+
+BOOST_FIXTURE_TEST_CASE(async_storage_drops_failed_save_only, common_fixture)
+{
+	// INIT
+	auto storage = create_storage();
+	storage->block_first_save = true;
+	storage->fail_volume = 100;
+	tbp::async_storage s(storage);
+
+	s.save_candles(instrument_id, granularity, generate_candles(granularity, 1, 0));
+	storage->first_save_started.wait(INFINITE);
+
+	// SB: another thread queues failed save into the same group commit and flushes after it's written
+	win::event failed_save_queued(false, false);
+	win::event flush_failed_save(false, false);
+	bool flush_failed = false;
+	std::thread other([&]()
+	{
+		s.save_candles(instrument_id, granularity, generate_candles(granularity, 1, 100));
+		failed_save_queued.set();
+		flush_failed_save.wait(INFINITE);
+
+		try
+		{
+			s.flush();
+		}
+		catch (const std::runtime_error&)
+		{
+			flush_failed = true;
+		}
+	});
+
+	failed_save_queued.wait(INFINITE);
+
+	// ACT
+	for (size_t i = 1; i <= 10; ++i)
+	{
+		s.save_candles(instrument_id, granularity, generate_candles(granularity, 1, i));
+	}
+
+	storage->release_first_save.set();
+	s.flush();
+
+	flush_failed_save.set();
+	other.join();
+
+	// ASSERT
+	BOOST_ASSERT(flush_failed);
+	BOOST_ASSERT(storage->candles.volume == generate_candles(granularity, 11, 0).volume);
+}
+
+BOOST_FIXTURE_TEST_CASE(async_storage_writes_queue_on_destruction, common_fixture)
+{
+	// INIT
+	auto storage = create_storage();
+
+	// ACT
+	{
+		tbp::async_storage s(storage);
+		for (size_t i = 0; i < 10; ++i)
+		{
+			s.save_candles(instrument_id, granularity, generate_candles(granularity, 1, i));
+		}
+	}
+
+	// ASSERT
+	BOOST_ASSERT(storage->candles.volume == generate_candles(granularity, 10, 0).volume);
+}
\ No newline at end of file
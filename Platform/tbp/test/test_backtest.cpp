@@ -0,0 +1,322 @@
+#include <boost/test/unit_test.hpp>
+
+#include <core/backtest.h>
+
+#include <test_helpers/base_fixture.h>
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <sstream>
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////
+	// scripted_strategy
+	// SB: opens trade with specified amount on the 'open_at' candle and closes it on the 'close_at' candle
+
+	struct scripted_strategy : public tbp::strategy
+	{
+		const tbp::trader::ptr trader;
+		const double amount;
+		const size_t open_at;
+		const size_t close_at;
+		size_t index;
+		std::wstring trade_id;
+		boost::signals2::scoped_connection connection;
+
+	public:
+		void on_candles(const std::wstring& instrument_id, const tbp::candle_series& candles)
+		{
+			for (size_t i = 0; i < candles.size(); ++i)
+			{
+				const auto current = index++;
+				if (current == open_at)
+				{
+					trade_id = trader->open_trade(instrument_id, amount);
+				}
+				else if (current == close_at && !trade_id.empty())
+				{
+					trader->close_trade(trade_id, 0.0);
+					trade_id.clear();
+				}
+			}
+		}
+
+	public:
+		scripted_strategy(const tbp::data_provider::ptr& dp, const tbp::trader::ptr& t, double amount, size_t open_at, size_t close_at)
+			: trader(t)
+			, amount(amount)
+			, open_at(open_at)
+			, close_at(close_at)
+			, index(0)
+			, connection(dp->on_historical_candles.connect(std::bind(&scripted_strategy::on_candles, this, std::placeholders::_1, std::placeholders::_2)))
+		{
+		}
+	};
+
+	/////////////////////////////////////////////////////////////////////
+	// series_provider
+	// SB: returns candles from the series within requested range, counts requests
+
+	struct series_provider : public tbp::data_provider
+	{
+		tbp::candle_series candles;
+		mutable size_t requests_count = 0;
+
+	public:
+		virtual std::vector<tbp::data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
+		{
+			return std::vector<tbp::data_t::ptr>();
+		}
+
+		virtual std::vector<tbp::data_t::ptr> get_instant_data(const std::wstring& instrument_id, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
+		{
+			return std::vector<tbp::data_t::ptr>();
+		}
+
+		virtual tbp::candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
+		{
+			++requests_count;
+
+			tbp::candle_series result;
+			for (size_t i = 0; i < candles.size(); ++i)
+			{
+				if (candles.timestamp[i] >= *start_datetime && candles.timestamp[i] <= *end_datetime)
+				{
+					result.append(candles, i, 1);
+				}
+			}
+
+			return result;
+		}
+	};
+
+	struct common_fixture : test_helpers::base_fixture
+	{
+		const std::wstring instrument = L"EUR_USD";
+		const tbp::time_t start_time = tbp::time_t(std::chrono::hours(24 * 365 * 40));
+		const tbp::settings::ptr settings = tbp::settings::load_from_json(LR"({ "WorkingInstrument": "EUR_USD", "DataGranularity": 60, "TradeFrame": 3600 })");
+
+	public:
+		// SB: trending sine wave, it crosses EMAs many times
+		tbp::candle_series generate_candles(size_t count)
+		{
+			tbp::candle_series result;
+			result.reserve(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				const double price = 1.1 + 0.01 * std::sin(i / 20.0) + 0.000001 * i;
+
+				tbp::candlestick_data candle;
+				candle.timestamp = start_time + std::chrono::minutes(i);
+				candle.volume = 10;
+				candle.bid.open = price - 0.0001;
+				candle.bid.high = price + 0.0004;
+				candle.bid.low = price - 0.0006;
+				candle.bid.close = price;
+				candle.ask.open = candle.bid.open + 0.0002;
+				candle.ask.high = candle.bid.high + 0.0002;
+				candle.ask.low = candle.bid.low + 0.0002;
+				candle.ask.close = candle.bid.close + 0.0002;
+
+				result.push_back(candle);
+			}
+
+			return result;
+		}
+
+		tbp::backtest::parameters get_parameters()
+		{
+			tbp::backtest::parameters params;
+			params.instrument = instrument;
+			params.granularity = 60;
+			params.initial_balance = 10000.0;
+			params.margin_rate = 0.02;
+
+			return params;
+		}
+
+		tbp::backtest::strategy_factory scripted(double amount, size_t open_at, size_t close_at)
+		{
+			return [=](const tbp::data_provider::ptr& dp, const tbp::connector::ptr&, const tbp::trader::ptr& t)
+			{
+				return std::make_shared<scripted_strategy>(dp, t, amount, open_at, close_at);
+			};
+		}
+
+		tbp::backtest::strategy_factory ema_strategy()
+		{
+			return [this](const tbp::data_provider::ptr& dp, const tbp::connector::ptr& c, const tbp::trader::ptr& t)
+			{
+				return tbp::create_ema_strategy(dp, c, t, settings);
+			};
+		}
+
+		static bool is_close(double lhs, double rhs)
+		{
+			return std::abs(lhs - rhs) < 1e-9;
+		}
+
+	public:
+		common_fixture()
+			: base_fixture(L"backtest")
+		{
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(backtest_fills_at_close_prices, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(10);
+
+	// ACT
+	const auto result = tbp::backtest::run(candles, get_parameters(), scripted(1000.0, 2, 6));
+
+	// ASSERT
+	const double profit = 1000.0 * (candles.bid.close[6] - candles.ask.close[2]);
+
+	BOOST_ASSERT(10 == result.candles_count);
+	BOOST_ASSERT(2 == result.fills.size());
+	BOOST_ASSERT(result.fills[0].trade_id == result.fills[1].trade_id);
+	BOOST_ASSERT(1000.0 == result.fills[0].amount);
+	BOOST_ASSERT(candles.ask.close[2] == result.fills[0].price);
+	BOOST_ASSERT(candles.timestamp[2] == result.fills[0].timestamp);
+	BOOST_ASSERT(-1000.0 == result.fills[1].amount);
+	BOOST_ASSERT(candles.bid.close[6] == result.fills[1].price);
+	BOOST_ASSERT(is_close(profit, result.fills[1].profit));
+	BOOST_ASSERT(is_close(profit, result.realized_profit));
+	BOOST_ASSERT(is_close(10000.0 + profit, result.final_balance));
+}
+
+BOOST_FIXTURE_TEST_CASE(backtest_equity_curve, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(10);
+
+	// ACT
+	const auto result = tbp::backtest::run(candles, get_parameters(), scripted(-1000.0, 2, 6));
+
+	// ASSERT
+	BOOST_ASSERT(candles.timestamp == result.timestamp);
+	BOOST_ASSERT(10 == result.equity.size());
+	BOOST_ASSERT(10000.0 == result.equity[1]);
+
+	// SB: short trade is marked to market by ask price
+	BOOST_ASSERT(is_close(10000.0 + 1000.0 * (candles.bid.close[2] - candles.ask.close[4]), result.equity[4]));
+	BOOST_ASSERT(is_close(result.final_balance, result.equity[9]));
+
+	double peak = 10000.0;
+	double drawdown = 0.0;
+	for (auto equity : result.equity)
+	{
+		peak = std::max(peak, equity);
+		drawdown = std::max(drawdown, peak - equity);
+	}
+
+	BOOST_ASSERT(drawdown == result.max_drawdown);
+}
+
+BOOST_FIXTURE_TEST_CASE(backtest_closes_opened_trades_at_the_end, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(10);
+
+	// ACT
+	const auto result = tbp::backtest::run(candles, get_parameters(), scripted(-500.0, 3, 100));
+
+	// ASSERT
+	BOOST_ASSERT(2 == result.fills.size());
+	BOOST_ASSERT(500.0 == result.fills[1].amount);
+	BOOST_ASSERT(candles.ask.close[9] == result.fills[1].price);
+	BOOST_ASSERT(candles.timestamp[9] == result.fills[1].timestamp);
+	BOOST_ASSERT(is_close(10000.0 + result.fills[1].profit, result.final_balance));
+}
+
+BOOST_FIXTURE_TEST_CASE(backtest_rejects_order_without_margin, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(10);
+
+	// ACT
+	const auto result = tbp::backtest::run(candles, get_parameters(), scripted(1000000000.0, 2, 6));
+
+	// ASSERT
+	BOOST_ASSERT(1 == result.rejected_orders);
+	BOOST_ASSERT(result.fills.empty());
+	BOOST_ASSERT(10 == result.equity.size());
+	BOOST_ASSERT(10000.0 == result.final_balance);
+}
+
+BOOST_FIXTURE_TEST_CASE(backtest_ema_strategy, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(2000);
+
+	// ACT
+	const auto result = tbp::backtest::run(candles, get_parameters(), ema_strategy());
+
+	// ASSERT
+	BOOST_ASSERT(2000 == result.candles_count);
+	BOOST_ASSERT(2000 == result.equity.size());
+	BOOST_ASSERT(result.fills.size() > 2);
+	BOOST_ASSERT(0 == result.fills.size() % 2);
+	BOOST_ASSERT(is_close(10000.0 + result.realized_profit, result.final_balance));
+}
+
+BOOST_FIXTURE_TEST_CASE(backtest_over_data_provider_in_chunks, common_fixture)
+{
+	// INIT
+	auto provider = std::make_shared<series_provider>();
+	provider->candles = generate_candles(1000);
+
+	auto params = get_parameters();
+	params.chunk_size = 64;
+
+	const auto expected = tbp::backtest::run(provider->candles, params, ema_strategy());
+
+	// ACT
+	const auto result = tbp::backtest::run(provider, provider->candles.timestamp.front(), provider->candles.timestamp.back(), params, ema_strategy());
+
+	// ASSERT
+	BOOST_ASSERT(16 == provider->requests_count);
+	BOOST_ASSERT(expected.timestamp == result.timestamp);
+	BOOST_ASSERT(expected.equity == result.equity);
+	BOOST_ASSERT(expected.fills.size() == result.fills.size());
+	BOOST_ASSERT(expected.final_balance == result.final_balance);
+}
+
+BOOST_FIXTURE_TEST_CASE(backtest_invalid_chunk_size, common_fixture)
+{
+	// INIT
+	auto provider = std::make_shared<series_provider>();
+	auto params = get_parameters();
+	params.chunk_size = 0;
+
+	// ACT / ASSERT
+	BOOST_ASSERT_EXCEPT(tbp::backtest::run(provider, start_time, start_time + std::chrono::hours(1), params, ema_strategy()), std::invalid_argument);
+}
+
+/////////////////////////////////////////////////////////////////////
+// SB: benchmarks are disabled by default, run with --run_test=backtest_benchmark --log_level=message
+
+BOOST_AUTO_TEST_SUITE(backtest_benchmark, *boost::unit_test::disabled())
+
+// SB: one year of M1 candles
+BOOST_FIXTURE_TEST_CASE(backtest_throughput, common_fixture)
+{
+	const auto candles = generate_candles(365 * 24 * 60);
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	const auto result = tbp::backtest::run(candles, get_parameters(), ema_strategy());
+	const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::ostringstream message;
+	message << "ema strategy: " << result.candles_count << " candles, " << result.fills.size() << " fills, " << elapsed << " ms, "
+		<< (elapsed > 0 ? result.candles_count * 1000 / elapsed : 0) << " candles/s";
+
+	BOOST_TEST_MESSAGE(message.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
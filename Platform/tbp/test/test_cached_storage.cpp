@@ -0,0 +1,157 @@
+#include <boost/test/unit_test.hpp>
+
+#include <core/cached_storage.h>
+
+#include <mock/mock_data_storage.h>
+
+#include <test_helpers/base_fixture.h>
+
+#include <algorithm>
+
+namespace
+{
+	const tbp::field_id c_timestamp = mock_data_storage::timestamp_field();
+
+	struct common_fixture : test_helpers::base_fixture
+	{
+		const std::wstring instrument_id = L"instrument1";
+		const unsigned long granularity = 5;
+		const size_t capacity = 1024 * 1024;
+
+		tbp::time_t get_time(size_t index)
+		{
+			return tbp::time_t(std::chrono::seconds(granularity * index));
+		}
+
+	public:
+		common_fixture()
+			: base_fixture(L"cached_storage")
+		{
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(cached_storage_repeated_reads, common_fixture)
+{
+	// INIT
+	auto storage = std::make_shared<mock_data_storage>();
+	storage->candles = generate_candles(granularity, 5000, 0);
+	tbp::cached_storage s(storage, c_timestamp, capacity);
+
+	// ACT
+	auto start = get_time(100);
+	auto end = get_time(1999);
+	const auto result = s.get_candles(instrument_id, granularity, &start, &end);
+
+	const auto reads = storage->reads;
+
+	// SB: overlapping range is served by already loaded blocks
+	auto start2 = get_time(500);
+	auto end2 = get_time(1500);
+	const auto result2 = s.get_candles(instrument_id, granularity, &start2, &end2);
+
+	// ASSERT
+	BOOST_ASSERT(2 == reads);
+	BOOST_ASSERT(reads == storage->reads);
+	BOOST_ASSERT(result.volume == generate_candles(granularity, 1900, 100).volume);
+	BOOST_ASSERT(result2.volume == generate_candles(granularity, 1001, 500).volume);
+	BOOST_ASSERT(start == get_time(100) && end == get_time(1999));
+	BOOST_ASSERT(start2 == get_time(500) && end2 == get_time(1500));
+	BOOST_ASSERT(2 == s.stats().hits);
+	BOOST_ASSERT(2 == s.stats().misses);
+}
+
+BOOST_FIXTURE_TEST_CASE(cached_storage_invalidation, common_fixture)
+{
+	// INIT
+	auto storage = std::make_shared<mock_data_storage>();
+	storage->candles = generate_candles(granularity, 100, 0);
+	tbp::cached_storage s(storage, c_timestamp, capacity);
+
+	auto start = get_time(0);
+	auto end = get_time(199);
+	s.get_candles(instrument_id, granularity, &start, &end);
+
+	// ACT
+	s.save_candles(instrument_id, granularity, generate_candles(granularity, 100, 100));
+
+	start = get_time(0);
+	end = get_time(199);
+	const auto result = s.get_candles(instrument_id, granularity, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(2 == storage->reads);
+	BOOST_ASSERT(result.volume == generate_candles(granularity, 200, 0).volume);
+}
+
+BOOST_FIXTURE_TEST_CASE(cached_storage_data_records, common_fixture)
+{
+	// INIT
+	auto storage = std::make_shared<mock_data_storage>();
+	tbp::cached_storage s(storage, c_timestamp, capacity);
+
+	std::vector<tbp::data_t::ptr> data;
+	for (size_t i = 0; i < 10; ++i)
+	{
+		tbp::data_t record;
+		record[c_timestamp] = get_time(i);
+
+		data.emplace_back(std::make_shared<tbp::data_t>(std::move(record)));
+	}
+
+	s.save_data(instrument_id, granularity, data);
+
+	// ACT
+	auto start = get_time(2);
+	auto end = get_time(5);
+	const auto result = s.get_data(instrument_id, granularity, &start, &end);
+
+	start = get_time(3);
+	end = get_time(20);
+	const auto result2 = s.get_data(instrument_id, granularity, &start, &end);
+
+	// ASSERT
+	BOOST_ASSERT(1 == storage->reads);
+	BOOST_ASSERT(std::vector<tbp::data_t::ptr>(data.begin() + 2, data.begin() + 6) == result);
+	BOOST_ASSERT(std::vector<tbp::data_t::ptr>(data.begin() + 3, data.end()) == result2);
+	BOOST_ASSERT(start == get_time(3) && end == get_time(9));
+}
+
+BOOST_FIXTURE_TEST_CASE(cached_storage_eviction, common_fixture)
+{
+	// INIT
+	auto storage = std::make_shared<mock_data_storage>();
+	storage->candles = generate_candles(granularity, tbp::cached_storage::block_candles * 3, 0);
+
+	// SB: budget fits two blocks only
+	tbp::cached_storage s(storage, c_timestamp, tbp::cached_storage::block_candles * 200);
+
+	auto read_block = [&](size_t index)
+	{
+		auto start = get_time(index * tbp::cached_storage::block_candles);
+		auto end = start;
+		s.get_candles(instrument_id, granularity, &start, &end);
+	};
+
+	// ACT
+	read_block(0);
+	read_block(1);
+	read_block(0);
+	read_block(2);
+
+	// SB: the least recently used block is the second one
+	const auto reads = storage->reads;
+	read_block(0);
+
+	// ASSERT
+	BOOST_ASSERT(3 == reads);
+	BOOST_ASSERT(reads == storage->reads);
+	BOOST_ASSERT(1 == s.stats().evictions);
+	BOOST_ASSERT(s.stats().size <= s.stats().capacity);
+
+	// ACT
+	read_block(1);
+
+	// ASSERT
+	BOOST_ASSERT(4 == storage->reads);
+}
\ No newline at end of file
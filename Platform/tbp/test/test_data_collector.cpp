@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <functional>
 #include <fstream>
+#include <map>
 
 namespace 
 {
@@ -19,11 +20,17 @@ namespace
 	{
 		std::vector<tbp::data_t::ptr> values;
 		std::vector<tbp::data_t::ptr> instant_values;
+		tbp::candle_series candles;
+		std::map<unsigned long, tbp::candle_series> fine_candles;
 		win::event on_new_instant_data;
 		win::event on_new_data;
 		tbp::time_t start;
 		tbp::time_t end;
 
+		// SB: storage keeps coverage index per granularity if it's set
+		bool keep_coverage = false;
+		std::map<unsigned long, std::vector<tbp::time_range>> coverage;
+
 		virtual std::vector<tbp::data_t::ptr> get_data(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
 		{
 			*start_datetime = start;
@@ -40,6 +47,37 @@ namespace
 			return instant_values;
 		}
 
+		virtual tbp::candle_series get_candles(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t* start_datetime, tbp::time_t* end_datetime) const override
+		{
+			// SB: finer candles are returned for requested range the same way as real storage does
+			auto it = fine_candles.find(granularity);
+			if (fine_candles.end() != it)
+			{
+				tbp::candle_series result;
+				for (size_t i = 0; i < it->second.size(); ++i)
+				{
+					if (it->second.timestamp[i] >= *start_datetime && it->second.timestamp[i] <= *end_datetime)
+					{
+						result.push_back(it->second.at(i));
+					}
+				}
+
+				return result;
+			}
+
+			*start_datetime = start;
+			*end_datetime = end;
+
+			return candles;
+		}
+
+		virtual void save_candles(const std::wstring& instrument_id, unsigned long granularity, const tbp::candle_series& data) override
+		{
+			candles.append(data);
+
+			on_new_data.set();
+		}
+
 		virtual void save_data(const std::wstring& instrument_id, unsigned long granularity, const std::vector<tbp::data_t::ptr>& data) override
 		{
 			for (const auto& d : data)
@@ -60,6 +98,37 @@ namespace
 			on_new_instant_data.set();
 		}
 
+		virtual bool get_coverage(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t start_datetime, tbp::time_t end_datetime, std::vector<tbp::time_range>* result) const override
+		{
+			if (!keep_coverage)
+			{
+				return false;
+			}
+
+			auto it = coverage.find(granularity);
+			if (coverage.end() == it)
+			{
+				return true;
+			}
+
+			for (const auto& range : it->second)
+			{
+				if (range.start <= end_datetime && range.end >= start_datetime)
+				{
+					result->push_back(range);
+				}
+			}
+
+			return true;
+		}
+
+		virtual void add_coverage(const std::wstring& instrument_id, unsigned long granularity, tbp::time_t start_datetime, tbp::time_t end_datetime) override
+		{
+			auto& ranges = coverage[granularity];
+			ranges.push_back({ start_datetime, end_datetime });
+			std::sort(ranges.begin(), ranges.end(), [](const tbp::time_range& lhs, const tbp::time_range& rhs) { return lhs.start < rhs.start; });
+		}
+
 	public:
 		mock_data_storage()
 			: on_new_instant_data(true, false)
@@ -170,6 +239,244 @@ BOOST_FIXTURE_TEST_CASE(data_collector_request_data_from_connector_if_not_presen
 	BOOST_ASSERT(conn->data_request_log[0].end == requested_end);
 }
 
+BOOST_FIXTURE_TEST_CASE(data_collector_request_candles_from_connector_if_not_present_in_datastorage, common_fixture)
+{
+	// INIT
+	auto ds = std::make_shared<mock_data_storage>();
+	auto conn = std::make_shared<mock_connector>();
+	auto dc = std::make_unique<tbp::data_collector>(L"instrument_1", settings, conn, ds);
+	const auto delta = std::chrono::system_clock::duration(10000);
+
+	// ACT
+	ds->start = std::chrono::system_clock::now();
+	ds->end = ds->start + delta;
+	ds->on_new_data.reset();
+	const auto requested_start = ds->start - delta;
+	const auto requested_end = ds->end + delta;
+	auto actual_start = requested_start;
+	auto actual_end = requested_end;
+	auto candles = dc->get_candles(L"instrument_1", 5, &actual_start, &actual_end);
+
+	// ASSERT
+	BOOST_ASSERT(actual_start == requested_start);
+	BOOST_ASSERT(actual_end == requested_end);
+	BOOST_ASSERT(candles.size() == 1);
+	BOOST_ASSERT(ds->on_new_data.wait(0));
+	BOOST_ASSERT(ds->candles.size() == 1);
+	BOOST_ASSERT(conn->data_request_log.size() == 1);
+	BOOST_ASSERT(conn->data_request_log[0].start == requested_start);
+	BOOST_ASSERT(conn->data_request_log[0].end == requested_end);
+}
+
+BOOST_FIXTURE_TEST_CASE(data_collector_get_candles_from_datastorage, common_fixture)
+{
+	// INIT
+	auto ds = std::make_shared<mock_data_storage>();
+	auto conn = std::make_shared<mock_connector>();
+	auto dc = std::make_unique<tbp::data_collector>(L"instrument_1", settings, conn, ds);
+
+	tbp::candlestick_data candle;
+	candle.timestamp = std::chrono::system_clock::now();
+	ds->candles.push_back(candle);
+	ds->start = candle.timestamp;
+	ds->end = candle.timestamp;
+
+	// ACT
+	auto actual_start = ds->start;
+	auto actual_end = ds->end;
+	auto candles = dc->get_candles(L"instrument_1", 5, &actual_start, &actual_end);
+
+	// ASSERT
+	BOOST_ASSERT(candles.size() == 1);
+	BOOST_ASSERT(candles.timestamp[0] == candle.timestamp);
+	BOOST_ASSERT(conn->data_request_log.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(data_collector_resamples_stored_candles, common_fixture)
+{
+	// INIT
+	auto ds = std::make_shared<mock_data_storage>();
+	auto conn = std::make_shared<mock_connector>();
+	auto dc = std::make_unique<tbp::data_collector>(L"instrument_1", settings, conn, ds);
+
+	const auto start = tbp::time_t(std::chrono::hours(420000));
+	for (size_t i = 0; i < 120; ++i)
+	{
+		tbp::candlestick_data candle;
+		candle.timestamp = start + std::chrono::minutes(i);
+		candle.volume = 1;
+		candle.bid.open = candle.bid.high = candle.bid.low = candle.bid.close = 1.1 + i * 0.0001;
+		candle.ask.open = candle.ask.high = candle.ask.low = candle.ask.close = 1.1002 + i * 0.0001;
+
+		ds->fine_candles[60].push_back(candle);
+	}
+
+	ds->start = tbp::time_t();
+	ds->end = tbp::time_t();
+	ds->on_new_data.reset();
+
+	// ACT
+	auto actual_start = start;
+	auto actual_end = start + std::chrono::hours(1);
+	auto candles = dc->get_candles(L"instrument_1", 3600, &actual_start, &actual_end);
+
+	auto incomplete_start = start;
+	auto incomplete_end = start + std::chrono::hours(2);
+	auto connector_candles = dc->get_candles(L"instrument_1", 3600, &incomplete_start, &incomplete_end);
+
+	// ASSERT
+	BOOST_ASSERT(2 == candles.size());
+	BOOST_ASSERT(start == candles.timestamp[0]);
+	BOOST_ASSERT(60 == candles.volume[0]);
+	BOOST_ASSERT(ds->fine_candles[60].bid.open[60] == candles.bid.open[1]);
+	BOOST_ASSERT(ds->fine_candles[60].ask.high[119] == candles.ask.high[1]);
+	BOOST_ASSERT(ds->on_new_data.wait(0));
+
+	// SB: the third hour is not in storage, so candles are requested from connector
+	BOOST_ASSERT(1 == conn->data_request_log.size());
+	BOOST_ASSERT(incomplete_start == conn->data_request_log[0].start);
+}
+
+BOOST_FIXTURE_TEST_CASE(data_collector_does_not_resample_partial_candle, common_fixture)
+{
+	// INIT
+	auto ds = std::make_shared<mock_data_storage>();
+	auto conn = std::make_shared<mock_connector>();
+	auto dc = std::make_unique<tbp::data_collector>(L"instrument_1", settings, conn, ds);
+
+	// SB: stored candles start in the middle of the first hour
+	const auto start = tbp::time_t(std::chrono::hours(420000));
+	for (size_t i = 30; i < 120; ++i)
+	{
+		tbp::candlestick_data candle;
+		candle.timestamp = start + std::chrono::minutes(i);
+		candle.volume = 1;
+
+		ds->fine_candles[60].push_back(candle);
+	}
+
+	ds->start = tbp::time_t();
+	ds->end = tbp::time_t();
+
+	// ACT
+	auto actual_start = start;
+	auto actual_end = start + std::chrono::hours(1);
+	dc->get_candles(L"instrument_1", 3600, &actual_start, &actual_end);
+
+	// ASSERT
+	BOOST_ASSERT(1 == conn->data_request_log.size());
+	BOOST_ASSERT(start == conn->data_request_log[0].start);
+	BOOST_ASSERT(std::none_of(ds->candles.volume.begin(), ds->candles.volume.end(), [](__int64 volume) { return 30 == volume; }));
+}
+
+BOOST_FIXTURE_TEST_CASE(data_collector_requests_missing_ranges_only, common_fixture)
+{
+	// INIT
+	auto ds = std::make_shared<mock_data_storage>();
+	auto conn = std::make_shared<mock_connector>();
+	auto dc = std::make_unique<tbp::data_collector>(L"instrument_1", settings, conn, ds);
+
+	const auto start = tbp::time_t(std::chrono::hours(420000));
+	const auto tick = tbp::time_t::duration(1);
+	ds->keep_coverage = true;
+	ds->coverage[60] = { { start + std::chrono::minutes(10), start + std::chrono::minutes(20) }, { start + std::chrono::minutes(30), start + std::chrono::minutes(40) } };
+
+	// ACT
+	auto actual_start = start;
+	auto actual_end = start + std::chrono::minutes(50);
+	dc->get_candles(L"instrument_1", 60, &actual_start, &actual_end);
+
+	// ASSERT
+	// SB: gaps are requested concurrently, so requests order isn't defined
+	std::map<tbp::time_t, tbp::time_t> requests;
+	for (const auto& info : conn->data_request_log)
+	{
+		requests[info.start] = info.end;
+	}
+
+	BOOST_ASSERT(3 == conn->data_request_log.size());
+	BOOST_ASSERT(start + std::chrono::minutes(10) - tick == requests.at(start));
+	BOOST_ASSERT(start + std::chrono::minutes(30) - tick == requests.at(start + std::chrono::minutes(20) + tick));
+	BOOST_ASSERT(start + std::chrono::minutes(50) == requests.at(start + std::chrono::minutes(40) + tick));
+	BOOST_ASSERT(3 == ds->candles.size());
+
+	// ACT
+	// SB: downloaded ranges are covered now, so nothing is requested
+	actual_start = start + std::chrono::minutes(5);
+	actual_end = start + std::chrono::minutes(45);
+	dc->get_data(L"instrument_1", 60, &actual_start, &actual_end);
+
+	// ASSERT
+	BOOST_ASSERT(3 == conn->data_request_log.size());
+}
+
+BOOST_FIXTURE_TEST_CASE(data_collector_resamples_covered_candles_only, common_fixture)
+{
+	// INIT
+	auto ds = std::make_shared<mock_data_storage>();
+	auto conn = std::make_shared<mock_connector>();
+	auto dc = std::make_unique<tbp::data_collector>(L"instrument_1", settings, conn, ds);
+
+	const auto start = tbp::time_t(std::chrono::hours(420000));
+	for (size_t i = 0; i < 180; ++i)
+	{
+		tbp::candlestick_data candle;
+		candle.timestamp = start + std::chrono::minutes(i);
+		candle.volume = 1;
+
+		ds->fine_candles[60].push_back(candle);
+	}
+
+	// SB: the second hour of stored candles isn't covered, so it may have gaps
+	ds->keep_coverage = true;
+	ds->coverage[60] = { { start, start + std::chrono::minutes(59) }, { start + std::chrono::hours(2), start + std::chrono::minutes(179) } };
+
+	// ACT
+	auto actual_start = start;
+	auto actual_end = start + std::chrono::hours(1);
+	dc->get_candles(L"instrument_1", 3600, &actual_start, &actual_end);
+
+	auto covered_start = start + std::chrono::hours(2);
+	auto covered_end = start + std::chrono::hours(2);
+	dc->get_candles(L"instrument_1", 3600, &covered_start, &covered_end);
+
+	// ASSERT
+	BOOST_ASSERT(1 == conn->data_request_log.size());
+	BOOST_ASSERT(start == conn->data_request_log[0].start);
+
+	BOOST_ASSERT(2 == ds->coverage[3600].size());
+	BOOST_ASSERT(start + std::chrono::hours(2) == ds->coverage[3600][1].start);
+	BOOST_ASSERT(60 == ds->candles.volume.back());
+}
+
+BOOST_FIXTURE_TEST_CASE(data_collector_find_gaps, common_fixture)
+{
+	// INIT
+	const auto start = tbp::time_t(std::chrono::hours(420000));
+	const auto tick = tbp::time_t::duration(1);
+	const std::vector<tbp::time_range> covered =
+	{
+		{ start - std::chrono::minutes(10), start + std::chrono::minutes(5) },
+		{ start + std::chrono::minutes(3), start + std::chrono::minutes(8) },
+		{ start + std::chrono::minutes(20), start + std::chrono::minutes(30) },
+	};
+
+	// ACT
+	const auto gaps = tbp::find_gaps(covered, start, start + std::chrono::minutes(40));
+	const auto inner_gaps = tbp::find_gaps(covered, start + std::chrono::minutes(21), start + std::chrono::minutes(29));
+	const auto no_coverage_gaps = tbp::find_gaps(std::vector<tbp::time_range>(), start, start);
+
+	// ASSERT
+	BOOST_ASSERT(2 == gaps.size());
+	BOOST_ASSERT(start + std::chrono::minutes(8) + tick == gaps[0].start);
+	BOOST_ASSERT(start + std::chrono::minutes(20) - tick == gaps[0].end);
+	BOOST_ASSERT(start + std::chrono::minutes(30) + tick == gaps[1].start);
+	BOOST_ASSERT(start + std::chrono::minutes(40) == gaps[1].end);
+	BOOST_ASSERT(inner_gaps.empty());
+	BOOST_ASSERT(1 == no_coverage_gaps.size());
+	BOOST_ASSERT(start == no_coverage_gaps[0].start && start == no_coverage_gaps[0].end);
+}
+
 BOOST_FIXTURE_TEST_CASE(data_collector_get_instant_data, common_fixture)
 {
 	// INIT
@@ -231,7 +538,7 @@ BOOST_FIXTURE_TEST_CASE(data_collector_on_instant_data_signal, common_fixture)
 	BOOST_ASSERT(L"instrument_1" == signal_instrument_id);
 }
 
-BOOST_FIXTURE_TEST_CASE(data_collector_on_historical_data_signal, common_fixture)
+BOOST_FIXTURE_TEST_CASE(data_collector_on_historical_candles_signal, common_fixture)
 {
 	// INIT
 	const auto granularity = std::chrono::seconds(tbp::get_value<int>(settings, L"DataGranulatiry"));
@@ -245,7 +552,7 @@ BOOST_FIXTURE_TEST_CASE(data_collector_on_historical_data_signal, common_fixture
 	// ACT
 	size_t signal_called_count = 0;
 	std::wstring signal_instrument_id;
-	dc->on_historical_data.connect([&](const std::wstring& instrument_id, const std::vector<tbp::data_t::ptr>& data)
+	dc->on_historical_candles.connect([&](const std::wstring& instrument_id, const tbp::candle_series& data)
 	{
 		++signal_called_count;
 		signal_instrument_id = instrument_id;
@@ -261,8 +568,8 @@ BOOST_FIXTURE_TEST_CASE(data_collector_on_historical_data_signal, common_fixture
 	BOOST_ASSERT(signal_called_count != 0);
 	BOOST_ASSERT(L"instrument_1" == signal_instrument_id);
 	BOOST_ASSERT(conn->data_request_log.size() != 0);
-	BOOST_ASSERT(ds->values.size() != 0);
-	BOOST_ASSERT(ds->values.size() == conn->data_request_log.size());
+	BOOST_ASSERT(ds->candles.size() != 0);
+	BOOST_ASSERT(ds->candles.size() == conn->data_request_log.size());
 
 	tbp::time_t prev_start = conn->data_request_log[0].start - granularity;
 	for (const auto& info : conn->data_request_log)
@@ -0,0 +1,126 @@
+#include <boost/test/unit_test.hpp>
+
+#include <core/data_transfer.h>
+
+#include <mock/mock_data_storage.h>
+
+#include <test_helpers/base_fixture.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+	struct common_fixture : test_helpers::base_fixture
+	{
+		const std::wstring instrument_id = L"instrument1";
+		const unsigned long granularity = 60;
+
+		bool is_equal(const tbp::candle_series& lhs, const tbp::candle_series& rhs)
+		{
+			return lhs.timestamp == rhs.timestamp && lhs.volume == rhs.volume && lhs.complete == rhs.complete &&
+				lhs.bid.open == rhs.bid.open && lhs.bid.high == rhs.bid.high && lhs.bid.low == rhs.bid.low && lhs.bid.close == rhs.bid.close &&
+				lhs.ask.open == rhs.ask.open && lhs.ask.high == rhs.ask.high && lhs.ask.low == rhs.ask.low && lhs.ask.close == rhs.ask.close;
+		}
+
+	public:
+		common_fixture()
+			: base_fixture(L"data_transfer")
+		{
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(data_transfer_roundtrip, common_fixture)
+{
+	for (const auto format : { tbp::transfer_format::csv, tbp::transfer_format::binary })
+	{
+		// INIT
+		mock_data_storage source;
+		source.save_candles(instrument_id, granularity, generate_candles(granularity, 1000, 0));
+
+		mock_data_storage destination;
+		std::stringstream data;
+
+		// ACT
+		const auto exported = tbp::export_candles(source, instrument_id, granularity, source.candles.timestamp.front(), source.candles.timestamp.back(), format, data, 300);
+		const auto imported = tbp::import_candles(data, format, destination, instrument_id, granularity, 300);
+
+		// ASSERT
+		// SB: prices should be bit exact
+		BOOST_ASSERT(1000 == exported);
+		BOOST_ASSERT(1000 == imported);
+		BOOST_ASSERT(is_equal(destination.candles, source.candles));
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(data_transfer_import_csv_chunks, common_fixture)
+{
+	// INIT
+	// SB: lines of the first chunk are out of order, optional complete flag is missing
+	std::stringstream data;
+	data << "timestamp,volume,bid_open,bid_high,bid_low,bid_close,ask_open,ask_high,ask_low,ask_close\n";
+	data << "1500000060,1,1.1,1.2,1.0,1.15,1.1001,1.2001,1.0001,1.1501\r\n";
+	data << "1500000000,0,1.1,1.2,1.0,1.15,1.1001,1.2001,1.0001,1.1501\r\n";
+	data << "1500000120,2,1.1,1.2,1.0,1.15,1.1001,1.2001,1.0001,1.1501,0\r\n";
+
+	mock_data_storage storage;
+
+	// ACT
+	const auto imported = tbp::import_candles(data, tbp::transfer_format::csv, storage, instrument_id, granularity, 3);
+
+	// ASSERT
+	BOOST_ASSERT(3 == imported);
+	BOOST_ASSERT(2 == storage.batches.size());
+	BOOST_ASSERT(std::vector<__int64>({ 0, 1, 2 }) == storage.candles.volume);
+	BOOST_ASSERT(std::vector<tbp::byte_t>({ 1, 1, 0 }) == storage.candles.complete);
+	BOOST_ASSERT(tbp::time_t(std::chrono::seconds(1500000000)) == storage.candles.timestamp.front());
+	BOOST_ASSERT(1.1501 == storage.candles.ask.close.back());
+}
+
+BOOST_FIXTURE_TEST_CASE(data_transfer_import_adds_coverage, common_fixture)
+{
+	// INIT
+	// SB: the last candle is incomplete, so it isn't covered
+	mock_data_storage source;
+	source.save_candles(instrument_id, granularity, generate_candles(granularity, 1000, 0));
+	source.candles.complete.back() = 0;
+
+	mock_data_storage destination;
+	std::stringstream data;
+	tbp::export_candles(source, instrument_id, granularity, source.candles.timestamp.front(), source.candles.timestamp.back(), tbp::transfer_format::binary, data, 300);
+
+	// ACT
+	tbp::import_candles(data, tbp::transfer_format::binary, destination, instrument_id, granularity, 300);
+
+	// ASSERT
+	BOOST_ASSERT(4 == destination.batches.size());
+	BOOST_ASSERT(4 == destination.coverage.size());
+	for (size_t i = 0; i < destination.coverage.size(); ++i)
+	{
+		BOOST_ASSERT(i == destination.coverage[i].first);
+		BOOST_ASSERT(source.candles.timestamp[i * 300] == destination.coverage[i].second.start);
+	}
+
+	BOOST_ASSERT(source.candles.timestamp[299] == destination.coverage[0].second.end);
+	BOOST_ASSERT(source.candles.timestamp[998] == destination.coverage[3].second.end);
+}
+
+BOOST_FIXTURE_TEST_CASE(data_transfer_invalid_input, common_fixture)
+{
+	// INIT
+	mock_data_storage storage;
+	std::stringstream csv("1500000000,0,1.1,1.2,1.0\n");
+
+	std::stringstream binary;
+	tbp::export_candles(storage, instrument_id, granularity, tbp::time_t(), tbp::time_t(), tbp::transfer_format::binary, binary);
+	binary << "tr";
+
+	// ACT
+	// ASSERT
+	BOOST_ASSERT_EXCEPT(tbp::import_candles(csv, tbp::transfer_format::csv, storage, instrument_id, granularity), std::runtime_error);
+	BOOST_ASSERT_EXCEPT(tbp::import_candles(binary, tbp::transfer_format::binary, storage, instrument_id, granularity), std::runtime_error);
+	BOOST_ASSERT_EXCEPT(tbp::import_candles(csv, tbp::transfer_format::csv, storage, instrument_id, 0), std::invalid_argument);
+	BOOST_ASSERT_EXCEPT(tbp::export_candles(storage, instrument_id, 0, tbp::time_t(), tbp::time_t(), tbp::transfer_format::csv, binary), std::invalid_argument);
+	BOOST_ASSERT(storage.candles.empty());
+}
\ No newline at end of file
@@ -0,0 +1,463 @@
+#include <boost/test/unit_test.hpp>
+
+#include <core/kernels.h>
+#include <core/analysis.h>
+
+#include <test_helpers/base_fixture.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	// SB: SIMD results should match the scalar reference with relative tolerance (absolute for values less than 1)
+	template<typename T>
+	struct tolerance;
+
+	template<>
+	struct tolerance<double>
+	{
+		static double value() { return 1e-9; }
+	};
+
+	template<>
+	struct tolerance<float>
+	{
+		static double value() { return 1e-4; }
+	};
+
+	struct common_fixture : test_helpers::base_fixture
+	{
+		const std::vector<unsigned long> lengths{ 1, 2, 3, 7, 14, 26, 200 };
+		const std::vector<size_t> sizes{ 0, 1, 5, 17, 1000, 5003 };
+
+	public:
+		template<typename T>
+		struct market_data
+		{
+			std::vector<T> high;
+			std::vector<T> low;
+			std::vector<T> close;
+		};
+
+		// SB: random walk around typical FX price
+		template<typename T>
+		static market_data<T> generate(size_t count)
+		{
+			std::mt19937 generator(42);
+			std::normal_distribution<double> step(0.0, 0.0005);
+			std::uniform_real_distribution<double> spread(0.0, 0.001);
+
+			market_data<T> result;
+			double price = 1.1;
+			for (size_t i = 0; i < count; ++i)
+			{
+				price += step(generator);
+				result.close.push_back(static_cast<T>(price));
+				result.high.push_back(static_cast<T>(price + spread(generator)));
+				result.low.push_back(static_cast<T>(price - spread(generator)));
+			}
+
+			return result;
+		}
+
+		template<typename T>
+		static bool is_close(const std::vector<T>& actual, const std::vector<T>& expected)
+		{
+			if (actual.size() != expected.size())
+			{
+				return false;
+			}
+
+			for (size_t i = 0; i < actual.size(); ++i)
+			{
+				const double scale = std::max(1.0, std::abs(static_cast<double>(expected[i])));
+				if (std::abs(static_cast<double>(actual[i]) - expected[i]) > tolerance<T>::value() * scale)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// SB: calls 'func' for each supported instruction set except scalar one
+		static void for_each_simd_isa(const std::function<void()>& func)
+		{
+			const auto current = tbp::kernels::current_isa();
+			for (auto isa : { tbp::kernels::isa::sse2, tbp::kernels::isa::avx2 })
+			{
+				if (static_cast<int>(isa) > static_cast<int>(tbp::kernels::supported_isa()))
+				{
+					continue;
+				}
+
+				tbp::kernels::set_isa(isa);
+				func();
+			}
+
+			tbp::kernels::set_isa(current);
+		}
+
+		template<typename T>
+		static std::vector<T> run(const std::function<void(std::vector<T>*)>& kernel, size_t count)
+		{
+			std::vector<T> result(count, T(-1));
+			kernel(&result);
+
+			return result;
+		}
+
+		// SB: compares output of the kernel for each SIMD instruction set with the scalar reference
+		template<typename T>
+		bool matches_reference(const std::function<void(std::vector<T>*)>& kernel, size_t count)
+		{
+			const auto current = tbp::kernels::current_isa();
+			tbp::kernels::set_isa(tbp::kernels::isa::scalar);
+			const auto expected = run<T>(kernel, count);
+			tbp::kernels::set_isa(current);
+
+			bool result = true;
+			for_each_simd_isa([&]()
+			{
+				result = result && is_close(run<T>(kernel, count), expected);
+			});
+
+			return result;
+		}
+
+		template<typename T>
+		void check_all_kernels()
+		{
+			for (auto count : sizes)
+			{
+				const auto data = generate<T>(count);
+				const T* values = data.close.data();
+				for (auto length : lengths)
+				{
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out) { tbp::kernels::sma(values, count, length, out->data()); }, count));
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out) { tbp::kernels::ema(values, count, length, out->data()); }, count));
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out) { tbp::kernels::wma(values, count, length, out->data()); }, count));
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out) { tbp::kernels::rolling_stddev(values, count, length, out->data()); }, count));
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out) { tbp::kernels::rsi(values, count, length, out->data()); }, count));
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out) { tbp::kernels::atr(data.high.data(), data.low.data(), values, count, length, out->data()); }, count));
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out) { tbp::kernels::rolling_min(values, count, length, out->data()); }, count));
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out) { tbp::kernels::rolling_max(values, count, length, out->data()); }, count));
+
+					// SB: all three Bollinger bands are checked as one output
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out)
+					{
+						out->resize(3 * count);
+						tbp::kernels::bollinger(values, count, length, T(2), out->data(), out->data() + count, out->data() + 2 * count);
+					}, count));
+
+					BOOST_ASSERT(matches_reference<T>([&](std::vector<T>* out)
+					{
+						out->resize(3 * count);
+						tbp::kernels::macd(values, count, length, length + 13, 9, out->data(), out->data() + count, out->data() + 2 * count);
+					}, count));
+				}
+			}
+		}
+
+	public:
+		common_fixture()
+			: base_fixture(L"kernels")
+		{
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(kernels_match_scalar_reference_double, common_fixture)
+{
+	// ACT / ASSERT
+	check_all_kernels<double>();
+}
+
+BOOST_FIXTURE_TEST_CASE(kernels_match_scalar_reference_float, common_fixture)
+{
+	// ACT / ASSERT
+	check_all_kernels<float>();
+}
+
+BOOST_FIXTURE_TEST_CASE(kernels_reference_values, common_fixture)
+{
+	// INIT
+	const std::vector<double> prices{ 5.3, 6.7, 7.9, 7.1, 5.2, 4.1, 3.5, 5.4 };
+	std::vector<double> ema;
+	tbp::analysis::calculate_ema(prices, &ema, 4);
+
+	// ACT
+	std::vector<double> sma_values(prices.size());
+	std::vector<double> ema_values(prices.size());
+	std::vector<double> wma_values(prices.size());
+	std::vector<double> min_values(prices.size());
+	std::vector<double> max_values(prices.size());
+	tbp::kernels::sma(prices.data(), prices.size(), 3, sma_values.data());
+	tbp::kernels::ema(prices.data(), prices.size(), 4, ema_values.data());
+	tbp::kernels::wma(prices.data(), prices.size(), 3, wma_values.data());
+	tbp::kernels::rolling_min(prices.data(), prices.size(), 3, min_values.data());
+	tbp::kernels::rolling_max(prices.data(), prices.size(), 3, max_values.data());
+
+	// ASSERT
+	BOOST_ASSERT(is_close(sma_values, std::vector<double>{ 0.0, 0.0, (5.3 + 6.7 + 7.9) / 3, (6.7 + 7.9 + 7.1) / 3, (7.9 + 7.1 + 5.2) / 3, (7.1 + 5.2 + 4.1) / 3, (5.2 + 4.1 + 3.5) / 3, (4.1 + 3.5 + 5.4) / 3 }));
+	BOOST_ASSERT(is_close(ema_values, ema));
+	BOOST_ASSERT(is_close(wma_values, std::vector<double>{ 0.0, 0.0, (5.3 + 2 * 6.7 + 3 * 7.9) / 6, (6.7 + 2 * 7.9 + 3 * 7.1) / 6, (7.9 + 2 * 7.1 + 3 * 5.2) / 6, (7.1 + 2 * 5.2 + 3 * 4.1) / 6, (5.2 + 2 * 4.1 + 3 * 3.5) / 6, (4.1 + 2 * 3.5 + 3 * 5.4) / 6 }));
+	BOOST_ASSERT((min_values == std::vector<double>{ 0.0, 0.0, 5.3, 6.7, 5.2, 4.1, 3.5, 3.5 }));
+	BOOST_ASSERT((max_values == std::vector<double>{ 0.0, 0.0, 7.9, 7.9, 7.9, 7.1, 5.2, 5.4 }));
+}
+
+BOOST_FIXTURE_TEST_CASE(kernels_invalid_length, common_fixture)
+{
+	// INIT
+	const auto data = generate<double>(10);
+	std::vector<double> out(data.close.size());
+	std::vector<double> out2(data.close.size());
+	std::vector<double> out3(data.close.size());
+
+	// ACT / ASSERT
+	BOOST_ASSERT_EXCEPT(tbp::kernels::sma(data.close.data(), data.close.size(), 0, out.data()), std::runtime_error);
+	BOOST_ASSERT_EXCEPT(tbp::kernels::rsi(data.close.data(), data.close.size(), 0, out.data()), std::runtime_error);
+	BOOST_ASSERT_EXCEPT(tbp::kernels::macd(data.close.data(), data.close.size(), 26, 12, 9, out.data(), out2.data(), out3.data()), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(ema_sweep_matches_ema, common_fixture)
+{
+	// INIT
+	std::vector<unsigned long> sweep_lengths;
+	for (unsigned long length = 1; length <= 50; ++length)
+	{
+		sweep_lengths.push_back(length);
+	}
+
+	// SB: unsorted lengths and the group which is not full
+	sweep_lengths.push_back(200);
+	sweep_lengths.push_back(3);
+	sweep_lengths.push_back(9);
+
+	for (auto count : sizes)
+	{
+		const auto data = generate<double>(count);
+		const auto float_data = generate<float>(count);
+
+		std::vector<double> expected(count * sweep_lengths.size());
+		std::vector<float> float_expected(count * sweep_lengths.size());
+		for (size_t j = 0; j < sweep_lengths.size(); ++j)
+		{
+			tbp::kernels::ema(data.close.data(), count, sweep_lengths[j], expected.data() + j * count);
+			tbp::kernels::ema(float_data.close.data(), count, sweep_lengths[j], float_expected.data() + j * count);
+		}
+
+		for (auto isa : { tbp::kernels::isa::scalar, tbp::kernels::isa::sse2, tbp::kernels::isa::avx2 })
+		{
+			if (static_cast<int>(isa) > static_cast<int>(tbp::kernels::supported_isa()))
+			{
+				continue;
+			}
+
+			// ACT
+			const auto current = tbp::kernels::current_isa();
+			tbp::kernels::set_isa(isa);
+
+			std::vector<double> sweep(count * sweep_lengths.size(), -1.0);
+			std::vector<float> float_sweep(count * sweep_lengths.size(), -1.0f);
+			tbp::kernels::ema_sweep(data.close.data(), count, sweep_lengths.data(), sweep_lengths.size(), sweep.data());
+			tbp::kernels::ema_sweep(float_data.close.data(), count, sweep_lengths.data(), sweep_lengths.size(), float_sweep.data());
+
+			tbp::kernels::set_isa(current);
+
+			// ASSERT
+			BOOST_ASSERT(is_close(sweep, expected));
+			BOOST_ASSERT(is_close(float_sweep, float_expected));
+		}
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(ema_sweep_invalid_length, common_fixture)
+{
+	// INIT
+	const auto data = generate<double>(10);
+	const std::vector<unsigned long> sweep_lengths{ 9, 0, 26 };
+	std::vector<double> out(data.close.size() * sweep_lengths.size());
+
+	// ACT / ASSERT
+	BOOST_ASSERT_EXCEPT(tbp::kernels::ema_sweep(data.close.data(), data.close.size(), sweep_lengths.data(), sweep_lengths.size(), out.data()), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(segment_extremums_match_reference, common_fixture)
+{
+	for (auto count : sizes)
+	{
+		// INIT
+		const auto data = generate<double>(count);
+		const auto float_data = generate<float>(count);
+
+		// SB: segments of different sizes, including ones shorter than SIMD register
+		std::vector<size_t> offsets{ 0 };
+		for (size_t size = 1; offsets.back() + size <= count; size = size % 37 + 1)
+		{
+			offsets.push_back(offsets.back() + size);
+		}
+
+		const size_t segments_count = offsets.size() - 1;
+
+		// ACT / ASSERT
+		BOOST_ASSERT(matches_reference<double>([&](std::vector<double>* out) { tbp::kernels::segment_min(data.low.data(), offsets.data(), segments_count, out->data()); }, segments_count));
+		BOOST_ASSERT(matches_reference<double>([&](std::vector<double>* out) { tbp::kernels::segment_max(data.high.data(), offsets.data(), segments_count, out->data()); }, segments_count));
+		BOOST_ASSERT(matches_reference<float>([&](std::vector<float>* out) { tbp::kernels::segment_min(float_data.low.data(), offsets.data(), segments_count, out->data()); }, segments_count));
+		BOOST_ASSERT(matches_reference<float>([&](std::vector<float>* out) { tbp::kernels::segment_max(float_data.high.data(), offsets.data(), segments_count, out->data()); }, segments_count));
+
+		std::vector<double> result(segments_count);
+		tbp::kernels::segment_max(data.high.data(), offsets.data(), segments_count, result.data());
+		for (size_t s = 0; s < segments_count; ++s)
+		{
+			BOOST_ASSERT(*std::max_element(data.high.begin() + offsets[s], data.high.begin() + offsets[s + 1]) == result[s]);
+		}
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(segment_extremums_empty_segment, common_fixture)
+{
+	// INIT
+	const auto data = generate<double>(10);
+	const std::vector<size_t> offsets{ 0, 4, 4, 10 };
+	std::vector<double> out(offsets.size() - 1);
+
+	// ACT / ASSERT
+	BOOST_ASSERT_EXCEPT(tbp::kernels::segment_min(data.low.data(), offsets.data(), out.size(), out.data()), std::runtime_error);
+}
+
+/////////////////////////////////////////////////////////////////////
+// SB: benchmarks are disabled by default, run with --run_test=kernels_benchmark --log_level=message
+
+BOOST_AUTO_TEST_SUITE(kernels_benchmark, *boost::unit_test::disabled())
+
+BOOST_FIXTURE_TEST_CASE(kernels_throughput, common_fixture)
+{
+	// SB: data fits to L2 cache, so the benchmark measures computation, not memory bandwidth
+	const size_t count = 32 * 1024;
+	const unsigned long length = 26;
+	const auto data = generate<double>(count);
+	const auto float_data = generate<float>(count);
+	const double* values = data.close.data();
+	const float* float_values = float_data.close.data();
+	std::vector<double> out(3 * count);
+	std::vector<float> float_out(3 * count);
+
+	const std::vector<std::pair<std::wstring, std::function<void()>>> kernels
+	{
+		{ L"sma", [&]() { tbp::kernels::sma(values, count, length, out.data()); } },
+		{ L"sma<float>", [&]() { tbp::kernels::sma(float_values, count, length, float_out.data()); } },
+		{ L"ema", [&]() { tbp::kernels::ema(values, count, length, out.data()); } },
+		{ L"wma", [&]() { tbp::kernels::wma(values, count, length, out.data()); } },
+		{ L"wma<float>", [&]() { tbp::kernels::wma(float_values, count, length, float_out.data()); } },
+		{ L"rolling_stddev", [&]() { tbp::kernels::rolling_stddev(values, count, length, out.data()); } },
+		{ L"rolling_stddev<float>", [&]() { tbp::kernels::rolling_stddev(float_values, count, length, float_out.data()); } },
+		{ L"bollinger", [&]() { tbp::kernels::bollinger(values, count, length, 2.0, out.data(), out.data() + count, out.data() + 2 * count); } },
+		{ L"rsi", [&]() { tbp::kernels::rsi(values, count, length, out.data()); } },
+		{ L"atr", [&]() { tbp::kernels::atr(data.high.data(), data.low.data(), values, count, length, out.data()); } },
+		{ L"macd", [&]() { tbp::kernels::macd(values, count, 12, 26, 9, out.data(), out.data() + count, out.data() + 2 * count); } },
+		{ L"rolling_min", [&]() { tbp::kernels::rolling_min(values, count, length, out.data()); } },
+		{ L"rolling_max", [&]() { tbp::kernels::rolling_max(values, count, length, out.data()); } },
+		{ L"rolling_max<float>", [&]() { tbp::kernels::rolling_max(float_values, count, length, float_out.data()); } }
+	};
+
+	const auto current = tbp::kernels::current_isa();
+	for (auto isa : { tbp::kernels::isa::scalar, tbp::kernels::isa::sse2, tbp::kernels::isa::avx2 })
+	{
+		if (static_cast<int>(isa) > static_cast<int>(tbp::kernels::supported_isa()))
+		{
+			continue;
+		}
+
+		tbp::kernels::set_isa(isa);
+		for (const auto& kernel : kernels)
+		{
+			const size_t iterations = 200;
+			kernel.second();
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				kernel.second();
+			}
+
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+			const double throughput = static_cast<double>(count * iterations) / elapsed;
+
+			std::wostringstream message;
+			message << tbp::kernels::isa_name(isa) << L" " << kernel.first << L": " << throughput << L" values/ns";
+			const auto text = message.str();
+			BOOST_TEST_MESSAGE(std::string(text.begin(), text.end()));
+		}
+	}
+
+	tbp::kernels::set_isa(current);
+}
+
+// SB: 50 x 50 fast/slow grid needs EMA for 100 lengths: one sweep vs EMA for each length
+BOOST_FIXTURE_TEST_CASE(ema_sweep_throughput, common_fixture)
+{
+	const size_t count = 64 * 1024;
+	const auto data = generate<double>(count);
+	const double* values = data.close.data();
+	std::vector<unsigned long> sweep_lengths;
+	for (unsigned long length = 2; length < 102; ++length)
+	{
+		sweep_lengths.push_back(length);
+	}
+
+	std::vector<double> out(count * sweep_lengths.size());
+
+	const std::vector<std::pair<std::wstring, std::function<void()>>> kernels
+	{
+		{ L"ema per length", [&]()
+			{
+				for (size_t j = 0; j < sweep_lengths.size(); ++j)
+				{
+					tbp::kernels::ema(values, count, sweep_lengths[j], out.data() + j * count);
+				}
+			}
+		},
+		{ L"ema_sweep", [&]() { tbp::kernels::ema_sweep(values, count, sweep_lengths.data(), sweep_lengths.size(), out.data()); } }
+	};
+
+	const auto current = tbp::kernels::current_isa();
+	for (auto isa : { tbp::kernels::isa::scalar, tbp::kernels::isa::sse2, tbp::kernels::isa::avx2 })
+	{
+		if (static_cast<int>(isa) > static_cast<int>(tbp::kernels::supported_isa()))
+		{
+			continue;
+		}
+
+		tbp::kernels::set_isa(isa);
+		for (const auto& kernel : kernels)
+		{
+			const size_t iterations = 5;
+			kernel.second();
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				kernel.second();
+			}
+
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+			const double throughput = static_cast<double>(count * sweep_lengths.size() * iterations) / elapsed;
+
+			std::wostringstream message;
+			message << tbp::kernels::isa_name(isa) << L" " << kernel.first << L": " << throughput << L" values/ns";
+			const auto text = message.str();
+			BOOST_TEST_MESSAGE(std::string(text.begin(), text.end()));
+		}
+	}
+
+	tbp::kernels::set_isa(current);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
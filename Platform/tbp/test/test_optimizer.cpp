@@ -0,0 +1,280 @@
+#include <boost/test/unit_test.hpp>
+
+#include <core/optimizer.h>
+
+#include <test_helpers/base_fixture.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <set>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+	struct value_printer : boost::static_visitor<void>
+	{
+		std::wostream& stream;
+
+	public:
+		template<typename T>
+		void operator()(const T& val) const
+		{
+			stream << val;
+		}
+
+		void operator()(const tbp::empty_value&) const
+		{
+		}
+
+	public:
+		value_printer(std::wostream& s)
+			: stream(s)
+		{
+		}
+	};
+
+	struct common_fixture : test_helpers::base_fixture
+	{
+		const tbp::settings::ptr settings = tbp::settings::load_from_json(LR"({ "WorkingInstrument": "EUR_USD", "DataGranularity": 60, "TradeFrame": 3600 })");
+
+	public:
+		std::shared_ptr<const tbp::candle_series> generate_candles(size_t count)
+		{
+			auto result = std::make_shared<tbp::candle_series>();
+			result->reserve(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				const double price = 1.1 + 0.01 * std::sin(i / 20.0) + 0.003 * std::sin(i / 7.0);
+
+				tbp::candlestick_data candle;
+				candle.timestamp = tbp::time_t(std::chrono::minutes(i));
+				candle.bid.open = candle.bid.high = candle.bid.low = candle.bid.close = price;
+				candle.ask.open = candle.ask.high = candle.ask.low = candle.ask.close = price + 0.0002;
+
+				result->push_back(candle);
+			}
+
+			return result;
+		}
+
+		tbp::backtest::parameters get_parameters()
+		{
+			tbp::backtest::parameters params;
+			params.instrument = L"EUR_USD";
+
+			return params;
+		}
+
+		std::vector<tbp::optimizer::parameter> get_grid()
+		{
+			return
+			{
+				tbp::optimizer::make_range(L"FastEMA", 3, 12, 3),
+				tbp::optimizer::make_range(L"SlowEMA", 20, 30, 5),
+				tbp::optimizer::make_range(L"RiskDivisor", 2.0, 4.0, 2.0)
+			};
+		}
+
+		static tbp::strategy::ptr create_strategy(const tbp::data_provider::ptr& dp, const tbp::connector::ptr& c, const tbp::trader::ptr& t, const tbp::settings::ptr& s)
+		{
+			return tbp::create_ema_strategy(dp, c, t, s);
+		}
+
+		static std::wstring to_key(const tbp::optimizer::trial_result& result)
+		{
+			std::wostringstream key;
+			for (const auto& p : result.parameters)
+			{
+				key << p.first << L"=";
+				boost::apply_visitor(value_printer(key), p.second);
+				key << L";";
+			}
+
+			return key.str();
+		}
+
+	public:
+		common_fixture()
+			: base_fixture(L"optimizer")
+		{
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(make_range_values, common_fixture)
+{
+	// ACT
+	const auto int_range = tbp::optimizer::make_range(L"FastEMA", 5, 15, 5);
+	const auto double_range = tbp::optimizer::make_range(L"ThresholdFactor", 0.1, 0.5, 0.1);
+
+	// ASSERT
+	BOOST_ASSERT(L"FastEMA" == int_range.name);
+	BOOST_ASSERT(3 == int_range.values.size());
+	BOOST_ASSERT(15 == boost::get<int>(int_range.values.back()));
+	BOOST_ASSERT(5 == double_range.values.size());
+	BOOST_ASSERT(std::abs(0.5 - boost::get<double>(double_range.values.back())) < 1e-12);
+	BOOST_ASSERT_EXCEPT(tbp::optimizer::make_range(L"FastEMA", 5, 1, 1), std::invalid_argument);
+	BOOST_ASSERT_EXCEPT(tbp::optimizer::make_range(L"ThresholdFactor", 0.1, 0.5, 0.0), std::invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE(grid_search_ranks_all_combinations, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(3000);
+	tbp::optimizer::options opts;
+	opts.threads_count = 4;
+
+	// ACT
+	const auto results = tbp::optimizer::run(candles, get_parameters(), settings, get_grid(), opts, &common_fixture::create_strategy);
+
+	// ASSERT
+	BOOST_ASSERT(4 * 3 * 2 == results.size());
+
+	std::set<std::wstring> keys;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		BOOST_ASSERT(results[i].error.empty());
+		BOOST_ASSERT(3 == results[i].parameters.size());
+		BOOST_ASSERT(0 == i || results[i - 1].score >= results[i].score);
+		keys.insert(to_key(results[i]));
+	}
+
+	BOOST_ASSERT(results.size() == keys.size());
+
+	// SB: the best trial is the same as single backtest with its settings
+	const auto& best = results.front();
+	std::wostringstream best_settings;
+	best_settings << LR"({ "WorkingInstrument": "EUR_USD", "DataGranularity": 60, "TradeFrame": 3600, "FastEMA": )" << boost::get<int>(best.parameters[0].second)
+		<< LR"(, "SlowEMA": )" << boost::get<int>(best.parameters[1].second) << LR"(, "RiskDivisor": )" << boost::get<double>(best.parameters[2].second) << L"}";
+
+	const auto s = tbp::settings::load_from_json(best_settings.str());
+	const auto expected = tbp::backtest::run(*candles, get_parameters(), [&](const tbp::data_provider::ptr& dp, const tbp::connector::ptr& c, const tbp::trader::ptr& t)
+	{
+		return tbp::create_ema_strategy(dp, c, t, s);
+	});
+
+	BOOST_ASSERT(best.fills_count > 0);
+	BOOST_ASSERT(best.score == best.profit);
+	BOOST_ASSERT(expected.fills.size() == best.fills_count);
+	BOOST_ASSERT(expected.final_balance - 10000.0 == best.profit);
+}
+
+BOOST_FIXTURE_TEST_CASE(results_do_not_depend_on_threads_count, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(2000);
+	tbp::optimizer::options single_thread;
+	single_thread.threads_count = 1;
+	single_thread.target = tbp::optimizer::objective::profit_to_drawdown;
+
+	auto multi_thread = single_thread;
+	multi_thread.threads_count = 7;
+
+	// ACT
+	const auto expected = tbp::optimizer::run(candles, get_parameters(), settings, get_grid(), single_thread, &common_fixture::create_strategy);
+	const auto results = tbp::optimizer::run(candles, get_parameters(), settings, get_grid(), multi_thread, &common_fixture::create_strategy);
+
+	// ASSERT
+	BOOST_ASSERT(expected.size() == results.size());
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		BOOST_ASSERT(to_key(expected[i]) == to_key(results[i]));
+		BOOST_ASSERT(expected[i].score == results[i].score);
+		BOOST_ASSERT(expected[i].max_drawdown == results[i].max_drawdown);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(random_search_selects_distinct_trials, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(500);
+	tbp::optimizer::options opts;
+	opts.mode = tbp::optimizer::search_mode::random;
+	opts.random_trials = 10;
+	opts.random_seed = 42;
+
+	// ACT
+	const auto results = tbp::optimizer::run(candles, get_parameters(), settings, get_grid(), opts, &common_fixture::create_strategy);
+	const auto same_seed_results = tbp::optimizer::run(candles, get_parameters(), settings, get_grid(), opts, &common_fixture::create_strategy);
+
+	opts.random_trials = 1000;
+	const auto whole_grid = tbp::optimizer::run(candles, get_parameters(), settings, get_grid(), opts, &common_fixture::create_strategy);
+
+	// ASSERT
+	std::set<std::wstring> keys;
+	std::set<std::wstring> same_seed_keys;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		keys.insert(to_key(results[i]));
+		same_seed_keys.insert(to_key(same_seed_results[i]));
+	}
+
+	BOOST_ASSERT(10 == results.size());
+	BOOST_ASSERT(10 == keys.size());
+	BOOST_ASSERT(keys == same_seed_keys);
+	BOOST_ASSERT(24 == whole_grid.size());
+}
+
+BOOST_FIXTURE_TEST_CASE(failed_trials_are_ranked_last, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(500);
+	const std::vector<tbp::optimizer::parameter> parameters
+	{
+		{ L"FastEMA", { tbp::setting_value(0), tbp::setting_value(5), tbp::setting_value(9) } }
+	};
+
+	// ACT
+	const auto results = tbp::optimizer::run(candles, get_parameters(), settings, parameters, tbp::optimizer::options(), &common_fixture::create_strategy);
+	const auto table = tbp::optimizer::format_results(results, 10);
+
+	// ASSERT
+	BOOST_ASSERT(3 == results.size());
+	BOOST_ASSERT(results[0].error.empty());
+	BOOST_ASSERT(results[1].error.empty());
+	BOOST_ASSERT(!results[2].error.empty());
+	BOOST_ASSERT(0 == boost::get<int>(results[2].parameters.front().second));
+	BOOST_ASSERT(std::wstring::npos != table.find(L"FastEMA"));
+	BOOST_ASSERT(std::wstring::npos != table.find(L"failed"));
+}
+
+/////////////////////////////////////////////////////////////////////
+// SB: benchmarks are disabled by default, run with --run_test=optimizer_benchmark --log_level=message
+
+BOOST_AUTO_TEST_SUITE(optimizer_benchmark, *boost::unit_test::disabled())
+
+// SB: 20 x 20 grid over a month of M1 candles with growing number of threads
+BOOST_FIXTURE_TEST_CASE(optimizer_scaling, common_fixture)
+{
+	const auto candles = generate_candles(30 * 24 * 60);
+	const std::vector<tbp::optimizer::parameter> parameters
+	{
+		tbp::optimizer::make_range(L"FastEMA", 2, 21, 1),
+		tbp::optimizer::make_range(L"SlowEMA", 22, 60, 2)
+	};
+
+	double single_thread_time = 0.0;
+	for (size_t threads_count = 1; threads_count <= std::thread::hardware_concurrency(); threads_count *= 2)
+	{
+		tbp::optimizer::options opts;
+		opts.threads_count = threads_count;
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		const auto results = tbp::optimizer::run(candles, get_parameters(), settings, parameters, opts, &common_fixture::create_strategy);
+		const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - start).count();
+
+		if (1 == threads_count)
+		{
+			single_thread_time = elapsed;
+		}
+
+		std::ostringstream message;
+		message << threads_count << " threads: " << results.size() << " trials, " << elapsed << " s, speedup " << single_thread_time / elapsed;
+
+		BOOST_TEST_MESSAGE(message.str());
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include <boost/test/unit_test.hpp>
+
+#include <core/primitives.h>
+#include <core/fixed_price.h>
+
+#include <test_helpers/base_fixture.h>
+
+namespace
+{
+	struct common_fixture : test_helpers::base_fixture
+	{
+		const tbp::field_id timestamp_field = L"TIMESTAMP";
+		const tbp::field_id volume_field = L"VOLUME";
+		const tbp::field_id price_field = L"PRICE";
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(field_id_is_interned, common_fixture)
+{
+	// ACT
+	const tbp::field_id from_literal = L"VOLUME";
+	const tbp::field_id from_string = std::wstring(L"VOLUME");
+
+	// ASSERT
+	BOOST_ASSERT(from_literal == volume_field);
+	BOOST_ASSERT(from_string == volume_field);
+	BOOST_ASSERT(from_string.id() == volume_field.id());
+	BOOST_ASSERT(volume_field != timestamp_field);
+	BOOST_ASSERT(L"VOLUME" == volume_field.name());
+}
+
+BOOST_FIXTURE_TEST_CASE(data_access_by_field_id, common_fixture)
+{
+	// INIT
+	tbp::data_t record;
+
+	// ACT
+	record[volume_field] = __int64(10);
+	record.emplace(timestamp_field, tbp::time_t());
+	record.insert({ price_field, 1.5 });
+
+	// ASSERT
+	BOOST_ASSERT(3 == record.size());
+	BOOST_ASSERT(10 == tbp::get<__int64>(record.at(volume_field)));
+	BOOST_ASSERT(1.5 == tbp::get<double>(record.at(L"PRICE")));
+	BOOST_ASSERT(record.end() != record.find(timestamp_field));
+	BOOST_ASSERT(record.end() == record.find(L"UNKNOWN"));
+	BOOST_ASSERT(0 == record.count(L"UNKNOWN"));
+	BOOST_ASSERT_EXCEPT(record.at(L"UNKNOWN"), std::out_of_range);
+}
+
+BOOST_FIXTURE_TEST_CASE(data_behaves_like_map, common_fixture)
+{
+	// INIT
+	tbp::data_t record({ { volume_field, tbp::value_t(__int64(1)) }, { price_field, tbp::value_t(1.0) } });
+
+	// ACT
+	const auto emplace_result = record.emplace(volume_field, __int64(2));
+	record[price_field] = 2.0;
+	const auto erased = record.erase(volume_field);
+
+	// ASSERT
+	BOOST_ASSERT(!emplace_result.second);
+	BOOST_ASSERT(1 == erased);
+	BOOST_ASSERT(0 == record.erase(volume_field));
+	BOOST_ASSERT(1 == record.size());
+	BOOST_ASSERT(2.0 == tbp::get<double>(record.at(price_field)));
+}
+
+BOOST_FIXTURE_TEST_CASE(data_equality_does_not_depend_on_insertion_order, common_fixture)
+{
+	// INIT
+	tbp::data_t nested;
+	nested[price_field] = 1.5;
+
+	tbp::data_t lhs;
+	lhs[volume_field] = __int64(1);
+	lhs[price_field] = nested;
+
+	tbp::data_t rhs;
+	rhs[price_field] = nested;
+	rhs[volume_field] = __int64(1);
+
+	// ACT
+	const bool equal = lhs == rhs;
+	rhs[volume_field] = __int64(2);
+
+	// ASSERT
+	BOOST_ASSERT(equal);
+	BOOST_ASSERT(lhs != rhs);
+}
+
+BOOST_FIXTURE_TEST_CASE(data_with_string_keys, common_fixture)
+{
+	// INIT
+	tbp::data_t params;
+	params[L"units"] = 100.0;
+	params[std::wstring(L"instrument")] = std::wstring(L"EUR_USD");
+
+	// ACT
+	std::vector<std::wstring> names;
+	for (const auto& field : params)
+	{
+		names.push_back(field.first.name());
+	}
+
+	// ASSERT
+	BOOST_ASSERT(2 == names.size());
+	BOOST_ASSERT(names.end() != std::find(names.begin(), names.end(), L"units"));
+	BOOST_ASSERT(names.end() != std::find(names.begin(), names.end(), L"instrument"));
+	BOOST_ASSERT(L"EUR_USD" == tbp::get<std::wstring>(params.at(L"instrument")));
+}
+
+BOOST_FIXTURE_TEST_CASE(parse_fixed_price, common_fixture)
+{
+	// ACT & ASSERT
+	BOOST_ASSERT(110234 == tbp::parse_fixed(L"1.10234", 5));
+	BOOST_ASSERT(110230 == tbp::parse_fixed(L"1.1023", 5));
+	BOOST_ASSERT(110234 == tbp::parse_fixed(L"1.102344", 5));
+	BOOST_ASSERT(110235 == tbp::parse_fixed(L"1.102345", 5));
+	BOOST_ASSERT(-110235 == tbp::parse_fixed(L"-1.102345", 5));
+	BOOST_ASSERT(12345 == tbp::parse_fixed(L"123.45", 2));
+	BOOST_ASSERT(12300 == tbp::parse_fixed(L"123", 2));
+	BOOST_ASSERT(50 == tbp::parse_fixed(L".5", 2));
+	BOOST_ASSERT_EXCEPT(tbp::parse_fixed(L"", 5), std::invalid_argument);
+	BOOST_ASSERT_EXCEPT(tbp::parse_fixed(L"1.1a", 5), std::invalid_argument);
+	BOOST_ASSERT_EXCEPT(tbp::parse_fixed(L"-", 5), std::invalid_argument);
+	BOOST_ASSERT_EXCEPT(tbp::parse_fixed(L"1.1", 16), std::out_of_range);
+	BOOST_ASSERT_EXCEPT(tbp::parse_fixed(L"100000000000", 10), std::out_of_range);
+	BOOST_ASSERT_EXCEPT(tbp::parse_fixed(L"9223372036854775808", 0), std::out_of_range);
+	BOOST_ASSERT_EXCEPT(tbp::parse_fixed(L"9223372036854775809", 0), std::out_of_range);
+	BOOST_ASSERT(9223372036854775807LL == tbp::parse_fixed(L"9223372036854775807", 0));
+}
+
+BOOST_FIXTURE_TEST_CASE(fixed_price_conversion, common_fixture)
+{
+	// INIT
+	tbp::candle_series candles;
+	for (size_t i = 0; i < 10; ++i)
+	{
+		tbp::candlestick_data candle;
+		candle.timestamp = tbp::time_t(std::chrono::minutes(i));
+		candle.volume = i;
+		candle.bid.open = candle.bid.high = candle.bid.low = candle.bid.close = 1.1 + i * 0.00001;
+		candle.ask.open = candle.ask.high = candle.ask.low = candle.ask.close = 1.1002 + i * 0.00001;
+
+		candles.push_back(candle);
+	}
+
+	// ACT
+	const auto fixed_candles = tbp::to_fixed(candles, 5);
+	const auto restored = tbp::to_double(fixed_candles, 5);
+
+	// ASSERT
+	BOOST_ASSERT(110234 == tbp::to_fixed(1.10234, 5));
+	BOOST_ASSERT(1.10234 == tbp::to_double(110234, 5));
+	BOOST_ASSERT(candles.size() == fixed_candles.size());
+	BOOST_ASSERT(candles.timestamp == fixed_candles.timestamp);
+	BOOST_ASSERT(110009 == fixed_candles.bid.close[9]);
+	BOOST_ASSERT(110029 == fixed_candles.ask.open[9]);
+
+	for (size_t i = 0; i < candles.size(); ++i)
+	{
+		BOOST_ASSERT(tbp::parse_fixed(std::to_wstring(candles.bid.close[i]), 5) == fixed_candles.bid.close[i]);
+		BOOST_ASSERT(std::abs(candles.ask.close[i] - restored.ask.close[i]) < 1e-12);
+	}
+}
\ No newline at end of file
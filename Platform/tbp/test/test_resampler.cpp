@@ -0,0 +1,138 @@
+#include <boost/test/unit_test.hpp>
+
+#include <core/resampler.h>
+
+#include <test_helpers/base_fixture.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	struct common_fixture : test_helpers::base_fixture
+	{
+		// SB: M1 candles starting at the beginning of an hour. Prices are different for each candle to check extremums
+		tbp::candle_series generate_candles(size_t count)
+		{
+			tbp::candle_series result;
+			const auto start = tbp::time_t(std::chrono::hours(420000));
+			for (size_t i = 0; i < count; ++i)
+			{
+				const double price = 1.1 + 0.001 * std::sin(i / 3.0);
+
+				tbp::candlestick_data candle;
+				candle.timestamp = start + std::chrono::minutes(i);
+				candle.volume = i + 1;
+				candle.bid.open = price;
+				candle.bid.high = price + 0.0005 + 0.0001 * (i % 7);
+				candle.bid.low = price - 0.0005 - 0.0001 * (i % 5);
+				candle.bid.close = price + 0.0001;
+				candle.ask.open = candle.bid.open + 0.0002;
+				candle.ask.high = candle.bid.high + 0.0002;
+				candle.ask.low = candle.bid.low + 0.0002;
+				candle.ask.close = candle.bid.close + 0.0002;
+
+				result.push_back(candle);
+			}
+
+			return result;
+		}
+
+	public:
+		common_fixture()
+			: base_fixture(L"resampler")
+		{
+		}
+	};
+}
+
+BOOST_FIXTURE_TEST_CASE(resample_granularities, common_fixture)
+{
+	// ACT / ASSERT
+	BOOST_ASSERT(tbp::resampler::can_resample(5, 60));
+	BOOST_ASSERT(tbp::resampler::can_resample(60, 3600));
+	BOOST_ASSERT(tbp::resampler::can_resample(60, 43200));
+	BOOST_ASSERT(!tbp::resampler::can_resample(60, 60));
+	BOOST_ASSERT(!tbp::resampler::can_resample(3600, 60));
+	BOOST_ASSERT(!tbp::resampler::can_resample(300, 600 + 60));
+	BOOST_ASSERT(!tbp::resampler::can_resample(60, 86400));
+	BOOST_ASSERT(!tbp::resampler::can_resample(0, 60));
+	BOOST_ASSERT_EXCEPT(tbp::resampler::resample(generate_candles(10), 60, 86400), std::invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE(resample_ohlc_and_volume, common_fixture)
+{
+	// INIT
+	const auto candles = generate_candles(3 * 60);
+
+	// ACT
+	const auto result = tbp::resampler::resample(candles, 60, 3600);
+
+	// ASSERT
+	BOOST_ASSERT(3 == result.size());
+	for (size_t i = 0; i < result.size(); ++i)
+	{
+		const size_t first = i * 60;
+		const size_t last = first + 60;
+
+		BOOST_ASSERT(candles.timestamp[first] == result.timestamp[i]);
+		BOOST_ASSERT(0 != result.complete[i]);
+		BOOST_ASSERT(candles.bid.open[first] == result.bid.open[i]);
+		BOOST_ASSERT(candles.ask.open[first] == result.ask.open[i]);
+		BOOST_ASSERT(candles.bid.close[last - 1] == result.bid.close[i]);
+		BOOST_ASSERT(candles.ask.close[last - 1] == result.ask.close[i]);
+		BOOST_ASSERT(*std::max_element(candles.bid.high.begin() + first, candles.bid.high.begin() + last) == result.bid.high[i]);
+		BOOST_ASSERT(*std::max_element(candles.ask.high.begin() + first, candles.ask.high.begin() + last) == result.ask.high[i]);
+		BOOST_ASSERT(*std::min_element(candles.bid.low.begin() + first, candles.bid.low.begin() + last) == result.bid.low[i]);
+		BOOST_ASSERT(*std::min_element(candles.ask.low.begin() + first, candles.ask.low.begin() + last) == result.ask.low[i]);
+
+		__int64 volume = 0;
+		for (size_t j = first; j < last; ++j)
+		{
+			volume += candles.volume[j];
+		}
+
+		BOOST_ASSERT(volume == result.volume[i]);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(resample_gaps_and_incomplete_candles, common_fixture)
+{
+	// INIT
+	const auto source = generate_candles(100);
+	tbp::candle_series candles;
+
+	// SB: no ticks during candles 10..29, the last source candle isn't complete
+	candles.append(source, 0, 10);
+	candles.append(source, 30, 70);
+	candles.complete.back() = 0;
+
+	// ACT
+	const auto result = tbp::resampler::resample(candles, 60, 300);
+	const auto partial_result = tbp::resampler::resample(generate_candles(12), 60, 300);
+
+	// ASSERT
+	BOOST_ASSERT(16 == result.size());
+	BOOST_ASSERT(source.timestamp[30] == result.timestamp[2]);
+	BOOST_ASSERT(source.bid.open[30] == result.bid.open[2]);
+	BOOST_ASSERT(source.volume[5] + source.volume[6] + source.volume[7] + source.volume[8] + source.volume[9] == result.volume[1]);
+	BOOST_ASSERT(std::all_of(result.complete.begin(), result.complete.end() - 1, [](tbp::byte_t c) { return 0 != c; }));
+	BOOST_ASSERT(0 == result.complete.back());
+
+	// SB: the last period isn't over yet
+	BOOST_ASSERT(3 == partial_result.size());
+	BOOST_ASSERT(0 != partial_result.complete[1]);
+	BOOST_ASSERT(0 == partial_result.complete[2]);
+}
+
+BOOST_FIXTURE_TEST_CASE(resample_unsorted_candles, common_fixture)
+{
+	// INIT
+	auto candles = generate_candles(10);
+	std::swap(candles.timestamp[3], candles.timestamp[4]);
+
+	// ACT / ASSERT
+	BOOST_ASSERT_EXCEPT(tbp::resampler::resample(candles, 60, 300), std::invalid_argument);
+	BOOST_ASSERT(tbp::resampler::resample(tbp::candle_series(), 60, 300).empty());
+}
\ No newline at end of file